@@ -0,0 +1,269 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lte-module.h"
+#include "ns3/flow-monitor-module.h"
+
+/*
+Packet and byte tag benchmark
+- "tags": the tag pattern of a packet crossing an LTE + EPC network
+  monitored by the FlowMonitor: a FlowIdTag and a SocketIpTosTag
+  packet tag and a byte tag are added, the packet is copied at
+  every hop (--hops), a PdcpTag is added and removed on each copy,
+  and the tags are read at the receiver. Prints the time per packet.
+- "lte": the lena-simple-epc scenario, one eNB and --ues UEs receiving
+  UDP downlink traffic from a remote host, with the FlowMonitor
+  installed on all the nodes. Prints the wall clock time, the
+  number of packets received and the packets per second.
+Build with -DPACKET_TAG_LIST_INLINE_SIZE=8 -DBYTE_TAG_LIST_INLINE_SIZE=4
+for a baseline where nearly all the tags are on the heap.
+
+./bench-packet-tags --mode=tags --packets=1000000 --hops=4
+./bench-packet-tags --mode=lte --ues=10 --time=5
+*/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BenchPacketTags");
+
+/**
+ * A byte tag of the size of the FlowMonitor Ipv4FlowProbeTag.
+ */
+class BenchByteTag : public Tag
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::BenchByteTag")
+      .SetParent<Tag> ()
+      .SetGroupName ("Network")
+      .AddConstructor<BenchByteTag> ()
+    ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 4 + 4 + 4 + 4 + 4;
+  }
+  virtual void Serialize (TagBuffer buf) const
+  {
+    buf.WriteU32 (m_flowId);
+    buf.WriteU32 (m_packetId);
+    buf.WriteU32 (m_packetSize);
+    buf.WriteU32 (0);
+    buf.WriteU32 (0);
+  }
+  virtual void Deserialize (TagBuffer buf)
+  {
+    m_flowId = buf.ReadU32 ();
+    m_packetId = buf.ReadU32 ();
+    m_packetSize = buf.ReadU32 ();
+    buf.ReadU32 ();
+    buf.ReadU32 ();
+  }
+  virtual void Print (std::ostream &os) const
+  {
+    os << "FlowId=" << m_flowId;
+  }
+  uint32_t m_flowId;     //!< flow identifier
+  uint32_t m_packetId;   //!< packet identifier
+  uint32_t m_packetSize; //!< packet size
+};
+
+/**
+ * Time the tag operations of a packet crossing a network.
+ * \param packets The number of packets.
+ * \param hops The number of copies of each packet.
+ * \param [out] sink Accumulates the tag values, so that they are not
+ *        optimized away.
+ * \returns The time per packet, in nanoseconds.
+ */
+static double
+MeasureTags (uint32_t packets, uint32_t hops, uint64_t &sink)
+{
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (1000);
+      p->AddPacketTag (FlowIdTag (i));
+      SocketIpTosTag tos;
+      tos.SetTos (0x10);
+      p->AddPacketTag (tos);
+      BenchByteTag probe;
+      probe.m_flowId = 1;
+      probe.m_packetId = i;
+      probe.m_packetSize = 1000;
+      p->AddByteTag (probe);
+      for (uint32_t h = 0; h < hops; h++)
+        {
+          Ptr<Packet> copy = p->Copy ();
+          PdcpTag pdcp (Simulator::Now ());
+          copy->AddPacketTag (pdcp);
+          copy->RemovePacketTag (pdcp);
+          p = copy;
+        }
+      FlowIdTag flowId;
+      p->PeekPacketTag (flowId);
+      p->FindFirstMatchingByteTag (probe);
+      sink += flowId.GetFlowId () + probe.m_packetId;
+    }
+  return clock.End () * 1e6 / packets;
+}
+
+/**
+ * Run the LTE scenario.
+ * \param ues The number of UEs.
+ * \param simTime The simulated time.
+ */
+static void
+RunLte (uint32_t ues, Time simTime)
+{
+  Ptr<LteHelper> lteHelper = CreateObject<LteHelper> ();
+  Ptr<PointToPointEpcHelper> epcHelper = CreateObject<PointToPointEpcHelper> ();
+  lteHelper->SetEpcHelper (epcHelper);
+  Ptr<Node> pgw = epcHelper->GetPgwNode ();
+
+  NodeContainer remoteHostContainer;
+  remoteHostContainer.Create (1);
+  Ptr<Node> remoteHost = remoteHostContainer.Get (0);
+  InternetStackHelper internet;
+  internet.Install (remoteHostContainer);
+
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
+  p2ph.SetDeviceAttribute ("Mtu", UintegerValue (1500));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (10)));
+  NetDeviceContainer internetDevices = p2ph.Install (pgw, remoteHost);
+  Ipv4AddressHelper ipv4h;
+  ipv4h.SetBase ("1.0.0.0", "255.0.0.0");
+  ipv4h.Assign (internetDevices);
+  Ipv4StaticRoutingHelper ipv4RoutingHelper;
+  Ptr<Ipv4StaticRouting> remoteHostStaticRouting =
+    ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
+  remoteHostStaticRouting->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
+
+  NodeContainer enbNodes;
+  NodeContainer ueNodes;
+  enbNodes.Create (1);
+  ueNodes.Create (ues);
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "DeltaX", DoubleValue (10.0),
+                                 "GridWidth", UintegerValue (10));
+  mobility.Install (enbNodes);
+  mobility.Install (ueNodes);
+
+  NetDeviceContainer enbDevices = lteHelper->InstallEnbDevice (enbNodes);
+  NetDeviceContainer ueDevices = lteHelper->InstallUeDevice (ueNodes);
+  internet.Install (ueNodes);
+  Ipv4InterfaceContainer ueInterfaces = epcHelper->AssignUeIpv4Address (ueDevices);
+  for (uint32_t u = 0; u < ueNodes.GetN (); u++)
+    {
+      Ptr<Ipv4StaticRouting> ueStaticRouting =
+        ipv4RoutingHelper.GetStaticRouting (ueNodes.Get (u)->GetObject<Ipv4> ());
+      ueStaticRouting->SetDefaultRoute (epcHelper->GetUeDefaultGatewayAddress (), 1);
+    }
+  lteHelper->Attach (ueDevices, enbDevices.Get (0));
+
+  uint16_t port = 1234;
+  ApplicationContainer serverApps;
+  ApplicationContainer clientApps;
+  for (uint32_t u = 0; u < ueNodes.GetN (); u++)
+    {
+      UdpServerHelper server (port);
+      serverApps.Add (server.Install (ueNodes.Get (u)));
+      UdpClientHelper client (ueInterfaces.GetAddress (u), port);
+      client.SetAttribute ("Interval", TimeValue (MicroSeconds (500)));
+      client.SetAttribute ("MaxPackets", UintegerValue (1000000));
+      client.SetAttribute ("PacketSize", UintegerValue (1000));
+      clientApps.Add (client.Install (remoteHost));
+    }
+  serverApps.Start (MilliSeconds (100));
+  clientApps.Start (MilliSeconds (100));
+
+  FlowMonitorHelper flowmon;
+  Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
+
+  Simulator::Stop (simTime);
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  int64_t elapsed = clock.End ();
+
+  monitor->CheckForLostPackets ();
+  uint64_t received = 0;
+  FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats ();
+  for (FlowMonitor::FlowStatsContainer::const_iterator i = stats.begin (); i != stats.end (); ++i)
+    {
+      received += i->second.rxPackets;
+    }
+  std::cout << "ues " << ues
+            << " wall " << elapsed << " ms"
+            << " rx " << received << " packets"
+            << " " << std::fixed << std::setprecision (0)
+            << (elapsed > 0 ? received * 1000.0 / elapsed : 0.0) << " packets/s"
+            << std::endl;
+  Simulator::Destroy ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string mode = "tags";
+  uint32_t packets = 1000000;
+  uint32_t hops = 4;
+  uint32_t ues = 10;
+  double time = 5.0;
+
+  CommandLine cmd;
+  cmd.AddValue ("mode", "tags or lte", mode);
+  cmd.AddValue ("packets", "Number of packets in the tags mode", packets);
+  cmd.AddValue ("hops", "Number of copies of each packet in the tags mode", hops);
+  cmd.AddValue ("ues", "Number of UEs in the lte mode", ues);
+  cmd.AddValue ("time", "Simulated time in the lte mode, in seconds", time);
+  cmd.Parse (argc, argv);
+
+  if (mode == "lte")
+    {
+      RunLte (ues, Seconds (time));
+      return 0;
+    }
+
+  uint64_t sink = 0;
+  std::cout << "inline " << PACKET_TAG_LIST_INLINE_SIZE << "+" << BYTE_TAG_LIST_INLINE_SIZE
+            << " bytes, " << std::fixed << std::setprecision (1)
+            << MeasureTags (packets, hops, sink) << " ns/packet" << std::endl;
+  NS_LOG_INFO ("checksum " << sink);
+  return 0;
+}
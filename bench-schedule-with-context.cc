@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+/*
+Cross-context event injection benchmark
+- N foreign threads (like fd-net-device readers or tap-bridge) each
+  call Simulator::ScheduleWithContext() --events times, while the main
+  thread runs the simulation and executes the injected events.
+- A keep-alive event, rescheduled every microsecond of simulated time,
+  keeps the main loop polling until all the injected events have run.
+- Reports the injection rate (events per second of wall clock time,
+  from the first injection to the execution of the last event) for
+  each thread count.
+- --impl selects the simulator. Both queue the foreign events in a
+  lock-free MpscQueue; the MultithreadedSimulatorImpl drains it at the
+  barriers, the DefaultSimulatorImpl before each event. Each thread
+  injects into the context of its own node.
+
+./bench-schedule-with-context --threads=1,2,4,8 --events=1000000
+./bench-schedule-with-context --impl=ns3::MultithreadedSimulatorImpl
+*/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BenchScheduleWithContext");
+
+class Injector
+{
+public:
+  Injector (uint32_t context, uint32_t events);
+  /** Thread body: inject all the events. */
+  void Inject (void);
+
+private:
+  uint32_t m_context;
+  uint32_t m_events;
+};
+
+// Incremented by the worker threads of the MultithreadedSimulatorImpl
+static std::atomic<uint64_t> g_received (0);
+static uint64_t g_expected = 0;
+
+static void
+Receive (void)
+{
+  g_received++;
+}
+
+static void
+KeepAlive (void)
+{
+  if (g_received < g_expected)
+    {
+      Simulator::Schedule (MicroSeconds (1), &KeepAlive);
+    }
+}
+
+Injector::Injector (uint32_t context, uint32_t events)
+  : m_context (context),
+    m_events (events)
+{
+}
+
+void
+Injector::Inject (void)
+{
+  for (uint32_t i = 0; i < m_events; i++)
+    {
+      Simulator::ScheduleWithContext (m_context, Time (0), &Receive);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string threads = "1,2,4,8";
+  uint32_t events = 1000000;
+  std::string impl = "ns3::DefaultSimulatorImpl";
+
+  CommandLine cmd;
+  cmd.AddValue ("threads", "Comma separated list of injecting thread counts", threads);
+  cmd.AddValue ("events", "Number of events injected by each thread", events);
+  cmd.AddValue ("impl", "Simulator implementation type", impl);
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (impl));
+
+  std::cout << std::left << std::setw (10) << "threads"
+            << std::right << std::setw (14) << "events"
+            << std::setw (12) << "time (ms)"
+            << std::setw (16) << "events/s" << std::endl;
+
+  std::istringstream counts (threads);
+  std::string count;
+  while (std::getline (counts, count, ','))
+    {
+      uint32_t n;
+      std::istringstream (count) >> n;
+
+      g_received = 0;
+      g_expected = static_cast<uint64_t> (n) * events;
+      // The contexts of the injectors; Simulator::Destroy clears the NodeList.
+      NodeContainer nodes;
+      nodes.Create (n);
+      std::vector<Injector *> injectors;
+      std::vector<Ptr<SystemThread> > workers;
+      for (uint32_t i = 0; i < n; i++)
+        {
+          injectors.push_back (new Injector (nodes.Get (i)->GetId (), events));
+          workers.push_back (Create<SystemThread> (MakeCallback (&Injector::Inject, injectors[i])));
+        }
+      Simulator::Schedule (Time (0), &KeepAlive);
+
+      SystemWallClockMs time;
+      time.Start ();
+      for (uint32_t i = 0; i < n; i++)
+        {
+          workers[i]->Start ();
+        }
+      Simulator::Run ();
+      int64_t elapsed = time.End ();
+      for (uint32_t i = 0; i < n; i++)
+        {
+          workers[i]->Join ();
+          delete injectors[i];
+        }
+      Simulator::Destroy ();
+
+      uint64_t received = g_received.load ();
+      std::cout << std::left << std::setw (10) << n
+                << std::right << std::setw (14) << received
+                << std::setw (12) << elapsed
+                << std::setw (16) << std::fixed << std::setprecision (0)
+                << (elapsed > 0 ? received * 1000.0 / elapsed : 0) << std::endl;
+    }
+
+  return 0;
+}
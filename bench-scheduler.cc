@@ -0,0 +1,234 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "ns3/core-module.h"
+
+/*
+Scheduler benchmark
+- Keep a constant population of pending events ("hold" model):
+  every event, when it fires, schedules one new event.
+- The delays replay an event-time distribution typical of a packet
+  level network simulation, or a trace given with --file
+  (one delay in nanoseconds per line).
+    - 60% packet events: exponential, mean 10us (tx end, propagation, rx)
+    - 25% MAC timers: uniform [0, 1ms] (backoff, SIFS/DIFS, ACK timeout)
+    - 10% periodic events: constant 100ms (beacons, routing hellos)
+    -  5% long timers: uniform [200ms, 3s] (TCP RTO, application stop)
+- The same delays are replayed against every scheduler, selected
+  through the "SchedulerType" of the simulator.
+- The last column is the fraction of EventImpl allocations served by
+  the EventImplPool instead of malloc.
+
+./bench-scheduler --pop=1000000 --total=10000000
+*/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BenchScheduler");
+
+class Bench
+{
+public:
+  Bench (const std::vector<uint64_t> &delays, uint32_t population, uint32_t total);
+
+  /**
+   * Run the benchmark once with the current scheduler.
+   * \param [out] init Wall clock time (ms) to schedule the initial population.
+   * \param [out] run Wall clock time (ms) to run the simulation.
+   */
+  void RunBench (int64_t &init, int64_t &run);
+
+private:
+  void Cb (void);
+  uint64_t NextDelay (void);
+
+  const std::vector<uint64_t> &m_delays;
+  std::size_t m_next;
+  uint32_t m_population;
+  uint32_t m_total;
+  uint32_t m_count;
+};
+
+Bench::Bench (const std::vector<uint64_t> &delays, uint32_t population, uint32_t total)
+  : m_delays (delays),
+    m_next (0),
+    m_population (population),
+    m_total (total),
+    m_count (0)
+{
+}
+
+uint64_t
+Bench::NextDelay (void)
+{
+  uint64_t delay = m_delays[m_next];
+  m_next++;
+  if (m_next == m_delays.size ())
+    {
+      m_next = 0;
+    }
+  return delay;
+}
+
+void
+Bench::RunBench (int64_t &init, int64_t &run)
+{
+  SystemWallClockMs time;
+
+  time.Start ();
+  for (uint32_t i = 0; i < m_population; i++)
+    {
+      Simulator::Schedule (NanoSeconds (NextDelay ()), &Bench::Cb, this);
+    }
+  init = time.End ();
+
+  time.Start ();
+  Simulator::Run ();
+  run = time.End ();
+}
+
+void
+Bench::Cb (void)
+{
+  if (m_count >= m_total)
+    {
+      return;
+    }
+  m_count++;
+  Simulator::Schedule (NanoSeconds (NextDelay ()), &Bench::Cb, this);
+}
+
+static std::vector<uint64_t>
+GenerateDelays (uint32_t n)
+{
+  Ptr<UniformRandomVariable> mix = CreateObject<UniformRandomVariable> ();
+  Ptr<ExponentialRandomVariable> packet = CreateObject<ExponentialRandomVariable> ();
+  packet->SetAttribute ("Mean", DoubleValue (10000));
+  Ptr<UniformRandomVariable> timer = CreateObject<UniformRandomVariable> ();
+
+  std::vector<uint64_t> delays;
+  delays.reserve (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      double u = mix->GetValue ();
+      double delay;
+      if (u < 0.60)
+        {
+          delay = packet->GetValue ();
+        }
+      else if (u < 0.85)
+        {
+          delay = timer->GetValue (0, 1e6);
+        }
+      else if (u < 0.95)
+        {
+          delay = 1e8;
+        }
+      else
+        {
+          delay = timer->GetValue (2e8, 3e9);
+        }
+      delays.push_back (static_cast<uint64_t> (delay));
+    }
+  return delays;
+}
+
+static std::vector<uint64_t>
+ReadDelays (const std::string &filename)
+{
+  std::vector<uint64_t> delays;
+  std::ifstream is (filename.c_str ());
+  NS_ABORT_MSG_UNLESS (is.good (), "Cannot open " << filename);
+  uint64_t delay;
+  while (is >> delay)
+    {
+      delays.push_back (delay);
+    }
+  NS_ABORT_MSG_IF (delays.empty (), "No delay read from " << filename);
+  return delays;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t pop = 100000;
+  uint32_t total = 1000000;
+  uint32_t runs = 1;
+  std::string filename = "";
+  std::string schedulers = "ns3::ListScheduler,ns3::MapScheduler,ns3::HeapScheduler,"
+                           "ns3::CalendarScheduler,ns3::LadderScheduler";
+
+  CommandLine cmd;
+  cmd.AddValue ("pop", "Event population size", pop);
+  cmd.AddValue ("total", "Total number of events to run", total);
+  cmd.AddValue ("runs", "Number of runs per scheduler", runs);
+  cmd.AddValue ("file", "File of delays (ns), one per line, instead of the built-in distribution", filename);
+  cmd.AddValue ("schedulers", "Comma separated list of scheduler types", schedulers);
+  cmd.Parse (argc, argv);
+
+  std::vector<uint64_t> delays;
+  if (filename.empty ())
+    {
+      delays = GenerateDelays (pop + total);
+    }
+  else
+    {
+      delays = ReadDelays (filename);
+    }
+
+  std::cout << "population " << pop << ", total events " << total << std::endl;
+  std::cout << std::left << std::setw (26) << "scheduler"
+            << std::right << std::setw (12) << "init (ms)"
+            << std::setw (12) << "run (ms)"
+            << std::setw (14) << "ns/event"
+            << std::setw (14) << "pool reuse" << std::endl;
+
+  std::istringstream types (schedulers);
+  std::string type;
+  while (std::getline (types, type, ','))
+    {
+      for (uint32_t r = 0; r < runs; r++)
+        {
+          ObjectFactory factory;
+          factory.SetTypeId (type);
+          Simulator::SetScheduler (factory);
+
+          int64_t init;
+          int64_t run;
+          EventImplPool::ResetStats ();
+          Bench bench (delays, pop, total);
+          bench.RunBench (init, run);
+          Simulator::Destroy ();
+          EventImplPool::Stats stats = EventImplPool::GetStats ();
+
+          std::cout << std::left << std::setw (26) << type
+                    << std::right << std::setw (12) << init
+                    << std::setw (12) << run
+                    << std::setw (14) << std::fixed << std::setprecision (1)
+                    << (run * 1e6) / (pop + total)
+                    << std::setw (13) << (stats.reused * 100.0) / stats.allocations
+                    << "%" << std::endl;
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/spectrum-module.h"
+
+/*
+SpectrumValue arithmetic benchmark
+- Spectrum models of 100 bands (e.g. a 20 MHz Wi-Fi channel) and
+  1000 bands (e.g. a wideband LTE or mmWave carrier), or the
+  comma separated list given with --bands.
+- For every instruction set supported by the CPU, times the
+  SpectrumValueKernels which implement:
+    add      a += b           (SpectrumInterference::DoAddSignal)
+    muldiv   a *= b; a /= b   (propagation loss, spectral masks)
+    addsc    a.AddScaled (b, s), i.e. a += s * b without a temporary
+    sum      sum of the values (Sum, Integral: total power)
+    sop      SumOfProducts (a, b), i.e. Sum (a * b) without a temporary
+- As a reference, the last column times the same "a += s * b" with
+  the SpectrumValue operators, which allocate a temporary.
+- Times are in nanoseconds per operation.
+
+./bench-spectrum-value --bands=100,1000 --iterations=1000000
+*/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BenchSpectrumValue");
+
+/**
+ * Build a spectrum model of regularly spaced bands.
+ * \param bands The number of bands.
+ * \returns The spectrum model.
+ */
+static Ptr<SpectrumModel>
+MakeModel (uint32_t bands)
+{
+  std::vector<double> freqs;
+  for (uint32_t i = 0; i < bands; i++)
+    {
+      freqs.push_back (2.4e9 + i * 312.5e3);
+    }
+  return Create<SpectrumModel> (freqs);
+}
+
+/**
+ * Fill a SpectrumValue with arbitrary positive values.
+ * \param v The value.
+ * \param seed The first value.
+ */
+static void
+Fill (Ptr<SpectrumValue> v, double seed)
+{
+  double x = seed;
+  for (Values::iterator i = v->ValuesBegin (); i != v->ValuesEnd (); ++i)
+    {
+      *i = x;
+      x = x * 1.0001 + 1e-3;
+    }
+}
+
+/**
+ * Time one kernel.
+ * \param op The kernel: 0 add, 1 muldiv, 2 addsc, 3 sum, 4 sop, 5 operators.
+ * \param a The first operand, modified.
+ * \param b The second operand.
+ * \param iterations The number of operations.
+ * \param [out] sink Accumulates the results, so that they are not optimized away.
+ * \returns The time per operation, in nanoseconds.
+ */
+static double
+Measure (int op, Ptr<SpectrumValue> a, Ptr<const SpectrumValue> b, uint32_t iterations, double &sink)
+{
+  double *y = &(*a)[0];
+  const double *x = &(*b)[0];
+  std::size_t n = a->GetSpectrumModel ()->GetNumBands ();
+  // Small enough for the values not to overflow.
+  const double s = 1e-9;
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < iterations; i++)
+    {
+      switch (op)
+        {
+        case 0:
+          SpectrumValueKernels::Add (y, x, n);
+          break;
+        case 1:
+          SpectrumValueKernels::Multiply (y, x, n);
+          SpectrumValueKernels::Divide (y, x, n);
+          break;
+        case 2:
+          a->AddScaled (*b, s);
+          break;
+        case 3:
+          sink += SpectrumValueKernels::Sum (y, n);
+          break;
+        case 4:
+          sink += SumOfProducts (*a, *b);
+          break;
+        default:
+          *a += *b * s;
+          break;
+        }
+    }
+  int64_t elapsed = clock.End ();
+  sink += (*a)[0];
+  return elapsed * 1e6 / iterations;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string bands = "100,1000";
+  uint32_t iterations = 1000000;
+
+  CommandLine cmd;
+  cmd.AddValue ("bands", "Comma separated list of band counts", bands);
+  cmd.AddValue ("iterations", "Number of operations per measurement", iterations);
+  cmd.Parse (argc, argv);
+
+  const char *columns[] = { "add", "muldiv", "addsc", "sum", "sop", "operators" };
+  std::cout << std::left << std::setw (8) << "bands"
+            << std::setw (8) << "isa" << std::right;
+  for (uint32_t c = 0; c < 6; c++)
+    {
+      std::cout << std::setw (11) << columns[c];
+    }
+  std::cout << std::endl;
+
+  double sink = 0;
+  std::istringstream counts (bands);
+  std::string count;
+  while (std::getline (counts, count, ','))
+    {
+      uint32_t n;
+      std::istringstream (count) >> n;
+      Ptr<SpectrumModel> model = MakeModel (n);
+      Ptr<SpectrumValue> a = Create<SpectrumValue> (model);
+      Ptr<SpectrumValue> b = Create<SpectrumValue> (model);
+
+      for (int isa = SpectrumValueKernels::SCALAR; isa <= SpectrumValueKernels::AVX512; isa++)
+        {
+          SpectrumValueKernels::Isa kernels = static_cast<SpectrumValueKernels::Isa> (isa);
+          if (!SpectrumValueKernels::IsSupported (kernels))
+            {
+              continue;
+            }
+          SpectrumValueKernels::SetIsa (kernels);
+          std::cout << std::left << std::setw (8) << n
+                    << std::setw (8) << SpectrumValueKernels::GetName (kernels)
+                    << std::right << std::fixed << std::setprecision (1);
+          for (int op = 0; op < 6; op++)
+            {
+              Fill (a, 1.0);
+              Fill (b, 2.0);
+              std::cout << std::setw (11) << Measure (op, a, b, iterations, sink);
+            }
+          std::cout << std::endl;
+        }
+    }
+
+  NS_LOG_INFO ("checksum " << sink);
+  return 0;
+}
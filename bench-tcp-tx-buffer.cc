@@ -0,0 +1,251 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <list>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+/*
+TCP SACK scoreboard benchmark
+--segments segments of --size bytes are in flight, one in every
+--lossInterval is lost. The first half of the window is already SACKed
+and its losses detected; then --acks ACKs each SACK the next segment,
+and for each of them the sender, as TcpTxBuffer does:
+- finds the SACKed segment (Update);
+- marks lost the segments with DupThresh SACKed segments above them
+  (UpdateLostCount);
+- picks the first lost segment not retransmitted and retransmits it
+  (NextSeg, CopyFromSequence).
+- "list": the walks of the sent list, std::list<TcpTxItem*>;
+- "scoreboard": the same operations on a TcpTxScoreboard.
+Prints the time per ACK.
+
+./bench-tcp-tx-buffer --mode=scoreboard --segments=1000000 --acks=100000
+./bench-tcp-tx-buffer --mode=list --segments=1000000 --acks=100
+*/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BenchTcpTxBuffer");
+
+/**
+ * The sent list of the benchmark.
+ */
+typedef std::list<TcpTxItem*> PacketList;
+
+/// Duplicate ACK threshold.
+static const uint32_t DUP_THRESH = 3;
+
+/**
+ * Fill the sent list and SACK the first half of the window.
+ * \param segments The number of segments in flight.
+ * \param size The segment size.
+ * \param lossInterval One segment in lossInterval is lost.
+ * \param [out] list The sent list.
+ * \returns The number of the first segment not SACKed yet.
+ */
+static uint32_t
+Fill (uint32_t segments, uint32_t size, uint32_t lossInterval, PacketList &list)
+{
+  Ptr<Packet> p = Create<Packet> (size);
+  SequenceNumber32 seq (1);
+  uint32_t half = segments / 2;
+  for (uint32_t i = 0; i < segments; i++)
+    {
+      TcpTxItem *item = new TcpTxItem;
+      item->m_startSeq = seq;
+      item->m_packet = p;
+      bool lost = i % lossInterval == 0;
+      item->m_sacked = i < half && !lost;
+      item->m_lost = i + DUP_THRESH * lossInterval < half && lost;
+      list.push_back (item);
+      seq += size;
+    }
+  return half;
+}
+
+/**
+ * Time the ACKs with walks of the sent list.
+ * \param list The sent list.
+ * \param first The number of the first segment to SACK.
+ * \param acks The number of ACKs.
+ * \param size The segment size.
+ * \param lossInterval One segment in lossInterval is lost.
+ * \param [out] sink Accumulates the results, so that they are not
+ *        optimized away.
+ * \returns The time per ACK, in microseconds.
+ */
+static double
+MeasureList (PacketList &list, uint32_t first, uint32_t acks, uint32_t size,
+             uint32_t lossInterval, uint64_t &sink)
+{
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t a = 0, n = first; a < acks && n < list.size (); n++)
+    {
+      if (n % lossInterval == 0)
+        {
+          continue;
+        }
+      a++;
+      SequenceNumber32 sacked (1 + n * size);
+
+      // Update
+      PacketList::iterator highest = list.end ();
+      for (PacketList::iterator it = list.begin (); it != list.end (); ++it)
+        {
+          if ((*it)->m_startSeq == sacked)
+            {
+              (*it)->m_sacked = true;
+              highest = it;
+              break;
+            }
+        }
+
+      if (highest == list.end ())
+        {
+          continue;
+        }
+
+      // UpdateLostCount
+      uint32_t sackedAbove = 0;
+      for (PacketList::reverse_iterator it (++highest); it != list.rend (); ++it)
+        {
+          if ((*it)->m_sacked)
+            {
+              sackedAbove++;
+            }
+          else if (sackedAbove >= DUP_THRESH)
+            {
+              (*it)->m_lost = true;
+            }
+        }
+
+      // NextSeg
+      for (PacketList::iterator it = list.begin (); it != list.end (); ++it)
+        {
+          TcpTxItem *item = *it;
+          if (!item->m_sacked && !item->m_retrans && item->m_lost)
+            {
+              item->m_retrans = true;
+              sink += item->m_startSeq.GetValue ();
+              break;
+            }
+        }
+    }
+  return clock.End () * 1e3 / acks;
+}
+
+/**
+ * Time the ACKs with the scoreboard.
+ * \param list The sent list.
+ * \param first The number of the first segment to SACK.
+ * \param acks The number of ACKs.
+ * \param size The segment size.
+ * \param lossInterval One segment in lossInterval is lost.
+ * \param [out] sink Accumulates the results, so that they are not
+ *        optimized away.
+ * \returns The time per ACK, in microseconds.
+ */
+static double
+MeasureScoreboard (PacketList &list, uint32_t first, uint32_t acks, uint32_t size,
+                   uint32_t lossInterval, uint64_t &sink)
+{
+  TcpTxScoreboard scoreboard;
+  for (PacketList::iterator it = list.begin (); it != list.end (); ++it)
+    {
+      scoreboard.Insert (*it);
+    }
+  SequenceNumber32 head = list.front ()->m_startSeq;
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t a = 0, n = first; a < acks && n < list.size (); n++)
+    {
+      if (n % lossInterval == 0)
+        {
+          continue;
+        }
+      a++;
+
+      // Update
+      TcpTxItem *item = scoreboard.Find (SequenceNumber32 (1 + n * size));
+      item->m_sacked = true;
+      scoreboard.Refresh (item);
+
+      // UpdateLostCount
+      TcpTxItem *boundary = scoreboard.GetLostBoundary (DUP_THRESH, size);
+      if (boundary != 0)
+        {
+          for (item = scoreboard.FindFirst (TcpTxScoreboard::HOLE, head);
+               item != 0 && item->m_startSeq < boundary->m_startSeq;
+               item = scoreboard.FindFirst (TcpTxScoreboard::HOLE, item->m_startSeq))
+            {
+              item->m_lost = true;
+              scoreboard.Refresh (item);
+            }
+        }
+
+      // NextSeg
+      item = scoreboard.FindFirst (TcpTxScoreboard::LOST, head);
+      if (item != 0)
+        {
+          item->m_retrans = true;
+          scoreboard.Refresh (item);
+          sink += item->m_startSeq.GetValue ();
+        }
+    }
+  return clock.End () * 1e3 / acks;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string mode = "scoreboard";
+  uint32_t segments = 1000000;
+  uint32_t size = 1448;
+  uint32_t lossInterval = 100;
+  uint32_t acks = 100000;
+
+  CommandLine cmd;
+  cmd.AddValue ("mode", "list or scoreboard", mode);
+  cmd.AddValue ("segments", "Number of segments in flight", segments);
+  cmd.AddValue ("size", "Segment size", size);
+  cmd.AddValue ("lossInterval", "One segment in lossInterval is lost", lossInterval);
+  cmd.AddValue ("acks", "Number of ACKs timed", acks);
+  cmd.Parse (argc, argv);
+
+  PacketList list;
+  uint32_t first = Fill (segments, size, lossInterval, list);
+
+  uint64_t sink = 0;
+  double perAck = mode == "list"
+    ? MeasureList (list, first, acks, size, lossInterval, sink)
+    : MeasureScoreboard (list, first, acks, size, lossInterval, sink);
+  std::cout << mode << " " << segments << " segments, " << std::fixed
+            << std::setprecision (3) << perAck << " us/ack" << std::endl;
+  NS_LOG_INFO ("checksum " << sink);
+
+  for (PacketList::iterator it = list.begin (); it != list.end (); ++it)
+    {
+      delete *it;
+    }
+  return 0;
+}
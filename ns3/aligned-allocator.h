@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+ * \file
+ * \ingroup core
+ * ns3::AlignedAllocator declaration and template implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup core
+ * \brief A standard allocator which aligns its blocks.
+ *
+ * Use it for the containers whose storage is processed with vector
+ * instructions: a block aligned on a cache line never straddles two
+ * lines, and full-width vector loads and stores never split.
+ *
+ * \code
+ *   std::vector<double, AlignedAllocator<double, 64> > values;
+ * \endcode
+ *
+ * \tparam T \deduced The type of the elements.
+ * \tparam ALIGNMENT \explicit The alignment of the blocks, in bytes: a
+ * power of 2, multiple of sizeof (void *).
+ */
+template <typename T, std::size_t ALIGNMENT = 64>
+class AlignedAllocator
+{
+public:
+  typedef T value_type; //!< The type of the elements.
+
+  /** Rebind the allocator to another element type. */
+  template <typename U>
+  struct rebind
+  {
+    typedef AlignedAllocator<U, ALIGNMENT> other; //!< The rebound allocator.
+  };
+
+  /** Default constructor. */
+  AlignedAllocator ();
+  /**
+   * Converting constructor.
+   * \param [in] o The allocator of another element type.
+   */
+  template <typename U>
+  AlignedAllocator (const AlignedAllocator<U, ALIGNMENT> &o);
+
+  /**
+   * Allocate an aligned block.
+   * \param [in] n The number of elements.
+   * \returns The block.
+   */
+  T * allocate (std::size_t n);
+  /**
+   * Release a block obtained from allocate().
+   * \param [in] p The block.
+   * \param [in] n The number of elements.
+   */
+  void deallocate (T *p, std::size_t n);
+};
+
+/**
+ * All the AlignedAllocator instances are interchangeable.
+ * \returns \c true
+ */
+template <typename T, typename U, std::size_t ALIGNMENT>
+bool operator== (const AlignedAllocator<T, ALIGNMENT> &, const AlignedAllocator<U, ALIGNMENT> &);
+/**
+ * All the AlignedAllocator instances are interchangeable.
+ * \returns \c false
+ */
+template <typename T, typename U, std::size_t ALIGNMENT>
+bool operator!= (const AlignedAllocator<T, ALIGNMENT> &, const AlignedAllocator<U, ALIGNMENT> &);
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the templates declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+template <typename T, std::size_t ALIGNMENT>
+AlignedAllocator<T, ALIGNMENT>::AlignedAllocator ()
+{
+}
+
+template <typename T, std::size_t ALIGNMENT>
+template <typename U>
+AlignedAllocator<T, ALIGNMENT>::AlignedAllocator (const AlignedAllocator<U, ALIGNMENT> &)
+{
+}
+
+template <typename T, std::size_t ALIGNMENT>
+T *
+AlignedAllocator<T, ALIGNMENT>::allocate (std::size_t n)
+{
+  if (n == 0)
+    {
+      return 0;
+    }
+  if (n > static_cast<std::size_t> (-1) / sizeof (T))
+    {
+      throw std::bad_alloc ();
+    }
+  void *p = 0;
+  if (posix_memalign (&p, ALIGNMENT, n * sizeof (T)) != 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return static_cast<T *> (p);
+}
+
+template <typename T, std::size_t ALIGNMENT>
+void
+AlignedAllocator<T, ALIGNMENT>::deallocate (T *p, std::size_t)
+{
+  std::free (p);
+}
+
+template <typename T, typename U, std::size_t ALIGNMENT>
+bool
+operator== (const AlignedAllocator<T, ALIGNMENT> &, const AlignedAllocator<U, ALIGNMENT> &)
+{
+  return true;
+}
+
+template <typename T, typename U, std::size_t ALIGNMENT>
+bool
+operator!= (const AlignedAllocator<T, ALIGNMENT> &, const AlignedAllocator<U, ALIGNMENT> &)
+{
+  return false;
+}
+
+} // namespace ns3
+
+#endif /* ALIGNED_ALLOCATOR_H */
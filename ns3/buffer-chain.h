@@ -0,0 +1,545 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BUFFER_CHAIN_H
+#define BUFFER_CHAIN_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <ostream>
+#include <vector>
+#include <sys/uio.h>
+#include "ns3/assert.h"
+#include "buffer.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief A scatter-gather byte buffer: a sequence of Buffer segments.
+ *
+ * A Buffer is one contiguous array of bytes, so appending a Buffer to
+ * another one, as Packet::AddAtEnd does, copies the bytes of the
+ * second one. A BufferChain instead keeps a list of segments, each of
+ * them a Buffer which shares its storage, reference counted, with the
+ * Buffer it was taken from:
+ *  - AddAtEnd and AddAtStart append a segment;
+ *  - RemoveAtStart, RemoveAtEnd and CreateFragment drop whole segments
+ *    and trim the ones at the edges, without copying their bytes;
+ *  - Flatten copies the bytes into a single Buffer, once, only if there
+ *    is more than one segment; FillIovec describes the segments for
+ *    writev(2).
+ *
+ * This is meant for the byte streams which are repeatedly split and
+ * merged, such as the send buffer of a bulk TCP transfer, where every
+ * segment sent is a fragment of the application writes, and the
+ * reassembly of IP fragments. A Packet in scatter-gather mode keeps the
+ * bytes appended by AddAtEnd in one (see Packet::EnableScatterGather).
+ *
+ * The segments are read-only: they may share their bytes with other
+ * Buffers.
+ */
+class BufferChain
+{
+public:
+  /**
+   * \brief read-only iterator in a BufferChain instance
+   */
+  class Iterator
+  {
+public:
+    Iterator ();
+    /**
+     * \param delta number of bytes to go forward
+     */
+    void Next (uint32_t delta);
+    /**
+     * \return true if this iterator points to the end of the chain.
+     */
+    bool IsEnd (void) const;
+    /**
+     * \return the number of bytes left to read
+     */
+    uint32_t GetRemainingSize (void) const;
+    /**
+     * \return the byte read in the chain.
+     */
+    uint8_t ReadU8 (void);
+    /**
+     * \return the two bytes read in the chain, in network order.
+     */
+    uint16_t ReadNtohU16 (void);
+    /**
+     * \return the four bytes read in the chain, in network order.
+     */
+    uint32_t ReadNtohU32 (void);
+    /**
+     * \param buffer buffer to copy data into
+     * \param size number of bytes to copy
+     *
+     * Copy size bytes of data from the chain into the buffer,
+     * which may straddle several segments.
+     */
+    void Read (uint8_t *buffer, uint32_t size);
+
+private:
+    /// Friend class
+    friend class BufferChain;
+    /**
+     * \param chain the chain this iterator refers to
+     */
+    Iterator (BufferChain const *chain);
+    /**
+     * Skip the exhausted segments.
+     */
+    void Settle (void);
+
+    BufferChain const *m_chain;  //!< the chain
+    uint32_t m_segment;          //!< index of the current segment
+    uint32_t m_left;             //!< bytes left in the current segment
+    uint32_t m_remaining;        //!< bytes left in the chain
+    Buffer::Iterator m_current;  //!< position in the current segment
+  };
+
+  BufferChain ();
+  /**
+   * \param buffer the single segment of the chain
+   */
+  explicit BufferChain (const Buffer &buffer);
+
+  /**
+   * \return the number of bytes stored in this chain.
+   */
+  uint32_t GetSize (void) const;
+  /**
+   * \return the number of segments of this chain.
+   */
+  uint32_t GetNSegments (void) const;
+  /**
+   * \param i the index of the segment
+   * \return the segment
+   */
+  const Buffer & GetSegment (uint32_t i) const;
+
+  /**
+   * \param buffer the segment to append, shared with this chain
+   */
+  void AddAtEnd (const Buffer &buffer);
+  /**
+   * \param o the chain whose segments are appended to this chain
+   */
+  void AddAtEnd (const BufferChain &o);
+  /**
+   * \param buffer the segment to prepend, shared with this chain
+   */
+  void AddAtStart (const Buffer &buffer);
+  /**
+   * \param start size to remove
+   *
+   * Remove bytes at the start of the chain.
+   */
+  void RemoveAtStart (uint32_t start);
+  /**
+   * \param end size to remove
+   *
+   * Remove bytes at the end of the chain.
+   */
+  void RemoveAtEnd (uint32_t end);
+  /**
+   * \param start offset from start of chain
+   * \param length length of fragment to create
+   * \returns a fragment of this chain, sharing its segments
+   */
+  BufferChain CreateFragment (uint32_t start, uint32_t length) const;
+
+  /**
+   * \return an Iterator which points to the start of this chain.
+   */
+  Iterator Begin (void) const;
+
+  /**
+   * \return a Buffer with the bytes of this chain: the segment itself
+   * if there is a single one, a copy otherwise.
+   */
+  Buffer Flatten (void) const;
+  /**
+   * \param buffer points to a buffer to copy to
+   * \param size the size of the buffer
+   * \returns the number of bytes copied
+   */
+  uint32_t CopyData (uint8_t *buffer, uint32_t size) const;
+  /**
+   * \param os the output stream
+   * \param size the maximum number of bytes to write
+   */
+  void CopyData (std::ostream *os, uint32_t size) const;
+  /**
+   * Describe the segments for writev(2).
+   *
+   * \param iov the array to fill
+   * \param n the size of the array
+   * \returns the number of entries filled, at most n
+   */
+  uint32_t FillIovec (struct iovec *iov, uint32_t n) const;
+
+private:
+  /**
+   * \param offset offset from start of chain, smaller than the size
+   * \returns the index of the segment which holds the byte at offset
+   */
+  uint32_t FindSegment (uint32_t offset) const;
+  /**
+   * Recompute m_ends and m_size from the segments.
+   */
+  void UpdateEnds (void);
+
+  std::vector<Buffer> m_segments; //!< the segments
+  std::vector<uint32_t> m_ends;   //!< offset of the end of each segment
+  uint32_t m_size;                //!< the number of bytes in the chain
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+BufferChain::BufferChain ()
+  : m_size (0)
+{
+}
+
+inline
+BufferChain::BufferChain (const Buffer &buffer)
+  : m_size (0)
+{
+  AddAtEnd (buffer);
+}
+
+inline uint32_t
+BufferChain::GetSize (void) const
+{
+  return m_size;
+}
+
+inline uint32_t
+BufferChain::GetNSegments (void) const
+{
+  return m_segments.size ();
+}
+
+inline const Buffer &
+BufferChain::GetSegment (uint32_t i) const
+{
+  NS_ASSERT (i < m_segments.size ());
+  return m_segments[i];
+}
+
+inline void
+BufferChain::UpdateEnds (void)
+{
+  m_ends.resize (m_segments.size ());
+  uint32_t end = 0;
+  for (uint32_t i = 0; i < m_segments.size (); i++)
+    {
+      end += m_segments[i].GetSize ();
+      m_ends[i] = end;
+    }
+  m_size = end;
+}
+
+inline void
+BufferChain::AddAtEnd (const Buffer &buffer)
+{
+  if (buffer.GetSize () == 0)
+    {
+      return;
+    }
+  m_segments.push_back (buffer);
+  m_size += buffer.GetSize ();
+  m_ends.push_back (m_size);
+}
+
+inline void
+BufferChain::AddAtEnd (const BufferChain &o)
+{
+  // Copy first: o may be *this.
+  std::vector<Buffer> segments = o.m_segments;
+  for (uint32_t i = 0; i < segments.size (); i++)
+    {
+      AddAtEnd (segments[i]);
+    }
+}
+
+inline void
+BufferChain::AddAtStart (const Buffer &buffer)
+{
+  if (buffer.GetSize () == 0)
+    {
+      return;
+    }
+  m_segments.insert (m_segments.begin (), buffer);
+  UpdateEnds ();
+}
+
+inline uint32_t
+BufferChain::FindSegment (uint32_t offset) const
+{
+  NS_ASSERT (offset < m_size);
+  return std::upper_bound (m_ends.begin (), m_ends.end (), offset) - m_ends.begin ();
+}
+
+inline void
+BufferChain::RemoveAtStart (uint32_t start)
+{
+  if (start >= m_size)
+    {
+      m_segments.clear ();
+      m_ends.clear ();
+      m_size = 0;
+      return;
+    }
+  uint32_t first = FindSegment (start);
+  uint32_t skip = start - (first == 0 ? 0 : m_ends[first - 1]);
+  m_segments.erase (m_segments.begin (), m_segments.begin () + first);
+  m_segments.front ().RemoveAtStart (skip);
+  UpdateEnds ();
+}
+
+inline void
+BufferChain::RemoveAtEnd (uint32_t end)
+{
+  if (end >= m_size)
+    {
+      m_segments.clear ();
+      m_ends.clear ();
+      m_size = 0;
+      return;
+    }
+  uint32_t last = FindSegment (m_size - end - 1);
+  m_segments.resize (last + 1);
+  m_ends.resize (last + 1);
+  m_segments.back ().RemoveAtEnd (m_ends[last] - (m_size - end));
+  m_ends[last] = m_size - end;
+  m_size -= end;
+}
+
+inline BufferChain
+BufferChain::CreateFragment (uint32_t start, uint32_t length) const
+{
+  NS_ASSERT (start + length <= m_size);
+  BufferChain fragment;
+  if (length == 0)
+    {
+      return fragment;
+    }
+  uint32_t first = FindSegment (start);
+  uint32_t last = FindSegment (start + length - 1);
+  for (uint32_t i = first; i <= last; i++)
+    {
+      uint32_t segmentStart = i == 0 ? 0 : m_ends[i - 1];
+      uint32_t from = std::max (start, segmentStart) - segmentStart;
+      uint32_t to = std::min (start + length, m_ends[i]) - segmentStart;
+      if (from == 0 && to == m_segments[i].GetSize ())
+        {
+          fragment.AddAtEnd (m_segments[i]);
+        }
+      else
+        {
+          fragment.AddAtEnd (m_segments[i].CreateFragment (from, to - from));
+        }
+    }
+  return fragment;
+}
+
+inline BufferChain::Iterator
+BufferChain::Begin (void) const
+{
+  return Iterator (this);
+}
+
+inline Buffer
+BufferChain::Flatten (void) const
+{
+  if (m_segments.size () == 1)
+    {
+      return m_segments[0];
+    }
+  Buffer buffer;
+  buffer.AddAtStart (m_size);
+  Buffer::Iterator i = buffer.Begin ();
+  for (uint32_t j = 0; j < m_segments.size (); j++)
+    {
+      i.Write (m_segments[j].Begin (), m_segments[j].End ());
+    }
+  return buffer;
+}
+
+inline uint32_t
+BufferChain::CopyData (uint8_t *buffer, uint32_t size) const
+{
+  uint32_t copied = 0;
+  for (uint32_t i = 0; i < m_segments.size () && copied < size; i++)
+    {
+      copied += m_segments[i].CopyData (buffer + copied, size - copied);
+    }
+  return copied;
+}
+
+inline void
+BufferChain::CopyData (std::ostream *os, uint32_t size) const
+{
+  for (uint32_t i = 0; i < m_segments.size () && size > 0; i++)
+    {
+      uint32_t n = std::min (size, m_segments[i].GetSize ());
+      m_segments[i].CopyData (os, n);
+      size -= n;
+    }
+}
+
+inline uint32_t
+BufferChain::FillIovec (struct iovec *iov, uint32_t n) const
+{
+  uint32_t i = 0;
+  for (; i < n && i < m_segments.size (); i++)
+    {
+      // PeekData materializes the zero area of the segment, if any.
+      iov[i].iov_base = const_cast<uint8_t *> (m_segments[i].PeekData ());
+      iov[i].iov_len = m_segments[i].GetSize ();
+    }
+  return i;
+}
+
+inline
+BufferChain::Iterator::Iterator ()
+  : m_chain (0),
+    m_segment (0),
+    m_left (0),
+    m_remaining (0)
+{
+}
+
+inline
+BufferChain::Iterator::Iterator (BufferChain const *chain)
+  : m_chain (chain),
+    m_segment (0),
+    m_left (0),
+    m_remaining (chain->m_size)
+{
+  if (!chain->m_segments.empty ())
+    {
+      m_current = chain->m_segments[0].Begin ();
+      m_left = chain->m_segments[0].GetSize ();
+    }
+}
+
+inline void
+BufferChain::Iterator::Settle (void)
+{
+  while (m_left == 0 && m_remaining > 0)
+    {
+      m_segment++;
+      m_current = m_chain->m_segments[m_segment].Begin ();
+      m_left = m_chain->m_segments[m_segment].GetSize ();
+    }
+}
+
+inline bool
+BufferChain::Iterator::IsEnd (void) const
+{
+  return m_remaining == 0;
+}
+
+inline uint32_t
+BufferChain::Iterator::GetRemainingSize (void) const
+{
+  return m_remaining;
+}
+
+inline void
+BufferChain::Iterator::Next (uint32_t delta)
+{
+  NS_ASSERT (delta <= m_remaining);
+  while (delta > 0)
+    {
+      Settle ();
+      uint32_t n = std::min (delta, m_left);
+      m_current.Next (n);
+      m_left -= n;
+      m_remaining -= n;
+      delta -= n;
+    }
+}
+
+inline uint8_t
+BufferChain::Iterator::ReadU8 (void)
+{
+  NS_ASSERT (m_remaining > 0);
+  Settle ();
+  m_left--;
+  m_remaining--;
+  return m_current.ReadU8 ();
+}
+
+inline uint16_t
+BufferChain::Iterator::ReadNtohU16 (void)
+{
+  if (m_left >= 2)
+    {
+      m_left -= 2;
+      m_remaining -= 2;
+      return m_current.ReadNtohU16 ();
+    }
+  uint16_t v = ReadU8 ();
+  return (v << 8) | ReadU8 ();
+}
+
+inline uint32_t
+BufferChain::Iterator::ReadNtohU32 (void)
+{
+  if (m_left >= 4)
+    {
+      m_left -= 4;
+      m_remaining -= 4;
+      return m_current.ReadNtohU32 ();
+    }
+  uint32_t v = ReadNtohU16 ();
+  return (v << 16) | ReadNtohU16 ();
+}
+
+inline void
+BufferChain::Iterator::Read (uint8_t *buffer, uint32_t size)
+{
+  NS_ASSERT (size <= m_remaining);
+  while (size > 0)
+    {
+      Settle ();
+      uint32_t n = std::min (size, m_left);
+      m_current.Read (buffer, n);
+      buffer += n;
+      m_left -= n;
+      m_remaining -= n;
+      size -= n;
+    }
+}
+
+} // namespace ns3
+
+#endif /* BUFFER_CHAIN_H */
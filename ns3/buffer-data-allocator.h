@@ -0,0 +1,520 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef BUFFER_DATA_ALLOCATOR_H
+#define BUFFER_DATA_ALLOCATOR_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief Thread-safe, size-classed allocator of the Buffer::Data blocks.
+ *
+ * The payloads of a simulation fall in a few sizes: headers only
+ * (ACKs, control frames), small messages, Ethernet MTU frames and
+ * jumbo frames. Each size class below keeps its own free lists, so a
+ * mix of sizes does not defeat the reuse, as with a single free list
+ * sized after the largest buffer seen:
+ *
+ *   class | payload bytes
+ *   ------|--------------
+ *   0     | 64
+ *   1     | 256
+ *   2     | 1500
+ *   3     | 9000
+ *
+ * A block is rounded up to its class, plus room for the Data header,
+ * and the capacity returned by Allocate() is the full block: the
+ * Buffer uses the slack for later AddAtStart and AddAtEnd. Larger
+ * blocks go straight to operator new.
+ *
+ * The free blocks of a class are held by a global depot, protected by
+ * a mutex, and, unless disabled with SetThreadCache(), by small caches
+ * private to each thread, which exchange blocks with the depot in
+ * batches. So the simulation threads of the MultithreadedSimulatorImpl
+ * allocate without locking in steady state, and a packet may be freed
+ * by another thread than the one which allocated it.
+ *
+ * The counters are kept by each thread with its free lists, so that
+ * counting takes no atomic operation, and GetStats() sums them over all
+ * the threads, as PacketPool::GetTotalStats(). A block freed by another
+ * thread than its owner moves its bytes between the counters of the two
+ * threads: only the sums are meaningful.
+ */
+class BufferDataAllocator
+{
+public:
+  /** Allocation counters. */
+  struct Stats
+  {
+    uint64_t allocations;   /**< Number of Allocate calls. */
+    uint64_t cacheHits;     /**< Allocations served by a thread cache. */
+    uint64_t depotHits;     /**< Allocations served by the depot. */
+    uint64_t misses;        /**< Allocations served by operator new. */
+    uint64_t oversized;     /**< Allocations too large for the size classes. */
+    uint64_t residentBytes; /**< Bytes obtained from operator new and not returned. */
+    uint64_t freeBytes;     /**< Part of residentBytes held by the free lists. */
+  };
+
+  /** Number of size classes. */
+  static const uint32_t kClasses = 4;
+  /** Room for the header of Buffer::Data, added to the payload of each class. */
+  static const uint32_t kHeaderSlack = 32;
+
+  /**
+   * Allocate a block.
+   *
+   * \param [in] size The size requested, in bytes, header included.
+   * \param [out] capacity The size of the block, at least \p size.
+   * \returns The block.
+   */
+  static void * Allocate (std::size_t size, std::size_t &capacity);
+  /**
+   * Release a block obtained from Allocate(), from any thread.
+   *
+   * \param [in] p The block.
+   * \param [in] capacity The capacity returned by Allocate().
+   */
+  static void Deallocate (void *p, std::size_t capacity);
+  /**
+   * Enable or disable the thread caches. Disabled, every operation
+   * locks the depot, which bounds the memory held by idle threads.
+   *
+   * \param [in] enable Whether to use the thread caches.
+   */
+  static void SetThreadCache (bool enable);
+  /**
+   * Get the counters, summed over all the threads.
+   *
+   * \returns The counters.
+   */
+  static Stats GetStats (void);
+  /**
+   * Get the fraction of the allocations served by the free lists.
+   *
+   * \returns The hit rate, between 0 and 1.
+   */
+  static double GetHitRate (void);
+  /**
+   * Print the counters, the hit rate and the resident memory.
+   *
+   * \param [in] os The output stream.
+   */
+  static void PrintStats (std::ostream &os);
+  /**
+   * Return the free blocks of the calling thread cache and of the
+   * depot to operator delete.
+   */
+  static void Trim (void);
+
+private:
+  /** Maximum number of free blocks per class in a thread cache. */
+  static const uint32_t kCacheBlocks = 64;
+  /** Maximum number of free blocks per class in the depot. */
+  static const uint32_t kDepotBlocks = 8192;
+
+  /** A free block: the storage is reused as the free list link. */
+  struct Block
+  {
+    Block *next; /**< Next free block of the same class. */
+  };
+  /** A set of free lists, one per class. */
+  struct FreeLists
+  {
+    Block *head[kClasses];     /**< The free list of each class. */
+    uint32_t length[kClasses]; /**< The length of each free list. */
+    Stats stats;               /**< The counters of a thread; unused by the depot. */
+  };
+  /**
+   * The global state, allocated once and never destroyed: blocks may
+   * be released by static destructors.
+   */
+  struct Depot
+  {
+    std::mutex mutex;              /**< Protects lists. */
+    FreeLists lists;               /**< The free lists of the depot. */
+    std::atomic<bool> threadCache; /**< Whether the thread caches are used. */
+  };
+  /** The thread caches, for GetStats(). */
+  struct Registry
+  {
+    std::mutex mutex;                /**< Protects caches. */
+    std::vector<FreeLists *> caches; /**< The cache of each thread. */
+  };
+  /** Returns the blocks of a thread cache to the depot when its thread exits. */
+  struct CacheReleaser
+  {
+    ~CacheReleaser ();
+  };
+
+  /**
+   * \param [in] c A size class.
+   * \returns The size of its blocks, header included.
+   */
+  static std::size_t GetBlockSize (uint32_t c);
+  /**
+   * \param [in] size A block size.
+   * \returns The smallest class which fits it, or kClasses if none.
+   */
+  static uint32_t GetClass (std::size_t size);
+  /** \returns A new global state, empty. */
+  static Depot * CreateDepot (void);
+  /** \returns The global state. */
+  static Depot & GetDepot (void);
+  /** \returns The caches of all the threads; never destroyed, as the caches. */
+  static Registry & GetRegistry (void);
+  /** \returns The free lists of the calling thread. */
+  static FreeLists & GetCache (void);
+  /**
+   * Move blocks between two free lists of a class.
+   * \param [in,out] from The source.
+   * \param [in,out] to The destination.
+   * \param [in] c The class.
+   * \param [in] n The maximum number of blocks to move.
+   * \returns The number of blocks moved.
+   */
+  static uint32_t Move (FreeLists &from, FreeLists &to, uint32_t c, uint32_t n);
+  /**
+   * Detach the blocks of a class in excess of kDepotBlocks from the
+   * depot, whose mutex must be held.
+   * \param [in] c The class.
+   * \returns The list of the blocks detached.
+   */
+  static Block * Overflow (uint32_t c);
+  /**
+   * Return all the blocks of a thread cache to the depot.
+   * \param [in,out] cache The thread cache.
+   */
+  static void Flush (FreeLists &cache);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline std::size_t
+BufferDataAllocator::GetBlockSize (uint32_t c)
+{
+  static const uint32_t payload[kClasses] = { 64, 256, 1500, 9000 };
+  return payload[c] + kHeaderSlack;
+}
+
+inline uint32_t
+BufferDataAllocator::GetClass (std::size_t size)
+{
+  uint32_t c = 0;
+  while (c < kClasses && GetBlockSize (c) < size)
+    {
+      c++;
+    }
+  return c;
+}
+
+inline BufferDataAllocator::Depot *
+BufferDataAllocator::CreateDepot (void)
+{
+  Depot *depot = new Depot ();
+  for (uint32_t c = 0; c < kClasses; c++)
+    {
+      depot->lists.head[c] = 0;
+      depot->lists.length[c] = 0;
+    }
+  depot->threadCache = true;
+  return depot;
+}
+
+inline BufferDataAllocator::Depot &
+BufferDataAllocator::GetDepot (void)
+{
+  static Depot *depot = CreateDepot ();
+  return *depot;
+}
+
+inline BufferDataAllocator::Registry &
+BufferDataAllocator::GetRegistry (void)
+{
+  static Registry *registry = new Registry ();
+  return *registry;
+}
+
+inline
+BufferDataAllocator::CacheReleaser::~CacheReleaser ()
+{
+  Flush (GetCache ());
+}
+
+inline BufferDataAllocator::FreeLists &
+BufferDataAllocator::GetCache (void)
+{
+  // Never destroyed, so that GetStats() keeps the counters of the
+  // threads which exited: the releaser only empties the free lists.
+  static thread_local FreeLists *cache = 0;
+  static thread_local CacheReleaser releaser;
+  (void) releaser;
+  if (cache == 0)
+    {
+      cache = new FreeLists ();
+      Registry &registry = GetRegistry ();
+      std::lock_guard<std::mutex> lock (registry.mutex);
+      registry.caches.push_back (cache);
+    }
+  return *cache;
+}
+
+inline uint32_t
+BufferDataAllocator::Move (FreeLists &from, FreeLists &to, uint32_t c, uint32_t n)
+{
+  uint32_t moved = 0;
+  while (moved < n && from.head[c] != 0)
+    {
+      Block *block = from.head[c];
+      from.head[c] = block->next;
+      block->next = to.head[c];
+      to.head[c] = block;
+      moved++;
+    }
+  from.length[c] -= moved;
+  to.length[c] += moved;
+  return moved;
+}
+
+inline void
+BufferDataAllocator::Flush (FreeLists &cache)
+{
+  Depot &depot = GetDepot ();
+  std::lock_guard<std::mutex> lock (depot.mutex);
+  for (uint32_t c = 0; c < kClasses; c++)
+    {
+      Move (cache, depot.lists, c, cache.length[c]);
+    }
+}
+
+inline void *
+BufferDataAllocator::Allocate (std::size_t size, std::size_t &capacity)
+{
+  Depot &depot = GetDepot ();
+  FreeLists &cache = GetCache ();
+  cache.stats.allocations++;
+  uint32_t c = GetClass (size);
+  if (c == kClasses)
+    {
+      cache.stats.oversized++;
+      cache.stats.residentBytes += size;
+      capacity = size;
+      return ::operator new (size);
+    }
+  capacity = GetBlockSize (c);
+
+  Block *block = 0;
+  if (depot.threadCache.load (std::memory_order_relaxed))
+    {
+      if (cache.head[c] != 0)
+        {
+          cache.stats.cacheHits++;
+        }
+      else
+        {
+          std::lock_guard<std::mutex> lock (depot.mutex);
+          if (Move (depot.lists, cache, c, kCacheBlocks / 2) > 0)
+            {
+              cache.stats.depotHits++;
+            }
+        }
+      block = cache.head[c];
+      if (block != 0)
+        {
+          cache.head[c] = block->next;
+          cache.length[c]--;
+        }
+    }
+  else
+    {
+      std::lock_guard<std::mutex> lock (depot.mutex);
+      block = depot.lists.head[c];
+      if (block != 0)
+        {
+          depot.lists.head[c] = block->next;
+          depot.lists.length[c]--;
+          cache.stats.depotHits++;
+        }
+    }
+
+  if (block != 0)
+    {
+      cache.stats.freeBytes -= capacity;
+      return block;
+    }
+  cache.stats.misses++;
+  cache.stats.residentBytes += capacity;
+  return ::operator new (capacity);
+}
+
+inline BufferDataAllocator::Block *
+BufferDataAllocator::Overflow (uint32_t c)
+{
+  FreeLists &lists = GetDepot ().lists;
+  Block *excess = 0;
+  while (lists.length[c] > kDepotBlocks)
+    {
+      Block *block = lists.head[c];
+      lists.head[c] = block->next;
+      lists.length[c]--;
+      block->next = excess;
+      excess = block;
+    }
+  return excess;
+}
+
+inline void
+BufferDataAllocator::Deallocate (void *p, std::size_t capacity)
+{
+  Depot &depot = GetDepot ();
+  FreeLists &cache = GetCache ();
+  uint32_t c = GetClass (capacity);
+  if (c == kClasses || GetBlockSize (c) != capacity)
+    {
+      cache.stats.residentBytes -= capacity;
+      ::operator delete (p);
+      return;
+    }
+  Block *block = static_cast<Block *> (p);
+  cache.stats.freeBytes += capacity;
+
+  Block *excess;
+  if (depot.threadCache.load (std::memory_order_relaxed))
+    {
+      block->next = cache.head[c];
+      cache.head[c] = block;
+      cache.length[c]++;
+      if (cache.length[c] <= kCacheBlocks)
+        {
+          return;
+        }
+      // Give half of the cache back to the depot.
+      std::lock_guard<std::mutex> lock (depot.mutex);
+      Move (cache, depot.lists, c, kCacheBlocks / 2);
+      excess = Overflow (c);
+    }
+  else
+    {
+      std::lock_guard<std::mutex> lock (depot.mutex);
+      block->next = depot.lists.head[c];
+      depot.lists.head[c] = block;
+      depot.lists.length[c]++;
+      excess = Overflow (c);
+    }
+
+  // Free the blocks beyond the bound of the depot, out of the mutex.
+  while (excess != 0)
+    {
+      block = excess;
+      excess = block->next;
+      cache.stats.freeBytes -= capacity;
+      cache.stats.residentBytes -= capacity;
+      ::operator delete (block);
+    }
+}
+
+inline void
+BufferDataAllocator::SetThreadCache (bool enable)
+{
+  GetDepot ().threadCache = enable;
+}
+
+inline BufferDataAllocator::Stats
+BufferDataAllocator::GetStats (void)
+{
+  Stats total = Stats ();
+  Registry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.mutex);
+  for (std::vector<FreeLists *>::const_iterator i = registry.caches.begin (); i != registry.caches.end (); ++i)
+    {
+      const Stats &stats = (*i)->stats;
+      total.allocations += stats.allocations;
+      total.cacheHits += stats.cacheHits;
+      total.depotHits += stats.depotHits;
+      total.misses += stats.misses;
+      total.oversized += stats.oversized;
+      // Modulo 2^64: the bytes of a block freed by another thread are
+      // subtracted from the counters of that thread.
+      total.residentBytes += stats.residentBytes;
+      total.freeBytes += stats.freeBytes;
+    }
+  return total;
+}
+
+inline double
+BufferDataAllocator::GetHitRate (void)
+{
+  Stats stats = GetStats ();
+  if (stats.allocations == 0)
+    {
+      return 0;
+    }
+  return static_cast<double> (stats.cacheHits + stats.depotHits) / stats.allocations;
+}
+
+inline void
+BufferDataAllocator::PrintStats (std::ostream &os)
+{
+  Stats stats = GetStats ();
+  os << "allocations=" << stats.allocations
+     << " cache-hits=" << stats.cacheHits
+     << " depot-hits=" << stats.depotHits
+     << " misses=" << stats.misses
+     << " oversized=" << stats.oversized
+     << " hit-rate=" << GetHitRate ()
+     << " resident-bytes=" << stats.residentBytes
+     << " free-bytes=" << stats.freeBytes;
+}
+
+inline void
+BufferDataAllocator::Trim (void)
+{
+  FreeLists &cache = GetCache ();
+  Flush (cache);
+  Depot &depot = GetDepot ();
+  std::lock_guard<std::mutex> lock (depot.mutex);
+  for (uint32_t c = 0; c < kClasses; c++)
+    {
+      while (depot.lists.head[c] != 0)
+        {
+          Block *block = depot.lists.head[c];
+          depot.lists.head[c] = block->next;
+          cache.stats.freeBytes -= GetBlockSize (c);
+          cache.stats.residentBytes -= GetBlockSize (c);
+          ::operator delete (block);
+        }
+      depot.lists.length[c] = 0;
+    }
+}
+
+} // namespace ns3
+
+#endif /* BUFFER_DATA_ALLOCATOR_H */
@@ -24,8 +24,11 @@
 #include <vector>
 #include <ostream>
 #include "ns3/assert.h"
-
-#define BUFFER_FREE_LIST 1
+#include "buffer-data-allocator.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
+#include "ip-checksum.h"
 
 namespace ns3 {
 
@@ -361,15 +364,20 @@ public:
      * \param size size of the buffer.
      * \return checksum
      */
-    uint16_t CalculateIpChecksum (uint16_t size);
+    inline uint16_t CalculateIpChecksum (uint16_t size);
 
     /**
      * \brief Calculate the checksum.
+     *
+     * The bytes of the zero area add nothing to the sum: they are
+     * skipped, not read, so that the checksum of a packet with a large
+     * zero-filled payload costs no more than that of its headers.
+     *
      * \param size size of the buffer.
      * \param initialChecksum initial value
      * \return checksum
      */
-    uint16_t CalculateIpChecksum (uint16_t size, uint32_t initialChecksum);
+    inline uint16_t CalculateIpChecksum (uint16_t size, uint32_t initialChecksum);
 
     /**
      * \returns the size of the underlying buffer we are iterating
@@ -489,6 +497,16 @@ private:
    */
   inline uint32_t GetSize (void) const;
 
+  /**
+   * \return the number of bytes of this buffer which are stored in
+   * memory, i.e., GetSize () minus the size of the zero area.
+   *
+   * The zero-filled payload of Packet (uint32_t) stays virtual as long
+   * as nothing writes into it, peeks at it with PeekData, or appends
+   * a buffer whose start is not zero-filled after it.
+   */
+  inline uint32_t GetMaterializedSize (void) const;
+
   /**
    * \return a pointer to the start of the internal 
    * byte buffer.
@@ -662,8 +680,14 @@ private:
     /**
      * The reference count of an instance of this data structure.
      * Each buffer which references an instance holds a count.
+     * Atomic with NS3_MTP: the copies of a packet may live in two
+     * simulation threads.
      */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> m_count;
+#else
     uint32_t m_count;
+#endif
     /**
      * the size of the m_data field below.
      */
@@ -739,12 +763,20 @@ private:
   static struct Buffer::Data *Create (uint32_t size);
   /**
    * \brief Allocate a buffer data storage
+   *
+   * The storage comes from the BufferDataAllocator; m_size is set to
+   * the whole capacity of the block, which may exceed reqSize.
+   *
    * \param reqSize the storage size to create
    * \returns a pointer to the allocated buffer storage
    */
   static struct Buffer::Data *Allocate (uint32_t reqSize);
   /**
    * \brief Deallocate the buffer memory
+   *
+   * The storage goes back to the BufferDataAllocator, with the capacity
+   * recovered from m_size.
+   *
    * \param data the buffer data storage
    */
   static void Deallocate (struct Buffer::Data *data);
@@ -789,24 +821,12 @@ private:
    * instance from the start of m_data->m_data
    */
   uint32_t m_end;
-
-#ifdef BUFFER_FREE_LIST
-  /// Container for buffer data
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  /// Local static destructor structure
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
-  static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
-#endif
 };
 
 } // namespace ns3
 
 #include "ns3/assert.h"
+#include <algorithm>
 #include <cstring>
 
 namespace ns3 {
@@ -1046,6 +1066,48 @@ Buffer::Iterator::Read (Buffer::Iterator start, uint32_t size)
   start.Write (*this, end);
 }
 
+uint16_t
+Buffer::Iterator::CalculateIpChecksum (uint16_t size)
+{
+  return CalculateIpChecksum (size, 0);
+}
+
+uint16_t
+Buffer::Iterator::CalculateIpChecksum (uint16_t size, uint32_t initialChecksum)
+{
+  /* see RFC 1071 to understand this code. */
+  NS_ASSERT_MSG (m_current + size <= m_dataEnd,
+                 GetReadErrorMessage ());
+  uint64_t sum = initialChecksum;
+  uint32_t end = m_current + size;
+  // The 16 bit words are read in little endian order, as with ReadU16,
+  // and start at even offsets from m_current: a byte at an even
+  // offset is the low byte of its word. The zero area adds nothing.
+  uint32_t ranges[2][2] = {
+    { m_current, std::min (end, m_zeroStart) },
+    { std::max (m_current, m_zeroEnd), end }
+  };
+  for (uint32_t r = 0; r < 2; r++)
+    {
+      uint32_t i = ranges[r][0];
+      if (i >= ranges[r][1])
+        {
+          continue;
+        }
+      uint32_t left = ranges[r][1] - i;
+      const uint8_t *p = &m_data[i < m_zeroStart ? i : i - (m_zeroEnd - m_zeroStart)];
+      if ((i - m_current) & 1)
+        {
+          sum += static_cast<uint32_t> (*p++) << 8;
+          left--;
+        }
+      sum += IpChecksum::Sum (p, left);
+    }
+  m_current = end;
+
+  return static_cast<uint16_t> (~IpChecksum::Fold (sum));
+}
+
 
 Buffer::Buffer (Buffer const&o)
   : m_data (o.m_data),
@@ -1065,6 +1127,12 @@ Buffer::GetSize (void) const
   return m_end - m_start;
 }
 
+uint32_t
+Buffer::GetMaterializedSize (void) const
+{
+  return GetSize () - (m_zeroAreaEnd - m_zeroAreaStart);
+}
+
 Buffer::Iterator 
 Buffer::Begin (void) const
 {
@@ -1078,7 +1146,43 @@ Buffer::End (void) const
   return Buffer::Iterator (this, false);
 }
 
+inline struct Buffer::Data *
+Buffer::Create (uint32_t size)
+{
+  return Buffer::Allocate (size);
+}
+
+inline void
+Buffer::Recycle (struct Buffer::Data *data)
+{
+  NS_ASSERT (data->m_count == 0);
+  Buffer::Deallocate (data);
+}
 
+inline struct Buffer::Data *
+Buffer::Allocate (uint32_t reqSize)
+{
+  if (reqSize == 0)
+    {
+      reqSize = 1;
+    }
+  NS_ASSERT (reqSize >= 1);
+  std::size_t header = sizeof (struct Buffer::Data) - 1;
+  std::size_t capacity;
+  void *block = BufferDataAllocator::Allocate (header + reqSize, capacity);
+  struct Buffer::Data *data = static_cast<struct Buffer::Data *> (block);
+  data->m_size = capacity - header;
+  data->m_count = 1;
+  return data;
+}
+
+inline void
+Buffer::Deallocate (struct Buffer::Data *data)
+{
+  NS_ASSERT (data->m_count == 0);
+  std::size_t header = sizeof (struct Buffer::Data) - 1;
+  BufferDataAllocator::Deallocate (data, header + data->m_size);
+}
 
 } // namespace ns3
 
@@ -22,12 +22,40 @@
 
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
+#include "ns3/assert.h"
 #include "ns3/type-id.h"
 #include "tag-buffer.h"
 
+/**
+ * Size, in bytes, of the tag buffer stored inside each ByteTagList;
+ * a multiple of 4.
+ */
+#ifndef BYTE_TAG_LIST_INLINE_SIZE
+#define BYTE_TAG_LIST_INLINE_SIZE 64
+#endif
+
 namespace ns3 {
 
-struct ByteTagListData;
+/**
+ * \ingroup packet
+ *
+ * \brief Internal representation of the byte tags of a ByteTagList.
+ */
+struct ByteTagListData {
+  uint32_t size;   //!< size of the data
+#ifdef NS3_MTP
+  std::atomic<uint32_t> count; //!< use counter (for smart deallocation)
+#else
+  uint32_t count;  //!< use counter (for smart deallocation)
+#endif
+  uint32_t dirty;  //!< number of bytes actually in use
+  uint8_t data[4]; //!< data
+};
 
 /**
  * \ingroup packet
@@ -59,6 +87,12 @@ struct ByteTagListData;
  *     the boundaries before returning item. However, when packet is extending,
  *     it calls ByteTagList::AddAtStart or ByteTagList::AddAtEnd to cut byte
  *     tags that will otherwise cover new bytes.
+ *
+ *   - Up to BYTE_TAG_LIST_INLINE_SIZE bytes of tags, e.g. the flow probe
+ *     tag of the FlowMonitor, are stored in a ByteTagListData inside the
+ *     ByteTagList itself, which is never shared: copies duplicate these
+ *     few bytes instead of allocating when a tag is added to a copy.
+ *     Larger lists move to a shared, reference-counted ByteTagListData.
  */
 class ByteTagList
 {
@@ -252,19 +286,347 @@ private:
    */
   void Deallocate (struct ByteTagListData *data);
 
+  /**
+   * \brief Get the ByteTagListData stored inside this list
+   * \returns the ByteTagListData structure
+   */
+  struct ByteTagListData *GetInline (void) const;
+
+  /**
+   * \brief Share or copy the tag buffer of another list, after the
+   *        offsets and m_used were copied
+   * \param o the ByteTagList to copy
+   */
+  void CopyData (const ByteTagList &o);
+
   int32_t m_minStart; //!< minimal start offset
   int32_t m_maxEnd; //!< maximal end offset
   int32_t m_adjustment; //!< adjustment to byte tag offsets
   uint32_t m_used; //!< the number of used bytes in the buffer
   struct ByteTagListData *m_data; //!< the ByteTagListData structure
+  uint32_t m_inline[3 + BYTE_TAG_LIST_INLINE_SIZE / 4]; //!< the inline ByteTagListData
 };
 
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+ByteTagList::Iterator::Item::Item (TagBuffer buf_)
+  : buf (buf_)
+{
+}
+
+inline bool
+ByteTagList::Iterator::HasNext (void) const
+{
+  return m_current < m_end;
+}
+
+inline struct ByteTagList::Iterator::Item
+ByteTagList::Iterator::Next (void)
+{
+  NS_ASSERT (HasNext ());
+  struct Item item = Item (TagBuffer (m_current + 16, m_end));
+  item.tid.SetUid (m_nextTid);
+  item.size = m_nextSize;
+  item.start = std::max (m_nextStart, m_offsetStart);
+  item.end = std::min (m_nextEnd, m_offsetEnd);
+  m_current += 4 + 4 + 4 + 4 + m_nextSize;
+  item.buf.TrimAtEnd (m_end - m_current);
+  PrepareForNext ();
+  return item;
+}
+
+inline void
+ByteTagList::Iterator::PrepareForNext (void)
+{
+  while (m_current < m_end)
+    {
+      TagBuffer buf = TagBuffer (m_current, m_end);
+      m_nextTid = buf.ReadU32 ();
+      m_nextSize = buf.ReadU32 ();
+      m_nextStart = buf.ReadU32 () + m_adjustment;
+      m_nextEnd = buf.ReadU32 () + m_adjustment;
+      if (m_nextStart >= m_offsetEnd || m_nextEnd <= m_offsetStart)
+        {
+          m_current += 4 + 4 + 4 + 4 + m_nextSize;
+        }
+      else
+        {
+          break;
+        }
+    }
+}
+
+inline
+ByteTagList::Iterator::Iterator (uint8_t *start, uint8_t *end, int32_t offsetStart, int32_t offsetEnd, int32_t adjustment)
+  : m_current (start),
+    m_end (end),
+    m_offsetStart (offsetStart),
+    m_offsetEnd (offsetEnd),
+    m_adjustment (adjustment)
+{
+  PrepareForNext ();
+}
+
+inline uint32_t
+ByteTagList::Iterator::GetOffsetStart (void) const
+{
+  return m_offsetStart;
+}
+
+inline
+ByteTagList::ByteTagList ()
+  : m_minStart (INT32_MAX),
+    m_maxEnd (INT32_MIN),
+    m_adjustment (0),
+    m_used (0),
+    m_data (0)
+{
+}
+
+inline
+ByteTagList::ByteTagList (const ByteTagList &o)
+  : m_minStart (o.m_minStart),
+    m_maxEnd (o.m_maxEnd),
+    m_adjustment (o.m_adjustment),
+    m_used (o.m_used),
+    m_data (0)
+{
+  CopyData (o);
+}
+
+inline ByteTagList &
+ByteTagList::operator = (const ByteTagList &o)
+{
+  if (this == &o)
+    {
+      return *this;
+    }
+  Deallocate (m_data);
+  m_data = 0;
+  m_minStart = o.m_minStart;
+  m_maxEnd = o.m_maxEnd;
+  m_adjustment = o.m_adjustment;
+  m_used = o.m_used;
+  CopyData (o);
+  return *this;
+}
+
+inline
+ByteTagList::~ByteTagList ()
+{
+  Deallocate (m_data);
+  m_data = 0;
+  m_used = 0;
+}
+
+inline struct ByteTagListData *
+ByteTagList::GetInline (void) const
+{
+  return reinterpret_cast<struct ByteTagListData *> (const_cast<uint32_t *> (m_inline));
+}
+
+inline void
+ByteTagList::CopyData (const ByteTagList &o)
+{
+  if (o.m_data != 0 && o.m_data == o.GetInline ())
+    {
+      // inline buffers are never shared
+      m_data = GetInline ();
+      m_data->size = BYTE_TAG_LIST_INLINE_SIZE;
+      m_data->count = 1;
+      m_data->dirty = m_used;
+      std::memcpy (m_data->data, o.m_data->data, m_used);
+      return;
+    }
+  m_data = o.m_data;
+  if (m_data != 0)
+    {
+      m_data->count++;
+    }
+}
+
+inline struct ByteTagListData *
+ByteTagList::Allocate (uint32_t size)
+{
+  struct ByteTagListData *data = GetInline ();
+  if (size > BYTE_TAG_LIST_INLINE_SIZE || m_data == data)
+    {
+      // grow geometrically when tags are added one at a time
+      size = std::max (size, 2 * m_used);
+      uint8_t *buffer = new uint8_t [size + sizeof (struct ByteTagListData) - 4];
+      data = reinterpret_cast<struct ByteTagListData *> (buffer);
+    }
+  else
+    {
+      size = BYTE_TAG_LIST_INLINE_SIZE;
+    }
+  data->count = 1;
+  data->size = size;
+  data->dirty = 0;
+  return data;
+}
+
+inline void
+ByteTagList::Deallocate (struct ByteTagListData *data)
+{
+  if (data == 0 || data == GetInline ())
+    {
+      return;
+    }
+  if (--data->count == 0)
+    {
+      uint8_t *buffer = reinterpret_cast<uint8_t *> (data);
+      delete [] buffer;
+    }
+}
+
+inline TagBuffer
+ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
+{
+  uint32_t spaceNeeded = m_used + bufferSize + 4 + 4 + 4 + 4;
+  NS_ASSERT (m_used <= spaceNeeded);
+  if (m_data == 0)
+    {
+      m_data = Allocate (spaceNeeded);
+      m_used = 0;
+    }
+  else if (m_data->size < spaceNeeded
+           || (m_data->count != 1 && m_data->dirty != m_used))
+    {
+      struct ByteTagListData *newData = Allocate (spaceNeeded);
+      std::memcpy (&newData->data, &m_data->data, m_used);
+      Deallocate (m_data);
+      m_data = newData;
+    }
+  TagBuffer tag = TagBuffer (&m_data->data[m_used],
+                             &m_data->data[spaceNeeded]);
+  tag.WriteU32 (tid.GetUid ());
+  tag.WriteU32 (bufferSize);
+  tag.WriteU32 (start - m_adjustment);
+  tag.WriteU32 (end - m_adjustment);
+  if (start - m_adjustment < m_minStart)
+    {
+      m_minStart = start - m_adjustment;
+    }
+  if (m_maxEnd < end - m_adjustment)
+    {
+      m_maxEnd = end - m_adjustment;
+    }
+  m_used = spaceNeeded;
+  m_data->dirty = m_used;
+  return tag;
+}
+
+inline void
+ByteTagList::Add (const ByteTagList &o)
+{
+  ByteTagList::Iterator i = o.BeginAll ();
+  while (i.HasNext ())
+    {
+      ByteTagList::Iterator::Item item = i.Next ();
+      TagBuffer buf = Add (item.tid, item.size, item.start, item.end);
+      buf.CopyFrom (item.buf);
+    }
+}
+
+inline void
+ByteTagList::RemoveAll (void)
+{
+  Deallocate (m_data);
+  m_data = 0;
+  m_minStart = INT32_MAX;
+  m_maxEnd = INT32_MIN;
+  m_adjustment = 0;
+  m_used = 0;
+}
+
+inline ByteTagList::Iterator
+ByteTagList::BeginAll (void) const
+{
+  return Begin (INT32_MIN, INT32_MAX);
+}
+
+inline ByteTagList::Iterator
+ByteTagList::Begin (int32_t offsetStart, int32_t offsetEnd) const
+{
+  if (m_data == 0)
+    {
+      return Iterator (0, 0, offsetStart, offsetEnd, 0);
+    }
+  else
+    {
+      return Iterator (m_data->data, &m_data->data[m_used], offsetStart, offsetEnd, m_adjustment);
+    }
+}
+
 void
 ByteTagList::Adjust (int32_t adjustment)
 {
   m_adjustment += adjustment;
 }
 
+inline void
+ByteTagList::AddAtEnd (int32_t appendOffset)
+{
+  if (m_maxEnd <= appendOffset - m_adjustment)
+    {
+      return;
+    }
+  ByteTagList list;
+  ByteTagList::Iterator i = BeginAll ();
+  while (i.HasNext ())
+    {
+      ByteTagList::Iterator::Item item = i.Next ();
+
+      if (item.start >= appendOffset)
+        {
+          continue;
+        }
+      if (item.end > appendOffset)
+        {
+          item.end = appendOffset;
+        }
+      TagBuffer buf = list.Add (item.tid, item.size, item.start, item.end);
+      buf.CopyFrom (item.buf);
+    }
+  *this = list;
+}
+
+inline void
+ByteTagList::AddAtStart (int32_t prependOffset)
+{
+  if (m_minStart >= prependOffset - m_adjustment)
+    {
+      return;
+    }
+  ByteTagList list;
+  ByteTagList::Iterator i = BeginAll ();
+  while (i.HasNext ())
+    {
+      ByteTagList::Iterator::Item item = i.Next ();
+
+      if (item.end <= prependOffset)
+        {
+          continue;
+        }
+      if (item.start < prependOffset)
+        {
+          item.start = prependOffset;
+        }
+      TagBuffer buf = list.Add (item.tid, item.size, item.start, item.end);
+      buf.CopyFrom (item.buf);
+    }
+  *this = list;
+}
+
 } // namespace ns3
 
 #endif /* BYTE_TAG_LIST_H */
@@ -73,6 +73,7 @@ public:
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
   virtual void Remove (const Scheduler::Event &ev);
+  virtual uint32_t RemoveCancelled (void);
 
 private:
   /** Double the number of buckets if necessary. */
@@ -151,4 +152,38 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline uint32_t
+CalendarScheduler::RemoveCancelled (void)
+{
+  uint32_t removed = 0;
+  for (uint32_t i = 0; i < m_nBuckets; i++)
+    {
+      Bucket::iterator j = m_buckets[i].begin ();
+      while (j != m_buckets[i].end ())
+        {
+          if (j->impl->IsCancelled ())
+            {
+              j->impl->Unref ();
+              j = m_buckets[i].erase (j);
+              removed++;
+            }
+          else
+            {
+              j++;
+            }
+        }
+    }
+  m_qSize -= removed;
+  return removed;
+}
+
+} // namespace ns3
+
 #endif /* CALENDAR_SCHEDULER_H */
@@ -8,6 +8,7 @@
 
 // Module headers:
 #include "abort.h"
+#include "aligned-allocator.h"
 #include "assert.h"
 #include "attribute-accessor-helper.h"
 #include "attribute-construction-list.h"
@@ -29,7 +30,9 @@
 #include "enum.h"
 #include "event-garbage-collector.h"
 #include "event-id.h"
+#include "event-impl-pool.h"
 #include "event-impl.h"
+#include "event-profiler.h"
 #include "fatal-error.h"
 #include "fatal-impl.h"
 #include "global-value.h"
@@ -43,6 +46,7 @@
 #include "int64x64-double.h"
 #include "int64x64.h"
 #include "integer.h"
+#include "ladder-scheduler.h"
 #include "list-scheduler.h"
 #include "log-macros-disabled.h"
 #include "log-macros-enabled.h"
@@ -50,6 +54,7 @@
 #include "make-event.h"
 #include "map-scheduler.h"
 #include "math.h"
+#include "mpsc-queue.h"
 #include "names.h"
 #include "non-copyable.h"
 #include "nstime.h"
@@ -65,11 +70,13 @@
 #include "random-variable-stream.h"
 #include "realtime-simulator-impl.h"
 #include "ref-count-base.h"
+#include "replication-runner.h"
 #include "rng-seed-manager.h"
 #include "rng-stream.h"
 #include "scheduler.h"
 #include "simple-ref-count.h"
 #include "simulation-singleton.h"
+#include "simulation-snapshot.h"
 #include "simulator-impl.h"
 #include "simulator.h"
 #include "singleton.h"
@@ -83,6 +90,7 @@
 #include "test.h"
 #include "timer-impl.h"
 #include "timer.h"
+#include "tombstone-tracker.h"
 #include "trace-source-accessor.h"
 #include "traced-callback.h"
 #include "traced-value.h"
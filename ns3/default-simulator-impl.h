@@ -25,11 +25,13 @@
 #include "scheduler.h"
 #include "event-impl.h"
 #include "system-thread.h"
-#include "system-mutex.h"
+#include "mpsc-queue.h"
+#include "tombstone-tracker.h"
 
 #include "ptr.h"
 
 #include <list>
+#include <vector>
 
 /**
  * \file
@@ -43,6 +45,11 @@ namespace ns3 {
  * \ingroup simulator
  *
  * The default single process simulator implementation.
+ *
+ * Cancelled events are left in the event list as tombstones, and with
+ * the \c LazyRemove attribute Simulator::Remove() does the same instead
+ * of searching the list; the list is compacted in one pass when the
+ * tombstones exceed \c CompactionRatio of it (see TombstoneTracker).
  */
 class DefaultSimulatorImpl : public SimulatorImpl
 {
@@ -77,13 +84,27 @@ public:
   virtual void SetScheduler (ObjectFactory schedulerFactory);
   virtual uint32_t GetSystemId (void) const; 
   virtual uint32_t GetContext (void) const;
+  virtual void Checkpoint (SimulationSnapshot &snapshot);
+  virtual void Restore (const SimulationSnapshot &snapshot);
+
+  /**
+   * Get the lazy deletion counters of the event list.
+   *
+   * \returns The counters.
+   */
+  TombstoneTracker::Stats GetTombstoneStats (void) const;
 
 private:
   virtual void DoDispose (void);
 
   /** Process the next event. */
   void ProcessOneEvent (void);
-  /** Move events from a different context into the main event queue. */
+  /**
+   * Move events from a different context into the main event queue.
+   *
+   * The events pushed by foreign threads are drained from
+   * m_eventsWithContext in a single batch.
+   */
   void ProcessEventsWithContext (void);
  
   /** Wrap an event with its execution context. */
@@ -95,17 +116,14 @@ private:
     /** The event implementation. */
     EventImpl *event;
   };
-  /** Container type for the events from a different context. */
-  typedef std::list<struct EventWithContext> EventsWithContext;
-  /** The container of events from a different context. */
-  EventsWithContext m_eventsWithContext;
   /**
-   * Flag \c true if all events with context have been moved to the
-   * primary event queue.
+   * The events scheduled with a context by threads other than the main
+   * one. Pushing is lock-free, and the main loop only checks
+   * MpscQueue::IsEmpty before each event.
    */
-  bool m_eventsWithContextEmpty;
-  /** Mutex to control access to the list of events with context. */
-  SystemMutex m_eventsWithContextMutex;
+  MpscQueue<struct EventWithContext> m_eventsWithContext;
+  /** Buffer reused by ProcessEventsWithContext() to drain m_eventsWithContext. */
+  std::vector<struct EventWithContext> m_eventsWithContextBatch;
 
   /** Container type for the events to run at Simulator::Destroy() */
   typedef std::list<EventId> DestroyEvents;
@@ -115,6 +133,14 @@ private:
   bool m_stop;
   /** The event priority queue. */
   Ptr<Scheduler> m_events;
+  /** Lazy deletion bookkeeping of m_events. */
+  TombstoneTracker m_tombstones;
+  /** Flag \c true if Remove() leaves a tombstone instead of searching m_events. */
+  bool m_lazyRemove;
+  /** Fraction of tombstones above which m_events is compacted. */
+  double m_compactionRatio;
+  /** Minimum number of tombstones for a compaction. */
+  uint32_t m_compactionMinimum;
 
   /** Next event unique id. */
   uint32_t m_uid;
@@ -136,4 +162,67 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+#include "simulation-snapshot.h"
+
+namespace ns3 {
+
+inline TombstoneTracker::Stats
+DefaultSimulatorImpl::GetTombstoneStats (void) const
+{
+  return m_tombstones.GetStats ();
+}
+
+inline void
+DefaultSimulatorImpl::Checkpoint (SimulationSnapshot &snapshot)
+{
+  NS_ASSERT_MSG (SystemThread::Equals (m_main),
+                 "DefaultSimulatorImpl: Checkpoint() called from a foreign thread");
+  ProcessEventsWithContext ();
+  // The Scheduler cannot be iterated: drain it, and insert the events back.
+  std::vector<Scheduler::Event> events;
+  while (!m_events->IsEmpty ())
+    {
+      events.push_back (m_events->RemoveNext ());
+    }
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      snapshot.AddEvent (events[i]);
+      m_events->Insert (events[i]);
+    }
+  // m_currentUid changes whenever an event runs.
+  snapshot.SetClock (m_currentTs, m_uid, m_currentUid);
+}
+
+inline void
+DefaultSimulatorImpl::Restore (const SimulationSnapshot &snapshot)
+{
+  NS_ASSERT_MSG (SystemThread::Equals (m_main),
+                 "DefaultSimulatorImpl: Restore() called from a foreign thread");
+  NS_ABORT_MSG_IF (snapshot.GetProgress () != m_currentUid,
+                   "DefaultSimulatorImpl: events have run since the snapshot was taken");
+  ProcessEventsWithContext ();
+  while (!m_events->IsEmpty ())
+    {
+      m_events->RemoveNext ().impl->Unref ();
+    }
+  m_tombstones.Clear ();
+  m_unscheduledEvents = 0;
+  m_currentTs = snapshot.GetTimeStep ();
+  m_uid = snapshot.GetUid ();
+  for (uint32_t i = 0; i < snapshot.GetNEvents (); i++)
+    {
+      m_events->Insert (snapshot.GetEvent (i));
+      m_tombstones.NotifyInsert ();
+      m_unscheduledEvents++;
+    }
+  m_stop = false;
+}
+
+} // namespace ns3
+
 #endif /* DEFAULT_SIMULATOR_IMPL_H */
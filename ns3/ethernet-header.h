@@ -24,6 +24,7 @@
 #include "ns3/header.h"
 #include <string>
 #include "ns3/mac48-address.h"
+#include "ns3/fixed-size-header.h"
 
 namespace ns3 {
 
@@ -115,6 +116,25 @@ public:
   virtual uint32_t GetSerializedSize (void) const;
   virtual void Serialize (Buffer::Iterator start) const;
   virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  /** Size of a header without preamble, for Packet::AddHeader. */
+  static const uint32_t FIXED_SIZE = 2 * 6 + 2;
+  /**
+   * Serialize the header, without preamble, for Packet::AddHeader.
+   *
+   * \param [out] buffer The FIXED_SIZE bytes to write.
+   * \param [in] size The size of the packet.
+   * \returns false if the preamble is enabled.
+   */
+  bool SerializeFixed (uint8_t *buffer, uint32_t size) const;
+  /**
+   * Deserialize a header without preamble, for Packet::RemoveHeader.
+   *
+   * \param [in] buffer The FIXED_SIZE bytes to read.
+   * \param [in] size The size of the packet.
+   * \returns FIXED_SIZE, or 0 if the preamble is enabled.
+   */
+  uint32_t DeserializeFixed (uint8_t const *buffer, uint32_t size);
 private:
   static const int PREAMBLE_SIZE = 8; //!< size of the preamble_sfd header field
   static const int LENGTH_SIZE = 2;   //!< size of the length_type header field
@@ -133,4 +153,40 @@ private:
 } // namespace ns3
 
 
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline bool
+EthernetHeader::SerializeFixed (uint8_t *buffer, uint32_t size) const
+{
+  NS_UNUSED (size);
+  if (m_enPreambleSfd)
+    {
+      return false;
+    }
+  m_destination.CopyTo (buffer);
+  m_source.CopyTo (buffer + MAC_ADDR_SIZE);
+  FixedSizeHeader::WriteHtonU16 (buffer + 2 * MAC_ADDR_SIZE, m_lengthType);
+  return true;
+}
+
+inline uint32_t
+EthernetHeader::DeserializeFixed (uint8_t const *buffer, uint32_t size)
+{
+  NS_UNUSED (size);
+  if (m_enPreambleSfd)
+    {
+      return 0;
+    }
+  m_destination.CopyFrom (buffer);
+  m_source.CopyFrom (buffer + MAC_ADDR_SIZE);
+  m_lengthType = FixedSizeHeader::ReadNtohU16 (buffer + 2 * MAC_ADDR_SIZE);
+  return FIXED_SIZE;
+}
+
+} // namespace ns3
+
 #endif /* ETHERNET_HEADER_H */
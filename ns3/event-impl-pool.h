@@ -0,0 +1,234 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_IMPL_POOL_H
+#define EVENT_IMPL_POOL_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <new>
+
+/**
+ * \file
+ * \ingroup events
+ * ns3::EventImplPool declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup events
+ * \brief Size-classed, thread-local free lists for EventImpl storage.
+ *
+ * Every Simulator::Schedule call allocates one EventImpl subclass
+ * through the MakeEvent templates, and releases it once the event has
+ * been invoked or cancelled. EventImpl routes its class-specific
+ * operator new and operator delete through this pool so that, in
+ * steady state, scheduling an event does not call malloc or free.
+ *
+ * Blocks are grouped in size classes of kGranularity bytes, up to
+ * kGranularity * kClasses bytes; larger EventImpl subclasses use the
+ * global allocator. Each thread owns its free lists, so no locking is
+ * needed: a block released by another thread than the one which
+ * allocated it simply migrates to the free list of the releasing thread.
+ * Each free list holds at most kMaxBlocks blocks; extra blocks are
+ * returned to the global allocator.
+ *
+ * The counters are per thread and can be read with GetStats().
+ */
+class EventImplPool
+{
+public:
+  /** Allocation counters of the calling thread. */
+  struct Stats
+  {
+    uint64_t allocations; /**< Number of EventImpl allocations. */
+    uint64_t reused;      /**< Allocations served from the pool, i.e. avoided malloc calls. */
+    uint64_t oversized;   /**< Allocations too large for the pool. */
+    uint64_t pooled;      /**< Number of free blocks currently held by the pool. */
+    uint64_t peakPooled;  /**< Largest value ever taken by pooled. */
+  };
+
+  /**
+   * Allocate storage for an EventImpl.
+   *
+   * \param [in] size The size of the object, in bytes.
+   * \returns The storage.
+   */
+  static void * Allocate (std::size_t size);
+  /**
+   * Release storage obtained from Allocate().
+   *
+   * \param [in] p The storage.
+   * \param [in] size The size given to Allocate().
+   */
+  static void Deallocate (void *p, std::size_t size);
+  /**
+   * Get the counters of the calling thread.
+   *
+   * \returns The counters.
+   */
+  static Stats GetStats (void);
+  /** Reset the counters of the calling thread, except pooled. */
+  static void ResetStats (void);
+  /** Return all the free blocks of the calling thread to the global allocator. */
+  static void Trim (void);
+
+private:
+  /** Size class granularity, in bytes. */
+  static const std::size_t kGranularity = 16;
+  /** Number of size classes. */
+  static const uint32_t kClasses = 16;
+  /** Maximum number of free blocks per size class. */
+  static const uint32_t kMaxBlocks = 4096;
+
+  /** A free block: the storage is reused as the free list link. */
+  struct Block
+  {
+    Block *next; /**< Next free block of the same size class. */
+  };
+  /**
+   * The free lists and counters of one thread.
+   *
+   * This is a POD so that the thread-local instance is constant
+   * initialized and never destroyed: an EventImpl may be released
+   * late in the shutdown of its thread.
+   */
+  struct Cache
+  {
+    Block *head[kClasses];     /**< The free list of each size class. */
+    uint32_t length[kClasses]; /**< The length of each free list. */
+    Stats stats;               /**< The counters. */
+  };
+
+  /**
+   * Get the size class of an allocation.
+   *
+   * \param [in] size The size of the allocation.
+   * \returns The size class, or kClasses if \p size is too large.
+   */
+  static uint32_t GetClass (std::size_t size);
+  /**
+   * Get the free lists of the calling thread.
+   *
+   * \returns The free lists.
+   */
+  static Cache & GetCache (void);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline uint32_t
+EventImplPool::GetClass (std::size_t size)
+{
+  std::size_t index = (size - 1) / kGranularity;
+  return index < kClasses ? index : kClasses;
+}
+
+inline EventImplPool::Cache &
+EventImplPool::GetCache (void)
+{
+  static thread_local Cache cache;
+  return cache;
+}
+
+inline void *
+EventImplPool::Allocate (std::size_t size)
+{
+  Cache &cache = GetCache ();
+  cache.stats.allocations++;
+  uint32_t index = GetClass (size);
+  if (index == kClasses)
+    {
+      cache.stats.oversized++;
+      return ::operator new (size);
+    }
+  Block *block = cache.head[index];
+  if (block == 0)
+    {
+      return ::operator new ((index + 1) * kGranularity);
+    }
+  cache.head[index] = block->next;
+  cache.length[index]--;
+  cache.stats.pooled--;
+  cache.stats.reused++;
+  return block;
+}
+
+inline void
+EventImplPool::Deallocate (void *p, std::size_t size)
+{
+  Cache &cache = GetCache ();
+  uint32_t index = GetClass (size);
+  if (index == kClasses || cache.length[index] == kMaxBlocks)
+    {
+      ::operator delete (p);
+      return;
+    }
+  Block *block = static_cast<Block *> (p);
+  block->next = cache.head[index];
+  cache.head[index] = block;
+  cache.length[index]++;
+  cache.stats.pooled++;
+  if (cache.stats.pooled > cache.stats.peakPooled)
+    {
+      cache.stats.peakPooled = cache.stats.pooled;
+    }
+}
+
+inline EventImplPool::Stats
+EventImplPool::GetStats (void)
+{
+  return GetCache ().stats;
+}
+
+inline void
+EventImplPool::ResetStats (void)
+{
+  Stats &stats = GetCache ().stats;
+  stats.allocations = 0;
+  stats.reused = 0;
+  stats.oversized = 0;
+  stats.peakPooled = stats.pooled;
+}
+
+inline void
+EventImplPool::Trim (void)
+{
+  Cache &cache = GetCache ();
+  for (uint32_t i = 0; i < kClasses; i++)
+    {
+      while (cache.head[i] != 0)
+        {
+          Block *block = cache.head[i];
+          cache.head[i] = block->next;
+          ::operator delete (block);
+        }
+      cache.length[i] = 0;
+    }
+  cache.stats.pooled = 0;
+}
+
+} // namespace ns3
+
+#endif /* EVENT_IMPL_POOL_H */
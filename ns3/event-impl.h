@@ -21,7 +21,9 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
+#include "event-impl-pool.h"
 
 /**
  * \file
@@ -40,6 +42,10 @@ namespace ns3 {
  * when it reaches the time associated to this event. Most subclasses
  * are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * The storage of every subclass instance is taken from the
+ * EventImplPool, so that scheduling an event does not need to call the
+ * global allocator in steady state.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -65,6 +71,26 @@ public:
    * Checked by the simulation engine before calling Invoke().
    */
   bool IsCancelled (void);
+  /**
+   * Clear the 'canceled' mark. Used when the event list is rolled
+   * back to a SimulationSnapshot taken before the event was canceled.
+   */
+  void Uncancel (void);
+
+  /**
+   * Allocate storage for an event from the EventImplPool.
+   *
+   * \param [in] size The size of the event subclass.
+   * \returns The storage.
+   */
+  static void * operator new (std::size_t size);
+  /**
+   * Return the storage of an event to the EventImplPool.
+   *
+   * \param [in] p The storage.
+   * \param [in] size The size of the event subclass.
+   */
+  static void operator delete (void *p, std::size_t size);
 
 protected:
   /**
@@ -81,4 +107,31 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+EventImpl::Uncancel (void)
+{
+  m_cancel = false;
+}
+
+inline void *
+EventImpl::operator new (std::size_t size)
+{
+  return EventImplPool::Allocate (size);
+}
+
+inline void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+  EventImplPool::Deallocate (p, size);
+}
+
+} // namespace ns3
+
 #endif /* EVENT_IMPL_H */
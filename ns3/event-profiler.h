@@ -0,0 +1,560 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include "event-impl.h"
+#include "simulator.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#if defined (__GNUC__)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::EventProfiler declaration and inline implementation, and the
+ * NS_EVENT_PROFILER_INVOKE and NS_EVENT_PROFILER_REPORT macros.
+ */
+
+#ifdef NS3_EVENT_PROFILER
+/**
+ * \ingroup simulator
+ * Invoke an event from the event loop of a SimulatorImpl, through the
+ * EventProfiler when ns-3 is built with NS3_EVENT_PROFILER defined.
+ * Otherwise, this is a plain EventImpl::Invoke call.
+ *
+ * \param [in] event The event.
+ * \param [in] context The context of the event.
+ */
+#define NS_EVENT_PROFILER_INVOKE(event, context) \
+  ns3::EventProfiler::Invoke (event, context)
+/**
+ * \ingroup simulator
+ * Write the EventProfiler report, from Simulator::Destroy, when ns-3
+ * is built with NS3_EVENT_PROFILER defined. Otherwise, do nothing.
+ */
+#define NS_EVENT_PROFILER_REPORT() \
+  ns3::EventProfiler::Report ()
+#else /* NS3_EVENT_PROFILER */
+#define NS_EVENT_PROFILER_INVOKE(event, context) \
+  (event)->Invoke ()
+#define NS_EVENT_PROFILER_REPORT()
+#endif /* NS3_EVENT_PROFILER */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief Attribute the wall clock time of the simulation to the
+ * event types and the nodes.
+ *
+ * When ns-3 is built with NS3_EVENT_PROFILER defined and the profiler
+ * is enabled, the event loop measures each event with a steady clock,
+ * and accumulates its time and count under the pair (context, event
+ * type). Without NS3_EVENT_PROFILER, the event loop is unchanged.
+ *
+ * The event type is the dynamic type of the EventImpl. For the events
+ * created by MakeEvent, i.e. by Simulator::Schedule and friends, it is
+ * labelled with the type of the function or member function invoked,
+ * such as <tt>void (ns3::TcpSocketBase::*)()</tt>; SetLabel can give a
+ * more readable name to a function type.
+ *
+ * At Simulator::Destroy, two files are written:
+ *  - <tt>prefix.txt</tt>: the event types, then the contexts, sorted
+ *    by decreasing wall clock time;
+ *  - <tt>prefix.folded</tt>: one line per (context, event type) pair,
+ *    in the collapsed stack format of flamegraph.pl, weighted in
+ *    nanoseconds.
+ *
+ * The counters of each thread are kept apart, so the profiler can be
+ * used by the MultithreadedSimulatorImpl.
+ *
+ * Only the event loops which invoke their events with
+ * NS_EVENT_PROFILER_INVOKE are measured: the MultithreadedSimulatorImpl
+ * does, the DefaultSimulatorImpl does not.
+ *
+ * \code
+ *   EventProfiler::Enable ("my-sim-profile");
+ *   EventProfiler::SetLabel (&TcpSocketBase::ReTxTimeout, "TCP timer");
+ *   Simulator::Run ();
+ *   Simulator::Destroy ();
+ * \endcode
+ */
+class EventProfiler
+{
+public:
+  /**
+   * Enable the profiler.
+   *
+   * \param [in] prefix The prefix of the files written at Simulator::Destroy.
+   */
+  static void Enable (const std::string &prefix);
+  /** Disable the profiler; the counters are kept. */
+  static void Disable (void);
+  /**
+   * Check if the profiler is enabled.
+   *
+   * \returns \c true if enabled.
+   */
+  static bool IsEnabled (void);
+  /**
+   * Set the label of the events invoking a function type. The events
+   * are told apart by type only: all the member functions of a class
+   * with the same signature share the label.
+   *
+   * \tparam FN \deduced The function or member function pointer type.
+   * \param [in] function A function of the type to label.
+   * \param [in] label The label.
+   */
+  template <typename FN>
+  static void SetLabel (FN function, const std::string &label);
+  /**
+   * Invoke an event and account for it, if the profiler is enabled.
+   *
+   * \param [in] event The event.
+   * \param [in] context The context of the event.
+   */
+  static void Invoke (EventImpl *event, uint32_t context);
+  /**
+   * Write the report and the collapsed stack file, then clear the
+   * counters. Does nothing if the profiler is disabled.
+   */
+  static void Report (void);
+  /**
+   * Write the sorted report.
+   *
+   * \param [in] os The output stream.
+   */
+  static void WriteReport (std::ostream &os);
+  /**
+   * Write the collapsed stack file.
+   *
+   * \param [in] os The output stream.
+   */
+  static void WriteCollapsed (std::ostream &os);
+  /** Clear the counters of all the threads. */
+  static void Reset (void);
+
+private:
+  /** The counters of an event type, a context, or both. */
+  struct Entry
+  {
+    uint64_t count; /**< Number of events. */
+    uint64_t ns;    /**< Wall clock time, in nanoseconds. */
+  };
+  /** Key of the counters: context and event type. */
+  typedef std::pair<uint32_t, std::type_index> Key;
+  /** Hash function of a Key. */
+  struct KeyHash
+  {
+    /**
+     * \param [in] key The key.
+     * \returns The hash.
+     */
+    std::size_t operator () (const Key &key) const
+    {
+      return key.second.hash_code () ^ (static_cast<std::size_t> (key.first) * 0x9e3779b97f4a7c15ULL);
+    }
+  };
+  /** The counters of one thread. */
+  typedef std::unordered_map<Key, Entry, KeyHash> Table;
+
+  /** The global state. */
+  struct State
+  {
+    std::atomic<bool> enabled;                 /**< Flag \c true if enabled. */
+    std::string prefix;                        /**< Output file prefix. */
+    std::mutex mutex;                          /**< Protects tables and labels. */
+    std::vector<Table *> tables;               /**< The tables of all the threads. */
+    std::map<std::string, std::string> labels; /**< Function type to label. */
+  };
+
+  /**
+   * Get the global state.
+   *
+   * \returns The state.
+   */
+  static State & GetState (void);
+  /**
+   * Get the table of the calling thread. The table outlives the
+   * thread, so that the counters of the worker threads can be reported.
+   *
+   * \returns The table.
+   */
+  static Table & GetTable (void);
+  /**
+   * Demangle a type name.
+   *
+   * \param [in] name The name given by std::type_info::name.
+   * \returns The demangled name.
+   */
+  static std::string Demangle (const char *name);
+  /**
+   * Get the label of an event type.
+   *
+   * \param [in] type The type.
+   * \returns The label.
+   */
+  static std::string GetLabel (std::type_index type);
+  /**
+   * Merge the tables of all the threads.
+   *
+   * \param [out] byLabel The counters by label.
+   * \param [out] byContext The counters by context.
+   * \param [out] byBoth The counters by context and label.
+   */
+  static void Merge (std::map<std::string, Entry> &byLabel,
+                     std::map<uint32_t, Entry> &byContext,
+                     std::map<std::pair<uint32_t, std::string>, Entry> &byBoth);
+  /**
+   * Format a context.
+   *
+   * \param [in] context The context.
+   * \returns "global" for Simulator::NO_CONTEXT, "node N" otherwise.
+   */
+  static std::string FormatContext (uint32_t context);
+  /**
+   * Write a sorted section of the report.
+   *
+   * \tparam K \deduced The key type.
+   * \param [in] os The output stream.
+   * \param [in] title The column title of the keys.
+   * \param [in] entries The counters.
+   * \param [in] total The total wall clock time, in nanoseconds.
+   */
+  template <typename K>
+  static void WriteSection (std::ostream &os, const std::string &title,
+                            const std::map<K, Entry> &entries, uint64_t total);
+  /**
+   * Format a key of the report.
+   *
+   * \param [in] label The label.
+   * \returns The label.
+   */
+  static std::string FormatKey (const std::string &label);
+  /**
+   * Format a key of the report.
+   *
+   * \param [in] context The context.
+   * \returns The formatted context.
+   */
+  static std::string FormatKey (uint32_t context);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline EventProfiler::State &
+EventProfiler::GetState (void)
+{
+  static State state;
+  return state;
+}
+
+inline EventProfiler::Table &
+EventProfiler::GetTable (void)
+{
+  static thread_local Table *table = 0;
+  if (table == 0)
+    {
+      table = new Table ();
+      State &state = GetState ();
+      std::lock_guard<std::mutex> lock (state.mutex);
+      state.tables.push_back (table);
+    }
+  return *table;
+}
+
+inline void
+EventProfiler::Enable (const std::string &prefix)
+{
+  State &state = GetState ();
+  state.prefix = prefix;
+  state.enabled.store (true, std::memory_order_relaxed);
+}
+
+inline void
+EventProfiler::Disable (void)
+{
+  GetState ().enabled.store (false, std::memory_order_relaxed);
+}
+
+inline bool
+EventProfiler::IsEnabled (void)
+{
+  return GetState ().enabled.load (std::memory_order_relaxed);
+}
+
+template <typename FN>
+void
+EventProfiler::SetLabel (FN function, const std::string &label)
+{
+  State &state = GetState ();
+  std::lock_guard<std::mutex> lock (state.mutex);
+  state.labels[Demangle (typeid (FN).name ())] = label;
+}
+
+inline void
+EventProfiler::Invoke (EventImpl *event, uint32_t context)
+{
+  if (!IsEnabled ())
+    {
+      event->Invoke ();
+      return;
+    }
+  Table &table = GetTable ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  event->Invoke ();
+  std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now () - start;
+  Entry &entry = table[Key (context, std::type_index (typeid (*event)))];
+  entry.count++;
+  entry.ns += std::chrono::duration_cast<std::chrono::nanoseconds> (elapsed).count ();
+}
+
+inline std::string
+EventProfiler::Demangle (const char *name)
+{
+#if defined (__GNUC__)
+  int status;
+  char *demangled = abi::__cxa_demangle (name, 0, 0, &status);
+  if (status == 0)
+    {
+      std::string result = demangled;
+      std::free (demangled);
+      return result;
+    }
+#endif
+  return name;
+}
+
+inline std::string
+EventProfiler::GetLabel (std::type_index type)
+{
+  std::string name = Demangle (type.name ());
+  // The events of MakeEvent are local classes of a function whose
+  // first template argument, or first argument, is the type of the
+  // function invoked.
+  const std::string makeEvent = "ns3::MakeEvent";
+  std::size_t start = makeEvent.size () + 1;
+  if (name.compare (0, makeEvent.size (), makeEvent) == 0
+      && name.size () > start
+      && (name[start - 1] == '<' || name[start - 1] == '('))
+    {
+      std::size_t end = start;
+      int depth = 0;
+      for (; end < name.size (); end++)
+        {
+          char c = name[end];
+          if (c == '<' || c == '(')
+            {
+              depth++;
+            }
+          else if (c == '>' || c == ')' || c == ',')
+            {
+              if (depth == 0)
+                {
+                  break;
+                }
+              if (c != ',')
+                {
+                  depth--;
+                }
+            }
+        }
+      name = name.substr (start, end - start);
+    }
+  State &state = GetState ();
+  std::map<std::string, std::string>::const_iterator i = state.labels.find (name);
+  if (i != state.labels.end ())
+    {
+      return i->second;
+    }
+  return name;
+}
+
+inline void
+EventProfiler::Merge (std::map<std::string, Entry> &byLabel,
+                      std::map<uint32_t, Entry> &byContext,
+                      std::map<std::pair<uint32_t, std::string>, Entry> &byBoth)
+{
+  State &state = GetState ();
+  std::lock_guard<std::mutex> lock (state.mutex);
+  std::unordered_map<std::type_index, std::string> labels;
+  for (std::vector<Table *>::const_iterator t = state.tables.begin (); t != state.tables.end (); t++)
+    {
+      for (Table::const_iterator i = (*t)->begin (); i != (*t)->end (); i++)
+        {
+          std::unordered_map<std::type_index, std::string>::iterator label = labels.find (i->first.second);
+          if (label == labels.end ())
+            {
+              label = labels.insert (std::make_pair (i->first.second, GetLabel (i->first.second))).first;
+            }
+          Entry *entries[3] = { &byLabel[label->second],
+                                &byContext[i->first.first],
+                                &byBoth[std::make_pair (i->first.first, label->second)] };
+          for (uint32_t j = 0; j < 3; j++)
+            {
+              entries[j]->count += i->second.count;
+              entries[j]->ns += i->second.ns;
+            }
+        }
+    }
+}
+
+inline std::string
+EventProfiler::FormatContext (uint32_t context)
+{
+  if (context == Simulator::NO_CONTEXT)
+    {
+      return "global";
+    }
+  std::ostringstream oss;
+  oss << "node " << context;
+  return oss.str ();
+}
+
+inline std::string
+EventProfiler::FormatKey (const std::string &label)
+{
+  return label;
+}
+
+inline std::string
+EventProfiler::FormatKey (uint32_t context)
+{
+  return FormatContext (context);
+}
+
+template <typename K>
+void
+EventProfiler::WriteSection (std::ostream &os, const std::string &title,
+                             const std::map<K, Entry> &entries, uint64_t total)
+{
+  std::vector<std::pair<uint64_t, K> > sorted;
+  for (typename std::map<K, Entry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      sorted.push_back (std::make_pair (i->second.ns, i->first));
+    }
+  std::sort (sorted.begin (), sorted.end (), std::greater<std::pair<uint64_t, K> > ());
+  os << std::right << std::setw (12) << "time (ms)"
+     << std::setw (8) << "share"
+     << std::setw (14) << "events"
+     << std::setw (12) << "ns/event"
+     << "  " << title << std::endl;
+  for (uint32_t i = 0; i < sorted.size (); i++)
+    {
+      const Entry &entry = entries.find (sorted[i].second)->second;
+      os << std::fixed << std::setprecision (1)
+         << std::setw (12) << entry.ns / 1e6
+         << std::setw (7) << (total > 0 ? entry.ns * 100.0 / total : 0) << "%"
+         << std::setw (14) << entry.count
+         << std::setw (12) << (entry.count > 0 ? static_cast<double> (entry.ns) / entry.count : 0)
+         << "  " << FormatKey (sorted[i].second) << std::endl;
+    }
+}
+
+inline void
+EventProfiler::WriteReport (std::ostream &os)
+{
+  std::map<std::string, Entry> byLabel;
+  std::map<uint32_t, Entry> byContext;
+  std::map<std::pair<uint32_t, std::string>, Entry> byBoth;
+  Merge (byLabel, byContext, byBoth);
+  Entry total = { 0, 0 };
+  for (std::map<uint32_t, Entry>::const_iterator i = byContext.begin (); i != byContext.end (); i++)
+    {
+      total.count += i->second.count;
+      total.ns += i->second.ns;
+    }
+  os << "Event profile: " << total.count << " events, "
+     << std::fixed << std::setprecision (3) << total.ns / 1e9 << " s" << std::endl
+     << std::endl;
+  WriteSection (os, "event type", byLabel, total.ns);
+  os << std::endl;
+  WriteSection (os, "context", byContext, total.ns);
+}
+
+inline void
+EventProfiler::WriteCollapsed (std::ostream &os)
+{
+  std::map<std::string, Entry> byLabel;
+  std::map<uint32_t, Entry> byContext;
+  std::map<std::pair<uint32_t, std::string>, Entry> byBoth;
+  Merge (byLabel, byContext, byBoth);
+  for (std::map<std::pair<uint32_t, std::string>, Entry>::const_iterator i = byBoth.begin ();
+       i != byBoth.end (); i++)
+    {
+      // ';' separates the frames.
+      std::string label = i->first.second;
+      std::replace (label.begin (), label.end (), ';', ',');
+      os << FormatContext (i->first.first) << ";" << label << " " << i->second.ns << std::endl;
+    }
+}
+
+inline void
+EventProfiler::Report (void)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  const std::string &prefix = GetState ().prefix;
+  std::ofstream report ((prefix + ".txt").c_str ());
+  WriteReport (report);
+  std::ofstream collapsed ((prefix + ".folded").c_str ());
+  WriteCollapsed (collapsed);
+  Reset ();
+}
+
+inline void
+EventProfiler::Reset (void)
+{
+  State &state = GetState ();
+  std::lock_guard<std::mutex> lock (state.mutex);
+  for (std::vector<Table *>::const_iterator t = state.tables.begin (); t != state.tables.end (); t++)
+    {
+      (*t)->clear ();
+    }
+}
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
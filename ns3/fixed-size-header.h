@@ -0,0 +1,200 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FIXED_SIZE_HEADER_H
+#define FIXED_SIZE_HEADER_H
+
+#include <stdint.h>
+#include "ip-checksum.h"
+
+/**
+ * \file
+ * \ingroup packet
+ * ns3::FixedSizeHeader and ns3::IsFixedSizeHeader declarations and
+ * inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief Byte order helpers for the fixed-size header fast path.
+ *
+ * Packet::AddHeader, Packet::RemoveHeader and Packet::PeekHeader take
+ * a fast path for the header classes which declare, besides the
+ * Header methods:
+ *
+ * \code
+ *   // The size of the header, when SerializeFixed succeeds.
+ *   static const uint32_t FIXED_SIZE = 8;
+ *   // Write the header in buffer, FIXED_SIZE bytes; size is the size of
+ *   // the packet, header included. Returns false if the header must go
+ *   // through Serialize, e.g. to compute a checksum over the payload.
+ *   bool SerializeFixed (uint8_t *buffer, uint32_t size) const;
+ *   // Read the header from buffer, FIXED_SIZE bytes; size is the size of
+ *   // the packet. Returns FIXED_SIZE, or 0 if the header must go
+ *   // through Deserialize.
+ *   uint32_t DeserializeFixed (uint8_t const *buffer, uint32_t size);
+ * \endcode
+ *
+ * The header is built in a local array, with the constant offsets and
+ * stores the compiler sees through, and copied into the packet buffer
+ * at once, instead of one bounds-checked Buffer::Iterator write per
+ * field. SerializeFixed and DeserializeFixed must produce exactly the
+ * bytes of Serialize and Deserialize.
+ */
+class FixedSizeHeader
+{
+public:
+  /**
+   * \param [out] p Where to write.
+   * \param [in] data The value to write in network order.
+   */
+  static void WriteHtonU16 (uint8_t *p, uint16_t data);
+  /**
+   * \param [out] p Where to write.
+   * \param [in] data The value to write in network order.
+   */
+  static void WriteHtonU32 (uint8_t *p, uint32_t data);
+  /**
+   * \param [out] p Where to write.
+   * \param [in] data The value to write in little endian order, as
+   *             Buffer::Iterator::WriteU16.
+   */
+  static void WriteU16 (uint8_t *p, uint16_t data);
+  /**
+   * \param [in] p Where to read.
+   * \returns The value read in network order.
+   */
+  static uint16_t ReadNtohU16 (uint8_t const *p);
+  /**
+   * \param [in] p Where to read.
+   * \returns The value read in network order.
+   */
+  static uint32_t ReadNtohU32 (uint8_t const *p);
+  /**
+   * \param [in] p Where to read.
+   * \returns The value read in little endian order, as
+   *          Buffer::Iterator::ReadU16.
+   */
+  static uint16_t ReadU16 (uint8_t const *p);
+  /**
+   * Calculate the checksum of bytes, as
+   * Buffer::Iterator::CalculateIpChecksum.
+   *
+   * \param [in] p The bytes.
+   * \param [in] size The number of bytes.
+   * \returns The checksum.
+   */
+  static uint16_t CalculateIpChecksum (uint8_t const *p, uint32_t size);
+};
+
+/**
+ * \ingroup packet
+ *
+ * \brief Whether a header class takes the fixed-size fast path, i.e.,
+ * declares a FIXED_SIZE constant (see FixedSizeHeader).
+ *
+ * \tparam T \explicit The header class.
+ */
+template <typename T>
+class IsFixedSizeHeader
+{
+  /** Valid only if U::FIXED_SIZE is a constant. */
+  template <typename U, uint32_t SIZE = U::FIXED_SIZE>
+  struct Probe
+  {
+  };
+  /**
+   * Overload selected when U::FIXED_SIZE exists.
+   * \returns A char.
+   */
+  template <typename U>
+  static char Test (Probe<U> *);
+  /**
+   * Overload selected otherwise.
+   * \returns A long.
+   */
+  template <typename U>
+  static long Test (...);
+public:
+  /** Whether T declares FIXED_SIZE. */
+  static const bool value = sizeof (Test<T> (0)) == sizeof (char);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+FixedSizeHeader::WriteHtonU16 (uint8_t *p, uint16_t data)
+{
+  p[0] = (data >> 8) & 0xff;
+  p[1] = data & 0xff;
+}
+
+inline void
+FixedSizeHeader::WriteHtonU32 (uint8_t *p, uint32_t data)
+{
+  p[0] = (data >> 24) & 0xff;
+  p[1] = (data >> 16) & 0xff;
+  p[2] = (data >> 8) & 0xff;
+  p[3] = data & 0xff;
+}
+
+inline void
+FixedSizeHeader::WriteU16 (uint8_t *p, uint16_t data)
+{
+  p[0] = data & 0xff;
+  p[1] = (data >> 8) & 0xff;
+}
+
+inline uint16_t
+FixedSizeHeader::ReadNtohU16 (uint8_t const *p)
+{
+  return (static_cast<uint16_t> (p[0]) << 8) | p[1];
+}
+
+inline uint32_t
+FixedSizeHeader::ReadNtohU32 (uint8_t const *p)
+{
+  return (static_cast<uint32_t> (p[0]) << 24)
+         | (static_cast<uint32_t> (p[1]) << 16)
+         | (static_cast<uint32_t> (p[2]) << 8)
+         | p[3];
+}
+
+inline uint16_t
+FixedSizeHeader::ReadU16 (uint8_t const *p)
+{
+  return (static_cast<uint16_t> (p[1]) << 8) | p[0];
+}
+
+inline uint16_t
+FixedSizeHeader::CalculateIpChecksum (uint8_t const *p, uint32_t size)
+{
+  return static_cast<uint16_t> (~IpChecksum::Fold (IpChecksum::Sum (p, size)));
+}
+
+} // namespace ns3
+
+#endif /* FIXED_SIZE_HEADER_H */
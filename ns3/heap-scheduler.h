@@ -70,6 +70,7 @@ public:
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
   virtual void Remove (const Scheduler::Event &ev);
+  virtual uint32_t RemoveCancelled (void);
 
 private:
   /** Event list type:  vector of Events, managed as a heap. */
@@ -166,4 +167,40 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline uint32_t
+HeapScheduler::RemoveCancelled (void)
+{
+  // Slot 0 of m_heap is unused: the root is at index 1.
+  std::size_t last = 1;
+  for (std::size_t i = 1; i < m_heap.size (); i++)
+    {
+      if (m_heap[i].impl->IsCancelled ())
+        {
+          m_heap[i].impl->Unref ();
+        }
+      else
+        {
+          m_heap[last] = m_heap[i];
+          last++;
+        }
+    }
+  uint32_t removed = m_heap.size () - last;
+  m_heap.resize (last);
+  // Rebuild the heap bottom-up, in O(n).
+  for (std::size_t i = Last () / 2; i >= 1; i--)
+    {
+      TopDown (i);
+    }
+  return removed;
+}
+
+} // namespace ns3
+
 #endif /* HEAP_SCHEDULER_H */
@@ -82,8 +82,10 @@
 #include "ripng-helper.h"
 #include "ripng.h"
 #include "rtt-estimator.h"
+#include "tcp-bbr.h"
 #include "tcp-bic.h"
 #include "tcp-congestion-ops.h"
+#include "tcp-dctcp.h"
 #include "tcp-header.h"
 #include "tcp-highspeed.h"
 #include "tcp-htcp.h"
@@ -92,21 +94,27 @@
 #include "tcp-l4-protocol.h"
 #include "tcp-ledbat.h"
 #include "tcp-lp.h"
+#include "tcp-offload.h"
 #include "tcp-option-rfc793.h"
 #include "tcp-option-sack-permitted.h"
 #include "tcp-option-sack.h"
 #include "tcp-option-ts.h"
 #include "tcp-option-winscale.h"
 #include "tcp-option.h"
+#include "tcp-pacer.h"
 #include "tcp-prr-recovery.h"
+#include "tcp-rate-ops.h"
 #include "tcp-recovery-ops.h"
 #include "tcp-rx-buffer.h"
+#include "tcp-rx-ring-buffer.h"
 #include "tcp-scalable.h"
 #include "tcp-socket-base.h"
 #include "tcp-socket-factory.h"
 #include "tcp-socket-state.h"
 #include "tcp-socket.h"
 #include "tcp-tx-buffer.h"
+#include "tcp-tx-item.h"
+#include "tcp-tx-scoreboard.h"
 #include "tcp-vegas.h"
 #include "tcp-veno.h"
 #include "tcp-westwood.h"
@@ -0,0 +1,171 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef IP_CHECKSUM_H
+#define IP_CHECKSUM_H
+
+#include <stdint.h>
+#include <cstring>
+
+#if defined (__SSE2__)
+#define NS3_IP_CHECKSUM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/**
+ * \file
+ * \ingroup packet
+ * ns3::IpChecksum declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief Internet checksum kernels (RFC 1071 and RFC 1624).
+ *
+ * The Internet checksum is the ones' complement of the ones' complement
+ * sum of the 16 bit words of the data. As 2^16 = 1 modulo 2^16 - 1,
+ * the sum of the 32 bit words, or of any wider words, folded to 16 bits
+ * is the same value: Sum() adds 16 bytes at a time with SSE2, where
+ * available, or 8 bytes at a time otherwise, into 64 bit accumulators
+ * which cannot overflow for any packet size.
+ *
+ * The words are read in little endian order, as Buffer::Iterator::ReadU16
+ * does: the checksums are stored with Buffer::Iterator::WriteU16, so that
+ * the bytes on the wire are the ones of a big endian computation.
+ */
+class IpChecksum
+{
+public:
+  /**
+   * Add the 16 bit words of bytes, in little endian order; the last
+   * byte of an odd size is the low byte of a word.
+   *
+   * \param [in] p The bytes.
+   * \param [in] size The number of bytes.
+   * \returns The sum, not folded.
+   */
+  static uint64_t Sum (uint8_t const *p, uint32_t size);
+  /**
+   * Fold a sum to 16 bits.
+   *
+   * \param [in] sum The sum, as returned by Sum().
+   * \returns The ones' complement sum, not complemented.
+   */
+  static uint16_t Fold (uint64_t sum);
+  /**
+   * Update a checksum after one 16 bit word of the data changed,
+   * with eqn. 3 of RFC 1624: HC' = ~(~HC + ~m + m'). The words are in
+   * the byte order of the checksum.
+   *
+   * \param [in] checksum The checksum of the data.
+   * \param [in] oldWord The word before the change.
+   * \param [in] newWord The word after the change.
+   * \returns The checksum of the changed data.
+   */
+  static uint16_t Update (uint16_t checksum, uint16_t oldWord, uint16_t newWord);
+
+private:
+  /**
+   * The portable part of Sum().
+   *
+   * \param [in] p The bytes.
+   * \param [in] size The number of bytes.
+   * \returns The sum, not folded.
+   */
+  static uint64_t SumScalar (uint8_t const *p, uint32_t size);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline uint64_t
+IpChecksum::SumScalar (uint8_t const *p, uint32_t size)
+{
+  uint64_t sum = 0;
+#if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // Two 32 bit words per load; memcpy makes the unaligned loads legal.
+  for (; size >= 8; size -= 8, p += 8)
+    {
+      uint64_t v;
+      std::memcpy (&v, p, 8);
+      sum += (v & 0xffffffff) + (v >> 32);
+    }
+#endif
+  for (; size >= 2; size -= 2, p += 2)
+    {
+      sum += p[0] | (static_cast<uint32_t> (p[1]) << 8);
+    }
+  if (size == 1)
+    {
+      sum += p[0];
+    }
+  return sum;
+}
+
+inline uint64_t
+IpChecksum::Sum (uint8_t const *p, uint32_t size)
+{
+#ifdef NS3_IP_CHECKSUM_SSE2
+  if (size >= 32)
+    {
+      // Each 32 bit lane is widened to 64 bits before the addition.
+      __m128i zero = _mm_setzero_si128 ();
+      __m128i acc = zero;
+      for (; size >= 16; size -= 16, p += 16)
+        {
+          __m128i v = _mm_loadu_si128 (reinterpret_cast<__m128i const *> (p));
+          acc = _mm_add_epi64 (acc, _mm_unpacklo_epi32 (v, zero));
+          acc = _mm_add_epi64 (acc, _mm_unpackhi_epi32 (v, zero));
+        }
+      uint64_t lanes[2];
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (lanes), acc);
+      return lanes[0] + lanes[1] + SumScalar (p, size);
+    }
+#endif /* NS3_IP_CHECKSUM_SSE2 */
+  return SumScalar (p, size);
+}
+
+inline uint16_t
+IpChecksum::Fold (uint64_t sum)
+{
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  return static_cast<uint16_t> (sum);
+}
+
+inline uint16_t
+IpChecksum::Update (uint16_t checksum, uint16_t oldWord, uint16_t newWord)
+{
+  uint32_t sum = static_cast<uint16_t> (~checksum);
+  sum += static_cast<uint16_t> (~oldWord);
+  sum += newWord;
+  return static_cast<uint16_t> (~Fold (sum));
+}
+
+} // namespace ns3
+
+#endif /* IP_CHECKSUM_H */
@@ -23,6 +23,9 @@
 
 #include "ns3/header.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/fixed-size-header.h"
+#include "ns3/ip-checksum.h"
+#include "ns3/abort.h"
 
 namespace ns3 {
 /**
@@ -146,6 +149,14 @@ public:
    * \param ttl the ipv4 TTL
    */
   void SetTtl (uint8_t ttl);
+  /**
+   * \brief Decrement the TTL, as a router forwarding the packet does.
+   *
+   * If the header was deserialized with a correct checksum and not
+   * changed since, the checksum is updated incrementally (\RFC{1624})
+   * instead of being recalculated when the header is serialized.
+   */
+  void DecrementTtl (void);
   /**
    * \param num the ipv4 protocol field
    */
@@ -235,6 +246,26 @@ public:
   virtual uint32_t GetSerializedSize (void) const;
   virtual void Serialize (Buffer::Iterator start) const;
   virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  /** Size of a header without options, for Packet::AddHeader. */
+  static const uint32_t FIXED_SIZE = 20;
+  /**
+   * Serialize the header, without options, for Packet::AddHeader.
+   *
+   * \param [out] buffer The FIXED_SIZE bytes to write.
+   * \param [in] size The size of the packet.
+   * \returns false if the header has options.
+   */
+  bool SerializeFixed (uint8_t *buffer, uint32_t size) const;
+  /**
+   * Deserialize a header without options, for Packet::RemoveHeader.
+   *
+   * \param [in] buffer The FIXED_SIZE bytes to read.
+   * \param [in] size The size of the packet.
+   * \returns FIXED_SIZE, or 0 if the header is not an IPv4 header
+   *          without options.
+   */
+  uint32_t DeserializeFixed (uint8_t const *buffer, uint32_t size);
 private:
 
   /// flags related to IP fragmentation
@@ -257,9 +288,229 @@ private:
   uint16_t m_checksum; //!< checksum
   bool m_goodChecksum; //!< true if checksum is correct
   uint16_t m_headerSize; //!< IP header size
+  /**
+   * true if m_checksum is the checksum of the header fields: set by
+   * DeserializeFixed and kept by DecrementTtl, cleared by the setters.
+   */
+  bool m_checksumValid;
 };
 
 } // namespace ns3
 
 
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+Ipv4Header::Ipv4Header ()
+  : m_calcChecksum (false),
+    m_payloadSize (0),
+    m_identification (0),
+    m_tos (0),
+    m_ttl (0),
+    m_protocol (0),
+    m_flags (0),
+    m_fragmentOffset (0),
+    m_checksum (0),
+    m_goodChecksum (true),
+    m_headerSize (5*4),
+    m_checksumValid (false)
+{
+}
+
+inline void
+Ipv4Header::SetPayloadSize (uint16_t size)
+{
+  m_payloadSize = size;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetIdentification (uint16_t identification)
+{
+  m_identification = identification;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetTos (uint8_t tos)
+{
+  m_tos = tos;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetDscp (DscpType dscp)
+{
+  m_tos &= 0x3; // Clear out the DSCP part, retain 2 bits of ECN
+  m_tos |= (dscp << 2);
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetEcn (EcnType ecn)
+{
+  m_tos &= 0xFC; // Clear out the ECN part, retain 6 bits of DSCP
+  m_tos |= ecn;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetMoreFragments (void)
+{
+  m_flags |= MORE_FRAGMENTS;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetLastFragment (void)
+{
+  m_flags &= ~MORE_FRAGMENTS;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetDontFragment (void)
+{
+  m_flags |= DONT_FRAGMENT;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetMayFragment (void)
+{
+  m_flags &= ~DONT_FRAGMENT;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetFragmentOffset (uint16_t offsetBytes)
+{
+  // check if the user is trying to set an invalid offset
+  NS_ABORT_MSG_IF ((offsetBytes & 0x7), "offsetBytes must be multiple of 8 bytes");
+  m_fragmentOffset = offsetBytes;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetTtl (uint8_t ttl)
+{
+  m_ttl = ttl;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::DecrementTtl (void)
+{
+  // The TTL is the first byte of the word at offset 8, i.e., the low
+  // byte in the little endian order of the checksum.
+  uint16_t oldWord = m_ttl | (m_protocol << 8);
+  m_ttl = m_ttl - 1;
+  if (m_checksumValid)
+    {
+      m_checksum = IpChecksum::Update (m_checksum, oldWord, m_ttl | (m_protocol << 8));
+    }
+}
+
+inline void
+Ipv4Header::SetProtocol (uint8_t num)
+{
+  m_protocol = num;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetSource (Ipv4Address source)
+{
+  m_source = source;
+  m_checksumValid = false;
+}
+
+inline void
+Ipv4Header::SetDestination (Ipv4Address destination)
+{
+  m_destination = destination;
+  m_checksumValid = false;
+}
+
+inline bool
+Ipv4Header::SerializeFixed (uint8_t *buffer, uint32_t size) const
+{
+  NS_UNUSED (size);
+  if (m_headerSize != FIXED_SIZE)
+    {
+      return false;
+    }
+  // Same layout as Serialize.
+  uint32_t fragmentOffset = m_fragmentOffset / 8;
+  uint8_t flagsFrag = (fragmentOffset >> 8) & 0x1f;
+  if (m_flags & DONT_FRAGMENT)
+    {
+      flagsFrag |= (1<<6);
+    }
+  if (m_flags & MORE_FRAGMENTS)
+    {
+      flagsFrag |= (1<<5);
+    }
+  buffer[0] = (4 << 4) | 5;
+  buffer[1] = m_tos;
+  FixedSizeHeader::WriteHtonU16 (buffer + 2, m_payloadSize + FIXED_SIZE);
+  FixedSizeHeader::WriteHtonU16 (buffer + 4, m_identification);
+  buffer[6] = flagsFrag;
+  buffer[7] = fragmentOffset & 0xff;
+  buffer[8] = m_ttl;
+  buffer[9] = m_protocol;
+  buffer[10] = 0;
+  buffer[11] = 0;
+  FixedSizeHeader::WriteHtonU32 (buffer + 12, m_source.Get ());
+  FixedSizeHeader::WriteHtonU32 (buffer + 16, m_destination.Get ());
+  if (m_calcChecksum)
+    {
+      FixedSizeHeader::WriteU16 (buffer + 10, m_checksumValid ? m_checksum : FixedSizeHeader::CalculateIpChecksum (buffer, FIXED_SIZE));
+    }
+  return true;
+}
+
+inline uint32_t
+Ipv4Header::DeserializeFixed (uint8_t const *buffer, uint32_t size)
+{
+  NS_UNUSED (size);
+  m_checksumValid = false;
+  if (buffer[0] != ((4 << 4) | 5))
+    {
+      // Options, or not IPv4: let Deserialize handle it.
+      return 0;
+    }
+  m_tos = buffer[1];
+  m_payloadSize = FixedSizeHeader::ReadNtohU16 (buffer + 2) - FIXED_SIZE;
+  m_identification = FixedSizeHeader::ReadNtohU16 (buffer + 4);
+  m_flags = 0;
+  if (buffer[6] & (1<<6))
+    {
+      m_flags |= DONT_FRAGMENT;
+    }
+  if (buffer[6] & (1<<5))
+    {
+      m_flags |= MORE_FRAGMENTS;
+    }
+  m_fragmentOffset = (((buffer[6] & 0x1f) << 8) | buffer[7]) << 3;
+  m_ttl = buffer[8];
+  m_protocol = buffer[9];
+  m_checksum = FixedSizeHeader::ReadU16 (buffer + 10);
+  m_source.Set (FixedSizeHeader::ReadNtohU32 (buffer + 12));
+  m_destination.Set (FixedSizeHeader::ReadNtohU32 (buffer + 16));
+  m_headerSize = FIXED_SIZE;
+  if (m_calcChecksum)
+    {
+      m_goodChecksum = FixedSizeHeader::CalculateIpChecksum (buffer, FIXED_SIZE) == 0;
+      m_checksumValid = m_goodChecksum;
+    }
+  return FIXED_SIZE;
+}
+
+} // namespace ns3
+
 #endif /* IPV4_HEADER_H */
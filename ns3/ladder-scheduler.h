@@ -0,0 +1,528 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include "assert.h"
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::LadderScheduler declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue described in
+ * "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation" by W. T. Tang, R. S. M. Goh and
+ * I. L.-J. Thng (ACM TOMACS, 2005).
+ *
+ * The event set is split in three tiers:
+ *  - Top: an unsorted vector holding every event at or beyond
+ *    m_topStart. Inserting there is a push_back.
+ *  - Ladder: a stack of rungs, each one an array of unsorted buckets.
+ *    When Bottom runs dry, the earliest non-empty bucket of the
+ *    innermost rung is either moved to Bottom or, if it holds more
+ *    than kThreshold events, spread over a new, finer rung.
+ *  - Bottom: a short sorted vector from which events are dequeued.
+ *
+ * Unlike the CalendarScheduler, the bucket width is never globally
+ * recomputed: each rung is sized once, from the events it receives, so
+ * there is no equivalent of the ResizeUp/ResizeDown rebuild and both
+ * Insert and RemoveNext run in O(1) amortized time for the event time
+ * distributions commonly found in network simulations.
+ *
+ * Remove is O(n) in the size of the tier holding the event, as
+ * for the ListScheduler. RemoveCancelled sweeps every tier in place
+ * and keeps the bucket boundaries, so it does not reorganize the ladder.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  LadderScheduler ();
+  /** Destructor. */
+  virtual ~LadderScheduler ();
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+  virtual uint32_t RemoveCancelled (void);
+
+private:
+  /** Bucket type: an unsorted vector of Events. */
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  /** A rung of the ladder: an array of buckets of equal width. */
+  struct Rung
+  {
+    std::vector<Bucket> buckets; /**< The buckets of this rung. */
+    uint64_t start;              /**< Timestamp of the start of bucket 0. */
+    uint64_t width;              /**< Width of each bucket. */
+    uint32_t current;            /**< Index of the first unconsumed bucket. */
+    uint32_t count;              /**< Number of events held by this rung. */
+  };
+
+  /**
+   * Maximum number of events moved to Bottom at once before the
+   * source is spread over a new rung.
+   */
+  static const uint32_t kThreshold = 50;
+  /** Average number of events per bucket targeted when sizing a rung. */
+  static const uint32_t kBucketLoad = 16;
+  /** Maximum number of rungs. */
+  static const uint32_t kMaxRungs = 8;
+
+  /**
+   * Get the timestamp of the first unconsumed bucket of a rung.
+   *
+   * \param [in] rung The rung.
+   * \returns The lowest timestamp which can still be stored in \p rung.
+   */
+  static uint64_t CurrentStart (const Rung &rung);
+  /**
+   * Compare two events so that a vector sorted with it holds the
+   * earliest event at its back.
+   *
+   * \param [in] a The first event.
+   * \param [in] b The second event.
+   * \returns \c true if \p a is later than \p b.
+   */
+  static bool Later (const Scheduler::Event &a, const Scheduler::Event &b);
+  /**
+   * Prepare a new innermost rung.
+   *
+   * \param [in] start The timestamp of the first bucket.
+   * \param [in] width The width of each bucket.
+   * \param [in] nBuckets The number of buckets.
+   * \returns The new rung.
+   */
+  Rung & PushRung (uint64_t start, uint64_t width, uint32_t nBuckets);
+  /**
+   * Store an event in the right bucket of a rung.
+   *
+   * \param [in] rung The rung.
+   * \param [in] ev The event.
+   */
+  static void InsertInRung (Rung &rung, const Scheduler::Event &ev);
+  /**
+   * Spread a set of events over a new rung.
+   *
+   * \param [in] events The events to move; cleared on return.
+   * \param [in] start The timestamp of the first bucket of the new rung.
+   * \param [in] span The time interval the new rung must cover, 0 for
+   *             the whole range of 2^64 timestamps.
+   */
+  void Spread (Bucket &events, uint64_t start, uint64_t span);
+  /** Move all events from Top to a new first rung. */
+  void TransferTop (void);
+  /** Refill Bottom if it is empty. */
+  void FillBottom (void);
+  /**
+   * Insert an event in the sorted Bottom vector.
+   *
+   * \param [in] ev The event.
+   */
+  void InsertInBottom (const Scheduler::Event &ev);
+  /**
+   * Remove an event from an unsorted bucket.
+   *
+   * \param [in] bucket The bucket.
+   * \param [in] ev The event.
+   * \returns \c true if \p ev was found and removed.
+   */
+  static bool RemoveFromBucket (Bucket &bucket, const Scheduler::Event &ev);
+  /**
+   * Remove and unreference the cancelled events of a bucket, keeping
+   * the order of the other events.
+   *
+   * \param [in] bucket The bucket.
+   * \returns The number of events removed.
+   */
+  static uint32_t RemoveCancelledFromBucket (Bucket &bucket);
+
+  /** Events at or beyond m_topStart, unsorted. */
+  Bucket m_top;
+  /** Smallest timestamp stored in m_top. */
+  uint64_t m_topMin;
+  /** Largest timestamp stored in m_top. */
+  uint64_t m_topMax;
+  /** Events with a timestamp at or beyond this value go to Top. */
+  uint64_t m_topStart;
+  /**
+   * The rungs, outermost first. Only the first m_nRungs are in use:
+   * the others are kept to recycle their bucket storage.
+   */
+  std::vector<Rung> m_rungs;
+  /** Number of rungs in use. */
+  uint32_t m_nRungs;
+  /** The earliest events, sorted by decreasing key. */
+  Bucket m_bottom;
+  /** Number of events in the queue. */
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+inline
+LadderScheduler::LadderScheduler ()
+  : m_topMin (0),
+    m_topMax (0),
+    m_topStart (0),
+    m_nRungs (0),
+    m_size (0)
+{
+  // Rung references stay valid while new rungs are pushed.
+  m_rungs.reserve (kMaxRungs);
+}
+
+inline
+LadderScheduler::~LadderScheduler ()
+{
+}
+
+inline uint64_t
+LadderScheduler::CurrentStart (const Rung &rung)
+{
+  return rung.start + rung.current * rung.width;
+}
+
+inline bool
+LadderScheduler::Later (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return b.key < a.key;
+}
+
+inline LadderScheduler::Rung &
+LadderScheduler::PushRung (uint64_t start, uint64_t width, uint32_t nBuckets)
+{
+  NS_ASSERT (m_nRungs < kMaxRungs);
+  if (m_nRungs == m_rungs.size ())
+    {
+      m_rungs.push_back (Rung ());
+    }
+  Rung &rung = m_rungs[m_nRungs];
+  m_nRungs++;
+  rung.start = start;
+  rung.width = width;
+  rung.current = 0;
+  rung.count = 0;
+  if (rung.buckets.size () < nBuckets)
+    {
+      rung.buckets.resize (nBuckets);
+    }
+  for (uint32_t i = 0; i < nBuckets; i++)
+    {
+      rung.buckets[i].clear ();
+    }
+  rung.buckets.resize (nBuckets);
+  return rung;
+}
+
+inline void
+LadderScheduler::InsertInRung (Rung &rung, const Scheduler::Event &ev)
+{
+  uint64_t index = (ev.key.m_ts - rung.start) / rung.width;
+  NS_ASSERT (index >= rung.current && index < rung.buckets.size ());
+  rung.buckets[index].push_back (ev);
+  rung.count++;
+}
+
+inline void
+LadderScheduler::Spread (Bucket &events, uint64_t start, uint64_t span)
+{
+  // Work from the last offset of the interval, span - 1, so that a
+  // span of 2^64 (0) neither overflows nor yields a zero width.
+  uint64_t last = span - 1;
+  uint64_t n = std::max<uint64_t> (events.size () / kBucketLoad, 1);
+  uint64_t width = last / n + 1;
+  uint32_t nBuckets = last / width + 1;
+  Rung &rung = PushRung (start, width, nBuckets);
+  for (Bucket::const_iterator i = events.begin (); i != events.end (); i++)
+    {
+      InsertInRung (rung, *i);
+    }
+  events.clear ();
+}
+
+inline void
+LadderScheduler::TransferTop (void)
+{
+  NS_ASSERT (m_nRungs == 0 && !m_top.empty ());
+  uint64_t start = m_topMin;
+  // Wraps to 0 when Top holds both 0 and the largest timestamp
+  uint64_t span = m_topMax - m_topMin + 1;
+  Spread (m_top, start, span);
+  const Rung &rung = m_rungs[0];
+  uint64_t lastStart = rung.start + (rung.buckets.size () - 1) * rung.width;
+  if (rung.width > std::numeric_limits<uint64_t>::max () - lastStart)
+    {
+      // The rung reaches the end of the time range
+      m_topStart = std::numeric_limits<uint64_t>::max ();
+    }
+  else
+    {
+      m_topStart = lastStart + rung.width;
+    }
+}
+
+inline void
+LadderScheduler::FillBottom (void)
+{
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          TransferTop ();
+        }
+      Rung &rung = m_rungs[m_nRungs - 1];
+      if (rung.count == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      Bucket &bucket = rung.buckets[rung.current];
+      uint64_t bucketStart = CurrentStart (rung);
+      rung.current++;
+      rung.count -= bucket.size ();
+      if (bucket.size () > kThreshold
+          && rung.width > 1
+          && m_nRungs < kMaxRungs)
+        {
+          Spread (bucket, bucketStart, rung.width);
+        }
+      else
+        {
+          m_bottom.swap (bucket);
+          std::sort (m_bottom.begin (), m_bottom.end (), &LadderScheduler::Later);
+        }
+    }
+}
+
+inline void
+LadderScheduler::InsertInBottom (const Scheduler::Event &ev)
+{
+  Bucket::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (),
+                                         ev, &LadderScheduler::Later);
+  m_bottom.insert (i, ev);
+  if (m_bottom.size () > kThreshold && m_nRungs < kMaxRungs)
+    {
+      // Bottom is the slowest tier to insert into: spread it over a new
+      // rung reaching up to the first timestamp owned by the ladder.
+      uint64_t limit = m_nRungs == 0 ? m_topStart : CurrentStart (m_rungs[m_nRungs - 1]);
+      uint64_t start = m_bottom.back ().key.m_ts;
+      if (limit - start > 1)
+        {
+          Spread (m_bottom, start, limit - start);
+        }
+    }
+}
+
+inline bool
+LadderScheduler::RemoveFromBucket (Bucket &bucket, const Scheduler::Event &ev)
+{
+  for (Bucket::iterator i = bucket.begin (); i != bucket.end (); i++)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (ev.impl == i->impl);
+          *i = bucket.back ();
+          bucket.pop_back ();
+          return true;
+        }
+    }
+  return false;
+}
+
+inline uint32_t
+LadderScheduler::RemoveCancelledFromBucket (Bucket &bucket)
+{
+  Bucket::iterator last = bucket.begin ();
+  for (Bucket::iterator i = bucket.begin (); i != bucket.end (); i++)
+    {
+      if (i->impl->IsCancelled ())
+        {
+          i->impl->Unref ();
+        }
+      else
+        {
+          *last = *i;
+          last++;
+        }
+    }
+  uint32_t removed = bucket.end () - last;
+  bucket.erase (last, bucket.end ());
+  return removed;
+}
+
+inline void
+LadderScheduler::Insert (const Scheduler::Event &ev)
+{
+  m_size++;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      else
+        {
+          m_topMin = std::min (m_topMin, ts);
+          m_topMax = std::max (m_topMax, ts);
+        }
+      m_top.push_back (ev);
+      return;
+    }
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung &rung = m_rungs[i];
+      if (ts >= CurrentStart (rung))
+        {
+          InsertInRung (rung, ev);
+          return;
+        }
+    }
+  InsertInBottom (ev);
+}
+
+inline bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+inline Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  // Refilling Bottom does not change the logical content of the queue.
+  const_cast<LadderScheduler *> (this)->FillBottom ();
+  return m_bottom.back ();
+}
+
+inline Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  FillBottom ();
+  Scheduler::Event ev = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  return ev;
+}
+
+inline void
+LadderScheduler::Remove (const Scheduler::Event &ev)
+{
+  NS_ASSERT (!IsEmpty ());
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      bool found = RemoveFromBucket (m_top, ev);
+      NS_ASSERT (found);
+      m_size--;
+      return;
+    }
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung &rung = m_rungs[i];
+      if (ts >= CurrentStart (rung))
+        {
+          uint64_t index = (ts - rung.start) / rung.width;
+          bool found = RemoveFromBucket (rung.buckets[index], ev);
+          NS_ASSERT (found);
+          rung.count--;
+          m_size--;
+          return;
+        }
+    }
+  Bucket::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (),
+                                         ev, &LadderScheduler::Later);
+  NS_ASSERT (i != m_bottom.end () && i->key.m_uid == ev.key.m_uid);
+  m_bottom.erase (i);
+  m_size--;
+}
+
+inline uint32_t
+LadderScheduler::RemoveCancelled (void)
+{
+  // m_topMin and m_topMax may become loose bounds, which only
+  // affects the width of the next first rung.
+  uint32_t removed = RemoveCancelledFromBucket (m_top);
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung &rung = m_rungs[i];
+      for (uint32_t j = rung.current; j < rung.buckets.size (); j++)
+        {
+          uint32_t n = RemoveCancelledFromBucket (rung.buckets[j]);
+          rung.count -= n;
+          removed += n;
+        }
+    }
+  removed += RemoveCancelledFromBucket (m_bottom);
+  m_size -= removed;
+  return removed;
+}
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
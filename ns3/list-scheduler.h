@@ -63,6 +63,7 @@ public:
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
   virtual void Remove (const Scheduler::Event &ev);
+  virtual uint32_t RemoveCancelled (void);
 
 private:
   /** Event list type: a simple list of Events. */
@@ -76,4 +77,34 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline uint32_t
+ListScheduler::RemoveCancelled (void)
+{
+  uint32_t removed = 0;
+  EventsI i = m_events.begin ();
+  while (i != m_events.end ())
+    {
+      if (i->impl->IsCancelled ())
+        {
+          i->impl->Unref ();
+          i = m_events.erase (i);
+          removed++;
+        }
+      else
+        {
+          i++;
+        }
+    }
+  return removed;
+}
+
+} // namespace ns3
+
 #endif /* LIST_SCHEDULER_H */
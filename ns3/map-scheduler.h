@@ -61,6 +61,7 @@ public:
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
   virtual void Remove (const Scheduler::Event &ev);
+  virtual uint32_t RemoveCancelled (void);
 
 private:
   /** Event list type: a Map from EventKey to EventImpl. */
@@ -76,4 +77,34 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline uint32_t
+MapScheduler::RemoveCancelled (void)
+{
+  uint32_t removed = 0;
+  EventMapI i = m_list.begin ();
+  while (i != m_list.end ())
+    {
+      if (i->second->IsCancelled ())
+        {
+          i->second->Unref ();
+          m_list.erase (i++);
+          removed++;
+        }
+      else
+        {
+          i++;
+        }
+    }
+  return removed;
+}
+
+} // namespace ns3
+
 #endif /* MAP_SCHEDULER_H */
@@ -0,0 +1,166 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include "non-copyable.h"
+#include <atomic>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup thread
+ * ns3::MpscQueue declaration and template implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup thread
+ * \brief A lock-free, unbounded, multiple producer single consumer queue.
+ *
+ * Producers push items one at a time with a compare-and-swap on the
+ * head of a singly linked list. The consumer takes the whole list at
+ * once with a single atomic exchange, so draining a batch costs one
+ * atomic operation whatever its size; the batch is handed out in push
+ * order. Since the consumer never removes a single node, the list
+ * is not exposed to the ABA problem.
+ *
+ * Typical use is the injection of events in the simulator main loop by
+ * foreign threads: IsEmpty() is a single relaxed load, cheap enough to
+ * be polled before every event.
+ *
+ * \tparam T \explicit The item type.
+ */
+template <typename T>
+class MpscQueue : private NonCopyable
+{
+public:
+  /** Constructor. */
+  MpscQueue ();
+  /** Destructor: the items still queued are discarded. */
+  ~MpscQueue ();
+
+  /**
+   * Push an item. Can be called from any thread.
+   *
+   * \param [in] item The item.
+   */
+  void Push (const T &item);
+  /**
+   * Test if the queue is empty. Can be called from any thread, but
+   * the answer may be stale by the time it is used, except by the
+   * consumer for a \c false answer.
+   *
+   * \returns \c true if no item is queued.
+   */
+  bool IsEmpty (void) const;
+  /**
+   * Move all the queued items to a vector, in push order. Must only be
+   * called by the consumer.
+   *
+   * \param [out] items The vector the items are appended to.
+   * \returns The number of items appended.
+   */
+  std::size_t PopAll (std::vector<T> &items);
+
+private:
+  /** A queued item. */
+  struct Node
+  {
+    T item;     /**< The item. */
+    Node *next; /**< The node pushed before this one. */
+  };
+
+  /** The last pushed node. */
+  std::atomic<Node *> m_head;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the templates declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+template <typename T>
+MpscQueue<T>::MpscQueue ()
+  : m_head (0)
+{
+}
+
+template <typename T>
+MpscQueue<T>::~MpscQueue ()
+{
+  Node *node = m_head.exchange (0);
+  while (node != 0)
+    {
+      Node *next = node->next;
+      delete node;
+      node = next;
+    }
+}
+
+template <typename T>
+void
+MpscQueue<T>::Push (const T &item)
+{
+  Node *node = new Node;
+  node->item = item;
+  node->next = m_head.load (std::memory_order_relaxed);
+  while (!m_head.compare_exchange_weak (node->next, node,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed))
+    {
+    }
+}
+
+template <typename T>
+bool
+MpscQueue<T>::IsEmpty (void) const
+{
+  return m_head.load (std::memory_order_relaxed) == 0;
+}
+
+template <typename T>
+std::size_t
+MpscQueue<T>::PopAll (std::vector<T> &items)
+{
+  Node *node = m_head.exchange (0, std::memory_order_acquire);
+  // The list is in reverse push order.
+  std::size_t count = 0;
+  for (Node *i = node; i != 0; i = i->next)
+    {
+      count++;
+    }
+  std::size_t start = items.size ();
+  items.resize (start + count);
+  for (std::size_t i = start + count; i > start; i--)
+    {
+      Node *next = node->next;
+      items[i - 1] = node->item;
+      delete node;
+      node = next;
+    }
+  return count;
+}
+
+} // namespace ns3
+
+#endif /* MPSC_QUEUE_H */
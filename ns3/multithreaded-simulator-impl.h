@@ -0,0 +1,1364 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/event-profiler.h"
+#include "ns3/simulation-snapshot.h"
+#include "ns3/make-event.h"
+#include "ns3/system-thread.h"
+#include "ns3/mpsc-queue.h"
+#include "ns3/tombstone-tracker.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/fatal-error.h"
+#include "ns3/ptr.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/net-device.h"
+#include "ns3/channel.h"
+#include "ns3/channel-list.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/nstime.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+/**
+ * \file
+ * \ingroup mtp
+ * ns3::MultithreadedSimulatorImpl declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \defgroup mtp Multithreaded Parallel Simulation
+ *
+ * Conservative parallel simulation of a single topology by the worker
+ * threads of one process, without MPI.
+ */
+
+/**
+ * \ingroup mtp
+ * \ingroup simulator
+ *
+ * \brief A conservative parallel simulator running on the threads of
+ * a single process.
+ *
+ * When Run() is first called, the nodes of the NodeList are split in
+ * partitions, one per worker thread, each with its own Scheduler:
+ *  - the nodes attached to a same channel are kept in the same
+ *    partition, unless the channel is a PointToPointChannel with a
+ *    strictly positive delay;
+ *  - the resulting groups of nodes are assigned to at most
+ *    \c MaxThreads partitions, largest group first, to the least
+ *    loaded partition.
+ *
+ * The lookahead is the smallest delay of the point-to-point channels
+ * which link two different partitions. The simulation then proceeds by
+ * windows: if \c T is the earliest timestamp of all partitions, every
+ * partition processes in parallel its events earlier than
+ * \c T + lookahead. Events scheduled by a partition for another one are
+ * buffered in per-destination outboxes and inserted by the destination
+ * after the window, so no lock is taken on the event path; the worker
+ * threads only meet at a spinning barrier built on std::atomic.
+ *
+ * Events without context (Simulator::NO_CONTEXT), such as those scheduled
+ * from main() or by Simulator::Stop(), are global: they run one at a time
+ * on the main thread, while all the partitions are stopped at a window
+ * boundary, and can thus touch any node.
+ *
+ * Results do not depend on thread timing: event uids are allocated per
+ * partition, and outboxes are drained in a fixed order.
+ *
+ * To use it:
+ * \code
+ *   GlobalValue::Bind ("SimulatorImplementationType",
+ *                      StringValue ("ns3::MultithreadedSimulatorImpl"));
+ * \endcode
+ *
+ * Limitations:
+ *  - ns-3 must be built with NS3_MTP defined. A packet crossing a link is
+ *    referenced by both partitions, so SimpleRefCount then uses an atomic
+ *    reference count, and so do the copy-on-write blocks a packet copy
+ *    shares with its original: the Buffer data, the PacketTagList and
+ *    ByteTagList nodes and the PacketMetadata data. The packet uid
+ *    counter becomes atomic too, so the uids are unique but depend on
+ *    thread timing. The PacketMetadata storage is recycled through
+ *    per-thread free lists.
+ *  - A model must not schedule an event for a node of another partition
+ *    closer in time than the lookahead, nor share mutable state (other
+ *    than through a channel) with models of another partition; a
+ *    violation of the former is a fatal error.
+ *  - Simulator::Stop() called from an event takes effect at the end of
+ *    the current window: the request is only latched, and every
+ *    partition completes the window before the serial phase applies it.
+ *    Simulator::Stop(delay) latches its time the same way: no window
+ *    extends past it, and the events at or after it are left for a
+ *    later Run(); a time within the current window takes effect at its
+ *    end.
+ *  - Seen from another partition during a window, an event is expired
+ *    only if it ran before the window started (see IsExpired()).
+ *  - Cancelled events are left in the event lists as tombstones, and
+ *    with \c LazyRemove Simulator::Remove() does the same; each
+ *    partition compacts its list when the tombstones exceed
+ *    \c CompactionRatio of it (see TombstoneTracker). Only the
+ *    cancellations made by the partition holding the event, or during
+ *    the serial phase, are counted.
+ *  - Checkpoint() and Restore() can only be called outside Run(), or
+ *    from a global event.
+ *  - Other threads, such as emulation readers, can only use
+ *    Simulator::ScheduleWithContext(): their events are queued in a
+ *    lock-free MpscQueue, and inserted at the next window boundary with
+ *    a delay relative to it.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  MultithreadedSimulatorImpl ();
+  /** Destructor. */
+  ~MultithreadedSimulatorImpl ();
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (const Time &delay);
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+  virtual void Checkpoint (SimulationSnapshot &snapshot);
+  virtual void Restore (const SimulationSnapshot &snapshot);
+
+  /**
+   * Get the number of partitions, i.e. of threads used by Run().
+   *
+   * \returns The number of partitions, or zero before the first Run().
+   */
+  uint32_t GetNPartitions (void) const;
+  /**
+   * Get the partition of a node.
+   *
+   * \param [in] context The node id.
+   * \returns The partition index.
+   */
+  uint32_t GetPartition (uint32_t context) const;
+  /**
+   * Get the lookahead used to size the parallel windows.
+   *
+   * \returns The lookahead, or GetMaximumSimulationTime() if no
+   * channel links two partitions.
+   */
+  Time GetLookahead (void) const;
+  /**
+   * Get the number of events run by a partition.
+   *
+   * \param [in] partition The partition index.
+   * \returns The number of events run.
+   */
+  uint64_t GetEventCount (uint32_t partition) const;
+  /**
+   * Get the lazy deletion counters of all the event lists.
+   *
+   * \returns The sum of the counters of the partitions and of the
+   * global events.
+   */
+  TombstoneTracker::Stats GetTombstoneStats (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /** The event set and clock of one partition, or of the global events. */
+  struct Partition
+  {
+    /** The event priority queue. */
+    Ptr<Scheduler> events;
+    /** Timestamp of the current event. */
+    uint64_t currentTs;
+    /** Execution context of the current event. */
+    uint32_t currentContext;
+    /** Unique id of the current event. */
+    uint32_t currentUid;
+    /**
+     * currentTs at the start of the current window, read by the other
+     * partitions during the window.
+     */
+    uint64_t windowTs;
+    /** currentUid at the start of the current window. */
+    uint32_t windowUid;
+    /** Next event unique id. */
+    uint32_t uid;
+    /** Number of events run. */
+    uint64_t eventCount;
+    /** Lazy deletion bookkeeping of the event list. */
+    TombstoneTracker tombstones;
+    /**
+     * Events scheduled for other partitions during the current window,
+     * indexed by destination partition; the last one is for global events.
+     */
+    std::vector<std::vector<Scheduler::Event> > outbox;
+  };
+
+  /**
+   * Get the partition of the calling thread.
+   *
+   * \returns The partition.
+   */
+  Partition * GetCurrent (void) const;
+  /**
+   * Get the thread-local pointer to the partition run by the calling thread.
+   *
+   * \returns The partition pointer, null for threads which do not run one.
+   */
+  static Partition *& CurrentPartition (void);
+  /**
+   * Find the partition of a context.
+   *
+   * \param [in] context The context.
+   * \returns The partition, or null if the nodes have not been
+   * partitioned yet.
+   */
+  Partition * FindPartition (uint32_t context) const;
+  /**
+   * Create a scheduler from m_schedulerFactory.
+   *
+   * \returns The new scheduler.
+   */
+  Ptr<Scheduler> CreateScheduler (void) const;
+  /**
+   * Get the propagation delay of a point-to-point channel.
+   *
+   * \param [in] link The channel.
+   * \returns The value of its Delay attribute.
+   */
+  static Time GetLinkDelay (Ptr<PointToPointChannel> link);
+  /** Split the nodes in partitions and compute the lookahead. */
+  void DoPartition (void);
+  /** Spinning barrier shared by all the threads of Run(). */
+  void Barrier (void);
+  /** Entry point of the worker threads. */
+  void DoWorker (void);
+  /**
+   * Compute the next window, running the global events which precede it.
+   *
+   * \returns \c true if the simulation is over.
+   */
+  bool DoSerialPhase (void);
+  /**
+   * Run the events of a partition up to the end of the current window.
+   *
+   * \param [in] partition The partition.
+   */
+  void ProcessWindow (Partition *partition);
+  /**
+   * Insert the events sent to a partition during the last window.
+   *
+   * \param [in] index The index of the destination partition, or the
+   * number of partitions for the global events.
+   * \param [in] to The destination partition.
+   */
+  void DrainOutboxes (uint32_t index, Partition *to);
+  /** Insert the events scheduled by foreign threads. */
+  void DrainForeign (void);
+  /**
+   * Insert an event in a partition, allocating its uid.
+   *
+   * \param [in] to The partition.
+   * \param [in] ev The event.
+   */
+  static void Insert (Partition *to, Scheduler::Event &ev);
+  /**
+   * Release all the events of a partition.
+   *
+   * \param [in] partition The partition.
+   */
+  static void Clear (Partition *partition);
+  /**
+   * Record the events of a partition in a snapshot.
+   *
+   * \param [in] partition The partition.
+   * \param [in,out] snapshot The snapshot.
+   */
+  static void Checkpoint (Partition *partition, SimulationSnapshot &snapshot);
+
+  /**
+   * Record the cancellation of an event still in an event list, if it
+   * can be done from the calling thread.
+   *
+   * \param [in] partition The partition of the event, or null.
+   */
+  void NotifyCancel (Partition *partition);
+
+  /** Maximum number of worker threads, including the main thread. */
+  uint32_t m_maxThreads;
+  /** Flag \c true if Remove() leaves a tombstone instead of searching the event list. */
+  bool m_lazyRemove;
+  /** Fraction of tombstones above which an event list is compacted. */
+  double m_compactionRatio;
+  /** Minimum number of tombstones for a compaction. */
+  uint32_t m_compactionMinimum;
+  /** The factory used to create the schedulers. */
+  ObjectFactory m_schedulerFactory;
+  /** The global events, and the clock of the main thread. */
+  Partition m_global;
+  /** The node partitions. */
+  std::vector<Partition *> m_partitions;
+  /** The partition index of each node. */
+  std::vector<uint32_t> m_partitionOf;
+  /** Events with a node context scheduled before the nodes were partitioned. */
+  std::vector<Scheduler::Event> m_pending;
+  /** The lookahead, in time steps. */
+  uint64_t m_lookahead;
+  /** End of the current window, in time steps. */
+  uint64_t m_windowEnd;
+  /** Flag \c true while the partitions run in parallel. */
+  bool m_parallel;
+  /** Flag \c true when the worker threads must exit. */
+  bool m_finished;
+  /**
+   * Flag calling for the end of the simulation. Set by Stop() from any
+   * partition, only read in the serial phase.
+   */
+  std::atomic<bool> m_stop;
+  /**
+   * Earliest time requested by Stop(delay), or the maximum of uint64_t.
+   * Set from any partition, only applied in the serial phase.
+   */
+  std::atomic<uint64_t> m_stopTs;
+  /** Number of threads which reached the barrier. */
+  std::atomic<uint32_t> m_barrierCount;
+  /** Barrier generation, incremented each time all threads reach it. */
+  std::atomic<uint32_t> m_barrierGeneration;
+  /** Index of the next worker thread to start. */
+  std::atomic<uint32_t> m_nextWorker;
+  /** The worker threads. */
+  std::vector<Ptr<SystemThread> > m_threads;
+
+  /**
+   * Events scheduled by foreign threads; their timestamp is relative to
+   * the window boundary at which they are drained.
+   */
+  MpscQueue<Scheduler::Event> m_foreign;
+  /** Buffer reused by DrainForeign(). */
+  std::vector<Scheduler::Event> m_foreignBatch;
+  /** Main execution thread. */
+  SystemThread::ThreadId m_main;
+
+  /** Container type for the events to run at Simulator::Destroy() */
+  typedef std::list<EventId> DestroyEvents;
+  /** The container of events to run at Destroy. */
+  DestroyEvents m_destroyEvents;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Mtp")
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("MaxThreads",
+                   "The maximum number of threads (and partitions), "
+                   "including the main thread. 0 means one per hardware thread.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_maxThreads),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("LazyRemove",
+                   "If true, Simulator::Remove() only cancels the event, "
+                   "which stays in the event list as a tombstone.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&MultithreadedSimulatorImpl::m_lazyRemove),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CompactionRatio",
+                   "Fraction of cancelled events in an event list above which "
+                   "they are all removed in one pass. 0 disables compaction.",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&MultithreadedSimulatorImpl::m_compactionRatio),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("CompactionMinimum",
+                   "Minimum number of cancelled events in an event list "
+                   "for a compaction.",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_compactionMinimum),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+inline
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_maxThreads (0),
+    m_lazyRemove (true),
+    m_compactionRatio (0.5),
+    m_compactionMinimum (1024),
+    m_lookahead (0),
+    m_windowEnd (0),
+    m_parallel (false),
+    m_finished (false),
+    m_stop (false),
+    m_stopTs (std::numeric_limits<uint64_t>::max ()),
+    m_barrierCount (0),
+    m_barrierGeneration (0),
+    m_nextWorker (0)
+{
+  m_global.currentTs = 0;
+  m_global.currentContext = Simulator::NO_CONTEXT;
+  m_global.currentUid = 0;
+  m_global.windowTs = 0;
+  m_global.windowUid = 0;
+  // uid zero is "invalid" EventId
+  // uid 1 is "now" event
+  // uid 2 is "destroy" event
+  m_global.uid = 4;
+  m_global.eventCount = 0;
+  m_main = SystemThread::Self ();
+}
+
+inline
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+}
+
+inline void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  Clear (&m_global);
+  m_global.events = 0;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      Clear (m_partitions[i]);
+      delete m_partitions[i];
+    }
+  m_partitions.clear ();
+  for (uint32_t i = 0; i < m_pending.size (); i++)
+    {
+      m_pending[i].impl->Unref ();
+    }
+  m_pending.clear ();
+  m_foreign.PopAll (m_foreignBatch);
+  for (uint32_t i = 0; i < m_foreignBatch.size (); i++)
+    {
+      m_foreignBatch[i].impl->Unref ();
+    }
+  m_foreignBatch.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+inline void
+MultithreadedSimulatorImpl::Clear (Partition *partition)
+{
+  if (partition->events == 0)
+    {
+      return;
+    }
+  while (!partition->events->IsEmpty ())
+    {
+      Scheduler::Event next = partition->events->RemoveNext ();
+      next.impl->Unref ();
+    }
+  partition->tombstones.Clear ();
+  for (uint32_t i = 0; i < partition->outbox.size (); i++)
+    {
+      std::vector<Scheduler::Event> &box = partition->outbox[i];
+      for (uint32_t j = 0; j < box.size (); j++)
+        {
+          box[j].impl->Unref ();
+        }
+      box.clear ();
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  CurrentPartition () = &m_global;
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+  NS_EVENT_PROFILER_REPORT ();
+}
+
+inline MultithreadedSimulatorImpl::Partition *&
+MultithreadedSimulatorImpl::CurrentPartition (void)
+{
+  static thread_local Partition *current = 0;
+  return current;
+}
+
+inline MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetCurrent (void) const
+{
+  Partition *current = CurrentPartition ();
+  if (current != 0)
+    {
+      return current;
+    }
+  if (m_parallel)
+    {
+      NS_FATAL_ERROR ("MultithreadedSimulatorImpl: events can only be scheduled "
+                      "by the simulation threads");
+    }
+  return const_cast<Partition *> (&m_global);
+}
+
+inline MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::FindPartition (uint32_t context) const
+{
+  if (context == Simulator::NO_CONTEXT)
+    {
+      return const_cast<Partition *> (&m_global);
+    }
+  if (m_partitions.empty ())
+    {
+      return 0;
+    }
+  if (context < m_partitionOf.size ())
+    {
+      return m_partitions[m_partitionOf[context]];
+    }
+  // A node created after the partitioning.
+  return m_partitions[0];
+}
+
+inline Ptr<Scheduler>
+MultithreadedSimulatorImpl::CreateScheduler (void) const
+{
+  return m_schedulerFactory.Create<Scheduler> ();
+}
+
+inline void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  m_schedulerFactory = schedulerFactory;
+  std::vector<Partition *> all (m_partitions);
+  all.push_back (&m_global);
+  for (uint32_t i = 0; i < all.size (); i++)
+    {
+      Ptr<Scheduler> scheduler = CreateScheduler ();
+      if (all[i]->events != 0)
+        {
+          while (!all[i]->events->IsEmpty ())
+            {
+              scheduler->Insert (all[i]->events->RemoveNext ());
+            }
+        }
+      all[i]->events = scheduler;
+      all[i]->tombstones.SetCompaction (m_compactionRatio, m_compactionMinimum);
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::Insert (Partition *to, Scheduler::Event &ev)
+{
+  ev.key.m_uid = to->uid;
+  to->uid++;
+  to->events->Insert (ev);
+  to->tombstones.NotifyInsert ();
+}
+
+inline Time
+MultithreadedSimulatorImpl::GetLinkDelay (Ptr<PointToPointChannel> link)
+{
+  TimeValue delay;
+  link->GetAttribute ("Delay", delay);
+  return delay.Get ();
+}
+
+inline void
+MultithreadedSimulatorImpl::DoPartition (void)
+{
+  uint32_t nNodes = NodeList::GetNNodes ();
+
+  // Group the nodes which share a channel without a usable delay.
+  std::vector<uint32_t> group (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      group[i] = i;
+    }
+  std::vector<Ptr<PointToPointChannel> > links;
+  for (uint32_t i = 0; i < ChannelList::GetNChannels (); i++)
+    {
+      Ptr<Channel> channel = ChannelList::GetChannel (i);
+      Ptr<PointToPointChannel> link = DynamicCast<PointToPointChannel> (channel);
+      if (link != 0 && GetLinkDelay (link).IsStrictlyPositive ())
+        {
+          links.push_back (link);
+          continue;
+        }
+      uint32_t first = Simulator::NO_CONTEXT;
+      for (std::size_t j = 0; j < channel->GetNDevices (); j++)
+        {
+          uint32_t node = channel->GetDevice (j)->GetNode ()->GetId ();
+          while (group[node] != node)
+            {
+              node = group[node];
+            }
+          if (first == Simulator::NO_CONTEXT)
+            {
+              first = node;
+            }
+          else
+            {
+              group[node] = first;
+            }
+        }
+    }
+
+  // Assign the groups, largest first, to the least loaded partition.
+  std::vector<std::pair<uint32_t, uint32_t> > sizes; // (size, root)
+  std::vector<uint32_t> size (nNodes, 0);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      uint32_t root = i;
+      while (group[root] != root)
+        {
+          root = group[root];
+        }
+      group[i] = root;
+      size[root]++;
+    }
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      if (size[i] != 0)
+        {
+          sizes.push_back (std::make_pair (size[i], i));
+        }
+    }
+  std::sort (sizes.begin (), sizes.end (), std::greater<std::pair<uint32_t, uint32_t> > ());
+
+  uint32_t nPartitions = m_maxThreads;
+  if (nPartitions == 0)
+    {
+      nPartitions = std::max<uint32_t> (std::thread::hardware_concurrency (), 1);
+    }
+  nPartitions = std::max<uint32_t> (std::min<uint32_t> (nPartitions, sizes.size ()), 1);
+
+  std::vector<uint32_t> load (nPartitions, 0);
+  std::vector<uint32_t> partitionOfGroup (nNodes, 0);
+  for (uint32_t i = 0; i < sizes.size (); i++)
+    {
+      uint32_t target = std::min_element (load.begin (), load.end ()) - load.begin ();
+      load[target] += sizes[i].first;
+      partitionOfGroup[sizes[i].second] = target;
+    }
+  m_partitionOf.resize (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      m_partitionOf[i] = partitionOfGroup[group[i]];
+    }
+
+  m_lookahead = GetMaximumSimulationTime ().GetTimeStep ();
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      NS_ASSERT (links[i]->GetNDevices () == 2);
+      uint32_t a = links[i]->GetDevice (0)->GetNode ()->GetId ();
+      uint32_t b = links[i]->GetDevice (1)->GetNode ()->GetId ();
+      if (m_partitionOf[a] != m_partitionOf[b])
+        {
+          m_lookahead = std::min<uint64_t> (m_lookahead, GetLinkDelay (links[i]).GetTimeStep ());
+        }
+    }
+
+  for (uint32_t i = 0; i < nPartitions; i++)
+    {
+      Partition *partition = new Partition ();
+      partition->events = CreateScheduler ();
+      partition->currentTs = 0;
+      partition->currentContext = Simulator::NO_CONTEXT;
+      partition->currentUid = 0;
+      partition->windowTs = 0;
+      partition->windowUid = 0;
+      partition->uid = m_global.uid;
+      partition->eventCount = 0;
+      partition->outbox.resize (nPartitions + 1);
+      partition->tombstones.SetCompaction (m_compactionRatio, m_compactionMinimum);
+      m_partitions.push_back (partition);
+    }
+  m_global.outbox.resize (nPartitions + 1);
+
+  // The events scheduled before the partitioning keep their uid.
+  for (uint32_t i = 0; i < m_pending.size (); i++)
+    {
+      Partition *partition = FindPartition (m_pending[i].key.m_context);
+      partition->events->Insert (m_pending[i]);
+      partition->tombstones.NotifyInsert ();
+    }
+  m_pending.clear ();
+}
+
+inline void
+MultithreadedSimulatorImpl::Barrier (void)
+{
+  uint32_t generation = m_barrierGeneration.load (std::memory_order_acquire);
+  if (m_barrierCount.fetch_add (1, std::memory_order_acq_rel) + 1 == m_partitions.size ())
+    {
+      m_barrierCount.store (0, std::memory_order_relaxed);
+      m_barrierGeneration.fetch_add (1, std::memory_order_release);
+      return;
+    }
+  uint32_t spins = 0;
+  while (m_barrierGeneration.load (std::memory_order_acquire) == generation)
+    {
+      if (++spins > 1000)
+        {
+          std::this_thread::yield ();
+        }
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::DrainOutboxes (uint32_t index, Partition *to)
+{
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      std::vector<Scheduler::Event> &box = m_partitions[i]->outbox[index];
+      for (uint32_t j = 0; j < box.size (); j++)
+        {
+          Insert (to, box[j]);
+        }
+      box.clear ();
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::ProcessWindow (Partition *partition)
+{
+  Ptr<Scheduler> events = partition->events;
+  // A Stop() from this or another partition is applied at the barrier,
+  // so the window is run to its end whatever the thread timing.
+  while (!events->IsEmpty ())
+    {
+      Scheduler::Event next = events->PeekNext ();
+      if (next.key.m_ts >= m_windowEnd)
+        {
+          break;
+        }
+      events->RemoveNext ();
+      partition->tombstones.NotifyRemoveNext (next);
+      NS_ASSERT (next.key.m_ts >= partition->currentTs);
+      partition->currentTs = next.key.m_ts;
+      partition->currentContext = next.key.m_context;
+      partition->currentUid = next.key.m_uid;
+      partition->eventCount++;
+      NS_EVENT_PROFILER_INVOKE (next.impl, next.key.m_context);
+      next.impl->Unref ();
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::DrainForeign (void)
+{
+  if (m_foreign.IsEmpty ())
+    {
+      return;
+    }
+  m_foreign.PopAll (m_foreignBatch);
+  uint64_t now = std::max (m_windowEnd, m_global.currentTs);
+  for (uint32_t i = 0; i < m_foreignBatch.size (); i++)
+    {
+      Scheduler::Event &ev = m_foreignBatch[i];
+      // Current time added here, as in the DefaultSimulatorImpl.
+      ev.key.m_ts += now;
+      Insert (FindPartition (ev.key.m_context), ev);
+    }
+  m_foreignBatch.clear ();
+}
+
+inline bool
+MultithreadedSimulatorImpl::DoSerialPhase (void)
+{
+  DrainOutboxes (m_partitions.size (), &m_global);
+  const uint64_t never = GetMaximumSimulationTime ().GetTimeStep ();
+  while (!m_stop.load (std::memory_order_relaxed))
+    {
+      // Before each global event, as DefaultSimulatorImpl does before
+      // each event: a global event which reschedules itself must not
+      // starve the foreign injections.
+      DrainForeign ();
+      uint64_t tMin = never;
+      for (uint32_t i = 0; i < m_partitions.size (); i++)
+        {
+          if (!m_partitions[i]->events->IsEmpty ())
+            {
+              tMin = std::min (tMin, m_partitions[i]->events->PeekNext ().key.m_ts);
+            }
+        }
+      uint64_t tGlobal = never;
+      if (!m_global.events->IsEmpty ())
+        {
+          tGlobal = m_global.events->PeekNext ().key.m_ts;
+        }
+      uint64_t tStop = m_stopTs.load (std::memory_order_relaxed);
+      if (std::min (tMin, tGlobal) >= tStop)
+        {
+          // Like the Stop event of the DefaultSimulatorImpl: the clock
+          // advances to it, and the later events wait for the next Run ().
+          m_global.currentTs = std::max (m_global.currentTs, tStop);
+          m_stopTs = std::numeric_limits<uint64_t>::max ();
+          return true;
+        }
+      if (tMin == never && tGlobal == never)
+        {
+          return true;
+        }
+      if (tGlobal <= tMin)
+        {
+          Scheduler::Event next = m_global.events->RemoveNext ();
+          m_global.tombstones.NotifyRemoveNext (next);
+          m_global.currentTs = next.key.m_ts;
+          m_global.currentContext = next.key.m_context;
+          m_global.currentUid = next.key.m_uid;
+          m_global.eventCount++;
+          NS_EVENT_PROFILER_INVOKE (next.impl, next.key.m_context);
+          next.impl->Unref ();
+          continue;
+        }
+      m_windowEnd = tMin + std::min (m_lookahead, never - tMin);
+      m_windowEnd = std::min (m_windowEnd, std::min (tGlobal, tStop));
+      for (uint32_t i = 0; i < m_partitions.size (); i++)
+        {
+          m_partitions[i]->windowTs = m_partitions[i]->currentTs;
+          m_partitions[i]->windowUid = m_partitions[i]->currentUid;
+        }
+      m_global.windowTs = m_global.currentTs;
+      m_global.windowUid = m_global.currentUid;
+      return false;
+    }
+  return true;
+}
+
+inline void
+MultithreadedSimulatorImpl::DoWorker (void)
+{
+  uint32_t index = m_nextWorker.fetch_add (1);
+  Partition *partition = m_partitions[index];
+  CurrentPartition () = partition;
+  while (true)
+    {
+      Barrier ();
+      if (m_finished)
+        {
+          break;
+        }
+      ProcessWindow (partition);
+      Barrier ();
+      DrainOutboxes (index, partition);
+      Barrier ();
+    }
+  CurrentPartition () = 0;
+}
+
+inline void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_ASSERT_MSG (CurrentPartition () == 0 || CurrentPartition () == &m_global,
+                 "Run() must be called from the main thread");
+  if (m_partitions.empty ())
+    {
+      DoPartition ();
+    }
+  m_stop = false;
+  m_finished = false;
+  m_barrierCount = 0;
+  m_nextWorker = 1;
+  for (uint32_t i = 1; i < m_partitions.size (); i++)
+    {
+      Ptr<SystemThread> thread =
+        Create<SystemThread> (MakeCallback (&MultithreadedSimulatorImpl::DoWorker, this));
+      thread->Start ();
+      m_threads.push_back (thread);
+    }
+
+  Partition *partition = m_partitions[0];
+  while (true)
+    {
+      CurrentPartition () = &m_global;
+      m_finished = DoSerialPhase ();
+      m_parallel = !m_finished;
+      Barrier ();
+      if (m_finished)
+        {
+          break;
+        }
+      CurrentPartition () = partition;
+      ProcessWindow (partition);
+      Barrier ();
+      DrainOutboxes (0, partition);
+      Barrier ();
+      m_parallel = false;
+    }
+  CurrentPartition () = &m_global;
+
+  for (uint32_t i = 0; i < m_threads.size (); i++)
+    {
+      m_threads[i]->Join ();
+    }
+  m_threads.clear ();
+
+  // Like the DefaultSimulatorImpl, Now() stays at the time of the last event.
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      m_global.currentTs = std::max (m_global.currentTs, m_partitions[i]->currentTs);
+    }
+}
+
+inline bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  if (!m_global.events->IsEmpty () || !m_pending.empty ())
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      if (!m_partitions[i]->events->IsEmpty ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+inline void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  m_stop = true;
+}
+
+inline void
+MultithreadedSimulatorImpl::Stop (const Time &delay)
+{
+  NS_ASSERT_MSG (delay.IsPositive (), "MultithreadedSimulatorImpl::Stop(): Negative delay");
+  // Latched as Stop (): going through ScheduleWithContext would make a
+  // short delay from a partition violate the lookahead.
+  uint64_t ts = GetCurrent ()->currentTs + delay.GetTimeStep ();
+  uint64_t stopTs = m_stopTs.load ();
+  while (ts < stopTs && !m_stopTs.compare_exchange_weak (stopTs, ts))
+    {
+    }
+}
+
+inline EventId
+MultithreadedSimulatorImpl::Schedule (const Time &delay, EventImpl *event)
+{
+  NS_ASSERT_MSG (delay.IsPositive (), "MultithreadedSimulatorImpl::Schedule(): Negative delay");
+  Partition *from = GetCurrent ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = from->currentTs + delay.GetTimeStep ();
+  ev.key.m_context = from->currentContext;
+  Insert (from, ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+inline void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+{
+  NS_ASSERT_MSG (delay.IsPositive (), "MultithreadedSimulatorImpl::ScheduleWithContext(): Negative delay");
+  if (CurrentPartition () == 0 && !SystemThread::Equals (m_main))
+    {
+      Scheduler::Event ev;
+      ev.impl = event;
+      ev.key.m_ts = delay.GetTimeStep ();
+      ev.key.m_context = context;
+      m_foreign.Push (ev);
+      return;
+    }
+  Partition *from = GetCurrent ();
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = from->currentTs + delay.GetTimeStep ();
+  ev.key.m_context = context;
+  Partition *to = FindPartition (context);
+  if (to == 0)
+    {
+      ev.key.m_uid = m_global.uid;
+      m_global.uid++;
+      m_pending.push_back (ev);
+    }
+  else if (to == from || !m_parallel)
+    {
+      Insert (to, ev);
+    }
+  else
+    {
+      if (ev.key.m_ts < m_windowEnd)
+        {
+          NS_FATAL_ERROR ("MultithreadedSimulatorImpl: event for context " << context
+                          << " scheduled closer in time than the lookahead ("
+                          << GetLookahead () << ")");
+        }
+      uint32_t index = m_partitions.size ();
+      if (to != &m_global)
+        {
+          index = GetPartition (context);
+        }
+      from->outbox[index].push_back (ev);
+    }
+}
+
+inline EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return Schedule (Time (0), event);
+}
+
+inline EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), GetCurrent ()->currentTs, 0xffffffff, 2);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+inline Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  return TimeStep (GetCurrent ()->currentTs);
+}
+
+inline Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - GetCurrent ()->currentTs);
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  Partition *partition = FindPartition (id.GetContext ());
+  if (partition == 0)
+    {
+      for (std::vector<Scheduler::Event>::iterator i = m_pending.begin (); i != m_pending.end (); i++)
+        {
+          if (i->key.m_uid == event.key.m_uid)
+            {
+              m_pending.erase (i);
+              break;
+            }
+        }
+    }
+  else
+    {
+      NS_ABORT_MSG_IF (m_parallel && partition != GetCurrent (),
+                       "MultithreadedSimulatorImpl: cannot remove an event of another partition");
+      if (m_lazyRemove)
+        {
+          event.impl->Cancel ();
+          NotifyCancel (partition);
+          return;
+        }
+      partition->events->Remove (event);
+      partition->tombstones.NotifyRemove ();
+    }
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+inline void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+      if (id.GetUid () != 2)
+        {
+          NotifyCancel (FindPartition (id.GetContext ()));
+        }
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::NotifyCancel (Partition *partition)
+{
+  // The event list of another partition may be in use by its thread.
+  if (partition != 0 && (!m_parallel || partition == CurrentPartition ()))
+    {
+      partition->tombstones.NotifyCancel (PeekPointer (partition->events));
+    }
+}
+
+inline bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0
+          || id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (id.PeekEventImpl () == 0
+      || id.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  const Partition *partition = FindPartition (id.GetContext ());
+  if (partition == 0)
+    {
+      return false;
+    }
+  uint64_t ts = partition->currentTs;
+  uint32_t uid = partition->currentUid;
+  if (m_parallel && partition != CurrentPartition ())
+    {
+      // The clock of another partition moves during the window: use its
+      // value at the start of the window, set in the serial phase.
+      ts = partition->windowTs;
+      uid = partition->windowUid;
+    }
+  return id.GetTs () < ts
+         || (id.GetTs () == ts && id.GetUid () <= uid);
+}
+
+inline Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+inline uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+inline uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  return GetCurrent ()->currentContext;
+}
+
+inline uint32_t
+MultithreadedSimulatorImpl::GetNPartitions (void) const
+{
+  return m_partitions.size ();
+}
+
+inline uint32_t
+MultithreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  return context < m_partitionOf.size () ? m_partitionOf[context] : 0;
+}
+
+inline Time
+MultithreadedSimulatorImpl::GetLookahead (void) const
+{
+  return TimeStep (m_lookahead);
+}
+
+inline uint64_t
+MultithreadedSimulatorImpl::GetEventCount (uint32_t partition) const
+{
+  NS_ASSERT (partition < m_partitions.size ());
+  return m_partitions[partition]->eventCount;
+}
+
+inline void
+MultithreadedSimulatorImpl::Checkpoint (Partition *partition, SimulationSnapshot &snapshot)
+{
+  // The Scheduler cannot be iterated: drain it, and insert the events back.
+  std::vector<Scheduler::Event> events;
+  while (!partition->events->IsEmpty ())
+    {
+      events.push_back (partition->events->RemoveNext ());
+    }
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      snapshot.AddEvent (events[i]);
+      partition->events->Insert (events[i]);
+    }
+}
+
+inline void
+MultithreadedSimulatorImpl::Checkpoint (SimulationSnapshot &snapshot)
+{
+  NS_ABORT_MSG_IF (m_parallel, "MultithreadedSimulatorImpl: Checkpoint() called from a partition");
+  uint32_t uid = m_global.uid;
+  uint64_t count = m_global.eventCount;
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      uid = std::max (uid, m_partitions[i]->uid);
+      count += m_partitions[i]->eventCount;
+      Checkpoint (m_partitions[i], snapshot);
+    }
+  Checkpoint (&m_global, snapshot);
+  for (uint32_t i = 0; i < m_pending.size (); i++)
+    {
+      snapshot.AddEvent (m_pending[i]);
+    }
+  snapshot.SetClock (m_global.currentTs, uid, count);
+}
+
+inline void
+MultithreadedSimulatorImpl::Restore (const SimulationSnapshot &snapshot)
+{
+  NS_ABORT_MSG_IF (m_parallel, "MultithreadedSimulatorImpl: Restore() called from a partition");
+  std::vector<Partition *> all (m_partitions);
+  all.push_back (&m_global);
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < all.size (); i++)
+    {
+      count += all[i]->eventCount;
+    }
+  NS_ABORT_MSG_IF (snapshot.GetProgress () != count,
+                   "MultithreadedSimulatorImpl: events have run since the snapshot was taken");
+  for (uint32_t i = 0; i < all.size (); i++)
+    {
+      Clear (all[i]);
+      all[i]->currentTs = snapshot.GetTimeStep ();
+      all[i]->currentUid = 0;
+      all[i]->windowTs = all[i]->currentTs;
+      all[i]->windowUid = 0;
+      all[i]->uid = snapshot.GetUid ();
+    }
+  for (uint32_t i = 0; i < m_pending.size (); i++)
+    {
+      m_pending[i].impl->Unref ();
+    }
+  m_pending.clear ();
+  for (uint32_t i = 0; i < snapshot.GetNEvents (); i++)
+    {
+      Scheduler::Event ev = snapshot.GetEvent (i);
+      Partition *partition = FindPartition (ev.key.m_context);
+      if (partition == 0)
+        {
+          m_pending.push_back (ev);
+        }
+      else
+        {
+          partition->events->Insert (ev);
+          partition->tombstones.NotifyInsert ();
+        }
+    }
+  m_stop = false;
+  m_stopTs = std::numeric_limits<uint64_t>::max ();
+}
+
+inline TombstoneTracker::Stats
+MultithreadedSimulatorImpl::GetTombstoneStats (void) const
+{
+  TombstoneTracker::Stats total = m_global.tombstones.GetStats ();
+  for (uint32_t i = 0; i < m_partitions.size (); i++)
+    {
+      TombstoneTracker::Stats stats = m_partitions[i]->tombstones.GetStats ();
+      total.events += stats.events;
+      total.tombstones += stats.tombstones;
+      total.cancelled += stats.cancelled;
+      total.expired += stats.expired;
+      total.compactions += stats.compactions;
+      total.compacted += stats.compacted;
+    }
+  return total;
+}
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
@@ -13,6 +13,8 @@
 #include "application.h"
 #include "ascii-file.h"
 #include "ascii-test.h"
+#include "buffer-chain.h"
+#include "buffer-data-allocator.h"
 #include "buffer.h"
 #include "byte-tag-list.h"
 #include "channel-list.h"
@@ -27,11 +29,13 @@
 #include "error-model.h"
 #include "ethernet-header.h"
 #include "ethernet-trailer.h"
+#include "fixed-size-header.h"
 #include "flow-id-tag.h"
 #include "generic-phy.h"
 #include "header.h"
 #include "inet-socket-address.h"
 #include "inet6-socket-address.h"
+#include "ip-checksum.h"
 #include "ipv4-address.h"
 #include "ipv6-address.h"
 #include "llc-snap-header.h"
@@ -50,6 +54,8 @@
 #include "packet-burst.h"
 #include "packet-data-calculators.h"
 #include "packet-metadata.h"
+#include "packet-offload.h"
+#include "packet-pool.h"
 #include "packet-probe.h"
 #include "packet-socket-address.h"
 #include "packet-socket-client.h"
@@ -31,6 +31,7 @@
 #include "ns3/ptr.h"
 #include "ns3/data-rate.h"
 #include "ns3/traced-callback.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -106,6 +107,19 @@ public:
    */
   void SetMaxBytes (uint64_t maxBytes);
 
+  /**
+   * \brief Set the number of packets given to the socket per call.
+   *
+   * With a batch size n greater than one, the application hands n
+   * packets to Socket::SendBatch every n packet times instead of one
+   * packet to Socket::Send every packet time: the average rate is
+   * the same, but the socket and the layers below process the packets
+   * together. The default, one, sends the packets one at a time.
+   *
+   * \param batchSize the number of packets per call
+   */
+  void SetBatchSize (uint32_t batchSize);
+
   /**
    * \brief Return a pointer to associated socket.
    * \return pointer to associated socket
@@ -147,6 +161,13 @@ private:
    * \brief Send a packet
    */
   void SendPacket ();
+  /**
+   * \brief Send a batch of up to m_batchSize packets, and schedule
+   * the next batch
+   *
+   * Scheduled instead of SendPacket when m_batchSize is greater than one.
+   */
+  void SendPacketBatch ();
 
   Ptr<Socket>     m_socket;       //!< Associated socket
   Address         m_peer;         //!< Peer address
@@ -163,6 +184,7 @@ private:
   EventId         m_startStopEvent;     //!< Event id for next start or stop event
   EventId         m_sendEvent;    //!< Event id of pending "send packet" event
   TypeId          m_tid;          //!< Type of the socket used
+  uint32_t        m_batchSize {1}; //!< Number of packets per Socket::SendBatch call
 
   /// Traced Callback: transmitted packets.
   TracedCallback<Ptr<const Packet> > m_txTrace;
@@ -197,4 +219,75 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+#include "ns3/assert.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+
+namespace ns3 {
+
+inline void
+OnOffApplication::SetBatchSize (uint32_t batchSize)
+{
+  NS_ASSERT (batchSize > 0);
+  m_batchSize = batchSize;
+}
+
+inline void
+OnOffApplication::SendPacketBatch ()
+{
+  NS_ASSERT (m_sendEvent.IsExpired ());
+  std::vector<Ptr<Packet> > batch;
+  for (uint32_t i = 0; i < m_batchSize; i++)
+    {
+      if (m_maxBytes != 0 && m_totBytes + i * m_pktSize >= m_maxBytes)
+        {
+          break;
+        }
+      batch.push_back (Create<Packet> (m_pktSize));
+    }
+  // Only the packets accepted by the socket, a prefix of the batch,
+  // are traced and counted; the addresses are looked up once.
+  int sent = m_socket->SendBatch (batch);
+  uint32_t accepted = sent > 0 ? static_cast<uint32_t> (sent) : 0;
+  Address localAddress;
+  m_socket->GetSockName (localAddress);
+  bool inet = InetSocketAddress::IsMatchingType (m_peer);
+  bool inet6 = Inet6SocketAddress::IsMatchingType (m_peer);
+  for (uint32_t i = 0; i < accepted; i++)
+    {
+      m_txTrace (batch[i]);
+      if (inet)
+        {
+          m_txTraceWithAddresses (batch[i], localAddress, InetSocketAddress::ConvertFrom (m_peer));
+        }
+      else if (inet6)
+        {
+          m_txTraceWithAddresses (batch[i], localAddress, Inet6SocketAddress::ConvertFrom (m_peer));
+        }
+    }
+  m_totBytes += static_cast<uint64_t> (accepted) * m_pktSize;
+  m_lastStartTime = Simulator::Now ();
+  m_residualBits = 0;
+  if (m_maxBytes == 0 || m_totBytes < m_maxBytes)
+    {
+      uint64_t bits = static_cast<uint64_t> (batch.size ()) * m_pktSize * 8;
+      Time nextTime (Seconds (bits / static_cast<double> (m_cbrRate.GetBitRate ())));
+      m_sendEvent = Simulator::Schedule (nextTime, &OnOffApplication::SendPacketBatch, this);
+    }
+  else
+    { // All done, cancel any pending events
+      StopApplication ();
+    }
+}
+
+} // namespace ns3
+
 #endif /* ONOFF_APPLICATION_H */
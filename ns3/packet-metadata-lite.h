@@ -0,0 +1,795 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PACKET_METADATA_LITE_H
+#define PACKET_METADATA_LITE_H
+
+#ifndef PACKET_METADATA_H
+# error "Do not include packet-metadata-lite.h directly; include packet-metadata.h."
+#endif
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "ns3/assert.h"
+#include "ns3/fatal-error.h"
+#include "ns3/type-id.h"
+#include "buffer.h"
+#include "header.h"
+#include "trailer.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ * \brief Handle packet metadata about packet headers and trailers:
+ * the "lite" implementation, selected with NS3_PACKET_METADATA_LITE.
+ *
+ * This implementation has the same interface and the same output,
+ * through Packet::Print, as the default one, but a different storage:
+ * instead of a reference counted, uleb128 encoded linked list shared
+ * between the copies of a packet and recycled through a static free
+ * list, each PacketMetadata holds a plain array of fixed-size items,
+ * (chunk uid, size, trimmed bytes), with room for 8 items in the
+ * object itself. Packets with 8 headers, trailers and payload
+ * fragments or fewer, which is nearly all of them, never allocate
+ * anything for their metadata, and copying the metadata of a packet
+ * is copying a few items, without locking or sharing.
+ *
+ * When the metadata are disabled, which is the default, every method
+ * returns after a single test and only the packet uid is maintained.
+ * The inline items are there all the same: a PacketMetadata takes 152
+ * bytes instead of 24 on LP64, so every Packet is 128 bytes larger
+ * with this implementation, whether the metadata are enabled or not.
+ *
+ * Unlike the default implementation, the items do not record the uid
+ * of the packet in which they were created. Adjacent fragments of
+ * the same header, trailer or payload are merged by AddAtEnd when
+ * they are contiguous in the original chunk.
+ */
+class PacketMetadata
+{
+public:
+  /**
+   * \brief structure describing a packet metadata item
+   */
+  struct Item
+  {
+    /// Type of data in the packet
+    enum ItemType {
+      PAYLOAD,  //!< Payload
+      HEADER,   //!< Header
+      TRAILER   //!< Trailer
+    } type; //!< metadata type
+    /**
+     * true: this is a fragmented header, trailer, or, payload.
+     * false: this is a whole header, trailer, or, payload.
+     */
+    bool isFragment;
+    /**
+     * TypeId of Header or Trailer. Valid only if type is
+     * header or trailer.
+     */
+    TypeId tid;
+    /**
+     * size of item. If fragment, size of fragment. Otherwise,
+     * size of original item.
+     */
+    uint32_t currentSize;
+    /**
+     * how many bytes were trimmed from the start of a fragment.
+     * if isFragment is true, this field is zero.
+     */
+    uint32_t currentTrimedFromStart;
+    /**
+     * how many bytes were trimmed from the end of a fragment.
+     * if isFragment is true, this field is zero.
+     */
+    uint32_t currentTrimedFromEnd;
+    /**
+     * an iterator which can be fed to Deserialize. Valid only
+     * if isFragment and isPayload are false.
+     */
+    Buffer::Iterator current;
+  };
+
+  /**
+   * \brief Iterator class for metadata items.
+   */
+  class ItemIterator
+  {
+public:
+    /**
+     * \brief Constructor
+     * \param metadata a pointer to the metadata
+     * \param buffer the buffer the metadata refers to
+     */
+    ItemIterator (const PacketMetadata *metadata, Buffer buffer);
+    /**
+     * \brief Checks if there is another metadata item
+     * \returns true if there is another item
+     */
+    bool HasNext (void) const;
+    /**
+     * \brief Retrieve the next metadata item
+     * \returns the next metadata item
+     */
+    Item Next (void);
+private:
+    const PacketMetadata *m_metadata; //!< pointer to the metadata
+    Buffer m_buffer; //!< buffer the metadata refers to
+    uint32_t m_current; //!< index of the next item
+    uint32_t m_offset; //!< offset of the next item in the buffer
+  };
+
+  /**
+   * \brief Enable the packet metadata
+   */
+  static void Enable (void);
+  /**
+   * \brief Enable the packet metadata checking
+   */
+  static void EnableChecking (void);
+
+  /**
+   * \brief Constructor
+   * \param uid packet uid
+   * \param size size of the header
+   */
+  PacketMetadata (uint64_t uid, uint32_t size);
+  /**
+   * \brief Copy constructor
+   * \param o the object to copy
+   */
+  PacketMetadata (PacketMetadata const &o);
+  /**
+   * \brief Basic assignment
+   * \param o the object to copy
+   * \return a copied object
+   */
+  PacketMetadata &operator = (PacketMetadata const& o);
+  ~PacketMetadata ();
+
+  /**
+   * Add an header
+   * \param header header to add
+   * \param size header serialized size
+   */
+  void AddHeader (Header const &header, uint32_t size);
+  /**
+   * Remove an header
+   * \param header header to remove
+   * \param size header serialized size
+   */
+  void RemoveHeader (Header const &header, uint32_t size);
+  /**
+   * Add a trailer
+   * \param trailer trailer to add
+   * \param size trailer serialized size
+   */
+  void AddTrailer (Trailer const &trailer, uint32_t size);
+  /**
+   * Remove a trailer
+   * \param trailer trailer to remove
+   * \param size trailer serialized size
+   */
+  void RemoveTrailer (Trailer const &trailer, uint32_t size);
+  /**
+   * \brief Creates a fragment.
+   *
+   * \param start the amount of stuff to remove from the start
+   * \param end the amount of stuff to remove from the end
+   * \return the fragment's metadata
+   *
+   * Calling this method is equivalent to calling RemoveAtStart (start)
+   * and then, RemoveAtEnd (end).
+   */
+  PacketMetadata CreateFragment (uint32_t start, uint32_t end) const;
+  /**
+   * \brief Add a metadata at the metadata start
+   * \param o the metadata to add
+   */
+  void AddAtEnd (PacketMetadata const&o);
+  /**
+   * \brief Add some padding at the end
+   * \param end size of padding
+   */
+  void AddPaddingAtEnd (uint32_t end);
+  /**
+   * \brief Remove a chunk of metadata at the metadata start
+   * \param start the size of metadata to remove
+   */
+  void RemoveAtStart (uint32_t start);
+  /**
+   * \brief Remove a chunk of metadata at the metadata end
+   * \param end the size of metadata to remove
+   */
+  void RemoveAtEnd (uint32_t end);
+  /**
+   * \brief Get the packet Uid
+   * \return the packet Uid
+   */
+  uint64_t GetUid (void) const;
+  /**
+   * \brief Get the metadata serialized size
+   * \return the seralized size
+   */
+  uint32_t GetSerializedSize (void) const;
+  /**
+   * \brief Initialize the item iterator to the buffer begin
+   * \param buffer buffer to initialize.
+   * \return the buffer iterator.
+   */
+  ItemIterator BeginItem (Buffer buffer) const;
+  /**
+   *  \brief Serialization to raw uint8_t*
+   *  \param buffer the buffer to serialize to
+   *  \param maxSize the maximum serialization size
+   *  \return 1 on success, 0 on failure
+   */
+  uint32_t Serialize (uint8_t* buffer, uint32_t maxSize) const;
+  /**
+   *  \brief Deserialization from raw uint8_t*
+   *  \param buffer the buffer to deserialize from
+   *  \param size the size
+   *  \return 1 on success, 0 on failure
+   */
+  uint32_t Deserialize (const uint8_t* buffer, uint32_t size);
+
+private:
+  /** Number of items stored in the object itself. */
+  static const uint32_t kInlineItems = 8;
+
+  /** A header, trailer or payload, or a fragment of one. */
+  struct SmallItem
+  {
+    uint32_t size;       //!< size of the whole chunk
+    uint32_t trimStart;  //!< bytes trimmed from the start of the chunk
+    uint32_t trimEnd;    //!< bytes trimmed from the end of the chunk
+    uint16_t chunkUid;   //!< TypeId uid of the header or trailer, 0 for payload
+    uint8_t type;        //!< Item::ItemType
+    uint8_t reserved;    //!< padding
+  };
+
+  /**
+   * \returns a reference to the flag set by Enable
+   */
+  static bool & IsEnabled (void);
+  /**
+   * \returns a reference to the flag set by EnableChecking
+   */
+  static bool & IsChecking (void);
+
+  /**
+   * \returns the items; the inline array when there are none, so that
+   * the result is always a valid pointer
+   */
+  SmallItem * GetItems (void);
+  /**
+   * \returns the items
+   */
+  const SmallItem * GetItems (void) const;
+  /**
+   * \param item an item
+   * \returns the bytes of the packet covered by the item
+   */
+  static uint32_t GetCurrentSize (const SmallItem &item);
+  /**
+   * \param pos the index of the new item
+   * \param item the item to insert
+   */
+  void Insert (uint32_t pos, const SmallItem &item);
+  /**
+   * \param pos the index of the item to remove
+   */
+  void Erase (uint32_t pos);
+  /**
+   * Replace the items by those of another metadata.
+   * \param o the other metadata
+   */
+  void CopyItems (PacketMetadata const &o);
+  /**
+   * \param item the item to append
+   */
+  void Append (const SmallItem &item);
+  /**
+   * \param item the item which should be at the start or end
+   * \param type the expected type
+   * \param uid the expected chunk uid
+   * \param size the expected size
+   * \returns true if the item is the whole chunk expected
+   */
+  static bool Matches (const SmallItem &item, uint8_t type, uint16_t uid, uint32_t size);
+
+  SmallItem m_inline[kInlineItems];   //!< the items, when they fit
+  std::vector<SmallItem> *m_overflow; //!< the items, when they do not fit
+  uint32_t m_nItems;                  //!< number of items
+  uint64_t m_packetUid;               //!< packet Uid
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline bool &
+PacketMetadata::IsEnabled (void)
+{
+  static bool enable = false;
+  return enable;
+}
+
+inline bool &
+PacketMetadata::IsChecking (void)
+{
+  static bool checking = false;
+  return checking;
+}
+
+inline void
+PacketMetadata::Enable (void)
+{
+  IsEnabled () = true;
+}
+
+inline void
+PacketMetadata::EnableChecking (void)
+{
+  IsEnabled () = true;
+  IsChecking () = true;
+}
+
+inline PacketMetadata::SmallItem *
+PacketMetadata::GetItems (void)
+{
+  return m_overflow != 0 && !m_overflow->empty () ? m_overflow->data () : m_inline;
+}
+
+inline const PacketMetadata::SmallItem *
+PacketMetadata::GetItems (void) const
+{
+  return m_overflow != 0 && !m_overflow->empty () ? m_overflow->data () : m_inline;
+}
+
+inline uint32_t
+PacketMetadata::GetCurrentSize (const SmallItem &item)
+{
+  return item.size - item.trimStart - item.trimEnd;
+}
+
+inline
+PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
+  : m_overflow (0),
+    m_nItems (0),
+    m_packetUid (uid)
+{
+  if (size > 0 && IsEnabled ())
+    {
+      SmallItem item = { size, 0, 0, 0, Item::PAYLOAD, 0 };
+      Append (item);
+    }
+}
+
+inline
+PacketMetadata::PacketMetadata (PacketMetadata const &o)
+  : m_overflow (0),
+    m_nItems (0),
+    m_packetUid (o.m_packetUid)
+{
+  CopyItems (o);
+}
+
+inline PacketMetadata &
+PacketMetadata::operator = (PacketMetadata const& o)
+{
+  if (this != &o)
+    {
+      CopyItems (o);
+      m_packetUid = o.m_packetUid;
+    }
+  return *this;
+}
+
+inline
+PacketMetadata::~PacketMetadata ()
+{
+  delete m_overflow;
+}
+
+inline void
+PacketMetadata::CopyItems (PacketMetadata const &o)
+{
+  if (o.m_nItems <= kInlineItems)
+    {
+      delete m_overflow;
+      m_overflow = 0;
+      std::memcpy (m_inline, o.GetItems (), o.m_nItems * sizeof (SmallItem));
+    }
+  else if (m_overflow != 0)
+    {
+      *m_overflow = *o.m_overflow;
+    }
+  else
+    {
+      m_overflow = new std::vector<SmallItem> (*o.m_overflow);
+    }
+  m_nItems = o.m_nItems;
+}
+
+inline void
+PacketMetadata::Insert (uint32_t pos, const SmallItem &item)
+{
+  NS_ASSERT (pos <= m_nItems);
+  if (m_overflow == 0 && m_nItems < kInlineItems)
+    {
+      std::memmove (&m_inline[pos + 1], &m_inline[pos], (m_nItems - pos) * sizeof (SmallItem));
+      m_inline[pos] = item;
+    }
+  else
+    {
+      if (m_overflow == 0)
+        {
+          m_overflow = new std::vector<SmallItem> (m_inline, m_inline + m_nItems);
+        }
+      m_overflow->insert (m_overflow->begin () + pos, item);
+    }
+  m_nItems++;
+}
+
+inline void
+PacketMetadata::Erase (uint32_t pos)
+{
+  NS_ASSERT (pos < m_nItems);
+  if (m_overflow == 0)
+    {
+      std::memmove (&m_inline[pos], &m_inline[pos + 1], (m_nItems - pos - 1) * sizeof (SmallItem));
+    }
+  else
+    {
+      m_overflow->erase (m_overflow->begin () + pos);
+    }
+  m_nItems--;
+}
+
+inline void
+PacketMetadata::Append (const SmallItem &item)
+{
+  Insert (m_nItems, item);
+}
+
+inline bool
+PacketMetadata::Matches (const SmallItem &item, uint8_t type, uint16_t uid, uint32_t size)
+{
+  return item.type == type && item.chunkUid == uid && item.size == size
+         && item.trimStart == 0 && item.trimEnd == 0;
+}
+
+inline void
+PacketMetadata::AddHeader (Header const &header, uint32_t size)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  SmallItem item = { size, 0, 0, header.GetInstanceTypeId ().GetUid (), Item::HEADER, 0 };
+  Insert (0, item);
+}
+
+inline void
+PacketMetadata::RemoveHeader (Header const &header, uint32_t size)
+{
+  if (!IsEnabled () || m_nItems == 0)
+    {
+      return;
+    }
+  uint16_t uid = header.GetInstanceTypeId ().GetUid ();
+  if (!Matches (GetItems ()[0], Item::HEADER, uid, size))
+    {
+      if (IsChecking ())
+        {
+          NS_FATAL_ERROR ("Removing unexpected header.");
+        }
+      // Keep the byte accounting right.
+      RemoveAtStart (size);
+      return;
+    }
+  Erase (0);
+}
+
+inline void
+PacketMetadata::AddTrailer (Trailer const &trailer, uint32_t size)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  SmallItem item = { size, 0, 0, trailer.GetInstanceTypeId ().GetUid (), Item::TRAILER, 0 };
+  Append (item);
+}
+
+inline void
+PacketMetadata::RemoveTrailer (Trailer const &trailer, uint32_t size)
+{
+  if (!IsEnabled () || m_nItems == 0)
+    {
+      return;
+    }
+  uint16_t uid = trailer.GetInstanceTypeId ().GetUid ();
+  if (!Matches (GetItems ()[m_nItems - 1], Item::TRAILER, uid, size))
+    {
+      if (IsChecking ())
+        {
+          NS_FATAL_ERROR ("Removing unexpected trailer.");
+        }
+      RemoveAtEnd (size);
+      return;
+    }
+  Erase (m_nItems - 1);
+}
+
+inline PacketMetadata
+PacketMetadata::CreateFragment (uint32_t start, uint32_t end) const
+{
+  PacketMetadata fragment = *this;
+  fragment.RemoveAtStart (start);
+  fragment.RemoveAtEnd (end);
+  return fragment;
+}
+
+inline void
+PacketMetadata::AddAtEnd (PacketMetadata const&o)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  const SmallItem *items = o.GetItems ();
+  uint32_t n = o.m_nItems;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      SmallItem item = items[i];
+      if (i == 0 && m_nItems > 0)
+        {
+          SmallItem &last = GetItems ()[m_nItems - 1];
+          if (last.type == item.type && last.chunkUid == item.chunkUid
+              && last.size == item.size
+              && last.trimEnd > 0 && last.size - last.trimEnd == item.trimStart)
+            {
+              // Two contiguous fragments of the same chunk.
+              last.trimEnd = item.trimEnd;
+              continue;
+            }
+        }
+      Append (item);
+    }
+}
+
+inline void
+PacketMetadata::AddPaddingAtEnd (uint32_t end)
+{
+  if (!IsEnabled () || end == 0)
+    {
+      return;
+    }
+  SmallItem item = { end, 0, 0, 0, Item::PAYLOAD, 0 };
+  Append (item);
+}
+
+inline void
+PacketMetadata::RemoveAtStart (uint32_t start)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  while (start > 0 && m_nItems > 0)
+    {
+      SmallItem &item = GetItems ()[0];
+      uint32_t current = GetCurrentSize (item);
+      if (start < current)
+        {
+          item.trimStart += start;
+          return;
+        }
+      start -= current;
+      Erase (0);
+    }
+}
+
+inline void
+PacketMetadata::RemoveAtEnd (uint32_t end)
+{
+  if (!IsEnabled ())
+    {
+      return;
+    }
+  while (end > 0 && m_nItems > 0)
+    {
+      SmallItem &item = GetItems ()[m_nItems - 1];
+      uint32_t current = GetCurrentSize (item);
+      if (end < current)
+        {
+          item.trimEnd += end;
+          return;
+        }
+      end -= current;
+      Erase (m_nItems - 1);
+    }
+}
+
+inline uint64_t
+PacketMetadata::GetUid (void) const
+{
+  return m_packetUid;
+}
+
+inline PacketMetadata::ItemIterator
+PacketMetadata::BeginItem (Buffer buffer) const
+{
+  return ItemIterator (this, buffer);
+}
+
+/*
+ * Serialized form, in host byte order like the default implementation:
+ *   packet uid (8 bytes), number of items (4 bytes), then per item:
+ *   size, trimStart, trimEnd (4 bytes each), type (4 bytes),
+ *   length of the TypeId name (4 bytes), TypeId name padded to 4 bytes.
+ */
+
+inline uint32_t
+PacketMetadata::GetSerializedSize (void) const
+{
+  uint32_t size = 8 + 4;
+  const SmallItem *items = GetItems ();
+  for (uint32_t i = 0; i < m_nItems; i++)
+    {
+      size += 5 * 4;
+      if (items[i].chunkUid != 0)
+        {
+          TypeId tid;
+          tid.SetUid (items[i].chunkUid);
+          size += (tid.GetName ().size () + 3) & ~3u;
+        }
+    }
+  return size;
+}
+
+inline uint32_t
+PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
+{
+  if (GetSerializedSize () > maxSize)
+    {
+      return 0;
+    }
+  uint8_t *p = buffer;
+  std::memcpy (p, &m_packetUid, 8);
+  p += 8;
+  std::memcpy (p, &m_nItems, 4);
+  p += 4;
+  const SmallItem *items = GetItems ();
+  for (uint32_t i = 0; i < m_nItems; i++)
+    {
+      std::string name;
+      if (items[i].chunkUid != 0)
+        {
+          TypeId tid;
+          tid.SetUid (items[i].chunkUid);
+          name = tid.GetName ();
+        }
+      uint32_t fields[5] = { items[i].size, items[i].trimStart, items[i].trimEnd,
+                             items[i].type, static_cast<uint32_t> (name.size ()) };
+      std::memcpy (p, fields, sizeof (fields));
+      p += sizeof (fields);
+      uint32_t padded = (name.size () + 3) & ~3u;
+      std::memset (p, 0, padded);
+      std::memcpy (p, name.data (), name.size ());
+      p += padded;
+    }
+  return 1;
+}
+
+inline uint32_t
+PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
+{
+  const uint8_t *p = buffer;
+  const uint8_t *end = buffer + size;
+  uint32_t n;
+  if (size < 12)
+    {
+      return 0;
+    }
+  std::memcpy (&m_packetUid, p, 8);
+  p += 8;
+  std::memcpy (&n, p, 4);
+  p += 4;
+  delete m_overflow;
+  m_overflow = 0;
+  m_nItems = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t fields[5];
+      if (end - p < static_cast<int32_t> (sizeof (fields)))
+        {
+          return 0;
+        }
+      std::memcpy (fields, p, sizeof (fields));
+      p += sizeof (fields);
+      uint32_t padded = (fields[4] + 3) & ~3u;
+      if (end - p < static_cast<int32_t> (padded))
+        {
+          return 0;
+        }
+      SmallItem item = { fields[0], fields[1], fields[2], 0,
+                         static_cast<uint8_t> (fields[3]), 0 };
+      if (fields[4] > 0)
+        {
+          TypeId tid;
+          if (!TypeId::LookupByNameFailSafe (std::string (reinterpret_cast<const char *> (p), fields[4]), &tid))
+            {
+              return 0;
+            }
+          item.chunkUid = tid.GetUid ();
+        }
+      p += padded;
+      Append (item);
+    }
+  return 1;
+}
+
+inline
+PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
+  : m_metadata (metadata),
+    m_buffer (buffer),
+    m_current (0),
+    m_offset (0)
+{
+}
+
+inline bool
+PacketMetadata::ItemIterator::HasNext (void) const
+{
+  return m_current < m_metadata->m_nItems;
+}
+
+inline PacketMetadata::Item
+PacketMetadata::ItemIterator::Next (void)
+{
+  NS_ASSERT (HasNext ());
+  const SmallItem &small = m_metadata->GetItems ()[m_current];
+  Item item;
+  item.type = static_cast<Item::ItemType> (small.type);
+  item.isFragment = small.trimStart != 0 || small.trimEnd != 0;
+  if (small.chunkUid != 0)
+    {
+      item.tid.SetUid (small.chunkUid);
+    }
+  item.currentSize = GetCurrentSize (small);
+  item.currentTrimedFromStart = small.trimStart;
+  item.currentTrimedFromEnd = small.trimEnd;
+  item.current = m_buffer.Begin ();
+  item.current.Next (m_offset);
+  m_offset += item.currentSize;
+  m_current++;
+  return item;
+}
+
+} // namespace ns3
+
+#endif /* PACKET_METADATA_LITE_H */
@@ -23,11 +23,19 @@
 #include <stdint.h>
 #include <vector>
 #include <limits>
+#include <algorithm>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 #include "ns3/callback.h"
 #include "ns3/assert.h"
 #include "ns3/type-id.h"
 #include "buffer.h"
 
+#ifdef NS3_PACKET_METADATA_LITE
+#include "packet-metadata-lite.h"
+#else /* NS3_PACKET_METADATA_LITE */
+
 namespace ns3 {
 
 class Chunk;
@@ -74,6 +82,9 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * Building with NS3_PACKET_METADATA_LITE defined replaces this
+ * implementation by the allocation-free one of packet-metadata-lite.h.
  */
 class PacketMetadata 
 {
@@ -413,7 +424,11 @@ private:
    */
   struct Data {
     /** number of references to this struct Data instance. */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> m_count;
+#else
     uint32_t m_count;
+#endif
     /** size (in bytes) of m_data buffer below */
     uint16_t m_size;
     /** max of the m_used field over all objects which
@@ -673,6 +688,25 @@ public:
   static bool m_metadataSkipped;
 
   static uint32_t m_maxSize; //!< maximum metadata size
+#ifdef NS3_MTP
+  /**
+   * \brief Get the free list of the calling thread
+   *
+   * With NS3_MTP, Create and Recycle use a free list and a maximum
+   * size private to each thread, instead of m_freeList and m_maxSize,
+   * so that the worker threads of the MultithreadedSimulatorImpl do not
+   * share them. A storage may be recycled by another thread than the
+   * one which created it.
+   *
+   * \returns the free list of the calling thread
+   */
+  static DataFreeList & GetThreadFreeList (void);
+  /**
+   * \brief Get the maximum metadata size seen by the calling thread
+   * \returns the maximum size
+   */
+  static uint32_t & GetThreadMaxSize (void);
+#endif /* NS3_MTP */
   static uint16_t m_chunkUid; //!< Chunk Uid
 
   struct Data *m_data; //!< Metadata storage
@@ -691,6 +725,58 @@ public:
 
 namespace ns3 {
 
+#ifdef NS3_MTP
+inline PacketMetadata::DataFreeList &
+PacketMetadata::GetThreadFreeList (void)
+{
+  static thread_local DataFreeList freeList;
+  return freeList;
+}
+
+inline uint32_t &
+PacketMetadata::GetThreadMaxSize (void)
+{
+  static thread_local uint32_t maxSize = 0;
+  return maxSize;
+}
+
+inline struct PacketMetadata::Data *
+PacketMetadata::Create (uint32_t size)
+{
+  uint32_t &maxSize = GetThreadMaxSize ();
+  DataFreeList &freeList = GetThreadFreeList ();
+  maxSize = std::max (maxSize, size);
+  while (!freeList.empty ())
+    {
+      struct PacketMetadata::Data *data = freeList.back ();
+      freeList.pop_back ();
+      if (data->m_size >= size)
+        {
+          data->m_count = 1;
+          return data;
+        }
+      PacketMetadata::Deallocate (data);
+    }
+  return PacketMetadata::Allocate (size);
+}
+
+inline void
+PacketMetadata::Recycle (struct PacketMetadata::Data *data)
+{
+  NS_ASSERT (data->m_count == 0);
+  DataFreeList &freeList = GetThreadFreeList ();
+  if (!m_enable || freeList.size () > 1000
+      || data->m_size < GetThreadMaxSize ())
+    {
+      PacketMetadata::Deallocate (data);
+    }
+  else
+    {
+      freeList.push_back (data);
+    }
+}
+#endif /* NS3_MTP */
+
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
   : m_data (PacketMetadata::Create (10)),
     m_head (0xffff),
@@ -722,8 +808,7 @@ PacketMetadata::operator = (PacketMetadata const& o)
     {
       // not self assignment
       NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (--m_data->m_count == 0)
         {
           PacketMetadata::Recycle (m_data);
         }
@@ -740,8 +825,7 @@ PacketMetadata::operator = (PacketMetadata const& o)
 PacketMetadata::~PacketMetadata ()
 {
   NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (--m_data->m_count == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -749,5 +833,6 @@ PacketMetadata::~PacketMetadata ()
 
 } // namespace ns3
 
+#endif /* NS3_PACKET_METADATA_LITE */
 
 #endif /* PACKET_METADATA_H */
@@ -0,0 +1,338 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PACKET_OFFLOAD_H
+#define PACKET_OFFLOAD_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ns3/tag.h"
+#include "ns3/ptr.h"
+#include "ns3/callback.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/address.h"
+#include "packet.h"
+
+/**
+ * \file
+ * \ingroup network
+ * ns3::GsoTag, ns3::ReceiveOffload and ns3::PacketOffload declarations
+ * and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup network
+ *
+ * \brief Mark a super-segment: a packet carrying the payload of several
+ * segments of a transport protocol behind a single set of headers.
+ *
+ * A transport protocol with segmentation offload (e.g. TCP with
+ * TcpSocketBase::SetTsoMaxSegments) sends up to a few tens of segments
+ * as one packet, which crosses the IP layer and the queues as one
+ * packet. The NetDevice either splits it into segments of
+ * GetSegmentSize() bytes with PacketOffload::Segment, or, on a channel
+ * which carries it whole, sends it as it is.
+ */
+class GsoTag : public Tag
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer buf) const;
+  virtual void Deserialize (TagBuffer buf);
+  virtual void Print (std::ostream &os) const;
+  GsoTag ();
+  /**
+   * Constructs a GsoTag with the given segment size
+   *
+   * \param segmentSize the payload size of the segments
+   */
+  GsoTag (uint16_t segmentSize);
+  /**
+   * \returns the payload size of the segments
+   */
+  uint16_t GetSegmentSize (void) const;
+private:
+  uint16_t m_segmentSize; //!< Payload size of the segments
+};
+
+/**
+ * \ingroup network
+ *
+ * \brief Receive side of the offloads (GRO): aggregate the segments of
+ * a flow received by a NetDevice into super-segments before they go up
+ * the stack.
+ *
+ * The NetDevice gives every received packet to Receive() instead of its
+ * receive callback; the aggregator gives back, through the deliver
+ * callback, the packets it cannot merge as they are and the merged ones
+ * when their flow is flushed. Implemented by the protocols, e.g.
+ * TcpReceiveOffload, and created with PacketOffload::CreateReceiveOffload.
+ */
+class ReceiveOffload : public SimpleRefCount<ReceiveOffload>
+{
+public:
+  /**
+   * Deliver callback: packet, protocol number, sender address.
+   */
+  typedef Callback<void, Ptr<Packet>, uint16_t, const Address &> DeliverCallback;
+
+  virtual ~ReceiveOffload ();
+  /**
+   * \param cb the callback which passes the packets up the stack
+   */
+  void SetDeliverCallback (DeliverCallback cb);
+  /**
+   * \brief Aggregate or deliver a received packet.
+   *
+   * \param packet the packet, without its link-layer header
+   * \param protocol the protocol number of the packet
+   * \param from the address of the sender
+   */
+  virtual void Receive (Ptr<Packet> packet, uint16_t protocol, const Address &from) = 0;
+  /**
+   * \brief Deliver all the packets held.
+   */
+  virtual void Flush (void) = 0;
+
+protected:
+  /**
+   * \brief Pass a packet up the stack.
+   *
+   * \param packet the packet
+   * \param protocol the protocol number of the packet
+   * \param from the address of the sender
+   */
+  void Deliver (Ptr<Packet> packet, uint16_t protocol, const Address &from);
+
+private:
+  DeliverCallback m_deliver; //!< Callback to pass the packets up
+};
+
+/**
+ * \ingroup network
+ *
+ * \brief Registry of the segmentation and aggregation offloads.
+ *
+ * The NetDevices do not know the protocols above them: the protocols
+ * register their offloads by the protocol number of their packets
+ * (e.g. 0x0800 for IPv4), and the NetDevices call Segment() and
+ * CreateReceiveOffload(). Without a registered offload, the packets are
+ * sent and received unchanged.
+ */
+class PacketOffload
+{
+public:
+  /**
+   * Segmentation callback: super-segment, segments (output). Returns
+   * false if the packet cannot be segmented.
+   */
+  typedef Callback<bool, Ptr<const Packet>, std::vector<Ptr<Packet> > &> SegmentCallback;
+  /**
+   * Aggregator factory callback.
+   */
+  typedef Callback<Ptr<ReceiveOffload> > ReceiveOffloadFactory;
+
+  /**
+   * \param protocol the protocol number of the packets
+   * \param cb the segmentation function for these packets
+   */
+  static void RegisterSegmenter (uint16_t protocol, SegmentCallback cb);
+  /**
+   * \param cb the factory of the receive aggregators
+   */
+  static void RegisterReceiveOffload (ReceiveOffloadFactory cb);
+  /**
+   * \param packet the packet
+   * \returns true if the packet is a super-segment (see GsoTag)
+   */
+  static bool IsSuperSegment (Ptr<const Packet> packet);
+  /**
+   * \brief Split a super-segment into segments.
+   *
+   * \param packet the super-segment, without link-layer header
+   * \param protocol the protocol number of the packet
+   * \param [out] segments the segments, without GsoTag
+   * \returns false if no segmentation is registered for the protocol or
+   *          the packet cannot be segmented: it must be sent as it is
+   */
+  static bool Segment (Ptr<const Packet> packet, uint16_t protocol, std::vector<Ptr<Packet> > &segments);
+  /**
+   * \returns a new receive aggregator, or 0 if none is registered
+   */
+  static Ptr<ReceiveOffload> CreateReceiveOffload (void);
+
+private:
+  /**
+   * \returns the segmentation callbacks, by protocol number
+   */
+  static std::map<uint16_t, SegmentCallback> & GetSegmenters (void);
+  /**
+   * \returns the aggregator factory
+   */
+  static ReceiveOffloadFactory & GetReceiveOffloadFactory (void);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline TypeId
+GsoTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::GsoTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Network")
+    .AddConstructor<GsoTag> ()
+  ;
+  return tid;
+}
+
+inline TypeId
+GsoTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+inline uint32_t
+GsoTag::GetSerializedSize (void) const
+{
+  return 2;
+}
+
+inline void
+GsoTag::Serialize (TagBuffer buf) const
+{
+  buf.WriteU16 (m_segmentSize);
+}
+
+inline void
+GsoTag::Deserialize (TagBuffer buf)
+{
+  m_segmentSize = buf.ReadU16 ();
+}
+
+inline void
+GsoTag::Print (std::ostream &os) const
+{
+  os << "SegmentSize=" << m_segmentSize;
+}
+
+inline
+GsoTag::GsoTag ()
+  : m_segmentSize (0)
+{
+}
+
+inline
+GsoTag::GsoTag (uint16_t segmentSize)
+  : m_segmentSize (segmentSize)
+{
+}
+
+inline uint16_t
+GsoTag::GetSegmentSize (void) const
+{
+  return m_segmentSize;
+}
+
+inline
+ReceiveOffload::~ReceiveOffload ()
+{
+}
+
+inline void
+ReceiveOffload::SetDeliverCallback (DeliverCallback cb)
+{
+  m_deliver = cb;
+}
+
+inline void
+ReceiveOffload::Deliver (Ptr<Packet> packet, uint16_t protocol, const Address &from)
+{
+  m_deliver (packet, protocol, from);
+}
+
+inline std::map<uint16_t, PacketOffload::SegmentCallback> &
+PacketOffload::GetSegmenters (void)
+{
+  static std::map<uint16_t, SegmentCallback> segmenters;
+  return segmenters;
+}
+
+inline PacketOffload::ReceiveOffloadFactory &
+PacketOffload::GetReceiveOffloadFactory (void)
+{
+  static ReceiveOffloadFactory factory;
+  return factory;
+}
+
+inline void
+PacketOffload::RegisterSegmenter (uint16_t protocol, SegmentCallback cb)
+{
+  GetSegmenters ()[protocol] = cb;
+}
+
+inline void
+PacketOffload::RegisterReceiveOffload (ReceiveOffloadFactory cb)
+{
+  GetReceiveOffloadFactory () = cb;
+}
+
+inline bool
+PacketOffload::IsSuperSegment (Ptr<const Packet> packet)
+{
+  GsoTag tag;
+  return packet->PeekPacketTag (tag);
+}
+
+inline bool
+PacketOffload::Segment (Ptr<const Packet> packet, uint16_t protocol, std::vector<Ptr<Packet> > &segments)
+{
+  std::map<uint16_t, SegmentCallback>::const_iterator i = GetSegmenters ().find (protocol);
+  if (i == GetSegmenters ().end ())
+    {
+      return false;
+    }
+  return i->second (packet, segments);
+}
+
+inline Ptr<ReceiveOffload>
+PacketOffload::CreateReceiveOffload (void)
+{
+  if (GetReceiveOffloadFactory ().IsNull ())
+    {
+      return 0;
+    }
+  return GetReceiveOffloadFactory () ();
+}
+
+} // namespace ns3
+
+#endif /* PACKET_OFFLOAD_H */
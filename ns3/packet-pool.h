@@ -0,0 +1,371 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <vector>
+#include "ns3/ptr.h"
+#include "packet.h"
+
+/**
+ * \file
+ * \ingroup packet
+ * ns3::PacketPool declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief Recycle the memory of the Packet instances.
+ *
+ * Every application creates its packets with Create<Packet>, and every
+ * device, queue and protocol copies them with Packet::Copy, which
+ * allocate a new Packet each. When the pool is enabled, a Packet no
+ * longer referenced is destroyed, which releases its buffer, tags and
+ * metadata at once, but its memory is kept in a free list instead of
+ * being returned to operator delete. Create() and Packet::Copy build
+ * their packet in place in that memory:
+ *
+ * \code
+ *   PacketPool::SetEnabled (true);
+ *   Ptr<Packet> p = PacketPool::Create (1000);  // instead of Create<Packet> (1000)
+ * \endcode
+ *
+ * The pool is disabled by default; it can also be enabled by setting
+ * the NS_PACKET_POOL environment variable to 1, without changing the
+ * simulation scripts. Disabled, Create() is Create<Packet>.
+ *
+ * The free lists belong to the thread which releases the packets, so
+ * the pool needs no lock with the MultithreadedSimulatorImpl. They
+ * hold at most SetMaxPooled() packets per thread. GetStats() reads the
+ * counters of the calling thread, GetTotalStats() and PrintStats() the
+ * sum over all the threads.
+ */
+class PacketPool
+{
+public:
+  /** Allocation counters, of a thread or of all of them. */
+  struct Stats
+  {
+    uint64_t allocations; /**< Number of packets created through the pool. */
+    uint64_t reused;      /**< Allocations served from the free list. */
+    uint64_t released;    /**< Number of packets kept by the free list. */
+    uint64_t pooled;      /**< Number of packets currently in the free list. */
+  };
+
+  /**
+   * Enable or disable the pool. Packets released while the pool is
+   * disabled are deleted.
+   *
+   * \param [in] enabled Whether to recycle the packets.
+   */
+  static void SetEnabled (bool enabled);
+  /**
+   * \returns Whether the pool is enabled.
+   */
+  static bool IsEnabled (void);
+  /**
+   * Get a packet with a zero-filled payload, as with
+   * Create<Packet> (size).
+   *
+   * \param [in] size The size of the payload.
+   * \returns The packet.
+   */
+  static Ptr<Packet> Create (uint32_t size = 0);
+  /**
+   * Get a copy of a packet, as with Packet::Copy.
+   *
+   * \param [in] packet The packet to copy.
+   * \returns The copy.
+   */
+  static Ptr<Packet> Copy (const Packet &packet);
+  /**
+   * Destroy a packet no longer referenced, and keep its memory or
+   * delete it.
+   *
+   * \param [in] packet The packet.
+   */
+  static void Release (Packet *packet);
+  /**
+   * Set the maximum number of free packets per thread.
+   *
+   * \param [in] n The maximum.
+   */
+  static void SetMaxPooled (uint32_t n);
+  /**
+   * Get the counters of the calling thread.
+   *
+   * \returns The counters.
+   */
+  static Stats GetStats (void);
+  /**
+   * Get the sum of the counters of all the threads which used the pool.
+   *
+   * The counters of the other threads are read without synchronization:
+   * call it when they no longer use the pool, e.g. after Simulator::Run.
+   *
+   * \returns The counters.
+   */
+  static Stats GetTotalStats (void);
+  /**
+   * Print the counters of all the threads, as with GetTotalStats(), and
+   * the fraction of the allocations served by the free lists.
+   *
+   * \param [in] os The output stream.
+   */
+  static void PrintStats (std::ostream &os);
+  /** Return the memory of the free packets of the calling thread. */
+  static void Trim (void);
+
+private:
+  /**
+   * The free list and counters of one thread, never destroyed: a
+   * packet may be released late in the shutdown of its thread.
+   */
+  struct Cache
+  {
+    std::vector<void *> list; /**< The memory of the released packets. */
+    Stats stats;              /**< The counters. */
+  };
+
+  /** The caches of all the threads, for GetTotalStats(). */
+  struct Registry
+  {
+    std::mutex mutex;            /**< Protects caches. */
+    std::vector<Cache *> caches; /**< The cache of each thread. */
+  };
+
+  /**
+   * Get the free list of the calling thread.
+   *
+   * \returns The free list.
+   */
+  static Cache & GetCache (void);
+  /**
+   * Get the caches of all the threads; never destroyed, as the caches.
+   *
+   * \returns The registry.
+   */
+  static Registry & GetRegistry (void);
+  /**
+   * Get the flag set by SetEnabled.
+   *
+   * \returns A reference to the flag.
+   */
+  static bool & GetEnabled (void);
+  /**
+   * Get the maximum number of free packets per thread.
+   *
+   * \returns A reference to the maximum.
+   */
+  static uint32_t & GetMaxPooled (void);
+  /**
+   * Get the memory for a packet.
+   *
+   * \returns The memory, from the free list or operator new.
+   */
+  static void * Take (void);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+PacketPoolDeleter::Delete (Packet *packet)
+{
+  PacketPool::Release (packet);
+}
+
+inline Ptr<Packet>
+Packet::Copy (void) const
+{
+  return PacketPool::Copy (*this);
+}
+
+inline PacketPool::Cache &
+PacketPool::GetCache (void)
+{
+  static thread_local Cache *cache = 0;
+  if (cache == 0)
+    {
+      cache = new Cache ();
+      Registry &registry = GetRegistry ();
+      std::lock_guard<std::mutex> lock (registry.mutex);
+      registry.caches.push_back (cache);
+    }
+  return *cache;
+}
+
+inline PacketPool::Registry &
+PacketPool::GetRegistry (void)
+{
+  static Registry *registry = new Registry ();
+  return *registry;
+}
+
+inline bool &
+PacketPool::GetEnabled (void)
+{
+  static bool enabled = std::getenv ("NS_PACKET_POOL") != 0
+    && std::strcmp (std::getenv ("NS_PACKET_POOL"), "1") == 0;
+  return enabled;
+}
+
+inline void
+PacketPool::SetEnabled (bool enabled)
+{
+  GetEnabled () = enabled;
+}
+
+inline bool
+PacketPool::IsEnabled (void)
+{
+  return GetEnabled ();
+}
+
+inline uint32_t &
+PacketPool::GetMaxPooled (void)
+{
+  static uint32_t maxPooled = 4096;
+  return maxPooled;
+}
+
+inline void
+PacketPool::SetMaxPooled (uint32_t n)
+{
+  GetMaxPooled () = n;
+}
+
+inline void *
+PacketPool::Take (void)
+{
+  Cache &cache = GetCache ();
+  cache.stats.allocations++;
+  if (cache.list.empty ())
+    {
+      return ::operator new (sizeof (Packet));
+    }
+  void *p = cache.list.back ();
+  cache.list.pop_back ();
+  cache.stats.reused++;
+  cache.stats.pooled--;
+  return p;
+}
+
+inline Ptr<Packet>
+PacketPool::Create (uint32_t size)
+{
+  if (!IsEnabled ())
+    {
+      return ns3::Create<Packet> (size);
+    }
+  // The reference count of a new packet is 1.
+  return Ptr<Packet> (new (Take ()) Packet (size), false);
+}
+
+inline Ptr<Packet>
+PacketPool::Copy (const Packet &packet)
+{
+  if (!IsEnabled ())
+    {
+      return Ptr<Packet> (new Packet (packet), false);
+    }
+  return Ptr<Packet> (new (Take ()) Packet (packet), false);
+}
+
+inline void
+PacketPool::Release (Packet *packet)
+{
+  if (!IsEnabled ())
+    {
+      delete packet;
+      return;
+    }
+  packet->~Packet ();
+  Cache &cache = GetCache ();
+  if (cache.list.size () >= GetMaxPooled ())
+    {
+      ::operator delete (packet);
+      return;
+    }
+  cache.list.push_back (packet);
+  cache.stats.released++;
+  cache.stats.pooled++;
+}
+
+inline PacketPool::Stats
+PacketPool::GetStats (void)
+{
+  return GetCache ().stats;
+}
+
+inline PacketPool::Stats
+PacketPool::GetTotalStats (void)
+{
+  Stats total = Stats ();
+  Registry &registry = GetRegistry ();
+  std::lock_guard<std::mutex> lock (registry.mutex);
+  for (std::vector<Cache *>::const_iterator i = registry.caches.begin (); i != registry.caches.end (); ++i)
+    {
+      total.allocations += (*i)->stats.allocations;
+      total.reused += (*i)->stats.reused;
+      total.released += (*i)->stats.released;
+      total.pooled += (*i)->stats.pooled;
+    }
+  return total;
+}
+
+inline void
+PacketPool::PrintStats (std::ostream &os)
+{
+  Stats stats = GetTotalStats ();
+  os << "allocations=" << stats.allocations
+     << " reused=" << stats.reused
+     << " released=" << stats.released
+     << " pooled=" << stats.pooled
+     << " hit-rate=" << (stats.allocations > 0 ? static_cast<double> (stats.reused) / stats.allocations : 0.0);
+}
+
+inline void
+PacketPool::Trim (void)
+{
+  Cache &cache = GetCache ();
+  for (uint32_t i = 0; i < cache.list.size (); i++)
+    {
+      ::operator delete (cache.list[i]);
+    }
+  cache.list.clear ();
+  cache.stats.pooled = 0;
+}
+
+} // namespace ns3
+
+#endif /* PACKET_POOL_H */
@@ -26,12 +26,27 @@
 */
 
 #include <stdint.h>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <ostream>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
+#include "ns3/assert.h"
 #include "ns3/type-id.h"
+#include "tag.h"
 
-namespace ns3 {
+/**
+ * Size, in bytes, of the storage for the most recent tags inside each
+ * PacketTagList; a multiple of 8.
+ */
+#ifndef PACKET_TAG_LIST_INLINE_SIZE
+#define PACKET_TAG_LIST_INLINE_SIZE 96
+#endif
 
-class Tag;
+namespace ns3 {
 
 /**
  * \ingroup packet
@@ -119,6 +134,23 @@ class Tag;
  *       The portion of the list between the first branch and the target is
  *       shared. This portion is copied before the #Remove or #Replace is
  *       performed.
+ *
+ * \par <b> Inline storage </b>
+ *
+ *   - Most packets carry a few small tags (FlowIdTag, SocketIpTosTag,
+ *     PdcpTag, ...).  The TagData of the most recent tags are built in
+ *     a buffer of PACKET_TAG_LIST_INLINE_SIZE bytes inside the
+ *     PacketTagList rather than on the heap.  They always form the head
+ *     of the branch, are never shared (\c count = 1), and the last of
+ *     them points to the heap allocated, shared part of the tree, if any.
+ *
+ *   - Copies duplicate the inline TagData, a few tens of bytes, and
+ *     still share the heap part; a list without inline tags is copied
+ *     with a single pointer, as before.
+ *
+ *   - When a tag does not fit any more, the inline TagData are moved to
+ *     the heap and the new tag starts a new inline head.  Removing an
+ *     inline tag compacts the buffer.
  */
 class PacketTagList 
 {
@@ -141,7 +173,11 @@ public:
   struct TagData
   {
     struct TagData * next;      /**< Pointer to next in list */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> count; /**< Number of incoming links */
+#else
     uint32_t count;             /**< Number of incoming links */
+#endif
     TypeId tid;                 /**< Type of the tag serialized into #data */
     uint32_t size;              /**< Size of the \c data buffer */
     uint8_t data[1];            /**< Serialization buffer */
@@ -228,62 +264,73 @@ private:
    */
   static
   TagData * CreateTagData (size_t dataSize);
-  
   /**
-   * Typedef of method function pointer for copy-on-write operations
+   * Construct a TagData struct in the inline buffer.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True if operation successful, false otherwise
+   * \param [in] dataSize The serialized size of the Tag.
+   * \returns The newly constructed TagData object, or 0 if it does
+   *          not fit in the buffer.
    */
-  typedef bool (PacketTagList::*COWWriter)
-    (Tag       & tag, bool         preMerge,
-    struct TagData * cur, struct TagData ** prevNext);
+  TagData * CreateInlineTagData (size_t dataSize);
   /**
-   * Traverse the list implementing copy-on-write, using \pname{Writer}.
+   * Destroy a TagData which is not referenced any more.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] Writer The copy-on-write function to use.
-   * \returns True if \pname{tag} found, false otherwise.
+   * \param [in] data The TagData, unlinked from the list.
    */
-  bool COWTraverse   (Tag & tag, PacketTagList::COWWriter Writer);
+  void FreeTagData (struct TagData *data);
   /**
-   * Copy-on-write implementing Remove.
+   * Drop a reference to a TagData on the heap, and destroy it and the
+   * TagData after it which are no longer referenced.
    *
-   * \param [in] tag The target tag type to remove.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag will definitely be removed.
+   * \param [in] data The TagData.
+   */
+  static void ReleaseTagData (struct TagData *data);
+  /**
+   * \param [in] dataSize The serialized size of a Tag.
+   * \returns The size of its TagData in the inline buffer.
+   */
+  static size_t GetInlineSize (size_t dataSize);
+  /**
+   * \param [in] data A TagData.
+   * \returns True if \pname{data} is in the inline buffer.
    */
-  bool RemoveWriter  (Tag & tag, bool preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
+  bool IsInline (const struct TagData *data) const;
   /**
-   * Copy-on-write implementing Replace
+   * Duplicate the inline TagData of another list, and join its heap
+   * part.
    *
-   * \param [in] tag The target tag type to replace
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *          false otherwise.
-   * \param [in] cur Pointer to the tag
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag value will definitely be replaced.
+   * \param [in] o The PacketTagList to copy, into an empty list.
+   */
+  void CopyFrom (PacketTagList const &o);
+  /**
+   * Move the inline TagData to the heap.
    */
-  bool ReplaceWriter (Tag & tag, bool preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
+  void Spill (void);
+  /**
+   * Find a tag and make sure it is not shared, copying the shared
+   * part of the list up to it if needed (see Copy-on-write above).
+   *
+   * \param [in] tid The type of the tag.
+   * \returns The pointer pointing to the TagData of the tag, or 0 if
+   *          the tag is not in the list.
+   */
+  struct TagData ** FindPrivate (TypeId tid);
 
   /**
    * Pointer to first \ref TagData on the list
    */
   struct TagData *m_next;
+  /**
+   * Number of bytes used in the inline buffer.
+   */
+  uint32_t m_inlineUsed;
+  /**
+   * Buffer for the most recent TagData.
+   */
+  uint64_t m_inline[PACKET_TAG_LIST_INLINE_SIZE / 8];
 };
 
+
 } // namespace ns3
 
 /****************************************************
@@ -293,33 +340,28 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_next (),
+    m_inlineUsed (0)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_next (),
+    m_inlineUsed (0)
 {
-  if (m_next != 0)
-    {
-      m_next->count++;
-    }
+  CopyFrom (o);
 }
 
 PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o)
     {
       return *this;
     }
   RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
-    {
-      m_next->count++;
-    }
+  CopyFrom (o);
   return *this;
 }
 
@@ -331,27 +373,301 @@ PacketTagList::~PacketTagList ()
 void
 PacketTagList::RemoveAll (void)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  // The inline TagData are owned by this list alone.
+  struct TagData *cur = m_next;
+  while (cur != 0 && IsInline (cur))
+    {
+      cur = cur->next;
+    }
+  if (cur != 0)
+    {
+      ReleaseTagData (cur);
+    }
+  m_next = 0;
+  m_inlineUsed = 0;
+}
+
+inline void
+PacketTagList::ReleaseTagData (struct TagData *data)
+{
+  // Test the result of the decrement itself: with NS3_MTP, the other
+  // owner may release the same TagData concurrently.
+  while (data != 0 && --data->count == 0)
+    {
+      struct TagData *next = data->next;
+      data->~TagData ();
+      std::free (data);
+      data = next;
+    }
+}
+
+inline size_t
+PacketTagList::GetInlineSize (size_t dataSize)
+{
+  return (offsetof (struct TagData, data) + dataSize + 7) & ~static_cast<size_t> (7);
+}
+
+inline bool
+PacketTagList::IsInline (const struct TagData *data) const
+{
+  const uint8_t *p = reinterpret_cast<const uint8_t *> (data);
+  const uint8_t *start = reinterpret_cast<const uint8_t *> (m_inline);
+  return p >= start && p < start + m_inlineUsed;
+}
+
+inline struct PacketTagList::TagData *
+PacketTagList::CreateTagData (size_t dataSize)
+{
+  size_t size = offsetof (struct TagData, data) + dataSize;
+  if (size < sizeof (struct TagData))
     {
-      cur->count--;
-      if (cur->count > 0) 
+      size = sizeof (struct TagData);
+    }
+  void *p = std::malloc (size);
+  NS_ASSERT (p != 0);
+  struct TagData *tag = new (p) struct TagData ();
+  tag->size = dataSize;
+  return tag;
+}
+
+inline struct PacketTagList::TagData *
+PacketTagList::CreateInlineTagData (size_t dataSize)
+{
+  size_t size = GetInlineSize (dataSize);
+  if (m_inlineUsed + size > sizeof (m_inline))
+    {
+      return 0;
+    }
+  uint8_t *p = reinterpret_cast<uint8_t *> (m_inline) + m_inlineUsed;
+  m_inlineUsed += size;
+  struct TagData *tag = new (p) struct TagData ();
+  tag->size = dataSize;
+  return tag;
+}
+
+inline void
+PacketTagList::FreeTagData (struct TagData *data)
+{
+  if (!IsInline (data))
+    {
+      data->~TagData ();
+      std::free (data);
+      return;
+    }
+  // Close the gap: shift the pointers to the TagData after it, then
+  // the TagData themselves.
+  uint8_t *hole = reinterpret_cast<uint8_t *> (data);
+  size_t size = GetInlineSize (data->size);
+  struct TagData *cur = m_next;
+  struct TagData **link = &m_next;
+  while (true)
+    {
+      if (IsInline (*link) && reinterpret_cast<uint8_t *> (*link) > hole)
+        {
+          *link = reinterpret_cast<struct TagData *> (reinterpret_cast<uint8_t *> (*link) - size);
+        }
+      if (cur == 0 || !IsInline (cur))
         {
           break;
         }
-      if (prev != 0) 
+      link = &cur->next;
+      cur = cur->next;
+    }
+  uint8_t *end = reinterpret_cast<uint8_t *> (m_inline) + m_inlineUsed;
+  std::memmove (hole, hole + size, end - hole - size);
+  m_inlineUsed -= size;
+}
+
+inline void
+PacketTagList::CopyFrom (PacketTagList const &o)
+{
+  NS_ASSERT (m_next == 0 && m_inlineUsed == 0);
+  struct TagData *shared = o.m_next;
+  if (o.IsInline (shared))
+    {
+      std::memcpy (m_inline, o.m_inline, o.m_inlineUsed);
+      m_inlineUsed = o.m_inlineUsed;
+      ptrdiff_t delta = reinterpret_cast<uint8_t *> (m_inline)
+        - reinterpret_cast<const uint8_t *> (o.m_inline);
+      struct TagData **link = &m_next;
+      while (o.IsInline (shared))
         {
-          prev->~TagData ();
-          std::free (prev);
+          *link = reinterpret_cast<struct TagData *> (reinterpret_cast<uint8_t *> (shared) + delta);
+          shared = shared->next;
+          link = &(*link)->next;
         }
-      prev = cur;
+      *link = shared;
     }
-  if (prev != 0) 
+  else
     {
-      prev->~TagData ();
-      std::free (prev);
+      m_next = shared;
     }
-  m_next = 0;
+  if (shared != 0)
+    {
+      shared->count++;
+    }
+}
+
+inline void
+PacketTagList::Spill (void)
+{
+  struct TagData **link = &m_next;
+  for (struct TagData *cur = m_next; cur != 0 && IsInline (cur); cur = cur->next)
+    {
+      struct TagData *copy = CreateTagData (cur->size);
+      copy->count = 1;
+      copy->tid = cur->tid;
+      copy->next = cur->next;
+      std::memcpy (copy->data, cur->data, cur->size);
+      *link = copy;
+      link = &copy->next;
+    }
+  m_inlineUsed = 0;
+}
+
+inline struct PacketTagList::TagData **
+PacketTagList::FindPrivate (TypeId tid)
+{
+  struct TagData **prevNext = &m_next; // previous node's next pointer
+  struct TagData *cur = m_next;        // cursor to current node
+  // Search from the head of the list until we find tid or a merge
+  while (cur != 0 && cur->count == 1)
+    {
+      if (cur->tid == tid)
+        {
+          // found before first merge, can be edited in place
+          return prevNext;
+        }
+      prevNext = &cur->next;
+      cur = cur->next;
+    }
+  // Found merge (or the end) before finding tid: keep looking
+  struct TagData *it = cur;
+  while (it != 0 && it->tid != tid)
+    {
+      it = it->next;
+    }
+  if (it == 0)
+    {
+      return 0;
+    }
+  // tid is past the first merge: copy the shared part up to and
+  // including it, which adds one reference to the node after it,
+  // then drop the reference of this branch to the merge, not before:
+  // the other branches may release it meanwhile.
+  struct TagData *merge = cur;
+  struct TagData **found = 0;
+  while (true)
+    {
+      struct TagData *copy = CreateTagData (cur->size);
+      copy->count = 1;
+      copy->tid = cur->tid;
+      std::memcpy (copy->data, cur->data, cur->size);
+      *prevNext = copy;
+      found = prevNext;
+      prevNext = &copy->next;
+      if (cur == it)
+        {
+          copy->next = cur->next;
+          if (copy->next != 0)
+            {
+              copy->next->count++;
+            }
+          break;
+        }
+      cur = cur->next;
+    }
+  ReleaseTagData (merge);
+  return found;
+}
+
+inline void
+PacketTagList::Add (const Tag &tag) const
+{
+  TypeId tid = tag.GetInstanceTypeId ();
+  // ensure this id was not yet added
+  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+    {
+      NS_ASSERT_MSG (cur->tid != tid, "Error: cannot add the same kind of tag twice.");
+    }
+  // Add is conceptually const: it grows a branch no one else sees.
+  PacketTagList *self = const_cast<PacketTagList *> (this);
+  uint32_t size = tag.GetSerializedSize ();
+  struct TagData *head = self->CreateInlineTagData (size);
+  if (head == 0 && m_inlineUsed > 0)
+    {
+      self->Spill ();
+      head = self->CreateInlineTagData (size);
+    }
+  if (head == 0)
+    {
+      head = CreateTagData (size);
+    }
+  head->count = 1;
+  head->tid = tid;
+  head->next = m_next;
+  tag.Serialize (TagBuffer (head->data, head->data + head->size));
+  self->m_next = head;
+}
+
+inline bool
+PacketTagList::Remove (Tag &tag)
+{
+  struct TagData **link = FindPrivate (tag.GetInstanceTypeId ());
+  if (link == 0)
+    {
+      return false;
+    }
+  struct TagData *cur = *link;
+  tag.Deserialize (TagBuffer (cur->data, cur->data + cur->size));
+  *link = cur->next;
+  FreeTagData (cur);
+  return true;
+}
+
+inline bool
+PacketTagList::Replace (Tag &tag)
+{
+  struct TagData **link = FindPrivate (tag.GetInstanceTypeId ());
+  if (link == 0)
+    {
+      Add (tag);
+      return false;
+    }
+  struct TagData *cur = *link;
+  uint32_t size = tag.GetSerializedSize ();
+  if (size != cur->size)
+    {
+      *link = cur->next;
+      FreeTagData (cur);
+      Add (tag);
+      return true;
+    }
+  tag.Serialize (TagBuffer (cur->data, cur->data + cur->size));
+  return true;
+}
+
+inline bool
+PacketTagList::Peek (Tag &tag) const
+{
+  TypeId tid = tag.GetInstanceTypeId ();
+  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+    {
+      if (cur->tid == tid)
+        {
+          // found
+          tag.Deserialize (TagBuffer (cur->data, cur->data + cur->size));
+          return true;
+        }
+    }
+  // not found
+  return false;
+}
+
+inline const struct PacketTagList::TagData *
+PacketTagList::Head (void) const
+{
+  return m_next;
 }
 
 } // namespace ns3
@@ -21,8 +21,12 @@
 #define PACKET_H
 
 #include <stdint.h>
+#include <typeinfo>
+#include <type_traits>
 #include "buffer.h"
+#include "buffer-chain.h"
 #include "header.h"
+#include "fixed-size-header.h"
 #include "trailer.h"
 #include "packet-metadata.h"
 #include "tag.h"
@@ -34,11 +38,15 @@
 #include "ns3/assert.h"
 #include "ns3/ptr.h"
 #include "ns3/deprecated.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 namespace ns3 {
 
 // Forward declaration
 class Address;
+class Packet;
   
 /**
  * \ingroup network
@@ -179,6 +187,19 @@ private:
   const struct PacketTagList::TagData *m_current;  //!< actual position over the set of tags in a packet
 };
 
+/**
+ * \ingroup packet
+ *
+ * Deleter of Packet: gives the released instances to the PacketPool.
+ */
+struct PacketPoolDeleter
+{
+  /**
+   * \param packet the Packet no longer referenced
+   */
+  static void Delete (Packet *packet);
+};
+
 /**
  * \ingroup packet
  * \brief network packets
@@ -217,6 +238,14 @@ private:
  * qos class id set by an application and processed by a lower-level MAC 
  * layer.
  *
+ * - In scatter-gather mode (Packet::EnableScatterGather), AddAtEnd does
+ * not copy the bytes of the packet appended: its buffers are kept, shared,
+ * in a BufferChain after the byte buffer, and copied into it only when an
+ * operation needs the bytes at the end of the packet contiguous (a
+ * trailer, Serialize, PeekData...). Concatenating and fragmenting large
+ * packets, as TCP and IP reassembly do, then copy no payload. Headers are
+ * added and removed at the start of the byte buffer, as usual.
+ *
  * Implementing a new type of Header or Trailer for a new protocol is 
  * pretty easy and is a matter of creating a subclass of the ns3::Header 
  * or of the ns3::Trailer base class, and implementing the methods
@@ -228,7 +257,7 @@ private:
  * The performance aspects copy-on-write semantics of the
  * Packet API are discussed in \ref packetperf
  */
-class Packet : public SimpleRefCount<Packet>
+class Packet : public SimpleRefCount<Packet, empty, PacketPoolDeleter>
 {
 public:
 
@@ -251,10 +280,14 @@ public:
   /**
    * \brief Create a packet with a zero-filled payload.
    *
-   * The memory necessary for the payload is not allocated:
-   * it will be allocated at any later point if you attempt
-   * to fragment this packet or to access the zero-filled
-   * bytes. The packet is allocated with a new uid (as 
+   * The memory necessary for the payload is not allocated.
+   * The payload stays virtual through copies, fragments,
+   * the IP checksums, which skip it, and pcap traces, which
+   * write it from a static block of zeros: it is allocated
+   * only if you write into it, call PeekData, or append a
+   * buffer which does not start with zero-filled bytes after
+   * it. GetMaterializedSize tells how many bytes are stored.
+   * The packet is allocated with a new uid (as 
    * returned by getUid).
    * 
    * \param size the size of the zero-filled payload
@@ -302,6 +335,14 @@ public:
    * \returns the size in bytes of the packet
    */
   inline uint32_t GetSize (void) const;
+  /**
+   * \brief Returns the number of bytes of the packet which are stored
+   * in memory, i.e., the size of the packet minus its zero-filled
+   * payload, as long as the payload was not materialized.
+   *
+   * \returns the number of bytes stored in memory
+   */
+  inline uint32_t GetMaterializedSize (void) const;
   /**
    * \brief Add header to this packet.
    *
@@ -356,6 +397,51 @@ public:
    * \returns the number of bytes read from the packet.
    */
   uint32_t PeekHeader (Header &header, uint32_t size) const;
+  /**
+   * \brief Add a fixed-size header to this packet.
+   *
+   * Selected instead of AddHeader (const Header &) when T declares a
+   * FIXED_SIZE constant: the header is serialized by
+   * T::SerializeFixed into a local array, copied into the buffer with
+   * a single write and recorded in the metadata as by the generic
+   * version. Falls back to the generic version when T::SerializeFixed
+   * declines, or when header is an instance of a class derived from T.
+   *
+   * \tparam T \deduced The header class (see FixedSizeHeader).
+   * \param header a reference to the header to add to this packet.
+   */
+  template <typename T>
+  typename std::enable_if<IsFixedSizeHeader<T>::value>::type
+  AddHeader (const T &header);
+  /**
+   * \brief Deserialize and remove a fixed-size header from the internal
+   * buffer.
+   *
+   * Selected instead of RemoveHeader (Header &) when T declares a
+   * FIXED_SIZE constant: the header is read with a single read from
+   * the buffer and deserialized by T::DeserializeFixed.
+   *
+   * \tparam T \deduced The header class (see FixedSizeHeader).
+   * \param header a reference to the header to remove from the internal buffer.
+   * \returns the number of bytes removed from the packet.
+   */
+  template <typename T>
+  typename std::enable_if<IsFixedSizeHeader<T>::value, uint32_t>::type
+  RemoveHeader (T &header);
+  /**
+   * \brief Deserialize but does _not_ remove a fixed-size header from the
+   * internal buffer.
+   *
+   * Selected instead of PeekHeader (Header &) when T declares a
+   * FIXED_SIZE constant.
+   *
+   * \tparam T \deduced The header class (see FixedSizeHeader).
+   * \param header a reference to the header to read from the internal buffer.
+   * \returns the number of bytes read from the packet.
+   */
+  template <typename T>
+  typename std::enable_if<IsFixedSizeHeader<T>::value, uint32_t>::type
+  PeekHeader (T &header) const;
   /**
    * \brief Add trailer to this packet.
    *
@@ -449,9 +535,10 @@ public:
    *
    * The returns packet will behave like an independent copy of
    * the original packet, even though they both share the
-   * same datasets internally.
+   * same datasets internally. The copy is built in the memory of a
+   * released packet when the PacketPool is enabled.
    */
-  Ptr<Packet> Copy (void) const;
+  inline Ptr<Packet> Copy (void) const;
 
   /**
    * \brief Returns the packet's Uid.
@@ -530,6 +617,19 @@ public:
    * errors will be detected and will abort the program.
    */
   static void EnableChecking (void);
+  /**
+   * \brief Enable the scatter-gather mode of AddAtEnd and CreateFragment.
+   *
+   * The packets concatenated then share the buffers of the packets
+   * appended instead of copying them (see the class documentation).
+   * This method must be called during the simulation setup, before any
+   * packet is created.
+   */
+  static void EnableScatterGather (void);
+  /**
+   * \returns true if EnableScatterGather was called.
+   */
+  static bool IsScatterGatherEnabled (void);
 
   /**
    * \brief Returns number of bytes required for packet
@@ -758,7 +858,21 @@ private:
    */
   uint32_t Deserialize (uint8_t const*buffer, uint32_t size);
 
+  /**
+   * \brief Copy the bytes of m_tail at the end of m_buffer.
+   *
+   * Called before the operations which need the whole content of the
+   * packet in m_buffer. Const methods call it through a const_cast: the
+   * content of the packet is unchanged.
+   */
+  void FlattenTail (void);
+  /**
+   * \returns the flag set by EnableScatterGather
+   */
+  static bool & GetScatterGather (void);
+
   Buffer m_buffer;                //!< the packet buffer (it's actual contents)
+  BufferChain m_tail;             //!< In scatter-gather mode, the bytes after m_buffer, not yet copied into it
   ByteTagList m_byteTagList;      //!< the ByteTag list
   PacketTagList m_packetTagList;  //!< the packet's Tag list
   PacketMetadata m_metadata;      //!< the packet's metadata
@@ -767,6 +881,17 @@ private:
   Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
   static uint32_t m_globalUid; //!< Global counter of packets Uid
+
+  /**
+   * \brief Allocate the uid of a new packet.
+   *
+   * With NS3_MTP the counter is atomic, since the worker threads of the
+   * MultithreadedSimulatorImpl create packets concurrently. The uids stay
+   * unique, but which packet gets which uid depends on thread timing.
+   *
+   * \returns the next value of the global counter of packet uids
+   */
+  static uint32_t AllocateUid (void);
 };
 
 /**
@@ -821,16 +946,123 @@ std::ostream& operator<< (std::ostream& os, const Packet &packet);
 
 } // namespace ns3
 
+// The pool defines PacketPoolDeleter::Delete, used by every Ptr<Packet>,
+// and Packet::Copy.
+#include "packet-pool.h"
+#include "ns3/log.h"
+
 /****************************************************
  *  Implementation of inline methods for performance
  ****************************************************/
 
 namespace ns3 {
 
+inline uint32_t
+Packet::AllocateUid (void)
+{
+#ifdef NS3_MTP
+  static std::atomic<uint32_t> uid (0);
+  return uid.fetch_add (1, std::memory_order_relaxed);
+#else
+  return m_globalUid++;
+#endif
+}
+
 uint32_t 
 Packet::GetSize (void) const
 {
-  return m_buffer.GetSize ();
+  return m_buffer.GetSize () + m_tail.GetSize ();
+}
+
+uint32_t
+Packet::GetMaterializedSize (void) const
+{
+  uint32_t size = m_buffer.GetMaterializedSize ();
+  for (uint32_t i = 0; i < m_tail.GetNSegments (); i++)
+    {
+      size += m_tail.GetSegment (i).GetMaterializedSize ();
+    }
+  return size;
+}
+
+inline bool &
+Packet::GetScatterGather (void)
+{
+  static bool scatterGather = false;
+  return scatterGather;
+}
+
+inline void
+Packet::EnableScatterGather (void)
+{
+  GetScatterGather () = true;
+}
+
+inline bool
+Packet::IsScatterGatherEnabled (void)
+{
+  return GetScatterGather ();
+}
+
+inline void
+Packet::FlattenTail (void)
+{
+  if (m_tail.GetSize () == 0)
+    {
+      return;
+    }
+  m_buffer.AddAtEnd (m_tail.Flatten ());
+  m_tail = BufferChain ();
+}
+
+template <typename T>
+typename std::enable_if<IsFixedSizeHeader<T>::value>::type
+Packet::AddHeader (const T &header)
+{
+  NS_LOG_STATIC_TEMPLATE_DEFINE ("Packet");
+  uint8_t data[T::FIXED_SIZE];
+  if (typeid (header) != typeid (T)
+      || !header.SerializeFixed (data, GetSize () + T::FIXED_SIZE))
+    {
+      AddHeader (static_cast<const Header &> (header));
+      return;
+    }
+  NS_LOG_FUNCTION (this << header.GetInstanceTypeId ().GetName () << T::FIXED_SIZE);
+  m_buffer.AddAtStart (T::FIXED_SIZE);
+  m_byteTagList.Adjust (T::FIXED_SIZE);
+  m_byteTagList.AddAtStart (T::FIXED_SIZE);
+  m_buffer.Begin ().Write (data, T::FIXED_SIZE);
+  m_metadata.AddHeader (header, T::FIXED_SIZE);
+}
+
+template <typename T>
+typename std::enable_if<IsFixedSizeHeader<T>::value, uint32_t>::type
+Packet::RemoveHeader (T &header)
+{
+  NS_LOG_STATIC_TEMPLATE_DEFINE ("Packet");
+  uint32_t size = PeekHeader (header);
+  NS_LOG_FUNCTION (this << header.GetInstanceTypeId ().GetName () << size);
+  m_buffer.RemoveAtStart (size);
+  m_byteTagList.Adjust (-size);
+  m_metadata.RemoveHeader (header, size);
+  return size;
+}
+
+template <typename T>
+typename std::enable_if<IsFixedSizeHeader<T>::value, uint32_t>::type
+Packet::PeekHeader (T &header) const
+{
+  if (typeid (header) == typeid (T) && m_buffer.GetSize () >= T::FIXED_SIZE)
+    {
+      uint8_t data[T::FIXED_SIZE];
+      m_buffer.Begin ().Read (data, T::FIXED_SIZE);
+      uint32_t deserialized = header.DeserializeFixed (data, GetSize ());
+      if (deserialized != 0)
+        {
+          return deserialized;
+        }
+    }
+  return PeekHeader (static_cast<Header &> (header));
 }
 
 } // namespace ns3
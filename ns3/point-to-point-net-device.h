@@ -25,6 +25,7 @@
 #include "ns3/net-device.h"
 #include "ns3/callback.h"
 #include "ns3/packet.h"
+#include "ns3/packet-offload.h"
 #include "ns3/traced-callback.h"
 #include "ns3/nstime.h"
 #include "ns3/data-rate.h"
@@ -150,6 +151,23 @@ public:
    */
   void Receive (Ptr<Packet> p);
 
+  /**
+   * \brief Configure the segmentation and receive offloads.
+   *
+   * \param segmentationOffload if true, the channel carries the
+   *        super-segments (see GsoTag) whole; otherwise Send splits them
+   *        into segments with PacketOffload::Segment before queuing them.
+   * \param receiveOffload if true, the packets received go through a
+   *        GRO aggregator (see PacketOffload::CreateReceiveOffload)
+   *        before the receive callback.
+   *
+   * Both need the offloads of the protocol to be registered in
+   * PacketOffload (TcpOffload::Register for TCP); without them, the
+   * super-segments are sent unsplit and the packets received are
+   * delivered one by one.
+   */
+  void SetOffload (bool segmentationOffload, bool receiveOffload);
+
   // The remaining methods are documented in ns3::NetDevice*
 
   virtual void SetIfIndex (const uint32_t index);
@@ -462,6 +480,32 @@ private:
 
   Ptr<Packet> m_currentPkt; //!< Current packet processed
 
+  /**
+   * \brief Send the segments of a super-segment.
+   *
+   * Send (see the .cc file) starts with it for the packets with a
+   * GsoTag when m_segmentationOffload is false.
+   *
+   * \param packet the super-segment
+   * \param dest the destination address
+   * \param protocolNumber the protocol number of the packet
+   * \returns true if all the segments were queued
+   */
+  bool SendSegments (Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber);
+
+  /**
+   * \brief Pass a received packet to the receive callback; delivery
+   * callback of m_receiveOffload.
+   *
+   * \param packet the packet
+   * \param protocol the protocol number of the packet
+   * \param from the address of the sender
+   */
+  void ForwardUp (Ptr<Packet> packet, uint16_t protocol, const Address &from);
+
+  bool m_segmentationOffload; //!< True if the channel carries super-segments whole
+  Ptr<ReceiveOffload> m_receiveOffload; //!< GRO aggregator of the received packets, if enabled
+
   /**
    * \brief PPP to Ethernet protocol number mapping
    * \param protocol A PPP protocol number
@@ -479,4 +523,57 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+PointToPointNetDevice::SetOffload (bool segmentationOffload, bool receiveOffload)
+{
+  m_segmentationOffload = segmentationOffload;
+  if (m_receiveOffload != 0)
+    {
+      m_receiveOffload->Flush ();
+      m_receiveOffload = 0;
+    }
+  if (receiveOffload)
+    {
+      m_receiveOffload = PacketOffload::CreateReceiveOffload ();
+      if (m_receiveOffload != 0)
+        {
+          m_receiveOffload->SetDeliverCallback (MakeCallback (&PointToPointNetDevice::ForwardUp, this));
+        }
+    }
+}
+
+inline bool
+PointToPointNetDevice::SendSegments (Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber)
+{
+  std::vector<Ptr<Packet> > segments;
+  if (!PacketOffload::Segment (packet, protocolNumber, segments))
+    {
+      // No segmentation for this protocol: send it as a plain packet.
+      GsoTag tag;
+      packet->RemovePacketTag (tag);
+      return Send (packet, dest, protocolNumber);
+    }
+  bool queued = true;
+  for (std::vector<Ptr<Packet> >::const_iterator i = segments.begin (); i != segments.end (); ++i)
+    {
+      queued = Send (*i, dest, protocolNumber) && queued;
+    }
+  return queued;
+}
+
+inline void
+PointToPointNetDevice::ForwardUp (Ptr<Packet> packet, uint16_t protocol, const Address &from)
+{
+  m_rxCallback (this, packet, protocol, from);
+}
+
+} // namespace ns3
+
 #endif /* POINT_TO_POINT_NET_DEVICE_H */
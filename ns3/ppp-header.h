@@ -20,6 +20,7 @@
 #define PPP_HEADER_H
 
 #include "ns3/header.h"
+#include "ns3/fixed-size-header.h"
 
 namespace ns3 {
 
@@ -97,6 +98,25 @@ public:
    */
   uint16_t GetProtocol (void);
 
+  /** Size of the header, for Packet::AddHeader. */
+  static const uint32_t FIXED_SIZE = 2;
+  /**
+   * Serialize the header for Packet::AddHeader.
+   *
+   * \param [out] buffer The FIXED_SIZE bytes to write.
+   * \param [in] size The size of the packet.
+   * \returns true
+   */
+  bool SerializeFixed (uint8_t *buffer, uint32_t size) const;
+  /**
+   * Deserialize the header for Packet::RemoveHeader.
+   *
+   * \param [in] buffer The FIXED_SIZE bytes to read.
+   * \param [in] size The size of the packet.
+   * \returns FIXED_SIZE
+   */
+  uint32_t DeserializeFixed (uint8_t const *buffer, uint32_t size);
+
 private:
 
   /**
@@ -108,4 +128,28 @@ private:
 } // namespace ns3
 
 
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline bool
+PppHeader::SerializeFixed (uint8_t *buffer, uint32_t size) const
+{
+  NS_UNUSED (size);
+  FixedSizeHeader::WriteHtonU16 (buffer, m_protocol);
+  return true;
+}
+
+inline uint32_t
+PppHeader::DeserializeFixed (uint8_t const *buffer, uint32_t size)
+{
+  NS_UNUSED (size);
+  m_protocol = FixedSizeHeader::ReadNtohU16 (buffer);
+  return FIXED_SIZE;
+}
+
+} // namespace ns3
+
 #endif /* PPP_HEADER_H */
@@ -157,6 +157,9 @@ protected:
   RngStream *Peek(void) const;
 
 private:
+  /** Saves and restores the state of the RngStream. */
+  friend class SimulationSnapshot;
+
   /**
    * Copy constructor.  These objects are not copyable.
    *
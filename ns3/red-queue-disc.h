@@ -182,6 +182,27 @@ public:
    */
   void SetTh (double minTh, double maxTh);
 
+  /**
+   * \brief Set the step marking mode of DCTCP.
+   *
+   * Instead of the random early drops or marks on the average queue size,
+   * every packet which finds at least k bytes or packets in the queue (its
+   * instantaneous size) is marked, as a forced mark, or dropped if UseEcn
+   * is false or the packet is not ECN capable. The queue disc then behaves
+   * as the switches of RFC 8257, section 3.1. A k of 0 disables the mode.
+   * DoEnqueue (see red-queue-disc.cc) applies it through StepMark.
+   *
+   * \param k Marking threshold K in bytes or packets.
+   */
+  void SetStepMarking (double k);
+
+  /**
+   * \brief Get the marking threshold of the step marking mode.
+   *
+   * \returns The marking threshold K, 0 if the mode is disabled.
+   */
+  double GetStepMarking (void) const;
+
  /**
   * Assign a fixed random variable stream number to the random variables
   * used by this model.  Return the number of streams (possibly zero) that
@@ -258,6 +279,12 @@ private:
    * \returns Prob. of packet drop
    */
   double ModifyP (double p, uint32_t size);
+  /**
+   * \brief Check if a packet needs to be marked in the step marking mode
+   * \param qSize instantaneous queue size
+   * \returns DTYPE_FORCED to mark or drop, DTYPE_NONE otherwise
+   */
+  uint32_t StepMark (uint32_t qSize) const;
 
   // ** Variables supplied by user
   uint32_t m_meanPktSize;   //!< Avg pkt size
@@ -286,6 +313,7 @@ private:
   Time m_linkDelay;         //!< Link delay
   bool m_useEcn;            //!< True if ECN is used (packets are marked instead of being dropped)
   bool m_useHardDrop;       //!< True if packets are always dropped above max threshold
+  double m_stepTh {0};      //!< Threshold K of the step marking mode (bytes or packets), 0 if disabled
 
   // ** Variables maintained by RED
   double m_vA;              //!< 1.0 / (m_maxTh - m_minTh)
@@ -316,4 +344,31 @@ private:
 
 }; // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+RedQueueDisc::SetStepMarking (double k)
+{
+  m_stepTh = k;
+}
+
+inline double
+RedQueueDisc::GetStepMarking (void) const
+{
+  return m_stepTh;
+}
+
+inline uint32_t
+RedQueueDisc::StepMark (uint32_t qSize) const
+{
+  return m_stepTh > 0 && qSize >= m_stepTh ? DTYPE_FORCED : DTYPE_NONE;
+}
+
+} // namespace ns3
+
 #endif // RED_QUEUE_DISC_H
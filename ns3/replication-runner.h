@@ -0,0 +1,339 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef REPLICATION_RUNNER_H
+#define REPLICATION_RUNNER_H
+
+#include "callback.h"
+#include "simulator.h"
+#include "simulation-snapshot.h"
+#include "rng-seed-manager.h"
+#include "abort.h"
+
+#include <stdint.h>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::ReplicationRunner declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief Run independent replications of a simulation in forked
+ * worker processes.
+ *
+ * The topology is built once by the parent process. Run() then forks
+ * one child process per replication, at most \c workers at a time;
+ * thanks to copy-on-write, a child starts with the whole simulation
+ * state of its parent at no cost. Each child:
+ *  - sets the RngSeedManager run number to \c firstRun plus its
+ *    replication index, and calls SimulationSnapshot::Reseed so that
+ *    the random variables which already exist draw from the new run;
+ *  - invokes the replication callback, which typically runs the
+ *    simulation and writes its results (e.g. with
+ *    FlowMonitor::SerializeToXmlFile) to the file name it is given;
+ *  - exits without returning from Run().
+ *
+ * When all the replications are over, the parent merges their output
+ * files, in replication order, into a single file: if they are XML
+ * files, as written by the FlowMonitor, they become the elements of a
+ * \c Replications root element; other files are concatenated, each
+ * one after a <tt># replication i run r</tt> line.
+ *
+ * The random variables which are not reachable through the attributes
+ * of the objects of the Config root namespace keep, in every child,
+ * the state they had in the parent: give them a stream number with
+ * the \c AssignStreams helper methods before calling Run().
+ *
+ * \code
+ *   // build the topology
+ *   ReplicationRunner runner;
+ *   runner.SetReplications (100);
+ *   runner.SetWorkers (8);
+ *   runner.Run (MakeCallback (&RunOne), "flows.xml");
+ *
+ *   void RunOne (uint32_t replication, std::string output)
+ *   {
+ *     Ptr<FlowMonitor> monitor = flowHelper.InstallAll ();
+ *     Simulator::Stop (Seconds (100));
+ *     Simulator::Run ();
+ *     monitor->SerializeToXmlFile (output, false, false);
+ *   }
+ * \endcode
+ */
+class ReplicationRunner
+{
+public:
+  /**
+   * Replication callback signature.
+   *
+   * \param [in] replication The replication index.
+   * \param [in] output The name of the output file of the replication.
+   */
+  typedef Callback<void, uint32_t, std::string> ReplicationCallback;
+
+  /** Constructor: 1 replication, 1 worker, first run 1. */
+  ReplicationRunner ();
+
+  /**
+   * Set the number of replications.
+   *
+   * \param [in] n The number of replications.
+   */
+  void SetReplications (uint32_t n);
+  /**
+   * Set the maximum number of worker processes running at once.
+   *
+   * \param [in] n The number of workers; 0 means one per hardware thread.
+   */
+  void SetWorkers (uint32_t n);
+  /**
+   * Set the run number of the first replication; replication \c i
+   * uses run <tt>first + i</tt>.
+   *
+   * \param [in] run The first run number.
+   */
+  void SetFirstRun (uint64_t run);
+  /**
+   * Run all the replications, and merge their output files.
+   *
+   * \param [in] replication The replication callback, invoked in the
+   * worker processes.
+   * \param [in] output The name of the merged output file. The output
+   * file of replication \c i is <tt>output.i</tt>, removed once merged.
+   * \returns The number of replications which failed.
+   */
+  uint32_t Run (ReplicationCallback replication, const std::string &output);
+
+private:
+  /**
+   * Run one replication in a child process. Never returns.
+   *
+   * \param [in] replication The replication callback.
+   * \param [in] index The replication index.
+   * \param [in] output The name of the output file of the replication.
+   */
+  void RunChild (ReplicationCallback replication, uint32_t index, const std::string &output);
+  /**
+   * Get the name of the output file of a replication.
+   *
+   * \param [in] output The name of the merged output file.
+   * \param [in] index The replication index.
+   * \returns The file name.
+   */
+  static std::string GetOutputName (const std::string &output, uint32_t index);
+  /**
+   * Merge the output files of the replications.
+   *
+   * \param [in] output The name of the merged output file.
+   * \param [in] failed The failed replications, which are skipped.
+   */
+  void Merge (const std::string &output, const std::map<uint32_t, int> &failed) const;
+
+  /** Number of replications. */
+  uint32_t m_replications;
+  /** Maximum number of worker processes. */
+  uint32_t m_workers;
+  /** Run number of the first replication. */
+  uint64_t m_firstRun;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+ReplicationRunner::ReplicationRunner ()
+  : m_replications (1),
+    m_workers (1),
+    m_firstRun (1)
+{
+}
+
+inline void
+ReplicationRunner::SetReplications (uint32_t n)
+{
+  m_replications = n;
+}
+
+inline void
+ReplicationRunner::SetWorkers (uint32_t n)
+{
+  if (n == 0)
+    {
+      long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+      n = cpus > 0 ? cpus : 1;
+    }
+  m_workers = n;
+}
+
+inline void
+ReplicationRunner::SetFirstRun (uint64_t run)
+{
+  m_firstRun = run;
+}
+
+inline std::string
+ReplicationRunner::GetOutputName (const std::string &output, uint32_t index)
+{
+  std::ostringstream oss;
+  oss << output << "." << index;
+  return oss.str ();
+}
+
+inline void
+ReplicationRunner::RunChild (ReplicationCallback replication, uint32_t index, const std::string &output)
+{
+  RngSeedManager::SetRun (m_firstRun + index);
+  SimulationSnapshot::Reseed ();
+  replication (index, output);
+  Simulator::Destroy ();
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+  // Skip the static destructors, which belong to the parent.
+  _exit (0);
+}
+
+inline uint32_t
+ReplicationRunner::Run (ReplicationCallback replication, const std::string &output)
+{
+  // Do not let the children inherit unflushed output.
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+
+  std::map<pid_t, uint32_t> running;
+  std::map<uint32_t, int> failed;
+  uint32_t next = 0;
+  while (next < m_replications || !running.empty ())
+    {
+      if (next < m_replications && running.size () < m_workers)
+        {
+          pid_t pid = fork ();
+          NS_ABORT_MSG_IF (pid < 0, "ReplicationRunner: fork failed, errno " << errno);
+          if (pid == 0)
+            {
+              RunChild (replication, next, GetOutputName (output, next));
+            }
+          running[pid] = next;
+          next++;
+          continue;
+        }
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          NS_ABORT_MSG_IF (errno != EINTR, "ReplicationRunner: waitpid failed, errno " << errno);
+          continue;
+        }
+      std::map<pid_t, uint32_t>::iterator i = running.find (pid);
+      if (i == running.end ())
+        {
+          continue;
+        }
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+          std::cerr << "ReplicationRunner: replication " << i->second
+                    << " (run " << m_firstRun + i->second << ") failed with status "
+                    << status << std::endl;
+          failed[i->second] = status;
+        }
+      running.erase (i);
+    }
+  Merge (output, failed);
+  return failed.size ();
+}
+
+inline void
+ReplicationRunner::Merge (const std::string &output, const std::map<uint32_t, int> &failed) const
+{
+  const std::string declaration = "<?xml";
+  bool xml = true;
+  std::vector<std::string> contents (m_replications);
+  std::vector<bool> present (m_replications, false);
+  for (uint32_t i = 0; i < m_replications; i++)
+    {
+      std::string name = GetOutputName (output, i);
+      std::ifstream is (name.c_str ());
+      if (failed.count (i) != 0 || !is.good ())
+        {
+          continue;
+        }
+      std::ostringstream oss;
+      oss << is.rdbuf ();
+      contents[i] = oss.str ();
+      present[i] = true;
+      xml = xml && contents[i].compare (0, declaration.size (), declaration) == 0;
+    }
+
+  std::ofstream os (output.c_str ());
+  NS_ABORT_MSG_UNLESS (os.good (), "ReplicationRunner: cannot create " << output);
+  if (xml)
+    {
+      os << "<?xml version=\"1.0\" ?>" << std::endl
+         << "<Replications>" << std::endl;
+    }
+  for (uint32_t i = 0; i < m_replications; i++)
+    {
+      if (!present[i])
+        {
+          continue;
+        }
+      std::string &content = contents[i];
+      if (xml)
+        {
+          // Drop the XML declaration of the replication.
+          content.erase (0, content.find ("?>") + 2);
+          os << "<Replication index=\"" << i << "\" run=\"" << m_firstRun + i << "\">"
+             << content
+             << "</Replication>" << std::endl;
+        }
+      else
+        {
+          os << "# replication " << i << " run " << m_firstRun + i << std::endl
+             << content;
+        }
+      std::remove (GetOutputName (output, i).c_str ());
+    }
+  if (xml)
+    {
+      os << "</Replications>" << std::endl;
+    }
+}
+
+} // namespace ns3
+
+#endif /* REPLICATION_RUNNER_H */
@@ -70,6 +70,18 @@ public:
    * \returns The next random.
    */
   double RandU01 (void);
+  /**
+   * Get the state vector, e.g. to save it in a SimulationSnapshot.
+   *
+   * \param [out] state The state vector.
+   */
+  void GetState (double state[6]) const;
+  /**
+   * Set the state vector, e.g. to restore it from a SimulationSnapshot.
+   *
+   * \param [in] state The state vector.
+   */
+  void SetState (const double state[6]);
 
 private:
   /**
@@ -87,6 +99,33 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+RngStream::GetState (double state[6]) const
+{
+  for (int i = 0; i < 6; ++i)
+    {
+      state[i] = m_currentState[i];
+    }
+}
+
+inline void
+RngStream::SetState (const double state[6])
+{
+  for (int i = 0; i < 6; ++i)
+    {
+      m_currentState[i] = state[i];
+    }
+}
+
+} // namespace ns3
+
 #endif
  
 
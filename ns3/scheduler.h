@@ -22,7 +22,9 @@
 #define SCHEDULER_H
 
 #include <stdint.h>
+#include <vector>
 #include "object.h"
+#include "event-impl.h"
 
 /**
  * \file
@@ -34,8 +36,6 @@
 
 namespace ns3 {
 
-class EventImpl;
-
 /**
  * \ingroup core
  * \defgroup scheduler Scheduler and Events
@@ -62,6 +62,12 @@ class EventImpl;
  * calling EventId::Ref and SimpleRefCount::Unref at the right time.
  * Typically, EventId::Ref is called before Insert and SimpleRefCount::Unref is called
  * after a call to one of the Remove methods.
+ *
+ * Cancelled events can be left in the event list as tombstones
+ * instead of being removed one by one with Remove: they are then
+ * unreferenced either when they reach the head of the list, or in a
+ * single pass by RemoveCancelled. See TombstoneTracker for the
+ * bookkeeping deciding when to compact the list.
  */
 class Scheduler : public Object
 {
@@ -135,6 +141,18 @@ public:
    * \param [in] ev The event to remove
    */
   virtual void Remove (const Event &ev) = 0;
+  /**
+   * Remove all the cancelled events from the event list, and
+   * unreference them.
+   *
+   * The default implementation drains the list with RemoveNext and
+   * inserts back the live events, which costs O(n log n) for a heap;
+   * subclasses should override it with a single sweep over their
+   * storage.
+   *
+   * \returns The number of events removed.
+   */
+  virtual uint32_t RemoveCancelled (void);
 };
 
 /**
@@ -220,6 +238,30 @@ inline bool operator < (const Scheduler::Event &a,
   return a.key < b.key;
 }
 
+inline uint32_t
+Scheduler::RemoveCancelled (void)
+{
+  std::vector<Event> live;
+  uint32_t removed = 0;
+  while (!IsEmpty ())
+    {
+      Event ev = RemoveNext ();
+      if (ev.impl->IsCancelled ())
+        {
+          ev.impl->Unref ();
+          removed++;
+        }
+      else
+        {
+          live.push_back (ev);
+        }
+    }
+  for (std::vector<Event>::const_iterator i = live.begin (); i != live.end (); i++)
+    {
+      Insert (*i);
+    }
+  return removed;
+}
 
 } // namespace ns3
 
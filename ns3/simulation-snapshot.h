@@ -0,0 +1,839 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SIMULATION_SNAPSHOT_H
+#define SIMULATION_SNAPSHOT_H
+
+#include "scheduler.h"
+#include "event-impl.h"
+#include "simulator.h"
+#include "simulator-impl.h"
+#include "non-copyable.h"
+#include "object.h"
+#include "config.h"
+#include "pointer.h"
+#include "object-ptr-container.h"
+#include "random-variable-stream.h"
+#include "rng-stream.h"
+#include "rng-seed-manager.h"
+#include "fatal-error.h"
+#include "abort.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::SimulationSnapshot declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ * \brief A snapshot of a running simulation, stored in a memory-mapped
+ * binary file.
+ *
+ * A snapshot holds:
+ *  - the simulation clock and the pending events, saved by
+ *    SimulatorImpl::Checkpoint;
+ *  - the seed and run number of the RngSeedManager;
+ *  - the value of every read-write attribute of the objects reachable
+ *    from the Config root namespace (the NodeList and its nodes,
+ *    devices, channels, applications and aggregated protocols), and
+ *    the state of the RngStream of every RandomVariableStream among
+ *    them. Objects are identified by their Config path, as in the
+ *    ConfigStore, e.g. <tt>/NodeList/2/DeviceList/0/TxQueue</tt>.
+ *
+ * The file is a fixed header followed by arrays of fixed-size records
+ * and a string table, so Load() only maps it and validates the header.
+ *
+ * An event is a C++ closure (the EventImpl built by MakeEvent), not
+ * data, and the state of a model which is not visible as an attribute
+ * (e.g. the contents of a socket buffer) is not saved. The scope of a
+ * snapshot is narrowed accordingly:
+ *  - the file records the events by key only. The closures stay in a
+ *    table of the process which took the snapshot, which holds a
+ *    reference on them, and which a forked process inherits. Restore()
+ *    is a fatal error in any other process;
+ *  - Restore() is a fatal error once an event has run since the
+ *    Checkpoint(): the closures would run again on a model state
+ *    which has moved on. The snapshots which can no longer be restored
+ *    release their events at the next Checkpoint(), and all of them at
+ *    Simulator::Destroy().
+ *
+ * Restore() thus rolls back what the main program changed since the
+ * Checkpoint(): the attributes, the random number generators and the
+ * event list. The intended use is to run a long warm-up once, then to
+ * fork a branch per parameter set:
+ *
+ * \code
+ *   Simulator::Stop (Seconds (200));
+ *   Simulator::Run ();                       // warm-up
+ *   Simulator::Checkpoint ("warm-up.snap");
+ *   for (uint32_t i = 0; i < nBranches; i++)
+ *     {
+ *       if (fork () == 0)
+ *         {
+ *           Config::Set (...);               // the branch parameters
+ *           Simulator::Stop (Seconds (100));
+ *           Simulator::Run ();
+ *           Simulator::Destroy ();
+ *           exit (0);
+ *         }
+ *       wait (0);
+ *     }
+ * \endcode
+ */
+class SimulationSnapshot : private NonCopyable
+{
+public:
+  /** Constructor: an empty snapshot. */
+  SimulationSnapshot ();
+  /** Destructor: unmap the file, if any, and release the events not saved. */
+  ~SimulationSnapshot ();
+
+  /**
+   * Save the state of the current simulation to a file. Must not be
+   * called from an event run by a worker thread.
+   *
+   * \param [in] filename The file name.
+   */
+  static void Checkpoint (const std::string &filename);
+  /**
+   * Restore the state of the current simulation from a file written
+   * by Checkpoint(), in this process or in a process it was forked
+   * from, before any event has run. The pending events are replaced
+   * by the events of the snapshot.
+   *
+   * \param [in] filename The file name.
+   */
+  static void Restore (const std::string &filename);
+  /**
+   * Re-create the RngStream of every RandomVariableStream reachable
+   * from the Config root namespace, with the current seed and run
+   * number of the RngSeedManager, as if it had been created now; the
+   * stream numbers set with \c AssignStreams are kept.
+   *
+   * Used to give a new run number to a simulation whose topology, and
+   * thus whose random variables, already exist.
+   */
+  static void Reseed (void);
+
+  /**
+   * Record the simulation clock.
+   *
+   * \param [in] ts The current timestamp.
+   * \param [in] uid The next event uid.
+   * \param [in] progress A value of the SimulatorImpl which changes
+   *   whenever an event runs, e.g. the number of events run.
+   */
+  void SetClock (uint64_t ts, uint32_t uid, uint64_t progress);
+  /**
+   * Record a pending event, and keep a reference on it. A cancelled
+   * event is ignored.
+   *
+   * \param [in] ev The event.
+   */
+  void AddEvent (const Scheduler::Event &ev);
+  /**
+   * Get the recorded timestamp.
+   *
+   * \returns The timestamp.
+   */
+  uint64_t GetTimeStep (void) const;
+  /**
+   * Get the recorded next event uid.
+   *
+   * \returns The uid.
+   */
+  uint32_t GetUid (void) const;
+  /**
+   * Get the recorded progress value. SimulatorImpl::Restore must fail
+   * if it differs from the current one.
+   *
+   * \returns The progress value.
+   */
+  uint64_t GetProgress (void) const;
+  /**
+   * Get the number of recorded events.
+   *
+   * \returns The number of events.
+   */
+  uint32_t GetNEvents (void) const;
+  /**
+   * Get a recorded event. The event is no longer cancelled, and a new
+   * reference is taken for the caller, who is expected to insert it
+   * in its event list.
+   *
+   * \param [in] i The event index.
+   * \returns The event.
+   */
+  Scheduler::Event GetEvent (uint32_t i) const;
+
+  /**
+   * Write the snapshot to a file.
+   *
+   * \param [in] filename The file name.
+   */
+  void Save (const std::string &filename) const;
+  /**
+   * Map a snapshot file.
+   *
+   * \param [in] filename The file name.
+   */
+  void Load (const std::string &filename);
+
+private:
+  /** Magic number of the snapshot files. */
+  static const uint64_t kMagic = 0x50414e5333534e00ULL; // "\0NS3SNAP"
+  /** Version of the snapshot file format. */
+  static const uint32_t kVersion = 2;
+
+  /** File header. */
+  struct Header
+  {
+    uint64_t magic;         /**< kMagic. */
+    uint32_t version;       /**< kVersion. */
+    uint32_t padding;       /**< Unused. */
+    uint64_t ts;            /**< Simulation clock. */
+    uint32_t uid;           /**< Next event uid. */
+    uint32_t seed;          /**< RngSeedManager seed. */
+    uint64_t run;           /**< RngSeedManager run number. */
+    uint64_t token;         /**< Key of the events in the EventTable. */
+    uint64_t progress;      /**< SimulatorImpl progress value. */
+    uint32_t nEvents;       /**< Number of EventRecord. */
+    uint32_t nRngs;         /**< Number of RngRecord. */
+    uint32_t nAttributes;   /**< Number of AttributeRecord. */
+    uint32_t stringsSize;   /**< Size of the string table, in bytes. */
+  };
+  /** A pending event. */
+  struct EventRecord
+  {
+    uint64_t ts;            /**< Event timestamp. */
+    uint32_t uid;           /**< Event uid. */
+    uint32_t context;       /**< Event context. */
+  };
+  /** The state of the RngStream of a RandomVariableStream. */
+  struct RngRecord
+  {
+    uint32_t path;          /**< Offset of the object path in the string table. */
+    uint32_t padding;       /**< Unused. */
+    double state[6];        /**< The RngStream state. */
+  };
+  /** The value of an attribute. */
+  struct AttributeRecord
+  {
+    uint32_t path;          /**< Offset of the object path in the string table. */
+    uint32_t name;          /**< Offset of the attribute name in the string table. */
+    uint32_t value;         /**< Offset of the serialized value in the string table. */
+  };
+
+  /** The events of a snapshot taken by this process. */
+  struct EventTableEntry
+  {
+    uint64_t progress;                  /**< SimulatorImpl progress value. */
+    std::vector<EventImpl *> events;    /**< The events, each with a reference. */
+  };
+  /** The events of the snapshots taken by this process, by token. */
+  typedef std::map<uint64_t, EventTableEntry> EventTable;
+
+  /**
+   * Get the table of the events of the snapshots taken by this process,
+   * or by the process it was forked from.
+   *
+   * \returns The table.
+   */
+  static EventTable & GetEventTable (void);
+  /**
+   * Get the event which releases the EventTable at Simulator::Destroy().
+   *
+   * \returns The event.
+   */
+  static EventId & GetReleaseEvent (void);
+  /**
+   * Release the events of the snapshots which can no longer be
+   * restored, i.e. which were taken at another progress value.
+   *
+   * \param [in] progress The current progress value.
+   */
+  static void ReleaseEvents (uint64_t progress);
+  /** Release the events of all the snapshots. */
+  static void ReleaseAllEvents (void);
+  /**
+   * Release the references on a list of events.
+   *
+   * \param [in,out] events The events.
+   */
+  static void Unref (std::vector<EventImpl *> &events);
+
+  /** Direction of Walk(). */
+  enum Mode
+  {
+    SAVE,                   /**< Record the state of the objects. */
+    RESTORE,                /**< Restore the state of the objects. */
+    RESEED                  /**< Re-create the RngStreams. */
+  };
+
+  /**
+   * Add a string to the string table.
+   *
+   * \param [in] s The string.
+   * \returns The offset of \p s.
+   */
+  uint32_t AddString (const std::string &s);
+  /**
+   * Get a string of the string table.
+   *
+   * \param [in] offset The offset of the string.
+   * \returns The string.
+   */
+  const char * GetString (uint32_t offset) const;
+  /** Record the RngSeedManager and the objects of the Config root namespace. */
+  void SaveObjects (void);
+  /** Restore the RngSeedManager and the objects of the Config root namespace. */
+  void RestoreObjects (void) const;
+  /**
+   * Visit an object, its attributes, and the objects it points to, in
+   * a fixed order.
+   *
+   * \param [in] mode SAVE, RESTORE or RESEED.
+   * \param [in] object The object.
+   * \param [in] path The Config path of \p object.
+   * \param [in,out] visited The objects already visited.
+   */
+  void Walk (Mode mode, Ptr<Object> object, const std::string &path,
+             std::set<Object *> &visited);
+  /**
+   * Save or restore one attribute.
+   *
+   * \param [in] mode SAVE or RESTORE.
+   * \param [in] object The object.
+   * \param [in] path The Config path of \p object.
+   * \param [in] info The attribute.
+   */
+  void VisitAttribute (Mode mode, Ptr<Object> object, const std::string &path,
+                       const struct TypeId::AttributeInformation &info);
+
+  /** Recorded header, before Save(). */
+  Header m_header;
+  /** Recorded events, before Save(). */
+  std::vector<EventRecord> m_events;
+  /** The recorded events, each with a reference, until Checkpoint() moves them to the EventTable. */
+  std::vector<EventImpl *> m_eventImpls;
+  /** Recorded RNG states, before Save(). */
+  std::vector<RngRecord> m_rngs;
+  /** Recorded attributes, before Save(). */
+  std::vector<AttributeRecord> m_attributes;
+  /** Recorded string table, before Save(). */
+  std::string m_strings;
+  /** Offsets of the strings already in m_strings. */
+  std::map<std::string, uint32_t> m_stringOffsets;
+
+  /** The mapped file, after Load(). */
+  void *m_map;
+  /** The size of the mapped file. */
+  std::size_t m_mapSize;
+  /** The header in the mapped file. */
+  const Header *m_mapHeader;
+  /** The events in the mapped file. */
+  const EventRecord *m_mapEvents;
+  /** The RNG states in the mapped file. */
+  const RngRecord *m_mapRngs;
+  /** The attributes in the mapped file. */
+  const AttributeRecord *m_mapAttributes;
+  /** The string table in the mapped file. */
+  const char *m_mapStrings;
+  /** The events of the mapped file, in the EventTable. */
+  const std::vector<EventImpl *> *m_mapEventImpls;
+  /** RNG states by object path, while restoring. */
+  std::map<std::string, const RngRecord *> m_restoreRngs;
+  /** Attribute values by object path and name, while restoring. */
+  std::map<std::pair<std::string, std::string>, const char *> m_restoreAttributes;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+SimulationSnapshot::SimulationSnapshot ()
+  : m_map (0),
+    m_mapSize (0),
+    m_mapHeader (0),
+    m_mapEvents (0),
+    m_mapRngs (0),
+    m_mapAttributes (0),
+    m_mapStrings (0),
+    m_mapEventImpls (0)
+{
+  std::memset (&m_header, 0, sizeof (m_header));
+  m_header.magic = kMagic;
+  m_header.version = kVersion;
+}
+
+inline
+SimulationSnapshot::~SimulationSnapshot ()
+{
+  if (m_map != 0)
+    {
+      munmap (m_map, m_mapSize);
+    }
+  Unref (m_eventImpls);
+}
+
+inline SimulationSnapshot::EventTable &
+SimulationSnapshot::GetEventTable (void)
+{
+  static EventTable table;
+  return table;
+}
+
+inline EventId &
+SimulationSnapshot::GetReleaseEvent (void)
+{
+  static EventId release;
+  return release;
+}
+
+inline void
+SimulationSnapshot::Unref (std::vector<EventImpl *> &events)
+{
+  for (uint32_t i = 0; i < events.size (); i++)
+    {
+      events[i]->Unref ();
+    }
+  events.clear ();
+}
+
+inline void
+SimulationSnapshot::ReleaseEvents (uint64_t progress)
+{
+  EventTable &table = GetEventTable ();
+  EventTable::iterator i = table.begin ();
+  while (i != table.end ())
+    {
+      if (i->second.progress != progress)
+        {
+          Unref (i->second.events);
+          table.erase (i++);
+        }
+      else
+        {
+          i++;
+        }
+    }
+}
+
+inline void
+SimulationSnapshot::ReleaseAllEvents (void)
+{
+  EventTable &table = GetEventTable ();
+  for (EventTable::iterator i = table.begin (); i != table.end (); i++)
+    {
+      Unref (i->second.events);
+    }
+  table.clear ();
+}
+
+inline void
+SimulationSnapshot::Checkpoint (const std::string &filename)
+{
+  // Unique within this process and the processes forked from it.
+  static uint32_t count = 0;
+  SimulationSnapshot snapshot;
+  Simulator::GetImplementation ()->Checkpoint (snapshot);
+  snapshot.m_header.token = (static_cast<uint64_t> (getpid ()) << 32) | count++;
+  snapshot.SaveObjects ();
+  snapshot.Save (filename);
+
+  ReleaseEvents (snapshot.m_header.progress);
+  EventTableEntry &entry = GetEventTable ()[snapshot.m_header.token];
+  entry.progress = snapshot.m_header.progress;
+  entry.events.swap (snapshot.m_eventImpls);
+  if (GetReleaseEvent ().IsExpired ())
+    {
+      GetReleaseEvent () = Simulator::ScheduleDestroy (&SimulationSnapshot::ReleaseAllEvents);
+    }
+}
+
+inline void
+SimulationSnapshot::Restore (const std::string &filename)
+{
+  SimulationSnapshot snapshot;
+  snapshot.Load (filename);
+  EventTable::const_iterator i = GetEventTable ().find (snapshot.m_mapHeader->token);
+  NS_ABORT_MSG_IF (i == GetEventTable ().end (),
+                   "SimulationSnapshot: the events of " << filename << " are not in this process:"
+                   " it was written by another process, or events have run since");
+  NS_ABORT_MSG_IF (i->second.events.size () != snapshot.m_mapHeader->nEvents,
+                   "SimulationSnapshot: " << filename << " does not match its events");
+  snapshot.m_mapEventImpls = &i->second.events;
+  // Fails if an event has run since the checkpoint, before any change.
+  Simulator::GetImplementation ()->Restore (snapshot);
+  snapshot.RestoreObjects ();
+}
+
+inline void
+SimulationSnapshot::Reseed (void)
+{
+  SimulationSnapshot snapshot;
+  std::set<Object *> visited;
+  for (std::size_t i = 0; i < Config::GetRootNamespaceObjectN (); i++)
+    {
+      snapshot.Walk (RESEED, Config::GetRootNamespaceObject (i), "", visited);
+    }
+}
+
+inline void
+SimulationSnapshot::SetClock (uint64_t ts, uint32_t uid, uint64_t progress)
+{
+  m_header.ts = ts;
+  m_header.uid = uid;
+  m_header.progress = progress;
+}
+
+inline void
+SimulationSnapshot::AddEvent (const Scheduler::Event &ev)
+{
+  if (ev.impl->IsCancelled ())
+    {
+      return;
+    }
+  EventRecord record;
+  record.ts = ev.key.m_ts;
+  record.uid = ev.key.m_uid;
+  record.context = ev.key.m_context;
+  m_events.push_back (record);
+  // Keep the event alive if it is cancelled and removed, for Restore().
+  ev.impl->Ref ();
+  m_eventImpls.push_back (ev.impl);
+}
+
+inline uint64_t
+SimulationSnapshot::GetTimeStep (void) const
+{
+  return m_mapHeader != 0 ? m_mapHeader->ts : m_header.ts;
+}
+
+inline uint32_t
+SimulationSnapshot::GetUid (void) const
+{
+  return m_mapHeader != 0 ? m_mapHeader->uid : m_header.uid;
+}
+
+inline uint64_t
+SimulationSnapshot::GetProgress (void) const
+{
+  return m_mapHeader != 0 ? m_mapHeader->progress : m_header.progress;
+}
+
+inline uint32_t
+SimulationSnapshot::GetNEvents (void) const
+{
+  return m_mapHeader != 0 ? m_mapHeader->nEvents : m_events.size ();
+}
+
+inline Scheduler::Event
+SimulationSnapshot::GetEvent (uint32_t i) const
+{
+  NS_ASSERT (i < GetNEvents ());
+  NS_ASSERT (m_mapHeader == 0 || m_mapEventImpls != 0);
+  const EventRecord &record = m_mapHeader != 0 ? m_mapEvents[i] : m_events[i];
+  Scheduler::Event ev;
+  ev.impl = m_mapHeader != 0 ? (*m_mapEventImpls)[i] : m_eventImpls[i];
+  ev.key.m_ts = record.ts;
+  ev.key.m_uid = record.uid;
+  ev.key.m_context = record.context;
+  ev.impl->Uncancel ();
+  ev.impl->Ref ();
+  return ev;
+}
+
+inline uint32_t
+SimulationSnapshot::AddString (const std::string &s)
+{
+  std::map<std::string, uint32_t>::const_iterator i = m_stringOffsets.find (s);
+  if (i != m_stringOffsets.end ())
+    {
+      return i->second;
+    }
+  uint32_t offset = m_strings.size ();
+  m_strings.append (s.c_str (), s.size () + 1);
+  m_stringOffsets[s] = offset;
+  return offset;
+}
+
+inline const char *
+SimulationSnapshot::GetString (uint32_t offset) const
+{
+  NS_ABORT_MSG_IF (offset >= m_mapHeader->stringsSize, "SimulationSnapshot: corrupted string table");
+  return m_mapStrings + offset;
+}
+
+inline void
+SimulationSnapshot::Save (const std::string &filename) const
+{
+  Header header = m_header;
+  header.nEvents = m_events.size ();
+  header.nRngs = m_rngs.size ();
+  header.nAttributes = m_attributes.size ();
+  header.stringsSize = m_strings.size ();
+  std::string tmp = filename + ".tmp";
+  FILE *f = std::fopen (tmp.c_str (), "wb");
+  NS_ABORT_MSG_IF (f == 0, "SimulationSnapshot: cannot create " << tmp);
+  bool ok = std::fwrite (&header, sizeof (header), 1, f) == 1;
+  ok = ok && (m_events.empty ()
+              || std::fwrite (&m_events[0], sizeof (EventRecord), m_events.size (), f) == m_events.size ());
+  ok = ok && (m_rngs.empty ()
+              || std::fwrite (&m_rngs[0], sizeof (RngRecord), m_rngs.size (), f) == m_rngs.size ());
+  ok = ok && (m_attributes.empty ()
+              || std::fwrite (&m_attributes[0], sizeof (AttributeRecord), m_attributes.size (), f) == m_attributes.size ());
+  ok = ok && std::fwrite (m_strings.data (), 1, m_strings.size (), f) == m_strings.size ();
+  ok = (std::fclose (f) == 0) && ok;
+  NS_ABORT_MSG_IF (!ok, "SimulationSnapshot: cannot write " << tmp);
+  // Readers never see a partial file.
+  NS_ABORT_MSG_IF (std::rename (tmp.c_str (), filename.c_str ()) != 0,
+                   "SimulationSnapshot: cannot rename " << tmp << " to " << filename);
+}
+
+inline void
+SimulationSnapshot::Load (const std::string &filename)
+{
+  NS_ASSERT (m_map == 0);
+  int fd = open (filename.c_str (), O_RDONLY);
+  NS_ABORT_MSG_IF (fd < 0, "SimulationSnapshot: cannot open " << filename);
+  struct stat st;
+  NS_ABORT_MSG_IF (fstat (fd, &st) != 0, "SimulationSnapshot: cannot stat " << filename);
+  m_mapSize = st.st_size;
+  NS_ABORT_MSG_IF (m_mapSize < sizeof (Header), "SimulationSnapshot: " << filename << " is truncated");
+  m_map = mmap (0, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  NS_ABORT_MSG_IF (m_map == MAP_FAILED, "SimulationSnapshot: cannot map " << filename);
+
+  const char *start = static_cast<const char *> (m_map);
+  m_mapHeader = reinterpret_cast<const Header *> (start);
+  NS_ABORT_MSG_IF (m_mapHeader->magic != kMagic, "SimulationSnapshot: " << filename << " is not a snapshot");
+  NS_ABORT_MSG_IF (m_mapHeader->version != kVersion,
+                   "SimulationSnapshot: " << filename << " has version " << m_mapHeader->version
+                                          << ", expected " << kVersion);
+  std::size_t size = sizeof (Header)
+    + m_mapHeader->nEvents * sizeof (EventRecord)
+    + m_mapHeader->nRngs * sizeof (RngRecord)
+    + m_mapHeader->nAttributes * sizeof (AttributeRecord)
+    + m_mapHeader->stringsSize;
+  NS_ABORT_MSG_IF (size != m_mapSize, "SimulationSnapshot: " << filename << " has a wrong size");
+  // All the records are 8-byte aligned, as the mapping itself.
+  m_mapEvents = reinterpret_cast<const EventRecord *> (start + sizeof (Header));
+  m_mapRngs = reinterpret_cast<const RngRecord *> (m_mapEvents + m_mapHeader->nEvents);
+  m_mapAttributes = reinterpret_cast<const AttributeRecord *> (m_mapRngs + m_mapHeader->nRngs);
+  m_mapStrings = reinterpret_cast<const char *> (m_mapAttributes + m_mapHeader->nAttributes);
+}
+
+inline void
+SimulationSnapshot::SaveObjects (void)
+{
+  m_header.seed = RngSeedManager::GetSeed ();
+  m_header.run = RngSeedManager::GetRun ();
+  std::set<Object *> visited;
+  for (std::size_t i = 0; i < Config::GetRootNamespaceObjectN (); i++)
+    {
+      Walk (SAVE, Config::GetRootNamespaceObject (i), "", visited);
+    }
+}
+
+inline void
+SimulationSnapshot::RestoreObjects (void) const
+{
+  SimulationSnapshot *self = const_cast<SimulationSnapshot *> (this);
+  RngSeedManager::SetSeed (m_mapHeader->seed);
+  RngSeedManager::SetRun (m_mapHeader->run);
+  for (uint32_t i = 0; i < m_mapHeader->nRngs; i++)
+    {
+      self->m_restoreRngs[GetString (m_mapRngs[i].path)] = &m_mapRngs[i];
+    }
+  for (uint32_t i = 0; i < m_mapHeader->nAttributes; i++)
+    {
+      const AttributeRecord &record = m_mapAttributes[i];
+      self->m_restoreAttributes[std::make_pair (std::string (GetString (record.path)),
+                                                std::string (GetString (record.name)))]
+        = GetString (record.value);
+    }
+  std::set<Object *> visited;
+  for (std::size_t i = 0; i < Config::GetRootNamespaceObjectN (); i++)
+    {
+      self->Walk (RESTORE, Config::GetRootNamespaceObject (i), "", visited);
+    }
+  self->m_restoreRngs.clear ();
+  self->m_restoreAttributes.clear ();
+}
+
+inline void
+SimulationSnapshot::VisitAttribute (Mode mode, Ptr<Object> object, const std::string &path,
+                                    const struct TypeId::AttributeInformation &info)
+{
+  if (!(info.flags & TypeId::ATTR_GET) || !(info.flags & TypeId::ATTR_SET)
+      || !info.accessor->HasGetter () || !info.accessor->HasSetter ())
+    {
+      return;
+    }
+  Ptr<AttributeValue> value = info.checker->Create ();
+  if (!info.accessor->Get (PeekPointer (object), *value))
+    {
+      return;
+    }
+  std::string current = value->SerializeToString (info.checker);
+  if (mode == SAVE)
+    {
+      AttributeRecord record;
+      record.path = AddString (path);
+      record.name = AddString (info.name);
+      record.value = AddString (current);
+      m_attributes.push_back (record);
+      return;
+    }
+  std::map<std::pair<std::string, std::string>, const char *>::const_iterator i =
+    m_restoreAttributes.find (std::make_pair (path, info.name));
+  // Setters may have side effects: only call those which change the value.
+  if (i != m_restoreAttributes.end () && current != i->second
+      && value->DeserializeFromString (i->second, info.checker))
+    {
+      info.accessor->Set (PeekPointer (object), *value);
+    }
+}
+
+inline void
+SimulationSnapshot::Walk (Mode mode, Ptr<Object> object, const std::string &path,
+                          std::set<Object *> &visited)
+{
+  if (object == 0 || !visited.insert (PeekPointer (object)).second)
+    {
+      return;
+    }
+  std::vector<std::pair<std::string, Ptr<Object> > > children;
+  for (TypeId tid = object->GetInstanceTypeId (); ; tid = tid.GetParent ())
+    {
+      for (uint32_t i = 0; i < tid.GetAttributeN (); i++)
+        {
+          struct TypeId::AttributeInformation info = tid.GetAttribute (i);
+          const PointerChecker *pointer = dynamic_cast<const PointerChecker *> (PeekPointer (info.checker));
+          const ObjectPtrContainerChecker *container =
+            dynamic_cast<const ObjectPtrContainerChecker *> (PeekPointer (info.checker));
+          if (pointer != 0)
+            {
+              PointerValue value;
+              if ((info.flags & TypeId::ATTR_GET) && info.accessor->Get (PeekPointer (object), value))
+                {
+                  children.push_back (std::make_pair (path + "/" + info.name, value.GetObject ()));
+                }
+            }
+          else if (container != 0)
+            {
+              ObjectPtrContainerValue value;
+              if ((info.flags & TypeId::ATTR_GET) && info.accessor->Get (PeekPointer (object), value))
+                {
+                  for (ObjectPtrContainerValue::Iterator j = value.Begin (); j != value.End (); j++)
+                    {
+                      std::ostringstream oss;
+                      oss << path << "/" << info.name << "/" << j->first;
+                      children.push_back (std::make_pair (oss.str (), j->second));
+                    }
+                }
+            }
+          else if (mode != RESEED)
+            {
+              VisitAttribute (mode, object, path, info);
+            }
+        }
+      if (tid == tid.GetParent ())
+        {
+          break;
+        }
+    }
+
+  Ptr<RandomVariableStream> stream = DynamicCast<RandomVariableStream> (object);
+  if (stream != 0)
+    {
+      // After the attributes: setting "Stream" replaces the RngStream.
+      if (mode == SAVE)
+        {
+          RngRecord record;
+          record.path = AddString (path);
+          record.padding = 0;
+          stream->Peek ()->GetState (record.state);
+          m_rngs.push_back (record);
+        }
+      else if (mode == RESEED)
+        {
+          // -1 draws a new stream number, as at construction.
+          stream->SetStream (stream->GetStream ());
+        }
+      else
+        {
+          std::map<std::string, const RngRecord *>::const_iterator i = m_restoreRngs.find (path);
+          if (i != m_restoreRngs.end ())
+            {
+              stream->Peek ()->SetState (i->second->state);
+            }
+        }
+    }
+
+  Object::AggregateIterator aggregates = object->GetAggregateIterator ();
+  while (aggregates.HasNext ())
+    {
+      Ptr<Object> other = ConstCast<Object> (aggregates.Next ());
+      if (other != object)
+        {
+          children.push_back (std::make_pair (path + "/$" + other->GetInstanceTypeId ().GetName (), other));
+        }
+    }
+  for (uint32_t i = 0; i < children.size (); i++)
+    {
+      Walk (mode, children[i].second, children[i].first, visited);
+    }
+}
+
+inline void
+Simulator::Checkpoint (const std::string &filename)
+{
+  SimulationSnapshot::Checkpoint (filename);
+}
+
+inline void
+Simulator::Restore (const std::string &filename)
+{
+  SimulationSnapshot::Restore (filename);
+}
+
+} // namespace ns3
+
+#endif /* SIMULATION_SNAPSHOT_H */
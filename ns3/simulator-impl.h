@@ -27,6 +27,7 @@
 #include "object.h"
 #include "object-factory.h"
 #include "ptr.h"
+#include "fatal-error.h"
 
 /**
  * \file
@@ -37,6 +38,7 @@
 namespace ns3 {
 
 class Scheduler;
+class SimulationSnapshot;
 
 /**
  * \ingroup simulator
@@ -99,8 +101,47 @@ public:
   virtual uint32_t GetSystemId () const = 0; 
   /** \copydoc Simulator::GetContext */
   virtual uint32_t GetContext (void) const = 0;
+  /**
+   * Record the clock and the pending events in a snapshot.
+   *
+   * The default implementation is a fatal error.
+   *
+   * \param [in,out] snapshot The snapshot.
+   */
+  virtual void Checkpoint (SimulationSnapshot &snapshot);
+  /**
+   * Replace the clock and the pending events by those of a snapshot.
+   *
+   * The default implementation is a fatal error.
+   *
+   * \param [in] snapshot The snapshot.
+   */
+  virtual void Restore (const SimulationSnapshot &snapshot);
 };
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+SimulatorImpl::Checkpoint (SimulationSnapshot &snapshot)
+{
+  NS_UNUSED (snapshot);
+  NS_FATAL_ERROR (GetInstanceTypeId ().GetName () << " does not support snapshots");
+}
+
+inline void
+SimulatorImpl::Restore (const SimulationSnapshot &snapshot)
+{
+  NS_UNUSED (snapshot);
+  NS_FATAL_ERROR (GetInstanceTypeId ().GetName () << " does not support snapshots");
+}
+
+} // namespace ns3
+
 #endif /* SIMULATOR_IMPL_H */
@@ -166,6 +166,24 @@ public:
    */
   static void Stop (const Time &delay);
 
+  /**
+   * Save the state of the simulation to a memory-mapped snapshot file,
+   * with SimulationSnapshot::Checkpoint.
+   *
+   * @param [in] filename The snapshot file.
+   */
+  static void Checkpoint (const std::string &filename);
+
+  /**
+   * Roll the simulation back to a snapshot file written by
+   * Checkpoint(), in the same process or in a process forked from it,
+   * with SimulationSnapshot::Restore. No event may have run since the
+   * Checkpoint().
+   *
+   * @param [in] filename The snapshot file.
+   */
+  static void Restore (const std::string &filename);
+
   /**
    * Get the current simulation context.
    *
@@ -1780,4 +1798,8 @@ Simulator::ScheduleDestroy (void (*f)(U1,U2,U3,U4,U5,U6), T1 a1, T2 a2, T3 a3, T
 
 } // namespace ns3
 
+// Simulator::Checkpoint and Simulator::Restore are defined with
+// SimulationSnapshot.
+#include "simulation-snapshot.h"
+
 #endif /* SIMULATOR_H */
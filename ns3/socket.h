@@ -30,6 +30,7 @@
 #include "ns3/net-device.h"
 #include "address.h"
 #include <stdint.h>
+#include <vector>
 #include "ns3/inet-socket-address.h"
 #include "ns3/inet6-socket-address.h"
 
@@ -388,6 +389,22 @@ public:
   virtual int SendTo (Ptr<Packet> p, uint32_t flags, 
                       const Address &toAddress) = 0;
 
+  /**
+   * \brief Send several packets to the remote host in one call.
+   *
+   * Equivalent to calling Send (p, flags) for each packet in turn,
+   * stopping at the first failure, as sendmmsg() does. Subclasses
+   * override it to share the per-call work (state checks, route lookup,
+   * header construction, transmission scheduling) across the batch;
+   * the default implementation just loops on Send().
+   *
+   * \param packets the packets to send, in order
+   * \param flags Socket control flags
+   * \returns the number of packets accepted for transmission, or -1 if
+   *          the first one is refused, in which case GetErrno() tells why.
+   */
+  virtual int SendBatch (const std::vector<Ptr<Packet> > &packets, uint32_t flags);
+
   /**
    * Return number of bytes which can be returned from one or 
    * multiple calls to Recv.
@@ -489,6 +506,17 @@ public:
    */
   int Send (Ptr<Packet> p);
 
+  /**
+   * \brief Send several packets to the remote host in one call.
+   *
+   * Overloaded version of SendBatch(..., flags) with flags set to zero.
+   *
+   * \param packets the packets to send, in order
+   * \returns the number of packets accepted for transmission, or -1 if
+   *          the first one is refused.
+   */
+  int SendBatch (const std::vector<Ptr<Packet> > &packets);
+
   /**
    * \brief Send data (or dummy data) to the remote host
    * 
@@ -1396,4 +1424,36 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+inline int
+Socket::SendBatch (const std::vector<Ptr<Packet> > &packets, uint32_t flags)
+{
+  int sent = 0;
+  for (std::vector<Ptr<Packet> >::const_iterator i = packets.begin (); i != packets.end (); ++i)
+    {
+      if (Send (*i, flags) < 0)
+        {
+          return sent > 0 ? sent : -1;
+        }
+      sent++;
+    }
+  return sent;
+}
+
+inline int
+Socket::SendBatch (const std::vector<Ptr<Packet> > &packets)
+{
+  return SendBatch (packets, 0);
+}
+
+} // namespace ns3
+
 #endif /* NS3_SOCKET_H */
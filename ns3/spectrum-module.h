@@ -32,6 +32,8 @@
 #include "spectrum-propagation-loss-model.h"
 #include "spectrum-signal-parameters.h"
 #include "spectrum-test.h"
+#include "spectrum-value-kernels.h"
+#include "spectrum-value-pool.h"
 #include "spectrum-value.h"
 #include "tv-spectrum-transmitter-helper.h"
 #include "tv-spectrum-transmitter.h"
@@ -0,0 +1,835 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SPECTRUM_VALUE_KERNELS_H
+#define SPECTRUM_VALUE_KERNELS_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define NS3_SPECTRUM_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * \file
+ * \ingroup spectrum
+ * ns3::SpectrumValueKernels declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup spectrum
+ *
+ * \brief Vectorized arithmetic on the values of a SpectrumValue.
+ *
+ * The SpectrumValue operators are evaluated for every signal in
+ * SpectrumInterference, LteInterference and MultiModelSpectrumChannel,
+ * so they are among the hottest loops of spectrum simulations. These
+ * kernels operate on arrays of doubles and come in three flavours:
+ * scalar, AVX2 (with FMA) and AVX-512. The best one supported by the
+ * CPU is selected at run time, once, so a single binary runs
+ * everywhere.
+ *
+ * The vector kernels reorder the additions of Sum and SumOfProducts,
+ * so their results may differ from the scalar ones in the last bits.
+ * For bit-wise reproducible runs across machines, force the scalar
+ * kernels with SetIsa() or with the environment variable
+ * \c NS_SPECTRUM_KERNELS, set to \c scalar, \c avx2 or \c avx512. A
+ * flavour not supported by the CPU falls back to the best supported one.
+ */
+class SpectrumValueKernels
+{
+public:
+  /** Instruction set of the kernels. */
+  enum Isa
+  {
+    SCALAR = 0, //!< Portable C++ loops.
+    AVX2,       //!< 256-bit AVX2 and FMA.
+    AVX512      //!< 512-bit AVX-512F.
+  };
+
+  /**
+   * Get the instruction set of the kernels in use.
+   *
+   * \returns The instruction set.
+   */
+  static Isa GetIsa (void);
+  /**
+   * Select the instruction set of the kernels. Not thread safe: call it
+   * before running the simulation.
+   *
+   * \param [in] isa The instruction set; the best supported one is used
+   * if the CPU does not support it.
+   * \returns The instruction set actually selected.
+   */
+  static Isa SetIsa (Isa isa);
+  /**
+   * Check if the CPU supports an instruction set.
+   *
+   * \param [in] isa The instruction set.
+   * \returns \c true if the kernels can use it.
+   */
+  static bool IsSupported (Isa isa);
+  /**
+   * Get the name of an instruction set.
+   *
+   * \param [in] isa The instruction set.
+   * \returns Its name.
+   */
+  static const char * GetName (Isa isa);
+
+  /**
+   * \f$ y_i \leftarrow y_i + x_i \f$
+   * \param [in,out] y The destination.
+   * \param [in] x The operand.
+   * \param [in] n The number of values.
+   */
+  static void Add (double *y, const double *x, std::size_t n);
+  /**
+   * \f$ y_i \leftarrow y_i - x_i \f$
+   * \param [in,out] y The destination.
+   * \param [in] x The operand.
+   * \param [in] n The number of values.
+   */
+  static void Subtract (double *y, const double *x, std::size_t n);
+  /**
+   * \f$ y_i \leftarrow y_i x_i \f$
+   * \param [in,out] y The destination.
+   * \param [in] x The operand.
+   * \param [in] n The number of values.
+   */
+  static void Multiply (double *y, const double *x, std::size_t n);
+  /**
+   * \f$ y_i \leftarrow y_i / x_i \f$
+   * \param [in,out] y The destination.
+   * \param [in] x The operand.
+   * \param [in] n The number of values.
+   */
+  static void Divide (double *y, const double *x, std::size_t n);
+  /**
+   * \f$ y_i \leftarrow y_i + s \f$
+   * \param [in,out] y The destination.
+   * \param [in] s The scalar.
+   * \param [in] n The number of values.
+   */
+  static void AddScalar (double *y, double s, std::size_t n);
+  /**
+   * \f$ y_i \leftarrow s y_i \f$
+   * \param [in,out] y The destination.
+   * \param [in] s The scalar.
+   * \param [in] n The number of values.
+   */
+  static void MultiplyScalar (double *y, double s, std::size_t n);
+  /**
+   * \f$ y_i \leftarrow y_i + s x_i \f$, fused.
+   * \param [in,out] y The destination.
+   * \param [in] x The operand.
+   * \param [in] s The scale of the operand.
+   * \param [in] n The number of values.
+   */
+  static void AddScaled (double *y, const double *x, double s, std::size_t n);
+  /**
+   * \param [in] x The operand.
+   * \param [in] n The number of values.
+   * \returns \f$ \sum_i x_i \f$
+   */
+  static double Sum (const double *x, std::size_t n);
+  /**
+   * \param [in] x The first operand.
+   * \param [in] y The second operand.
+   * \param [in] n The number of values.
+   * \returns \f$ \sum_i x_i y_i \f$, without the temporary of the Schur product.
+   */
+  static double SumOfProducts (const double *x, const double *y, std::size_t n);
+
+private:
+  /** The kernels of one instruction set. */
+  struct Table
+  {
+    Isa isa; //!< The instruction set.
+    void (*add)(double *, const double *, std::size_t);              //!< Add
+    void (*subtract)(double *, const double *, std::size_t);         //!< Subtract
+    void (*multiply)(double *, const double *, std::size_t);         //!< Multiply
+    void (*divide)(double *, const double *, std::size_t);           //!< Divide
+    void (*addScalar)(double *, double, std::size_t);                //!< AddScalar
+    void (*multiplyScalar)(double *, double, std::size_t);           //!< MultiplyScalar
+    void (*addScaled)(double *, const double *, double, std::size_t); //!< AddScaled
+    double (*sum)(const double *, std::size_t);                      //!< Sum
+    double (*sumOfProducts)(const double *, const double *, std::size_t); //!< SumOfProducts
+  };
+
+  /**
+   * Get the kernels in use, selected by MakeTable() the first time.
+   * The initialization of the function-local static is thread safe.
+   * \returns The kernels.
+   */
+  static Table & GetTable (void);
+  /**
+   * Build the table of the kernels selected from \c NS_SPECTRUM_KERNELS
+   * and the CPU features.
+   * \returns The kernels.
+   */
+  static Table MakeTable (void);
+  /**
+   * Fill a kernel table.
+   * \param [in] isa The instruction set, which must be supported.
+   * \param [out] table The table.
+   */
+  static void Fill (Isa isa, Table &table);
+  /**
+   * Get the best supported instruction set, no better than \p isa.
+   * \param [in] isa The instruction set.
+   * \returns The instruction set.
+   */
+  static Isa Clamp (Isa isa);
+
+  /** \name Scalar kernels */
+  //@{
+  static void ScalarAdd (double *y, const double *x, std::size_t n);
+  static void ScalarSubtract (double *y, const double *x, std::size_t n);
+  static void ScalarMultiply (double *y, const double *x, std::size_t n);
+  static void ScalarDivide (double *y, const double *x, std::size_t n);
+  static void ScalarAddScalar (double *y, double s, std::size_t n);
+  static void ScalarMultiplyScalar (double *y, double s, std::size_t n);
+  static void ScalarAddScaled (double *y, const double *x, double s, std::size_t n);
+  static double ScalarSum (const double *x, std::size_t n);
+  static double ScalarSumOfProducts (const double *x, const double *y, std::size_t n);
+  //@}
+
+#ifdef NS3_SPECTRUM_KERNELS_X86
+  /** \name AVX2 kernels */
+  //@{
+  __attribute__ ((target ("avx2,fma"))) static void Avx2Add (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static void Avx2Subtract (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static void Avx2Multiply (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static void Avx2Divide (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static void Avx2AddScalar (double *y, double s, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static void Avx2MultiplyScalar (double *y, double s, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static void Avx2AddScaled (double *y, const double *x, double s, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static double Avx2Sum (const double *x, std::size_t n);
+  __attribute__ ((target ("avx2,fma"))) static double Avx2SumOfProducts (const double *x, const double *y, std::size_t n);
+  //@}
+
+  /** \name AVX-512 kernels */
+  //@{
+  __attribute__ ((target ("avx512f"))) static void Avx512Add (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static void Avx512Subtract (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static void Avx512Multiply (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static void Avx512Divide (double *y, const double *x, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static void Avx512AddScalar (double *y, double s, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static void Avx512MultiplyScalar (double *y, double s, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static void Avx512AddScaled (double *y, const double *x, double s, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static double Avx512Sum (const double *x, std::size_t n);
+  __attribute__ ((target ("avx512f"))) static double Avx512SumOfProducts (const double *x, const double *y, std::size_t n);
+  //@}
+  /**
+   * Add the lanes of a vector.
+   * \param [in] v The vector.
+   * \returns The sum of its lanes.
+   */
+  __attribute__ ((target ("avx512f"))) static double Avx512Reduce (__m512d v);
+#endif /* NS3_SPECTRUM_KERNELS_X86 */
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline bool
+SpectrumValueKernels::IsSupported (Isa isa)
+{
+  switch (isa)
+    {
+    case SCALAR:
+      return true;
+#ifdef NS3_SPECTRUM_KERNELS_X86
+    case AVX2:
+      return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+    case AVX512:
+      return __builtin_cpu_supports ("avx512f");
+#endif
+    default:
+      return false;
+    }
+}
+
+inline const char *
+SpectrumValueKernels::GetName (Isa isa)
+{
+  switch (isa)
+    {
+    case AVX2:
+      return "avx2";
+    case AVX512:
+      return "avx512";
+    default:
+      return "scalar";
+    }
+}
+
+inline SpectrumValueKernels::Isa
+SpectrumValueKernels::Clamp (Isa isa)
+{
+  while (isa != SCALAR && !IsSupported (isa))
+    {
+      isa = static_cast<Isa> (isa - 1);
+    }
+  return isa;
+}
+
+inline void
+SpectrumValueKernels::Fill (Isa isa, Table &table)
+{
+  table.isa = isa;
+  switch (isa)
+    {
+#ifdef NS3_SPECTRUM_KERNELS_X86
+    case AVX512:
+      table.add = &Avx512Add;
+      table.subtract = &Avx512Subtract;
+      table.multiply = &Avx512Multiply;
+      table.divide = &Avx512Divide;
+      table.addScalar = &Avx512AddScalar;
+      table.multiplyScalar = &Avx512MultiplyScalar;
+      table.addScaled = &Avx512AddScaled;
+      table.sum = &Avx512Sum;
+      table.sumOfProducts = &Avx512SumOfProducts;
+      break;
+    case AVX2:
+      table.add = &Avx2Add;
+      table.subtract = &Avx2Subtract;
+      table.multiply = &Avx2Multiply;
+      table.divide = &Avx2Divide;
+      table.addScalar = &Avx2AddScalar;
+      table.multiplyScalar = &Avx2MultiplyScalar;
+      table.addScaled = &Avx2AddScaled;
+      table.sum = &Avx2Sum;
+      table.sumOfProducts = &Avx2SumOfProducts;
+      break;
+#endif
+    default:
+      table.isa = SCALAR;
+      table.add = &ScalarAdd;
+      table.subtract = &ScalarSubtract;
+      table.multiply = &ScalarMultiply;
+      table.divide = &ScalarDivide;
+      table.addScalar = &ScalarAddScalar;
+      table.multiplyScalar = &ScalarMultiplyScalar;
+      table.addScaled = &ScalarAddScaled;
+      table.sum = &ScalarSum;
+      table.sumOfProducts = &ScalarSumOfProducts;
+      break;
+    }
+}
+
+inline SpectrumValueKernels::Table
+SpectrumValueKernels::MakeTable (void)
+{
+  Isa isa = AVX512;
+  const char *env = std::getenv ("NS_SPECTRUM_KERNELS");
+  if (env != 0)
+    {
+      if (std::strcmp (env, "scalar") == 0)
+        {
+          isa = SCALAR;
+        }
+      else if (std::strcmp (env, "avx2") == 0)
+        {
+          isa = AVX2;
+        }
+    }
+  Table table;
+  Fill (Clamp (isa), table);
+  return table;
+}
+
+inline SpectrumValueKernels::Table &
+SpectrumValueKernels::GetTable (void)
+{
+  static Table table = MakeTable ();
+  return table;
+}
+
+inline SpectrumValueKernels::Isa
+SpectrumValueKernels::GetIsa (void)
+{
+  return GetTable ().isa;
+}
+
+inline SpectrumValueKernels::Isa
+SpectrumValueKernels::SetIsa (Isa isa)
+{
+  Fill (Clamp (isa), GetTable ());
+  return GetTable ().isa;
+}
+
+inline void
+SpectrumValueKernels::Add (double *y, const double *x, std::size_t n)
+{
+  GetTable ().add (y, x, n);
+}
+
+inline void
+SpectrumValueKernels::Subtract (double *y, const double *x, std::size_t n)
+{
+  GetTable ().subtract (y, x, n);
+}
+
+inline void
+SpectrumValueKernels::Multiply (double *y, const double *x, std::size_t n)
+{
+  GetTable ().multiply (y, x, n);
+}
+
+inline void
+SpectrumValueKernels::Divide (double *y, const double *x, std::size_t n)
+{
+  GetTable ().divide (y, x, n);
+}
+
+inline void
+SpectrumValueKernels::AddScalar (double *y, double s, std::size_t n)
+{
+  GetTable ().addScalar (y, s, n);
+}
+
+inline void
+SpectrumValueKernels::MultiplyScalar (double *y, double s, std::size_t n)
+{
+  GetTable ().multiplyScalar (y, s, n);
+}
+
+inline void
+SpectrumValueKernels::AddScaled (double *y, const double *x, double s, std::size_t n)
+{
+  GetTable ().addScaled (y, x, s, n);
+}
+
+inline double
+SpectrumValueKernels::Sum (const double *x, std::size_t n)
+{
+  return GetTable ().sum (x, n);
+}
+
+inline double
+SpectrumValueKernels::SumOfProducts (const double *x, const double *y, std::size_t n)
+{
+  return GetTable ().sumOfProducts (x, y, n);
+}
+
+/*
+ * Scalar kernels.
+ */
+
+inline void
+SpectrumValueKernels::ScalarAdd (double *y, const double *x, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] += x[i];
+    }
+}
+
+inline void
+SpectrumValueKernels::ScalarSubtract (double *y, const double *x, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] -= x[i];
+    }
+}
+
+inline void
+SpectrumValueKernels::ScalarMultiply (double *y, const double *x, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] *= x[i];
+    }
+}
+
+inline void
+SpectrumValueKernels::ScalarDivide (double *y, const double *x, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] /= x[i];
+    }
+}
+
+inline void
+SpectrumValueKernels::ScalarAddScalar (double *y, double s, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] += s;
+    }
+}
+
+inline void
+SpectrumValueKernels::ScalarMultiplyScalar (double *y, double s, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] *= s;
+    }
+}
+
+inline void
+SpectrumValueKernels::ScalarAddScaled (double *y, const double *x, double s, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      y[i] += s * x[i];
+    }
+}
+
+inline double
+SpectrumValueKernels::ScalarSum (const double *x, std::size_t n)
+{
+  double sum = 0;
+  for (std::size_t i = 0; i < n; i++)
+    {
+      sum += x[i];
+    }
+  return sum;
+}
+
+inline double
+SpectrumValueKernels::ScalarSumOfProducts (const double *x, const double *y, std::size_t n)
+{
+  double sum = 0;
+  for (std::size_t i = 0; i < n; i++)
+    {
+      sum += x[i] * y[i];
+    }
+  return sum;
+}
+
+#ifdef NS3_SPECTRUM_KERNELS_X86
+
+/*
+ * AVX2 kernels: 4 doubles per vector, scalar tail.
+ */
+
+inline void
+SpectrumValueKernels::Avx2Add (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_add_pd (_mm256_loadu_pd (y + i), _mm256_loadu_pd (x + i)));
+    }
+  ScalarAdd (y + i, x + i, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx2Subtract (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_sub_pd (_mm256_loadu_pd (y + i), _mm256_loadu_pd (x + i)));
+    }
+  ScalarSubtract (y + i, x + i, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx2Multiply (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_mul_pd (_mm256_loadu_pd (y + i), _mm256_loadu_pd (x + i)));
+    }
+  ScalarMultiply (y + i, x + i, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx2Divide (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_div_pd (_mm256_loadu_pd (y + i), _mm256_loadu_pd (x + i)));
+    }
+  ScalarDivide (y + i, x + i, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx2AddScalar (double *y, double s, std::size_t n)
+{
+  __m256d vs = _mm256_set1_pd (s);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_add_pd (_mm256_loadu_pd (y + i), vs));
+    }
+  ScalarAddScalar (y + i, s, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx2MultiplyScalar (double *y, double s, std::size_t n)
+{
+  __m256d vs = _mm256_set1_pd (s);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_mul_pd (_mm256_loadu_pd (y + i), vs));
+    }
+  ScalarMultiplyScalar (y + i, s, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx2AddScaled (double *y, const double *x, double s, std::size_t n)
+{
+  __m256d vs = _mm256_set1_pd (s);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      _mm256_storeu_pd (y + i, _mm256_fmadd_pd (vs, _mm256_loadu_pd (x + i), _mm256_loadu_pd (y + i)));
+    }
+  ScalarAddScaled (y + i, x + i, s, n - i);
+}
+
+inline double
+SpectrumValueKernels::Avx2Sum (const double *x, std::size_t n)
+{
+  // Two accumulators to hide the latency of the additions.
+  __m256d a = _mm256_setzero_pd ();
+  __m256d b = _mm256_setzero_pd ();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      a = _mm256_add_pd (a, _mm256_loadu_pd (x + i));
+      b = _mm256_add_pd (b, _mm256_loadu_pd (x + i + 4));
+    }
+  if (i + 4 <= n)
+    {
+      a = _mm256_add_pd (a, _mm256_loadu_pd (x + i));
+      i += 4;
+    }
+  a = _mm256_add_pd (a, b);
+  __m128d h = _mm_add_pd (_mm256_castpd256_pd128 (a), _mm256_extractf128_pd (a, 1));
+  double sum = _mm_cvtsd_f64 (_mm_add_sd (h, _mm_unpackhi_pd (h, h)));
+  return sum + ScalarSum (x + i, n - i);
+}
+
+inline double
+SpectrumValueKernels::Avx2SumOfProducts (const double *x, const double *y, std::size_t n)
+{
+  __m256d a = _mm256_setzero_pd ();
+  __m256d b = _mm256_setzero_pd ();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      a = _mm256_fmadd_pd (_mm256_loadu_pd (x + i), _mm256_loadu_pd (y + i), a);
+      b = _mm256_fmadd_pd (_mm256_loadu_pd (x + i + 4), _mm256_loadu_pd (y + i + 4), b);
+    }
+  if (i + 4 <= n)
+    {
+      a = _mm256_fmadd_pd (_mm256_loadu_pd (x + i), _mm256_loadu_pd (y + i), a);
+      i += 4;
+    }
+  a = _mm256_add_pd (a, b);
+  __m128d h = _mm_add_pd (_mm256_castpd256_pd128 (a), _mm256_extractf128_pd (a, 1));
+  double sum = _mm_cvtsd_f64 (_mm_add_sd (h, _mm_unpackhi_pd (h, h)));
+  return sum + ScalarSumOfProducts (x + i, y + i, n - i);
+}
+
+/*
+ * AVX-512 kernels: 8 doubles per vector, masked tail.
+ */
+
+inline void
+SpectrumValueKernels::Avx512Add (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_add_pd (_mm512_loadu_pd (y + i), _mm512_loadu_pd (x + i)));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      _mm512_mask_storeu_pd (y + i, m, _mm512_add_pd (_mm512_maskz_loadu_pd (m, y + i),
+                                                      _mm512_maskz_loadu_pd (m, x + i)));
+    }
+}
+
+inline void
+SpectrumValueKernels::Avx512Subtract (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_sub_pd (_mm512_loadu_pd (y + i), _mm512_loadu_pd (x + i)));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      _mm512_mask_storeu_pd (y + i, m, _mm512_sub_pd (_mm512_maskz_loadu_pd (m, y + i),
+                                                      _mm512_maskz_loadu_pd (m, x + i)));
+    }
+}
+
+inline void
+SpectrumValueKernels::Avx512Multiply (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_mul_pd (_mm512_loadu_pd (y + i), _mm512_loadu_pd (x + i)));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      _mm512_mask_storeu_pd (y + i, m, _mm512_mul_pd (_mm512_maskz_loadu_pd (m, y + i),
+                                                      _mm512_maskz_loadu_pd (m, x + i)));
+    }
+}
+
+inline void
+SpectrumValueKernels::Avx512Divide (double *y, const double *x, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_div_pd (_mm512_loadu_pd (y + i), _mm512_loadu_pd (x + i)));
+    }
+  // Scalar tail: a masked division would divide the masked-out zeros.
+  ScalarDivide (y + i, x + i, n - i);
+}
+
+inline void
+SpectrumValueKernels::Avx512AddScalar (double *y, double s, std::size_t n)
+{
+  __m512d vs = _mm512_set1_pd (s);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_add_pd (_mm512_loadu_pd (y + i), vs));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      _mm512_mask_storeu_pd (y + i, m, _mm512_add_pd (_mm512_maskz_loadu_pd (m, y + i), vs));
+    }
+}
+
+inline void
+SpectrumValueKernels::Avx512MultiplyScalar (double *y, double s, std::size_t n)
+{
+  __m512d vs = _mm512_set1_pd (s);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_mul_pd (_mm512_loadu_pd (y + i), vs));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      _mm512_mask_storeu_pd (y + i, m, _mm512_mul_pd (_mm512_maskz_loadu_pd (m, y + i), vs));
+    }
+}
+
+inline void
+SpectrumValueKernels::Avx512AddScaled (double *y, const double *x, double s, std::size_t n)
+{
+  __m512d vs = _mm512_set1_pd (s);
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      _mm512_storeu_pd (y + i, _mm512_fmadd_pd (vs, _mm512_loadu_pd (x + i), _mm512_loadu_pd (y + i)));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      _mm512_mask_storeu_pd (y + i, m, _mm512_fmadd_pd (vs, _mm512_maskz_loadu_pd (m, x + i),
+                                                        _mm512_maskz_loadu_pd (m, y + i)));
+    }
+}
+
+inline double
+SpectrumValueKernels::Avx512Reduce (__m512d v)
+{
+  // Not _mm512_reduce_add_pd, which trips -Wuninitialized in GCC 12.
+  double lanes[8];
+  _mm512_storeu_pd (lanes, v);
+  return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6]))
+         + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+}
+
+inline double
+SpectrumValueKernels::Avx512Sum (const double *x, std::size_t n)
+{
+  __m512d a = _mm512_setzero_pd ();
+  __m512d b = _mm512_setzero_pd ();
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+    {
+      a = _mm512_add_pd (a, _mm512_loadu_pd (x + i));
+      b = _mm512_add_pd (b, _mm512_loadu_pd (x + i + 8));
+    }
+  for (; i + 8 <= n; i += 8)
+    {
+      a = _mm512_add_pd (a, _mm512_loadu_pd (x + i));
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      b = _mm512_add_pd (b, _mm512_maskz_loadu_pd (m, x + i));
+    }
+  return Avx512Reduce (_mm512_add_pd (a, b));
+}
+
+inline double
+SpectrumValueKernels::Avx512SumOfProducts (const double *x, const double *y, std::size_t n)
+{
+  __m512d a = _mm512_setzero_pd ();
+  __m512d b = _mm512_setzero_pd ();
+  std::size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+    {
+      a = _mm512_fmadd_pd (_mm512_loadu_pd (x + i), _mm512_loadu_pd (y + i), a);
+      b = _mm512_fmadd_pd (_mm512_loadu_pd (x + i + 8), _mm512_loadu_pd (y + i + 8), b);
+    }
+  for (; i + 8 <= n; i += 8)
+    {
+      a = _mm512_fmadd_pd (_mm512_loadu_pd (x + i), _mm512_loadu_pd (y + i), a);
+    }
+  if (i < n)
+    {
+      __mmask8 m = static_cast<__mmask8> ((1u << (n - i)) - 1);
+      b = _mm512_fmadd_pd (_mm512_maskz_loadu_pd (m, x + i), _mm512_maskz_loadu_pd (m, y + i), b);
+    }
+  return Avx512Reduce (_mm512_add_pd (a, b));
+}
+
+#endif /* NS3_SPECTRUM_KERNELS_X86 */
+
+} // namespace ns3
+
+#endif /* SPECTRUM_VALUE_KERNELS_H */
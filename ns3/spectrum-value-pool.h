@@ -0,0 +1,291 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SPECTRUM_VALUE_POOL_H
+#define SPECTRUM_VALUE_POOL_H
+
+#include <ns3/spectrum-value.h>
+#include <ns3/ptr.h>
+#include <ns3/assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup spectrum
+ * ns3::SpectrumValuePool declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup spectrum
+ *
+ * \brief Recycle the SpectrumValue instances of each SpectrumModel.
+ *
+ * Every transmission in the spectrum, LTE and spectrum Wi-Fi models
+ * creates new SpectrumValues for the transmitted PSD, the received
+ * PSD scaled by the propagation loss, the interference and the SINR,
+ * each with a heap allocated array of values. They all have the size
+ * of one of the few SpectrumModels of the simulation, and they live
+ * no longer than a transmission.
+ *
+ * When a SpectrumValue is no longer referenced, its
+ * SpectrumValuePoolDeleter keeps it, with its 64-byte aligned
+ * values, in a free list of its SpectrumModel instead of freeing it.
+ * The free list is indexed by the model uid: a pooled value does not
+ * reference its SpectrumModel, which can be destroyed meanwhile.
+ * Create() and Copy() take their instance from that free list, so in
+ * steady state a transmission allocates nothing:
+ *
+ * \code
+ *   Ptr<SpectrumValue> rxPsd = SpectrumValuePool::Copy (*txPsd);
+ *   Ptr<SpectrumValue> sinr = SpectrumValuePool::Create (model);
+ * \endcode
+ *
+ * SpectrumValues created otherwise, e.g. with Create<SpectrumValue>,
+ * are recycled as well when released.
+ *
+ * The pool is disabled by default, since a value kept in a free list is
+ * only reused by Create() and Copy(): SetMaxPooled() enables it, once
+ * the models allocate their values through them.
+ *
+ * The free lists belong to the thread which releases the values, so
+ * the pool needs no lock with the MultithreadedSimulatorImpl. They
+ * hold at most SetMaxPooled() values per model and thread.
+ */
+class SpectrumValuePool
+{
+public:
+  /** Allocation counters of the calling thread. */
+  struct Stats
+  {
+    uint64_t allocations; /**< Number of Create and Copy calls. */
+    uint64_t reused;      /**< Allocations served from a free list. */
+    uint64_t released;    /**< Number of values kept by a free list. */
+    uint64_t pooled;      /**< Number of values currently held by the free lists. */
+  };
+
+  /**
+   * Get a SpectrumValue of a model, with all its values set to 0, as
+   * with Create<SpectrumValue> (model).
+   *
+   * \param [in] model The SpectrumModel.
+   * \returns The SpectrumValue.
+   */
+  static Ptr<SpectrumValue> Create (Ptr<const SpectrumModel> model);
+  /**
+   * Get a copy of a SpectrumValue, as with SpectrumValue::Copy.
+   *
+   * \param [in] value The SpectrumValue to copy.
+   * \returns The copy.
+   */
+  static Ptr<SpectrumValue> Copy (const SpectrumValue &value);
+  /**
+   * Recycle a SpectrumValue no longer referenced, or delete it if
+   * its free list is full.
+   *
+   * \param [in] value The SpectrumValue.
+   */
+  static void Release (SpectrumValue *value);
+  /**
+   * Set the maximum number of free SpectrumValues per model and
+   * thread; 0, the default, disables the pool.
+   *
+   * \param [in] n The maximum.
+   */
+  static void SetMaxPooled (uint32_t n);
+  /**
+   * Get the counters of the calling thread.
+   *
+   * \returns The counters.
+   */
+  static Stats GetStats (void);
+  /** Delete all the free SpectrumValues of the calling thread. */
+  static void Trim (void);
+
+private:
+  /**
+   * The free lists and counters of one thread, never destroyed: a
+   * SpectrumValue may be released late in the shutdown of its thread.
+   */
+  struct Cache
+  {
+    /** The free lists, indexed by SpectrumModel uid. */
+    std::vector<std::vector<SpectrumValue *> > lists;
+    Stats stats; /**< The counters. */
+  };
+
+  /**
+   * Get the free lists of the calling thread.
+   *
+   * \returns The free lists.
+   */
+  static Cache & GetCache (void);
+  /**
+   * Get the maximum number of free SpectrumValues per model and thread.
+   *
+   * \returns A reference to the maximum.
+   */
+  static uint32_t & GetMaxPooled (void);
+  /**
+   * Take a SpectrumValue from a free list.
+   *
+   * \param [in] uid The SpectrumModel uid.
+   * \returns The SpectrumValue, unreferenced, or 0 if the free list is empty.
+   */
+  static SpectrumValue * Take (SpectrumModelUid_t uid);
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+SpectrumValuePoolDeleter::Delete (SpectrumValue *value)
+{
+  SpectrumValuePool::Release (value);
+}
+
+inline SpectrumValuePool::Cache &
+SpectrumValuePool::GetCache (void)
+{
+  static thread_local Cache *cache = 0;
+  if (cache == 0)
+    {
+      cache = new Cache ();
+    }
+  return *cache;
+}
+
+inline uint32_t &
+SpectrumValuePool::GetMaxPooled (void)
+{
+  static uint32_t maxPooled = 0;
+  return maxPooled;
+}
+
+inline void
+SpectrumValuePool::SetMaxPooled (uint32_t n)
+{
+  GetMaxPooled () = n;
+}
+
+inline SpectrumValue *
+SpectrumValuePool::Take (SpectrumModelUid_t uid)
+{
+  Cache &cache = GetCache ();
+  cache.stats.allocations++;
+  if (uid >= cache.lists.size () || cache.lists[uid].empty ())
+    {
+      return 0;
+    }
+  SpectrumValue *value = cache.lists[uid].back ();
+  cache.lists[uid].pop_back ();
+  cache.stats.reused++;
+  cache.stats.pooled--;
+  return value;
+}
+
+inline Ptr<SpectrumValue>
+SpectrumValuePool::Create (Ptr<const SpectrumModel> model)
+{
+  NS_ASSERT (model != 0);
+  SpectrumValue *value = Take (model->GetUid ());
+  if (value == 0)
+    {
+      return ns3::Create<SpectrumValue> (model);
+    }
+  value->m_spectrumModel = model;
+  std::fill (value->m_values.begin (), value->m_values.end (), 0.0);
+  // The reference count of a released value is 0.
+  return Ptr<SpectrumValue> (value, true);
+}
+
+inline Ptr<SpectrumValue>
+SpectrumValuePool::Copy (const SpectrumValue &other)
+{
+  NS_ASSERT (other.m_spectrumModel != 0);
+  SpectrumValue *value = Take (other.m_spectrumModel->GetUid ());
+  if (value == 0)
+    {
+      return ns3::Create<SpectrumValue> (other);
+    }
+  value->m_spectrumModel = other.m_spectrumModel;
+  std::copy (other.m_values.begin (), other.m_values.end (), value->m_values.begin ());
+  return Ptr<SpectrumValue> (value, true);
+}
+
+inline void
+SpectrumValuePool::Release (SpectrumValue *value)
+{
+  const SpectrumModel *model = PeekPointer (value->m_spectrumModel);
+  // Values resized by hand do not match their model any more.
+  if (GetMaxPooled () == 0 || model == 0
+      || value->m_values.size () != model->GetNumBands ())
+    {
+      delete value;
+      return;
+    }
+  Cache &cache = GetCache ();
+  SpectrumModelUid_t uid = model->GetUid ();
+  if (uid >= cache.lists.size ())
+    {
+      cache.lists.resize (uid + 1);
+    }
+  std::vector<SpectrumValue *> &list = cache.lists[uid];
+  if (list.size () >= GetMaxPooled ())
+    {
+      delete value;
+      return;
+    }
+  // A pooled value must not keep its model alive.
+  value->m_spectrumModel = 0;
+  list.push_back (value);
+  cache.stats.released++;
+  cache.stats.pooled++;
+}
+
+inline SpectrumValuePool::Stats
+SpectrumValuePool::GetStats (void)
+{
+  return GetCache ().stats;
+}
+
+inline void
+SpectrumValuePool::Trim (void)
+{
+  Cache &cache = GetCache ();
+  for (uint32_t i = 0; i < cache.lists.size (); i++)
+    {
+      for (uint32_t j = 0; j < cache.lists[i].size (); j++)
+        {
+          delete cache.lists[i][j];
+        }
+      cache.lists[i].clear ();
+    }
+  cache.stats.pooled = 0;
+}
+
+} // namespace ns3
+
+#endif /* SPECTRUM_VALUE_POOL_H */
@@ -23,15 +23,64 @@
 
 #include <ns3/ptr.h>
 #include <ns3/simple-ref-count.h>
+#include <ns3/aligned-allocator.h>
 #include <ns3/spectrum-model.h>
+#include <ns3/spectrum-value-kernels.h>
+#include <ns3/assert.h>
 #include <ostream>
 #include <vector>
 
 namespace ns3 {
 
 
-/// Container for element values
-typedef std::vector<double> Values;
+/**
+ * Container for element values, aligned on a cache line for the
+ * SpectrumValueKernels.
+ *
+ * \note This used to be a std::vector<double>. The code which converts
+ * between the two must copy, e.g. with ToStdVector() and ToValues().
+ */
+typedef std::vector<double, AlignedAllocator<double, 64> > Values;
+
+/**
+ * Copy Values into a std::vector<double>.
+ *
+ * \param values the values
+ * \return the copy
+ */
+inline std::vector<double>
+ToStdVector (const Values &values)
+{
+  return std::vector<double> (values.begin (), values.end ());
+}
+
+/**
+ * Copy a std::vector<double> into Values.
+ *
+ * \param values the values
+ * \return the copy
+ */
+inline Values
+ToValues (const std::vector<double> &values)
+{
+  return Values (values.begin (), values.end ());
+}
+
+class SpectrumValue;
+
+/**
+ * \ingroup spectrum
+ *
+ * Deleter of SpectrumValue: gives the released instances to the
+ * SpectrumValuePool of their SpectrumModel.
+ */
+struct SpectrumValuePoolDeleter
+{
+  /**
+   * \param value the SpectrumValue no longer referenced
+   */
+  static void Delete (SpectrumValue *value);
+};
 
 /**
  * \ingroup spectrum
@@ -55,7 +104,7 @@ typedef std::vector<double> Values;
  * things, such as power spectral densities, frequency-dependent
  * propagation losses, spectral masks, etc.
  */
-class SpectrumValue : public SimpleRefCount<SpectrumValue>
+class SpectrumValue : public SimpleRefCount<SpectrumValue, empty, SpectrumValuePoolDeleter>
 {
 public:
   /**
@@ -409,6 +458,18 @@ public:
    */
   SpectrumValue& operator= (double rhs);
 
+  /**
+   * Add the Right Hand Side scaled by a factor to *this, component by
+   * component. Equivalent to *this += scale * rhs, without the
+   * temporary SpectrumValue and with one fused multiply-add per value.
+   *
+   * @param rhs the Right Hand Side
+   * @param scale the factor
+   *
+   * @return a reference to *this
+   */
+  SpectrumValue& AddScaled (const SpectrumValue& rhs, double scale);
+
 
 
   /**
@@ -497,6 +558,16 @@ public:
    */
   friend double Integral (const SpectrumValue&  arg);
 
+  /**
+   *
+   * @param lhs the first operand
+   * @param rhs the second operand
+   *
+   * @return the sum of the products of the values of lhs and rhs,
+   * i.e., Sum (lhs * rhs) without the temporary SpectrumValue
+   */
+  friend double SumOfProducts (const SpectrumValue& lhs, const SpectrumValue& rhs);
+
   /**
    *
    * @return a Ptr to a copy of this instance
@@ -515,6 +586,8 @@ public:
 
 
 private:
+  friend class SpectrumValuePool;
+
   /**
    * Add a SpectrumValue (element to element addition)
    * \param x SpectrumValue
@@ -619,8 +692,119 @@ SpectrumValue Log10 (const SpectrumValue& arg);
 SpectrumValue Log2 (const SpectrumValue& arg);
 SpectrumValue Log (const SpectrumValue& arg);
 double Integral (const SpectrumValue& arg);
+double SumOfProducts (const SpectrumValue& lhs, const SpectrumValue& rhs);
+
 
+inline void
+SpectrumValue::Add (const SpectrumValue& x)
+{
+  NS_ASSERT (m_spectrumModel == x.m_spectrumModel);
+  SpectrumValueKernels::Add (m_values.data (), x.m_values.data (), m_values.size ());
+}
+
+inline void
+SpectrumValue::Add (double s)
+{
+  SpectrumValueKernels::AddScalar (m_values.data (), s, m_values.size ());
+}
+
+inline void
+SpectrumValue::Subtract (const SpectrumValue& x)
+{
+  NS_ASSERT (m_spectrumModel == x.m_spectrumModel);
+  SpectrumValueKernels::Subtract (m_values.data (), x.m_values.data (), m_values.size ());
+}
+
+inline void
+SpectrumValue::Subtract (double s)
+{
+  SpectrumValueKernels::AddScalar (m_values.data (), -s, m_values.size ());
+}
+
+inline void
+SpectrumValue::Multiply (const SpectrumValue& x)
+{
+  NS_ASSERT (m_spectrumModel == x.m_spectrumModel);
+  SpectrumValueKernels::Multiply (m_values.data (), x.m_values.data (), m_values.size ());
+}
+
+inline void
+SpectrumValue::Multiply (double s)
+{
+  SpectrumValueKernels::MultiplyScalar (m_values.data (), s, m_values.size ());
+}
+
+inline void
+SpectrumValue::Divide (const SpectrumValue& x)
+{
+  NS_ASSERT (m_spectrumModel == x.m_spectrumModel);
+  SpectrumValueKernels::Divide (m_values.data (), x.m_values.data (), m_values.size ());
+}
+
+inline void
+SpectrumValue::Divide (double s)
+{
+  // Not a multiplication by 1 / s, which would round differently.
+  for (Values::iterator it = m_values.begin (); it != m_values.end (); ++it)
+    {
+      *it /= s;
+    }
+}
+
+inline double
+Sum (const SpectrumValue& x)
+{
+  return SpectrumValueKernels::Sum (x.m_values.data (), x.m_values.size ());
+}
+
+inline double
+Integral (const SpectrumValue& arg)
+{
+  NS_ASSERT (arg.m_values.size () == arg.m_spectrumModel->GetNumBands ());
+  // The band widths of the last model integrated by this thread; the
+  // SpectrumModel uids start at 1 and are never reused.
+  static thread_local SpectrumModelUid_t uid = 0;
+  static thread_local Values widths;
+  if (uid != arg.m_spectrumModel->GetUid ())
+    {
+      widths.clear ();
+      for (Bands::const_iterator bit = arg.m_spectrumModel->Begin ();
+           bit != arg.m_spectrumModel->End (); ++bit)
+        {
+          widths.push_back (bit->fh - bit->fl);
+        }
+      uid = arg.m_spectrumModel->GetUid ();
+    }
+  return SpectrumValueKernels::SumOfProducts (arg.m_values.data (), widths.data (),
+                                              arg.m_values.size ());
+}
+
+inline SpectrumValue&
+SpectrumValue::AddScaled (const SpectrumValue& rhs, double scale)
+{
+  NS_ASSERT (m_spectrumModel == rhs.m_spectrumModel);
+  if (m_values.empty ())
+    {
+      return *this;
+    }
+  SpectrumValueKernels::AddScaled (&m_values[0], &rhs.m_values[0], scale, m_values.size ());
+  return *this;
+}
+
+inline double
+SumOfProducts (const SpectrumValue& lhs, const SpectrumValue& rhs)
+{
+  NS_ASSERT (lhs.m_spectrumModel == rhs.m_spectrumModel);
+  if (lhs.m_values.empty ())
+    {
+      return 0;
+    }
+  return SpectrumValueKernels::SumOfProducts (&lhs.m_values[0], &rhs.m_values[0], lhs.m_values.size ());
+}
 
 } // namespace ns3
 
+// The pool defines SpectrumValuePoolDeleter::Delete, used by every Ptr<SpectrumValue>.
+#include <ns3/spectrum-value-pool.h>
+
 #endif /* SPECTRUM_VALUE_H */
@@ -0,0 +1,825 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_BBR_H
+#define TCP_BBR_H
+
+#include <algorithm>
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/tcp-rate-ops.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/data-rate.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+
+/**
+ * \file
+ * \ingroup congestionOps
+ * ns3::TcpBbr declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief BBR congestion control algorithm
+ *
+ * BBR (Bottleneck Bandwidth and Round-trip propagation time) builds a model
+ * of the path from the delivery rate samples of TcpRateOps, instead of
+ * reacting to losses or delay: BtlBw is the maximum delivery rate over the
+ * last 10 round trips, RTprop the minimum RTT over the last 10 seconds. It
+ * paces at pacing_gain * BtlBw and bounds the data in flight to
+ * cwnd_gain * BtlBw * RTprop, with the gains of
+ * draft-cardwell-iccrg-bbr-congestion-control-00 and Linux v4.9 tcp_bbr.c:
+ *
+ * - STARTUP: pacing and cwnd gains of 2/ln(2), doubling the rate each
+ *   round trip, until BtlBw grows by less than 25% in three rounds;
+ * - DRAIN: pacing gain of ln(2)/2, until the queue made in STARTUP drains;
+ * - PROBE_BW: cwnd gain of 2, pacing gain cycling over eight phases of one
+ *   RTprop each, 5/4 to probe for more bandwidth, 3/4 to drain the queue
+ *   made, then 1; the first phase is chosen at random (but not 3/4);
+ * - PROBE_RTT: when RTprop has not been refreshed for 10 s, cwnd drops to
+ *   4 segments for 200 ms and one round trip, to measure it again.
+ *
+ * In loss recovery, cwnd is bounded by packet conservation during the
+ * first round trip, and restored when the recovery ends. BBR sets
+ * TcpSocketState::m_pacing, and relies on the pacing of the socket.
+ * The long-term bandwidth sampling of Linux (policer detection) is not
+ * modelled.
+ */
+class TcpBbr : public TcpCongestionOps
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Constructor
+   */
+  TcpBbr ();
+
+  /**
+   * \brief Copy constructor.
+   * \param sock object to copy.
+   */
+  TcpBbr (const TcpBbr &sock);
+
+  /**
+   * \brief BBR has the following 4 modes for deciding how fast to send:
+   */
+  typedef enum
+  {
+    BBR_STARTUP,        /**< Ramp up sending rate rapidly to fill pipe */
+    BBR_DRAIN,          /**< Drain any queue created during startup */
+    BBR_PROBE_BW,       /**< Discover, share bw: pace around estimated bw */
+    BBR_PROBE_RTT,      /**< Cut inflight to min to probe min_rtt */
+  } BbrMode_t;
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random
+   * variables used by this model.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  virtual std::string GetName () const;
+  virtual bool HasCongControl () const;
+  virtual void CongControl (Ptr<TcpSocketState> tcb,
+                            const TcpRateOps::TcpRateConnection &rc,
+                            const TcpRateOps::TcpRateSample &rs);
+  virtual void CongestionStateSet (Ptr<TcpSocketState> tcb,
+                                   const TcpSocketState::TcpCongState_t newState);
+  virtual void CwndEvent (Ptr<TcpSocketState> tcb,
+                          const TcpSocketState::TcpCAEvent_t event);
+  virtual uint32_t GetSsThresh (Ptr<const TcpSocketState> tcb,
+                                uint32_t bytesInFlight);
+  virtual void IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked);
+  virtual void UpdatePacingRate (Ptr<TcpSocketState> tcb);
+  virtual Ptr<TcpCongestionOps> Fork ();
+
+  /**
+   * \return the current mode
+   */
+  BbrMode_t GetMode (void) const;
+  /**
+   * \return the bottleneck bandwidth estimate (BtlBw)
+   */
+  DataRate GetBtlBw (void) const;
+  /**
+   * \return the round-trip propagation time estimate (RTprop)
+   */
+  Time GetRtProp (void) const;
+
+protected:
+  /**
+   * \brief Windowed running maximum of the bandwidth samples
+   *
+   * The Kathleen Nichols' algorithm of Linux lib/win_minmax.c: the best,
+   * second best and third best samples of the window are kept, so that
+   * the maximum is tracked in O(1) as the window slides.
+   */
+  class MaxBandwidthFilter
+  {
+  public:
+    /**
+     * \brief Add a sample
+     * \param window the length of the window, in rounds
+     * \param time the round of the sample
+     * \param value the sample, in bit/s
+     * \return the maximum over the window
+     */
+    uint64_t Update (uint32_t window, uint32_t time, uint64_t value);
+    /**
+     * \return the maximum over the window
+     */
+    uint64_t GetBest (void) const;
+    /**
+     * \brief Forget all the samples
+     */
+    void Reset (void);
+
+  private:
+    /// A sample
+    struct Sample
+    {
+      uint32_t time;   //!< Round of the sample
+      uint64_t value;  //!< Value of the sample
+    };
+    Sample m_samples[3] {{0, 0}, {0, 0}, {0, 0}}; //!< Best, second and third best samples
+  };
+
+  /**
+   * \brief Initialize the state on the first ACK
+   * \param tcb the socket state
+   */
+  void Init (Ptr<TcpSocketState> tcb);
+  /**
+   * \brief Count the round trips and sample the bottleneck bandwidth
+   * \param rc the connection rate
+   * \param rs the rate sample
+   */
+  void UpdateBtlBw (const TcpRateOps::TcpRateConnection &rc,
+                    const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \brief Advance the PROBE_BW gain cycle when the phase is over
+   * \param tcb the socket state
+   * \param rs the rate sample
+   */
+  void UpdateCyclePhase (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \param tcb the socket state
+   * \param rs the rate sample
+   * \return true if the current PROBE_BW phase is over
+   */
+  bool IsNextCyclePhase (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateSample &rs) const;
+  /**
+   * \brief Detect that the bandwidth stopped growing in STARTUP
+   * \param rs the rate sample
+   */
+  void CheckFullPipe (const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \brief Leave STARTUP for DRAIN, and DRAIN for PROBE_BW
+   * \param tcb the socket state
+   */
+  void CheckDrain (Ptr<TcpSocketState> tcb);
+  /**
+   * \brief Refresh RTprop, and enter or leave PROBE_RTT
+   * \param tcb the socket state
+   * \param rc the connection rate
+   * \param rs the rate sample
+   */
+  void UpdateRtProp (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateConnection &rc,
+                     const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \brief Enter STARTUP
+   */
+  void EnterStartup (void);
+  /**
+   * \brief Enter PROBE_BW, at a random phase of the gain cycle
+   */
+  void EnterProbeBw (void);
+  /**
+   * \brief Set the pacing rate to gain * BtlBw
+   * \param tcb the socket state
+   * \param gain the pacing gain
+   */
+  void SetPacingRate (Ptr<TcpSocketState> tcb, double gain);
+  /**
+   * \brief Set the cwnd from the model, the recovery and the mode
+   * \param tcb the socket state
+   * \param rc the connection rate
+   * \param rs the rate sample
+   */
+  void SetCwnd (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateConnection &rc,
+                const TcpRateOps::TcpRateSample &rs);
+  /**
+   * \param tcb the socket state
+   * \param gain the gain
+   * \return gain * BtlBw * RTprop, in bytes
+   */
+  uint32_t InFlight (Ptr<const TcpSocketState> tcb, double gain) const;
+  /**
+   * \brief Remember the cwnd before a recovery or PROBE_RTT
+   * \param tcb the socket state
+   */
+  void SaveCwnd (Ptr<const TcpSocketState> tcb);
+  /**
+   * \brief Restore the cwnd saved by SaveCwnd
+   * \param tcb the socket state
+   */
+  void RestoreCwnd (Ptr<TcpSocketState> tcb);
+
+private:
+  // Parameters
+  double m_highGain {2.89};                    //!< Pacing and cwnd gain of STARTUP, 2/ln(2)
+  uint32_t m_bandwidthWindowLength {10};       //!< Length of the BtlBw filter, in rounds
+  Time m_rtPropFilterLength {Seconds (10)};    //!< Length of the RTprop filter
+  Time m_probeRttDuration {MilliSeconds (200)}; //!< Time spent in PROBE_RTT
+  uint32_t m_minPipeCwnd {4};                  //!< Minimum cwnd, in segments
+
+  // State
+  bool m_isInitialized {false};                //!< Was Init called?
+  BbrMode_t m_mode {BBR_STARTUP};              //!< Current mode
+  double m_pacingGain {0};                     //!< Current pacing gain
+  double m_cWndGain {0};                       //!< Current cwnd gain
+  MaxBandwidthFilter m_maxBwFilter;            //!< BtlBw filter
+  Time m_rtProp {Time::Max ()};                //!< RTprop estimate
+  Time m_rtPropStamp {Seconds (0)};            //!< Time of the RTprop estimate
+  bool m_hasSeenRtt {false};                   //!< Was the pacing rate set from an RTT?
+  uint32_t m_roundCount {0};                   //!< Number of round trips
+  bool m_roundStart {false};                   //!< Does this ACK start a round trip?
+  uint64_t m_nextRoundDelivered {0};           //!< Delivered count which ends the round trip
+  bool m_isPipeFilled {false};                 //!< Did the bandwidth stop growing in STARTUP?
+  uint64_t m_fullBandwidth {0};                //!< BtlBw at the last growth of 25%
+  uint32_t m_fullBandwidthCount {0};           //!< Rounds without a growth of 25%
+  uint32_t m_cycleIndex {0};                   //!< Phase of the PROBE_BW gain cycle
+  Time m_cycleStamp {Seconds (0)};             //!< Start of the phase
+  Time m_probeRttDoneStamp {Seconds (0)};      //!< End of PROBE_RTT, 0 if not set
+  bool m_probeRttRoundDone {false};            //!< Did a round trip end in PROBE_RTT?
+  bool m_idleRestart {false};                  //!< Restarting after idle?
+  bool m_packetConservation {false};           //!< Is the cwnd bounded by packet conservation?
+  TcpSocketState::TcpCongState_t m_prevCaState {TcpSocketState::CA_OPEN}; //!< Congestion state of the last ACK
+  uint32_t m_priorCwnd {0};                    //!< Cwnd saved by SaveCwnd
+  Ptr<UniformRandomVariable> m_uv;             //!< Random phase of PROBE_BW
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+/// PROBE_BW pacing gains, one phase per RTprop
+static const double BBR_PACING_GAIN_CYCLE[] = { 5.0 / 4, 3.0 / 4, 1, 1, 1, 1, 1, 1 };
+/// Number of phases of the PROBE_BW gain cycle
+static const uint32_t BBR_GAIN_CYCLE_LENGTH = 8;
+
+inline uint64_t
+TcpBbr::MaxBandwidthFilter::GetBest (void) const
+{
+  return m_samples[0].value;
+}
+
+inline void
+TcpBbr::MaxBandwidthFilter::Reset (void)
+{
+  for (int i = 0; i < 3; ++i)
+    {
+      m_samples[i].time = 0;
+      m_samples[i].value = 0;
+    }
+}
+
+inline uint64_t
+TcpBbr::MaxBandwidthFilter::Update (uint32_t window, uint32_t time, uint64_t value)
+{
+  Sample sample = { time, value };
+  if (value >= m_samples[0].value || time - m_samples[2].time > window)
+    {
+      // A new maximum, or nothing left in the window
+      m_samples[0] = m_samples[1] = m_samples[2] = sample;
+      return value;
+    }
+  if (value >= m_samples[1].value)
+    {
+      m_samples[1] = m_samples[2] = sample;
+    }
+  else if (value >= m_samples[2].value)
+    {
+      m_samples[2] = sample;
+    }
+
+  // Age the best samples out of the window
+  uint32_t dt = time - m_samples[0].time;
+  if (dt > window)
+    {
+      m_samples[0] = m_samples[1];
+      m_samples[1] = m_samples[2];
+      m_samples[2] = sample;
+      if (time - m_samples[0].time > window)
+        {
+          m_samples[0] = m_samples[1];
+          m_samples[1] = m_samples[2];
+          m_samples[2] = sample;
+        }
+    }
+  else if (m_samples[1].time == m_samples[0].time && dt > window / 4)
+    {
+      // A quarter of the window passed without a second best
+      m_samples[1] = m_samples[2] = sample;
+    }
+  else if (m_samples[2].time == m_samples[1].time && dt > window / 2)
+    {
+      // Half of the window passed without a third best
+      m_samples[2] = sample;
+    }
+  return m_samples[0].value;
+}
+
+inline TypeId
+TcpBbr::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpBbr")
+    .SetParent<TcpCongestionOps> ()
+    .AddConstructor<TcpBbr> ()
+    .SetGroupName ("Internet")
+    .AddAttribute ("HighGain",
+                   "Pacing and cwnd gain of STARTUP, 2/ln(2)",
+                   DoubleValue (2.89),
+                   MakeDoubleAccessor (&TcpBbr::m_highGain),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("BwWindowLength",
+                   "Length of the bottleneck bandwidth filter, in round trips",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&TcpBbr::m_bandwidthWindowLength),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("RttWindowLength",
+                   "Length of the round-trip propagation time filter",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&TcpBbr::m_rtPropFilterLength),
+                   MakeTimeChecker ())
+    .AddAttribute ("ProbeRttDuration",
+                   "Time spent in PROBE_RTT",
+                   TimeValue (MilliSeconds (200)),
+                   MakeTimeAccessor (&TcpBbr::m_probeRttDuration),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+inline
+TcpBbr::TcpBbr ()
+  : TcpCongestionOps ()
+{
+  m_uv = CreateObject<UniformRandomVariable> ();
+}
+
+inline
+TcpBbr::TcpBbr (const TcpBbr &sock)
+  : TcpCongestionOps (sock),
+    m_highGain (sock.m_highGain),
+    m_bandwidthWindowLength (sock.m_bandwidthWindowLength),
+    m_rtPropFilterLength (sock.m_rtPropFilterLength),
+    m_probeRttDuration (sock.m_probeRttDuration),
+    m_minPipeCwnd (sock.m_minPipeCwnd),
+    m_uv (sock.m_uv)
+{
+}
+
+inline int64_t
+TcpBbr::AssignStreams (int64_t stream)
+{
+  m_uv->SetStream (stream);
+  return 1;
+}
+
+inline std::string
+TcpBbr::GetName () const
+{
+  return "TcpBbr";
+}
+
+inline bool
+TcpBbr::HasCongControl () const
+{
+  return true;
+}
+
+inline Ptr<TcpCongestionOps>
+TcpBbr::Fork (void)
+{
+  return CopyObject<TcpBbr> (this);
+}
+
+inline TcpBbr::BbrMode_t
+TcpBbr::GetMode (void) const
+{
+  return m_mode;
+}
+
+inline DataRate
+TcpBbr::GetBtlBw (void) const
+{
+  return DataRate (m_maxBwFilter.GetBest ());
+}
+
+inline Time
+TcpBbr::GetRtProp (void) const
+{
+  return m_rtProp;
+}
+
+inline void
+TcpBbr::Init (Ptr<TcpSocketState> tcb)
+{
+  m_isInitialized = true;
+  tcb->m_pacing = true;
+  m_rtProp = tcb->m_minRtt;
+  m_rtPropStamp = Simulator::Now ();
+  m_cycleStamp = Simulator::Now ();
+  m_maxBwFilter.Reset ();
+  EnterStartup ();
+  // Until BtlBw is measured, pace the initial window over the RTT
+  SetPacingRate (tcb, m_highGain);
+}
+
+inline void
+TcpBbr::EnterStartup (void)
+{
+  m_mode = BBR_STARTUP;
+  m_pacingGain = m_highGain;
+  m_cWndGain = m_highGain;
+}
+
+inline void
+TcpBbr::EnterProbeBw (void)
+{
+  m_mode = BBR_PROBE_BW;
+  m_cWndGain = 2;
+  // Any phase but the 3/4 one: the index is advanced right below
+  m_cycleIndex = BBR_GAIN_CYCLE_LENGTH - 1 - m_uv->GetInteger (0, BBR_GAIN_CYCLE_LENGTH - 2);
+  m_cycleIndex = (m_cycleIndex + 1) % BBR_GAIN_CYCLE_LENGTH;
+  m_cycleStamp = Simulator::Now ();
+  m_pacingGain = BBR_PACING_GAIN_CYCLE[m_cycleIndex];
+}
+
+inline uint32_t
+TcpBbr::InFlight (Ptr<const TcpSocketState> tcb, double gain) const
+{
+  if (m_rtProp == Time::Max ())
+    {
+      // No RTT yet: the initial window
+      return tcb->m_initialCWnd * tcb->m_segmentSize;
+    }
+  double bdp = m_maxBwFilter.GetBest () * m_rtProp.GetSeconds () / 8.0;
+  return static_cast<uint32_t> (gain * bdp);
+}
+
+inline void
+TcpBbr::SetPacingRate (Ptr<TcpSocketState> tcb, double gain)
+{
+  uint64_t bw = m_maxBwFilter.GetBest ();
+  if (!m_hasSeenRtt && !tcb->m_lastRtt.Get ().IsZero ())
+    {
+      // Initial rate: the window over the first RTT
+      m_hasSeenRtt = true;
+      bw = static_cast<uint64_t> (tcb->m_cWnd * 8.0 / tcb->m_lastRtt.Get ().GetSeconds ());
+      tcb->m_currentPacingRate = DataRate (static_cast<uint64_t> (m_highGain * bw));
+      return;
+    }
+  // 1% below the estimate, to drain the queues at the bottleneck
+  DataRate rate (static_cast<uint64_t> (gain * bw * 0.99));
+  if (tcb->m_maxPacingRate.GetBitRate () > 0 && rate > tcb->m_maxPacingRate)
+    {
+      rate = tcb->m_maxPacingRate;
+    }
+  if (m_isPipeFilled || rate > tcb->m_currentPacingRate)
+    {
+      tcb->m_currentPacingRate = rate;
+    }
+}
+
+inline void
+TcpBbr::UpdateBtlBw (const TcpRateOps::TcpRateConnection &rc,
+                     const TcpRateOps::TcpRateSample &rs)
+{
+  m_roundStart = false;
+  if (rs.m_delivered < 0 || rs.m_interval.IsZero ())
+    {
+      return;
+    }
+  if (rs.m_priorDelivered >= m_nextRoundDelivered)
+    {
+      // The data sent at the start of the round trip is delivered
+      m_nextRoundDelivered = rc.m_delivered;
+      m_roundCount++;
+      m_roundStart = true;
+      m_packetConservation = false;
+    }
+  uint64_t bw = rs.m_deliveryRate.GetBitRate ();
+  // An application limited sample only raises the estimate
+  if (!rs.m_isAppLimited || bw >= m_maxBwFilter.GetBest ())
+    {
+      m_maxBwFilter.Update (m_bandwidthWindowLength, m_roundCount, bw);
+    }
+}
+
+inline bool
+TcpBbr::IsNextCyclePhase (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateSample &rs) const
+{
+  bool isFullLength = Simulator::Now () - m_cycleStamp > m_rtProp;
+  if (m_pacingGain == 1)
+    {
+      return isFullLength;
+    }
+  uint32_t inFlight = rs.m_priorInFlight;
+  if (m_pacingGain > 1)
+    {
+      // Probing: until losses, or the extra data in flight
+      return isFullLength && (rs.m_bytesLoss > 0 || inFlight >= InFlight (tcb, m_pacingGain));
+    }
+  // Draining: until the queue is drained
+  return isFullLength || inFlight <= InFlight (tcb, 1);
+}
+
+inline void
+TcpBbr::UpdateCyclePhase (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateSample &rs)
+{
+  if (m_mode == BBR_PROBE_BW && IsNextCyclePhase (tcb, rs))
+    {
+      m_cycleIndex = (m_cycleIndex + 1) % BBR_GAIN_CYCLE_LENGTH;
+      m_cycleStamp = Simulator::Now ();
+      m_pacingGain = BBR_PACING_GAIN_CYCLE[m_cycleIndex];
+    }
+}
+
+inline void
+TcpBbr::CheckFullPipe (const TcpRateOps::TcpRateSample &rs)
+{
+  if (m_isPipeFilled || !m_roundStart || rs.m_isAppLimited)
+    {
+      return;
+    }
+  uint64_t bw = m_maxBwFilter.GetBest ();
+  if (bw >= m_fullBandwidth * 5 / 4)
+    {
+      // Still growing
+      m_fullBandwidth = bw;
+      m_fullBandwidthCount = 0;
+      return;
+    }
+  m_fullBandwidthCount++;
+  m_isPipeFilled = m_fullBandwidthCount >= 3;
+}
+
+inline void
+TcpBbr::CheckDrain (Ptr<TcpSocketState> tcb)
+{
+  if (m_mode == BBR_STARTUP && m_isPipeFilled)
+    {
+      m_mode = BBR_DRAIN;
+      m_pacingGain = 1 / m_highGain;
+      m_cWndGain = m_highGain;
+    }
+  if (m_mode == BBR_DRAIN && tcb->m_bytesInFlight <= InFlight (tcb, 1))
+    {
+      EnterProbeBw ();
+    }
+}
+
+inline void
+TcpBbr::UpdateRtProp (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateConnection &rc,
+                      const TcpRateOps::TcpRateSample &rs)
+{
+  bool filterExpired = Simulator::Now () > m_rtPropStamp + m_rtPropFilterLength;
+  Time rtt = tcb->m_lastRtt;
+  if (!rtt.IsZero () && (rtt < m_rtProp || filterExpired))
+    {
+      m_rtProp = rtt;
+      m_rtPropStamp = Simulator::Now ();
+    }
+
+  if (filterExpired && !m_idleRestart && m_mode != BBR_PROBE_RTT)
+    {
+      m_mode = BBR_PROBE_RTT;
+      m_pacingGain = 1;
+      m_cWndGain = 1;
+      SaveCwnd (tcb);
+      m_probeRttDoneStamp = Seconds (0);
+    }
+
+  if (m_mode == BBR_PROBE_RTT)
+    {
+      if (m_probeRttDoneStamp.IsZero ()
+          && tcb->m_bytesInFlight <= m_minPipeCwnd * tcb->m_segmentSize)
+        {
+          // The queue is drained: stay one round trip and 200 ms
+          m_probeRttDoneStamp = Simulator::Now () + m_probeRttDuration;
+          m_probeRttRoundDone = false;
+          m_nextRoundDelivered = rc.m_delivered;
+        }
+      else if (!m_probeRttDoneStamp.IsZero ())
+        {
+          if (m_roundStart)
+            {
+              m_probeRttRoundDone = true;
+            }
+          if (m_probeRttRoundDone && Simulator::Now () > m_probeRttDoneStamp)
+            {
+              m_rtPropStamp = Simulator::Now ();
+              RestoreCwnd (tcb);
+              if (m_isPipeFilled)
+                {
+                  EnterProbeBw ();
+                }
+              else
+                {
+                  EnterStartup ();
+                }
+            }
+        }
+    }
+
+  if (rs.m_delivered > 0)
+    {
+      m_idleRestart = false;
+    }
+}
+
+inline void
+TcpBbr::SaveCwnd (Ptr<const TcpSocketState> tcb)
+{
+  if (m_prevCaState < TcpSocketState::CA_RECOVERY && m_mode != BBR_PROBE_RTT)
+    {
+      m_priorCwnd = tcb->m_cWnd;
+    }
+  else
+    {
+      // Already reduced: keep the cwnd of before the reduction
+      m_priorCwnd = std::max (m_priorCwnd, tcb->m_cWnd.Get ());
+    }
+}
+
+inline void
+TcpBbr::RestoreCwnd (Ptr<TcpSocketState> tcb)
+{
+  tcb->m_cWnd = std::max (m_priorCwnd, tcb->m_cWnd.Get ());
+}
+
+inline void
+TcpBbr::SetCwnd (Ptr<TcpSocketState> tcb, const TcpRateOps::TcpRateConnection &rc,
+                 const TcpRateOps::TcpRateSample &rs)
+{
+  uint32_t acked = rs.m_ackedSacked;
+  uint32_t cWnd = tcb->m_cWnd;
+  TcpSocketState::TcpCongState_t state = tcb->m_congState;
+
+  if (acked > 0)
+    {
+      // Recovery: packet conservation during the first round trip, then
+      // restoration of the cwnd when the recovery ends
+      bool conservation = false;
+      if (rs.m_bytesLoss > 0)
+        {
+          cWnd = cWnd > rs.m_bytesLoss + tcb->m_segmentSize ? cWnd - rs.m_bytesLoss
+                                                            : tcb->m_segmentSize;
+        }
+      if (state == TcpSocketState::CA_RECOVERY && m_prevCaState != TcpSocketState::CA_RECOVERY)
+        {
+          m_packetConservation = true;
+          m_nextRoundDelivered = rc.m_delivered;
+          cWnd = tcb->m_bytesInFlight + acked;
+        }
+      else if (m_prevCaState >= TcpSocketState::CA_RECOVERY && state < TcpSocketState::CA_RECOVERY)
+        {
+          cWnd = std::max (cWnd, m_priorCwnd);
+          m_packetConservation = false;
+        }
+      m_prevCaState = state;
+      if (m_packetConservation)
+        {
+          cWnd = std::max (cWnd, tcb->m_bytesInFlight.Get () + acked);
+          conservation = true;
+        }
+
+      if (!conservation)
+        {
+          // Three segments above the BDP keep the pipe full across the
+          // delayed and stretched ACKs
+          uint32_t target = InFlight (tcb, m_cWndGain) + 3 * tcb->m_segmentSize;
+          if (m_isPipeFilled)
+            {
+              cWnd = std::min (cWnd + acked, target);
+            }
+          else if (cWnd < target || rc.m_delivered < tcb->m_initialCWnd * tcb->m_segmentSize)
+            {
+              cWnd = cWnd + acked;
+            }
+          cWnd = std::max (cWnd, m_minPipeCwnd * tcb->m_segmentSize);
+        }
+    }
+
+  if (m_mode == BBR_PROBE_RTT)
+    {
+      cWnd = std::min (cWnd, m_minPipeCwnd * tcb->m_segmentSize);
+    }
+  tcb->m_cWnd = cWnd;
+}
+
+inline void
+TcpBbr::CongControl (Ptr<TcpSocketState> tcb,
+                     const TcpRateOps::TcpRateConnection &rc,
+                     const TcpRateOps::TcpRateSample &rs)
+{
+  if (!m_isInitialized)
+    {
+      Init (tcb);
+    }
+  UpdateBtlBw (rc, rs);
+  UpdateCyclePhase (tcb, rs);
+  CheckFullPipe (rs);
+  CheckDrain (tcb);
+  UpdateRtProp (tcb, rc, rs);
+  SetPacingRate (tcb, m_pacingGain);
+  SetCwnd (tcb, rc, rs);
+}
+
+inline void
+TcpBbr::CongestionStateSet (Ptr<TcpSocketState> tcb,
+                            const TcpSocketState::TcpCongState_t newState)
+{
+  NS_UNUSED (tcb);
+  if (newState == TcpSocketState::CA_LOSS)
+    {
+      // An RTO ends the round trip, and the estimate of a full pipe
+      m_prevCaState = TcpSocketState::CA_LOSS;
+      m_fullBandwidth = 0;
+      m_roundStart = true;
+    }
+}
+
+inline void
+TcpBbr::CwndEvent (Ptr<TcpSocketState> tcb,
+                   const TcpSocketState::TcpCAEvent_t event)
+{
+  if (event == TcpSocketState::CA_EVENT_TX_START && m_isInitialized)
+    {
+      // Restart after idle: no PROBE_RTT on a stale RTprop before a
+      // delivery, and no probing above the estimate
+      m_idleRestart = true;
+      if (m_mode == BBR_PROBE_BW)
+        {
+          SetPacingRate (tcb, 1);
+        }
+    }
+}
+
+inline uint32_t
+TcpBbr::GetSsThresh (Ptr<const TcpSocketState> tcb, uint32_t bytesInFlight)
+{
+  NS_UNUSED (bytesInFlight);
+  // BBR does not use ssThresh: the cwnd is restored after the recovery
+  SaveCwnd (tcb);
+  return tcb->m_ssThresh;
+}
+
+inline void
+TcpBbr::IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
+{
+  NS_UNUSED (tcb);
+  NS_UNUSED (segmentsAcked);
+}
+
+inline void
+TcpBbr::UpdatePacingRate (Ptr<TcpSocketState> tcb)
+{
+  // Set by CongControl
+  NS_UNUSED (tcb);
+}
+
+} // namespace ns3
+
+#endif /* TCP_BBR_H */
@@ -19,7 +19,9 @@
 #ifndef TCPCONGESTIONOPS_H
 #define TCPCONGESTIONOPS_H
 
+#include <algorithm>
 #include "ns3/tcp-socket-state.h"
+#include "ns3/tcp-rate-ops.h"
 
 namespace ns3 {
 
@@ -154,6 +156,70 @@ public:
     NS_UNUSED (tcb);
     NS_UNUSED (event);
   }
+  /**
+   * \brief Returns true when Congestion Control Algorithm implements CongControl
+   *
+   * \return true if CC implements CongControl function
+   *
+   * This function is the equivalent in C++ of the C checks that are used
+   * for asserting the existence of a function in Linux.
+   */
+  virtual bool HasCongControl () const
+  {
+    return false;
+  }
+
+  /**
+   * \brief Called when packets are delivered to update cwnd and pacing rate
+   *
+   * This function mimics the function cong_control in Linux. It is called
+   * once per ACK, with the delivery rate sample of the ACK, instead of
+   * IncreaseWindow and UpdatePacingRate when HasCongControl returns true.
+   *
+   * \param tcb internal congestion state
+   * \param rc the connection rate information
+   * \param rs the rate sample of the ACK
+   */
+  virtual void CongControl (Ptr<TcpSocketState> tcb,
+                            const TcpRateOps::TcpRateConnection &rc,
+                            const TcpRateOps::TcpRateSample &rs)
+  {
+    NS_UNUSED (tcb);
+    NS_UNUSED (rc);
+    NS_UNUSED (rs);
+  }
+
+  /**
+   * \brief Set the pacing rate of the socket
+   *
+   * This function mimics tcp_update_pacing_rate in Linux. It is called on
+   * each ACK, after IncreaseWindow, when pacing is enabled; the socket
+   * sends at m_currentPacingRate. The default implementation paces the
+   * larger of cWnd and the bytes in flight over the last RTT, scaled by
+   * m_pacingSsRatio in slow start (so that the window can double in one
+   * RTT) and by m_pacingCaRatio otherwise, up to m_maxPacingRate if set. Rate
+   * based algorithms override it to set their own rate.
+   *
+   * \param tcb internal congestion state
+   */
+  virtual void UpdatePacingRate (Ptr<TcpSocketState> tcb)
+  {
+    if (tcb->m_lastRtt.Get ().IsZero ())
+      {
+        return;
+      }
+    uint64_t ratio = tcb->m_cWnd < tcb->m_ssThresh / 2 ? tcb->m_pacingSsRatio
+                                                       : tcb->m_pacingCaRatio;
+    uint64_t bytes = std::max (tcb->m_cWnd.Get (), tcb->m_bytesInFlight.Get ());
+    DataRate rate (static_cast<uint64_t> (bytes * 8 * ratio / 100
+                                          / tcb->m_lastRtt.Get ().GetSeconds ()));
+    if (tcb->m_maxPacingRate.GetBitRate () > 0 && rate > tcb->m_maxPacingRate)
+      {
+        rate = tcb->m_maxPacingRate;
+      }
+    tcb->m_currentPacingRate = rate;
+  }
+
   // Present in Linux but not in ns-3 yet:
   /* call when ack arrives (optional) */
   // void (*in_ack_event)(struct sock *sk, u32 flags);
@@ -0,0 +1,295 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_DCTCP_H
+#define TCP_DCTCP_H
+
+#include <algorithm>
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/sequence-number.h"
+#include "ns3/double.h"
+#include "ns3/traced-callback.h"
+
+/**
+ * \file
+ * \ingroup congestionOps
+ * ns3::TcpDctcp declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief An implementation of DCTCP (RFC 8257)
+ *
+ * The switches mark CE the packets which find more than K packets in the
+ * queue (see RedQueueDisc::SetStepMarking), and the receiver echoes each
+ * mark on its ACKs (TcpSocketBase::DctcpEcn). Once per window of data,
+ * the sender updates the fraction of the bytes marked:
+ *
+ *   alpha = (1 - g) * alpha + g * F
+ *
+ * F being the fraction of the bytes ACKed with ECE in the window, and on
+ * the first ECE of a window reduces the cwnd in proportion to it:
+ *
+ *   cwnd = cwnd * (1 - alpha / 2)
+ *
+ * instead of halving it. The window grows as in NewReno. A loss halves
+ * the window, as in NewReno (RFC 8257, section 3.5): on a fast
+ * retransmit, the socket enters CA_RECOVERY before asking for the
+ * ssThresh; on a retransmission timeout, it asks first, and the
+ * CA_EVENT_LOSS which follows replaces the reduction by alpha with the
+ * halving, as the Linux implementation does.
+ */
+class TcpDctcp : public TcpNewReno
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Constructor
+   */
+  TcpDctcp ();
+
+  /**
+   * \brief Copy constructor.
+   * \param sock object to copy.
+   */
+  TcpDctcp (const TcpDctcp &sock);
+
+  virtual ~TcpDctcp ();
+
+  virtual std::string GetName () const;
+  virtual uint32_t GetSsThresh (Ptr<const TcpSocketState> tcb,
+                                uint32_t bytesInFlight);
+  virtual void PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked,
+                          const Time &rtt);
+  virtual void CongestionStateSet (Ptr<TcpSocketState> tcb,
+                                   const TcpSocketState::TcpCongState_t newState);
+  virtual void CwndEvent (Ptr<TcpSocketState> tcb,
+                          const TcpSocketState::TcpCAEvent_t event);
+  virtual Ptr<TcpCongestionOps> Fork ();
+
+  /**
+   * \return the current estimate of the fraction of the bytes marked
+   */
+  double GetAlpha (void) const;
+
+  /**
+   * TracedCallback signature for the update of alpha
+   * \param [in] bytesAcked bytes ACKed in the window
+   * \param [in] bytesMarked bytes ACKed with ECE in the window
+   * \param [in] alpha the new value of alpha
+   */
+  typedef void (* CongestionEstimateTracedCallback)(uint32_t bytesAcked,
+                                                    uint32_t bytesMarked,
+                                                    double alpha);
+
+private:
+  /**
+   * \brief Update alpha from the bytes ACKed in the window, and start
+   * a new window
+   * \param tcb the socket state
+   */
+  void UpdateAlpha (Ptr<const TcpSocketState> tcb);
+
+  double m_g;                         //!< Estimation gain
+  double m_alpha;                     //!< Estimate of the fraction of the bytes marked
+  uint32_t m_ackedBytesEcn;           //!< Bytes ACKed with ECE in the window
+  uint32_t m_ackedBytesTotal;         //!< Bytes ACKed in the window
+  SequenceNumber32 m_nextSeq;         //!< End of the window
+  bool m_nextSeqFlag;                 //!< Was m_nextSeq set?
+  bool m_lossReaction;                //!< Is GetSsThresh called for a loss?
+  bool m_alphaReduced;                //!< Did the last GetSsThresh reduce by alpha?
+  uint32_t m_priorBytesInFlight;      //!< Bytes in flight at the last GetSsThresh
+  TracedCallback<uint32_t, uint32_t, double> m_traceCongestionEstimate; //!< Update of alpha
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline TypeId
+TcpDctcp::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpDctcp")
+    .SetParent<TcpNewReno> ()
+    .AddConstructor<TcpDctcp> ()
+    .SetGroupName ("Internet")
+    .AddAttribute ("DctcpShiftG",
+                   "Gain g of the estimate of the fraction of the bytes marked",
+                   DoubleValue (0.0625),
+                   MakeDoubleAccessor (&TcpDctcp::m_g),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddAttribute ("DctcpAlphaOnInit",
+                   "Initial value of alpha",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&TcpDctcp::m_alpha),
+                   MakeDoubleChecker<double> (0, 1))
+    .AddTraceSource ("CongestionEstimate",
+                     "Update of the estimate of the fraction of the bytes marked",
+                     MakeTraceSourceAccessor (&TcpDctcp::m_traceCongestionEstimate),
+                     "ns3::TcpDctcp::CongestionEstimateTracedCallback")
+  ;
+  return tid;
+}
+
+inline
+TcpDctcp::TcpDctcp ()
+  : TcpNewReno (),
+    m_g (0.0625),
+    m_alpha (1.0),
+    m_ackedBytesEcn (0),
+    m_ackedBytesTotal (0),
+    m_nextSeq (0),
+    m_nextSeqFlag (false),
+    m_lossReaction (false),
+    m_alphaReduced (false),
+    m_priorBytesInFlight (0)
+{
+}
+
+inline
+TcpDctcp::TcpDctcp (const TcpDctcp &sock)
+  : TcpNewReno (sock),
+    m_g (sock.m_g),
+    m_alpha (sock.m_alpha),
+    m_ackedBytesEcn (sock.m_ackedBytesEcn),
+    m_ackedBytesTotal (sock.m_ackedBytesTotal),
+    m_nextSeq (sock.m_nextSeq),
+    m_nextSeqFlag (sock.m_nextSeqFlag),
+    m_lossReaction (sock.m_lossReaction),
+    m_alphaReduced (sock.m_alphaReduced),
+    m_priorBytesInFlight (sock.m_priorBytesInFlight)
+{
+}
+
+inline
+TcpDctcp::~TcpDctcp ()
+{
+}
+
+inline std::string
+TcpDctcp::GetName () const
+{
+  return "TcpDctcp";
+}
+
+inline Ptr<TcpCongestionOps>
+TcpDctcp::Fork (void)
+{
+  return CopyObject<TcpDctcp> (this);
+}
+
+inline double
+TcpDctcp::GetAlpha (void) const
+{
+  return m_alpha;
+}
+
+inline void
+TcpDctcp::UpdateAlpha (Ptr<const TcpSocketState> tcb)
+{
+  double fraction = 0;
+  if (m_ackedBytesTotal > 0)
+    {
+      fraction = static_cast<double> (m_ackedBytesEcn) / m_ackedBytesTotal;
+    }
+  m_alpha = (1.0 - m_g) * m_alpha + m_g * fraction;
+  m_traceCongestionEstimate (m_ackedBytesTotal, m_ackedBytesEcn, m_alpha);
+  m_ackedBytesEcn = 0;
+  m_ackedBytesTotal = 0;
+  m_nextSeq = tcb->m_nextTxSequence;
+  m_nextSeqFlag = true;
+}
+
+inline void
+TcpDctcp::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked,
+                     const Time &rtt)
+{
+  NS_UNUSED (rtt);
+  m_alphaReduced = false;
+  uint32_t bytesAcked = segmentsAcked * tcb->m_segmentSize;
+  m_ackedBytesTotal += bytesAcked;
+  if (tcb->m_ecnState == TcpSocketState::ECN_ECE_RCVD)
+    {
+      m_ackedBytesEcn += bytesAcked;
+    }
+  if (!m_nextSeqFlag)
+    {
+      // First ACK: the window ends with the data in flight
+      m_nextSeq = tcb->m_nextTxSequence;
+      m_nextSeqFlag = true;
+    }
+  if (tcb->m_lastAckedSeq >= m_nextSeq)
+    {
+      UpdateAlpha (tcb);
+    }
+}
+
+inline void
+TcpDctcp::CongestionStateSet (Ptr<TcpSocketState> tcb,
+                              const TcpSocketState::TcpCongState_t newState)
+{
+  NS_UNUSED (tcb);
+  // The socket asks for the ssThresh on entering the state: on a loss,
+  // the window is halved; on an ECN echo (CA_CWR), it is reduced by alpha
+  m_lossReaction = newState == TcpSocketState::CA_RECOVERY
+    || newState == TcpSocketState::CA_LOSS;
+  m_alphaReduced = false;
+}
+
+inline void
+TcpDctcp::CwndEvent (Ptr<TcpSocketState> tcb,
+                     const TcpSocketState::TcpCAEvent_t event)
+{
+  // A retransmission timeout asks for the ssThresh before the event: undo
+  // the reduction by alpha, the cwnd being already one segment.
+  if (event == TcpSocketState::CA_EVENT_LOSS && m_alphaReduced)
+    {
+      tcb->m_ssThresh = TcpNewReno::GetSsThresh (tcb, m_priorBytesInFlight);
+    }
+  m_alphaReduced = false;
+}
+
+inline uint32_t
+TcpDctcp::GetSsThresh (Ptr<const TcpSocketState> tcb,
+                       uint32_t bytesInFlight)
+{
+  if (m_lossReaction)
+    {
+      return TcpNewReno::GetSsThresh (tcb, bytesInFlight);
+    }
+  m_alphaReduced = true;
+  m_priorBytesInFlight = bytesInFlight;
+  uint32_t cWnd = tcb->m_cWnd;
+  uint32_t reduced = static_cast<uint32_t> ((1.0 - m_alpha / 2.0) * cWnd);
+  return std::max (reduced, 2 * tcb->m_segmentSize);
+}
+
+} // namespace ns3
+
+#endif /* TCP_DCTCP_H */
@@ -29,6 +29,7 @@
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
 #include "ns3/sequence-number.h"
+#include "ns3/fixed-size-header.h"
 
 namespace ns3 {
 
@@ -314,6 +315,27 @@ public:
    */
   friend bool operator== (const TcpHeader &lhs, const TcpHeader &rhs);
 
+  /** Size of a header without options, for Packet::AddHeader. */
+  static const uint32_t FIXED_SIZE = 20;
+  /**
+   * Serialize the header, without options, for Packet::AddHeader.
+   *
+   * \param [out] buffer The FIXED_SIZE bytes to write.
+   * \param [in] size The size of the packet.
+   * \returns false if the header has options or the checksum must be
+   *          calculated.
+   */
+  bool SerializeFixed (uint8_t *buffer, uint32_t size) const;
+  /**
+   * Deserialize a header without options, for Packet::RemoveHeader.
+   *
+   * \param [in] buffer The FIXED_SIZE bytes to read.
+   * \param [in] size The size of the packet.
+   * \returns FIXED_SIZE, or 0 if the header has options or the checksum
+   *          must be verified.
+   */
+  uint32_t DeserializeFixed (uint8_t const *buffer, uint32_t size);
+
 private:
   /**
    * \brief Calculate the header checksum
@@ -355,4 +377,55 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline bool
+TcpHeader::SerializeFixed (uint8_t *buffer, uint32_t size) const
+{
+  NS_UNUSED (size);
+  if (m_length != FIXED_SIZE / 4 || m_optionsLen != 0 || m_calcChecksum)
+    {
+      return false;
+    }
+  FixedSizeHeader::WriteHtonU16 (buffer, m_sourcePort);
+  FixedSizeHeader::WriteHtonU16 (buffer + 2, m_destinationPort);
+  FixedSizeHeader::WriteHtonU32 (buffer + 4, m_sequenceNumber.GetValue ());
+  FixedSizeHeader::WriteHtonU32 (buffer + 8, m_ackNumber.GetValue ());
+  FixedSizeHeader::WriteHtonU16 (buffer + 12, m_length << 12 | m_flags); //reserved bits are all zero
+  FixedSizeHeader::WriteHtonU16 (buffer + 14, m_windowSize);
+  buffer[16] = 0;
+  buffer[17] = 0;
+  FixedSizeHeader::WriteHtonU16 (buffer + 18, m_urgentPointer);
+  return true;
+}
+
+inline uint32_t
+TcpHeader::DeserializeFixed (uint8_t const *buffer, uint32_t size)
+{
+  NS_UNUSED (size);
+  uint16_t field = FixedSizeHeader::ReadNtohU16 (buffer + 12);
+  if ((field >> 12) != FIXED_SIZE / 4 || m_calcChecksum)
+    {
+      return 0;
+    }
+  m_sourcePort = FixedSizeHeader::ReadNtohU16 (buffer);
+  m_destinationPort = FixedSizeHeader::ReadNtohU16 (buffer + 2);
+  m_sequenceNumber = SequenceNumber32 (FixedSizeHeader::ReadNtohU32 (buffer + 4));
+  m_ackNumber = SequenceNumber32 (FixedSizeHeader::ReadNtohU32 (buffer + 8));
+  m_flags = field & 0xFF;
+  m_length = field >> 12;
+  m_windowSize = FixedSizeHeader::ReadNtohU16 (buffer + 14);
+  m_urgentPointer = FixedSizeHeader::ReadNtohU16 (buffer + 18);
+  m_options.clear ();
+  m_optionsLen = 0;
+  return FIXED_SIZE;
+}
+
+} // namespace ns3
+
 #endif /* TCP_HEADER */
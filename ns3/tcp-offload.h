@@ -0,0 +1,409 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_OFFLOAD_H
+#define TCP_OFFLOAD_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <list>
+#include <vector>
+#include "ns3/packet.h"
+#include "ns3/packet-offload.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
+
+/**
+ * \file
+ * \ingroup tcp
+ * ns3::TcpOffload and ns3::TcpReceiveOffload declarations and inline
+ * implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief TCP segmentation offload (TSO/GSO) over IPv4.
+ *
+ * With TcpSocketBase::SetTsoMaxSegments, a socket sends up to that many
+ * segments as one IPv4 packet tagged with a GsoTag, which goes through
+ * Ipv4L3Protocol, the traffic control layer and the device queue as a
+ * single packet. The NetDevice splits it with Segment() when it is
+ * about to put it on the wire, or sends it whole on a channel which
+ * carries super-segments, so that a bulk flow generates one event chain
+ * per super-segment instead of one per segment.
+ *
+ * Register() plugs Segment() and the TcpReceiveOffload aggregator in
+ * PacketOffload; TcpL4Protocol calls it once.
+ */
+class TcpOffload
+{
+public:
+  /** Register the TCP offloads in PacketOffload. */
+  static void Register (void);
+  /**
+   * \brief Split a TCP/IPv4 super-segment into segments.
+   *
+   * Each segment has a copy of the IPv4 and TCP headers, with its own
+   * IP identification, total length and TCP sequence number; FIN and
+   * PSH are kept on the last segment only, CWR on the first one only.
+   * The checksums are calculated when Node::ChecksumEnabled() is set.
+   *
+   * \param packet the super-segment, starting with its IPv4 header
+   * \param [out] segments the segments
+   * \returns false if the packet is not a TCP/IPv4 super-segment
+   */
+  static bool Segment (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &segments);
+};
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Generic receive offload (GRO) for TCP over IPv4.
+ *
+ * Merges the in-sequence data segments of a flow, received by the same
+ * NetDevice, into one packet carrying a GsoTag, as Linux does in
+ * tcp_gro_receive: the segments must have the same IP TOS and TTL, no
+ * IP options and no fragmentation, the same ACK number and TCP options,
+ * and only the ACK flag besides PSH. A flow is flushed when a segment
+ * cannot be merged, carries PSH, is shorter than the first one, or the
+ * packet would exceed GetMaxSize(); and in any case FlushTimeout after
+ * its first segment, as with gro_flush_timeout. Packets of other
+ * protocols go through unchanged.
+ */
+class TcpReceiveOffload : public ReceiveOffload
+{
+public:
+  TcpReceiveOffload ();
+  virtual ~TcpReceiveOffload ();
+
+  /**
+   * \param timeout the longest time a segment is held
+   */
+  void SetFlushTimeout (Time timeout);
+  /**
+   * \param size the maximum size of a merged IP packet
+   */
+  void SetMaxSize (uint32_t size);
+  /**
+   * \returns the maximum size of a merged IP packet
+   */
+  uint32_t GetMaxSize (void) const;
+  /**
+   * \returns the number of segments merged into a previous one
+   */
+  uint64_t GetMergedSegments (void) const;
+
+  virtual void Receive (Ptr<Packet> packet, uint16_t protocol, const Address &from);
+  virtual void Flush (void);
+
+private:
+  /// A flow with held segments.
+  struct Flow
+  {
+    Ptr<Packet> first;       //!< The first segment, as received
+    Ptr<Packet> payload;     //!< The payload of the merged segments
+    Ipv4Header ipHeader;     //!< IPv4 header of the first segment
+    TcpHeader tcpHeader;     //!< TCP header of the first segment
+    std::vector<uint8_t> options; //!< Raw TCP options of the first segment
+    uint16_t protocol;       //!< Protocol number
+    Address from;            //!< Sender
+    uint32_t segmentSize;    //!< Payload size of the first segment
+    uint32_t segments;       //!< Number of segments merged
+  };
+
+  /**
+   * \brief Deliver the packet of a flow.
+   * \param flow the flow
+   */
+  void FlushFlow (Flow &flow);
+
+  std::list<Flow> m_flows;     //!< Flows with held segments, oldest first
+  Time m_flushTimeout;         //!< Longest time a segment is held
+  uint32_t m_maxSize;          //!< Maximum size of a merged packet
+  uint32_t m_maxFlows;         //!< Maximum number of flows held
+  uint64_t m_merged;           //!< Number of segments merged
+  EventId m_flushEvent;        //!< Flush of the flows held
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+/**
+ * \returns a new TcpReceiveOffload, for PacketOffload.
+ */
+inline Ptr<ReceiveOffload>
+CreateTcpReceiveOffload (void)
+{
+  return Create<TcpReceiveOffload> ();
+}
+
+inline void
+TcpOffload::Register (void)
+{
+  PacketOffload::RegisterSegmenter (0x0800, MakeCallback (&TcpOffload::Segment));
+  PacketOffload::RegisterReceiveOffload (MakeCallback (&CreateTcpReceiveOffload));
+}
+
+inline bool
+TcpOffload::Segment (Ptr<const Packet> packet, std::vector<Ptr<Packet> > &segments)
+{
+  GsoTag tag;
+  Ptr<Packet> p = packet->Copy ();
+  if (!p->RemovePacketTag (tag) || tag.GetSegmentSize () == 0)
+    {
+      return false;
+    }
+  Ipv4Header ipHeader;
+  p->RemoveHeader (ipHeader);
+  if (ipHeader.GetProtocol () != 6)
+    {
+      return false;
+    }
+  TcpHeader tcpHeader;
+  p->RemoveHeader (tcpHeader);
+  bool checksum = Node::ChecksumEnabled ();
+  uint32_t size = p->GetSize ();
+  uint32_t segmentSize = tag.GetSegmentSize ();
+  uint16_t id = ipHeader.GetIdentification ();
+  uint32_t offset = 0;
+  do
+    {
+      uint32_t length = std::min (segmentSize, size - offset);
+      Ptr<Packet> segment = p->CreateFragment (offset, length);
+      TcpHeader header = tcpHeader;
+      header.SetSequenceNumber (tcpHeader.GetSequenceNumber () + offset);
+      uint8_t flags = tcpHeader.GetFlags ();
+      if (offset + length < size)
+        {
+          flags &= ~(TcpHeader::FIN | TcpHeader::PSH);
+        }
+      if (offset > 0)
+        {
+          flags &= ~TcpHeader::CWR;
+        }
+      header.SetFlags (flags);
+      if (checksum)
+        {
+          header.EnableChecksums ();
+          header.InitializeChecksum (ipHeader.GetSource (), ipHeader.GetDestination (), 6);
+        }
+      segment->AddHeader (header);
+      Ipv4Header ip = ipHeader;
+      ip.SetPayloadSize (segment->GetSize ());
+      ip.SetIdentification (id++);
+      if (checksum)
+        {
+          ip.EnableChecksum ();
+        }
+      segment->AddHeader (ip);
+      segments.push_back (segment);
+      offset += length;
+    }
+  while (offset < size);
+  return true;
+}
+
+inline
+TcpReceiveOffload::TcpReceiveOffload ()
+  : m_flushTimeout (MicroSeconds (20)),
+    m_maxSize (65535),
+    m_maxFlows (8),
+    m_merged (0)
+{
+}
+
+inline
+TcpReceiveOffload::~TcpReceiveOffload ()
+{
+  m_flushEvent.Cancel ();
+}
+
+inline void
+TcpReceiveOffload::SetFlushTimeout (Time timeout)
+{
+  m_flushTimeout = timeout;
+}
+
+inline void
+TcpReceiveOffload::SetMaxSize (uint32_t size)
+{
+  m_maxSize = size;
+}
+
+inline uint32_t
+TcpReceiveOffload::GetMaxSize (void) const
+{
+  return m_maxSize;
+}
+
+inline uint64_t
+TcpReceiveOffload::GetMergedSegments (void) const
+{
+  return m_merged;
+}
+
+inline void
+TcpReceiveOffload::Receive (Ptr<Packet> packet, uint16_t protocol, const Address &from)
+{
+  if (protocol != 0x0800)
+    {
+      Deliver (packet, protocol, from);
+      return;
+    }
+  Ptr<Packet> p = packet->Copy ();
+  Ipv4Header ipHeader;
+  if (p->GetSize () < 40 || p->RemoveHeader (ipHeader) != 20
+      || ipHeader.GetProtocol () != 6 || !ipHeader.IsLastFragment ()
+      || ipHeader.GetFragmentOffset () != 0)
+    {
+      Deliver (packet, protocol, from);
+      return;
+    }
+  TcpHeader tcpHeader;
+  uint32_t tcpSize = p->RemoveHeader (tcpHeader);
+  std::vector<uint8_t> options (tcpSize - 20);
+  if (!options.empty ())
+    {
+      std::vector<uint8_t> raw (20 + tcpSize);
+      packet->CopyData (&raw[0], raw.size ());
+      std::copy (raw.begin () + 40, raw.end (), options.begin ());
+    }
+  uint32_t length = p->GetSize ();
+  uint8_t flags = tcpHeader.GetFlags ();
+  bool mergeable = length > 0 && (flags & ~TcpHeader::PSH) == TcpHeader::ACK;
+
+  std::list<Flow>::iterator flow = m_flows.begin ();
+  for (; flow != m_flows.end (); ++flow)
+    {
+      if (flow->ipHeader.GetSource () == ipHeader.GetSource ()
+          && flow->ipHeader.GetDestination () == ipHeader.GetDestination ()
+          && flow->tcpHeader.GetSourcePort () == tcpHeader.GetSourcePort ()
+          && flow->tcpHeader.GetDestinationPort () == tcpHeader.GetDestinationPort ())
+        {
+          break;
+        }
+    }
+  if (flow != m_flows.end ())
+    {
+      uint32_t held = flow->payload->GetSize ();
+      if (mergeable
+          && tcpHeader.GetSequenceNumber () == flow->tcpHeader.GetSequenceNumber () + held
+          && tcpHeader.GetAckNumber () == flow->tcpHeader.GetAckNumber ()
+          && ipHeader.GetTos () == flow->ipHeader.GetTos ()
+          && ipHeader.GetTtl () == flow->ipHeader.GetTtl ()
+          && options == flow->options
+          && length <= flow->segmentSize
+          && 20 + tcpSize + held + length <= m_maxSize)
+        {
+          flow->payload->AddAtEnd (p);
+          flow->segments++;
+          m_merged++;
+          if ((flags & TcpHeader::PSH) || length < flow->segmentSize)
+            {
+              flow->tcpHeader.SetFlags (flow->tcpHeader.GetFlags () | (flags & TcpHeader::PSH));
+              Flow done = *flow;
+              m_flows.erase (flow);
+              FlushFlow (done);
+            }
+          return;
+        }
+      // Out of sequence or different: the segments held go first.
+      Flow done = *flow;
+      m_flows.erase (flow);
+      FlushFlow (done);
+    }
+  if (!mergeable || (flags & TcpHeader::PSH))
+    {
+      Deliver (packet, protocol, from);
+      return;
+    }
+  if (m_flows.size () >= m_maxFlows)
+    {
+      Flow oldest = m_flows.front ();
+      m_flows.pop_front ();
+      FlushFlow (oldest);
+    }
+  Flow held;
+  held.first = packet;
+  held.payload = p;
+  held.ipHeader = ipHeader;
+  held.tcpHeader = tcpHeader;
+  held.options.swap (options);
+  held.protocol = protocol;
+  held.from = from;
+  held.segmentSize = length;
+  held.segments = 1;
+  m_flows.push_back (held);
+  if (!m_flushEvent.IsRunning ())
+    {
+      m_flushEvent = Simulator::Schedule (m_flushTimeout, &TcpReceiveOffload::Flush, this);
+    }
+}
+
+inline void
+TcpReceiveOffload::FlushFlow (Flow &flow)
+{
+  if (flow.segments == 1)
+    {
+      Deliver (flow.first, flow.protocol, flow.from);
+      return;
+    }
+  Ptr<Packet> packet = flow.payload;
+  bool checksum = Node::ChecksumEnabled ();
+  if (checksum)
+    {
+      flow.tcpHeader.EnableChecksums ();
+      flow.tcpHeader.InitializeChecksum (flow.ipHeader.GetSource (), flow.ipHeader.GetDestination (), 6);
+    }
+  packet->AddHeader (flow.tcpHeader);
+  flow.ipHeader.SetPayloadSize (packet->GetSize ());
+  if (checksum)
+    {
+      flow.ipHeader.EnableChecksum ();
+    }
+  packet->AddHeader (flow.ipHeader);
+  // A router forwarding the merged packet segments it again.
+  packet->AddPacketTag (GsoTag (flow.segmentSize));
+  Deliver (packet, flow.protocol, flow.from);
+}
+
+inline void
+TcpReceiveOffload::Flush (void)
+{
+  m_flushEvent.Cancel ();
+  while (!m_flows.empty ())
+    {
+      // Pop first: delivering may reenter Receive.
+      Flow flow = m_flows.front ();
+      m_flows.pop_front ();
+      FlushFlow (flow);
+    }
+}
+
+} // namespace ns3
+
+#endif /* TCP_OFFLOAD_H */
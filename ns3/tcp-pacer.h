@@ -0,0 +1,290 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_PACER_H
+#define TCP_PACER_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/simulator.h"
+
+/**
+ * \file
+ * \ingroup tcp
+ * ns3::TcpPacer declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Release timer shared by the paced sockets of a node
+ *
+ * A paced socket which has used its budget asks the pacer to call it back
+ * at the time of its next segment, instead of scheduling an event of its
+ * own. The pacer keeps the release times of all the sockets of the node
+ * and a single simulator event, at the earliest of them. As the high
+ * resolution timers of Linux with a slack, when the event expires it
+ * releases every socket due within the slack, so the sockets paced at
+ * close times share one event and a socket sends the segments of a whole
+ * slack at once: at 100 Gbps, a 10 us slack releases about 80 segments of
+ * 1500 bytes per event, instead of one event per segment.
+ *
+ * The pacer of a node is aggregated to it and shared by its sockets
+ * (GetPacer). Subclasses can override Schedule and Cancel to model other
+ * release disciplines, e.g. a fair queue across the flows.
+ */
+class TcpPacer : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  TcpPacer ();
+  virtual ~TcpPacer ();
+
+  /**
+   * \brief Get the pacer of a node, aggregating a new one on first use
+   * \param node the node
+   * \return the pacer
+   */
+  static Ptr<TcpPacer> GetPacer (Ptr<Node> node);
+
+  /**
+   * \brief Set the slack of the releases
+   * \param slack the time by which a release may be early
+   */
+  void SetSlack (Time slack);
+  /**
+   * \brief Get the slack of the releases
+   * \return the time by which a release may be early
+   */
+  Time GetSlack (void) const;
+
+  /**
+   * \brief Schedule the release of a socket
+   *
+   * Replaces the pending release of the same owner, if any.
+   *
+   * \param owner the socket, as identity of the release
+   * \param when the absolute time of the release
+   * \param release the callback of the release
+   */
+  virtual void Schedule (const void *owner, Time when, Callback<void> release);
+  /**
+   * \brief Cancel the pending release of a socket, if any
+   * \param owner the socket
+   */
+  virtual void Cancel (const void *owner);
+
+  /**
+   * \return the number of pending releases
+   */
+  uint32_t GetPending (void) const;
+  /**
+   * \return the number of timer expirations since the creation
+   */
+  uint64_t GetExpirations (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// Release times, earliest first
+  typedef std::multimap<Time, const void *> ReleaseQueue;
+  /// Pending release of an owner
+  typedef std::pair<ReleaseQueue::iterator, Callback<void> > Pending;
+
+  /**
+   * \brief Release the sockets due, and re-arm the timer
+   */
+  void Expire (void);
+  /**
+   * \brief Schedule the timer at the earliest release
+   */
+  void Rearm (void);
+
+  Time m_slack;                               //!< Time by which a release may be early
+  ReleaseQueue m_queue;                       //!< Release times
+  std::map<const void *, Pending> m_pending;  //!< Pending release of each owner
+  EventId m_timer;                            //!< The timer
+  uint64_t m_expirations;                     //!< Number of timer expirations
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline TypeId
+TcpPacer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpPacer")
+    .SetParent<Object> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<TcpPacer> ()
+    .AddAttribute ("Slack",
+                   "Time by which a release may be early; the releases due "
+                   "within it share one timer expiration",
+                   TimeValue (MicroSeconds (10)),
+                   MakeTimeAccessor (&TcpPacer::SetSlack,
+                                     &TcpPacer::GetSlack),
+                   MakeTimeChecker (Time (0)))
+  ;
+  return tid;
+}
+
+inline
+TcpPacer::TcpPacer ()
+  : m_slack (MicroSeconds (10)),
+    m_expirations (0)
+{
+}
+
+inline
+TcpPacer::~TcpPacer ()
+{
+}
+
+inline void
+TcpPacer::DoDispose (void)
+{
+  m_timer.Cancel ();
+  m_queue.clear ();
+  m_pending.clear ();
+  Object::DoDispose ();
+}
+
+inline Ptr<TcpPacer>
+TcpPacer::GetPacer (Ptr<Node> node)
+{
+  Ptr<TcpPacer> pacer = node->GetObject<TcpPacer> ();
+  if (pacer == 0)
+    {
+      pacer = CreateObject<TcpPacer> ();
+      node->AggregateObject (pacer);
+    }
+  return pacer;
+}
+
+inline void
+TcpPacer::SetSlack (Time slack)
+{
+  m_slack = slack;
+}
+
+inline Time
+TcpPacer::GetSlack (void) const
+{
+  return m_slack;
+}
+
+inline uint32_t
+TcpPacer::GetPending (void) const
+{
+  return m_pending.size ();
+}
+
+inline uint64_t
+TcpPacer::GetExpirations (void) const
+{
+  return m_expirations;
+}
+
+inline void
+TcpPacer::Schedule (const void *owner, Time when, Callback<void> release)
+{
+  std::map<const void *, Pending>::iterator i = m_pending.find (owner);
+  if (i != m_pending.end ())
+    {
+      m_queue.erase (i->second.first);
+      m_pending.erase (i);
+    }
+  ReleaseQueue::iterator q = m_queue.insert (std::make_pair (when, owner));
+  m_pending.insert (std::make_pair (owner, Pending (q, release)));
+  Rearm ();
+}
+
+inline void
+TcpPacer::Cancel (const void *owner)
+{
+  std::map<const void *, Pending>::iterator i = m_pending.find (owner);
+  if (i == m_pending.end ())
+    {
+      return;
+    }
+  m_queue.erase (i->second.first);
+  m_pending.erase (i);
+  // The timer is left armed: an expiration with nothing due re-arms it
+}
+
+inline void
+TcpPacer::Rearm (void)
+{
+  if (m_queue.empty ())
+    {
+      m_timer.Cancel ();
+      return;
+    }
+  Time earliest = std::max (m_queue.begin ()->first, Simulator::Now ());
+  if (m_timer.IsRunning ()
+      && Time (m_timer.GetTs ()) <= earliest)
+    {
+      // The pending expiration is not later than the earliest release
+      return;
+    }
+  m_timer.Cancel ();
+  m_timer = Simulator::Schedule (earliest - Simulator::Now (), &TcpPacer::Expire, this);
+}
+
+inline void
+TcpPacer::Expire (void)
+{
+  m_expirations++;
+  Time limit = Simulator::Now () + m_slack;
+  std::vector<Callback<void> > due;
+  while (!m_queue.empty () && m_queue.begin ()->first <= limit)
+    {
+      std::map<const void *, Pending>::iterator i = m_pending.find (m_queue.begin ()->second);
+      due.push_back (i->second.second);
+      m_pending.erase (i);
+      m_queue.erase (m_queue.begin ());
+    }
+  // The released sockets may schedule again
+  for (std::vector<Callback<void> >::iterator i = due.begin (); i != due.end (); ++i)
+    {
+      (*i) ();
+    }
+  Rearm ();
+}
+
+} // namespace ns3
+
+#endif /* TCP_PACER_H */
@@ -0,0 +1,410 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_RATE_OPS_H
+#define TCP_RATE_OPS_H
+
+#include <algorithm>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/simulator.h"
+#include "ns3/sequence-number.h"
+#include "ns3/traced-callback.h"
+#include "ns3/tcp-tx-item.h"
+
+/**
+ * \file
+ * \ingroup tcp
+ * ns3::TcpRateOps and ns3::TcpRateLinux declarations and inline
+ * implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Interface for the delivery rate estimation of a TCP connection
+ *
+ * The estimator follows draft-cheng-iccrg-delivery-rate-estimation: each
+ * segment records, when it is sent, how much data the connection had
+ * delivered and when (TcpTxItem::RateInformation); when it is ACKed or
+ * SACKed, the data delivered since, over the time elapsed, is a sample
+ * of the delivery rate. The socket calls SkbSent for each transmission,
+ * SkbDelivered for each segment newly ACKed or SACKed, and
+ * GenerateSample once per ACK; the sample goes to
+ * TcpCongestionOps::CongControl.
+ */
+class TcpRateOps : public Object
+{
+public:
+  /**
+   * \brief Rate sample, generated once per ACK
+   */
+  struct TcpRateSample
+  {
+    DataRate m_deliveryRate   {DataRate ("0bps")}; //!< The delivery rate sample
+    bool m_isAppLimited       {false};             //!< Indicates whether the rate sample is application-limited
+    Time m_interval           {Seconds (0.0)};     //!< The length of the sampling interval
+    int32_t m_delivered       {0};                 //!< The amount of data marked as delivered over the sampling interval, -1 if invalid
+    uint64_t m_priorDelivered {0};                 //!< The delivered count of the most recent packet delivered
+    Time m_priorTime          {Seconds (0.0)};     //!< The delivered time of the most recent packet delivered
+    Time m_sendElapsed        {Seconds (0.0)};     //!< Send time interval calculated from the most recent packet delivered
+    Time m_ackElapsed         {Seconds (0.0)};     //!< ACK time interval calculated from the most recent packet delivered
+    uint32_t m_bytesLoss      {0};                 //!< The amount of data marked as lost by the ACK
+    uint32_t m_priorInFlight  {0};                 //!< The amount of data in flight before the ACK
+    uint32_t m_ackedSacked    {0};                 //!< The amount of data newly ACKed or SACKed by the ACK
+
+    /**
+     * \brief Is the sample valid?
+     * \return true if the sample is valid, false otherwise.
+     */
+    bool IsValid () const
+    {
+      return (m_priorTime != Seconds (0.0) || m_interval != Seconds (0.0));
+    }
+  };
+
+  /**
+   * \brief Information about the connection rate
+   */
+  struct TcpRateConnection
+  {
+    uint64_t m_delivered        {0};               //!< The total amount of data in bytes delivered so far
+    Time m_deliveredTime        {Seconds (0.0)};   //!< Simulator time when m_delivered was last updated
+    Time m_firstSentTime        {Seconds (0.0)};   //!< The send time of the packet that was most recently marked as delivered
+    uint64_t m_appLimited       {0};               //!< The index of the last transmitted packet marked as application-limited
+    DataRate m_rateDelivered    {DataRate ("0bps")}; //!< Delivery rate of the last non app-limited sample, or of the highest one
+    Time m_rateInterval         {Seconds (0.0)};   //!< Interval of m_rateDelivered
+    bool m_rateAppLimited       {false};           //!< Was m_rateDelivered app-limited?
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual ~TcpRateOps ();
+
+  /**
+   * \brief Record the connection state in a segment being sent
+   *
+   * \param skb the segment
+   * \param isStartOfTransmission true if no data is in flight
+   */
+  virtual void SkbSent (TcpTxItem *skb, bool isStartOfTransmission) = 0;
+
+  /**
+   * \brief Update the rate sample with a segment newly ACKed or SACKed
+   *
+   * \param skb the segment
+   */
+  virtual void SkbDelivered (TcpTxItem *skb) = 0;
+
+  /**
+   * \brief Mark the connection as application limited, if it is
+   *
+   * The connection is application limited when the application has no
+   * data to send, the window is not full and no lost segment waits for
+   * a retransmission; the samples taken until the data sent now is
+   * delivered can then underestimate the rate.
+   *
+   * \param cWnd the congestion window
+   * \param inFlight the bytes in flight
+   * \param segmentSize the segment size
+   * \param tailSeq the tail of the transmission buffer
+   * \param nextTx the next sequence to transmit
+   * \param lostOut the lost bytes
+   * \param retransOut the retransmitted bytes
+   */
+  virtual void CalculateAppLimited (uint32_t cWnd, uint32_t inFlight,
+                                    uint32_t segmentSize,
+                                    const SequenceNumber32 &tailSeq,
+                                    const SequenceNumber32 &nextTx,
+                                    uint32_t lostOut, uint32_t retransOut) = 0;
+
+  /**
+   * \brief Generate the rate sample of an ACK
+   *
+   * \param delivered the bytes newly ACKed or SACKed
+   * \param lost the bytes newly marked lost
+   * \param isSackReneg true if the receiver reneged on its SACKs
+   * \param priorInFlight the bytes in flight before the ACK
+   * \param minRtt the minimum RTT observed
+   * \return the rate sample
+   */
+  virtual const TcpRateSample & GenerateSample (uint32_t delivered, uint32_t lost,
+                                                bool isSackReneg, uint32_t priorInFlight,
+                                                const Time &minRtt) = 0;
+
+  /**
+   * \return the information about the connection rate
+   */
+  virtual const TcpRateConnection & GetConnectionRate (void) = 0;
+
+  /**
+   * TracedCallback signature for rate sample updates
+   * \param [in] sample the rate sample
+   */
+  typedef void (* TcpRateSampleUpdated)(const TcpRateSample &sample);
+
+  /**
+   * TracedCallback signature for connection rate updates
+   * \param [in] rate the connection rate
+   */
+  typedef void (* TcpRateUpdated)(const TcpRateConnection &rate);
+};
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Delivery rate estimation of Linux (net/ipv4/tcp_rate.c)
+ */
+class TcpRateLinux : public TcpRateOps
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual ~TcpRateLinux ();
+
+  virtual void SkbSent (TcpTxItem *skb, bool isStartOfTransmission);
+  virtual void SkbDelivered (TcpTxItem *skb);
+  virtual void CalculateAppLimited (uint32_t cWnd, uint32_t inFlight,
+                                    uint32_t segmentSize,
+                                    const SequenceNumber32 &tailSeq,
+                                    const SequenceNumber32 &nextTx,
+                                    uint32_t lostOut, uint32_t retransOut);
+  virtual const TcpRateSample & GenerateSample (uint32_t delivered, uint32_t lost,
+                                                bool isSackReneg, uint32_t priorInFlight,
+                                                const Time &minRtt);
+  virtual const TcpRateConnection & GetConnectionRate (void);
+
+private:
+  /**
+   * \brief Start the sample of a new ACK, if the last one was generated
+   */
+  void StartSample (void);
+
+  TcpRateConnection m_rate;         //!< Rate information
+  TcpRateSample m_rateSample;       //!< Rate sample of the current ACK
+  bool m_sampleGenerated {false};   //!< Was m_rateSample returned by GenerateSample?
+
+  TracedCallback<const TcpRateConnection &> m_rateTrace;        //!< Rate trace
+  TracedCallback<const TcpRateSample &> m_rateSampleTrace;      //!< Rate sample trace
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline TypeId
+TcpRateOps::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpRateOps")
+    .SetParent<Object> ()
+    .SetGroupName ("Internet")
+  ;
+  return tid;
+}
+
+inline
+TcpRateOps::~TcpRateOps ()
+{
+}
+
+inline TypeId
+TcpRateLinux::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpRateLinux")
+    .SetParent<TcpRateOps> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<TcpRateLinux> ()
+    .AddTraceSource ("TcpRateUpdated",
+                     "Tcp rate information has been updated",
+                     MakeTraceSourceAccessor (&TcpRateLinux::m_rateTrace),
+                     "ns3::TcpRateOps::TcpRateUpdated")
+    .AddTraceSource ("TcpRateSampleUpdated",
+                     "Tcp rate sample has been updated",
+                     MakeTraceSourceAccessor (&TcpRateLinux::m_rateSampleTrace),
+                     "ns3::TcpRateOps::TcpRateSampleUpdated")
+  ;
+  return tid;
+}
+
+inline
+TcpRateLinux::~TcpRateLinux ()
+{
+}
+
+inline void
+TcpRateLinux::StartSample (void)
+{
+  if (m_sampleGenerated)
+    {
+      m_rateSample = TcpRateSample ();
+      m_sampleGenerated = false;
+    }
+}
+
+inline void
+TcpRateLinux::SkbSent (TcpTxItem *skb, bool isStartOfTransmission)
+{
+  if (isStartOfTransmission)
+    {
+      // Nothing in flight: the sending interval starts now, not at the
+      // last delivery, which could be long ago
+      m_rate.m_firstSentTime = Simulator::Now ();
+      m_rate.m_deliveredTime = Simulator::Now ();
+      m_rateTrace (m_rate);
+    }
+
+  skb->m_rateInfo.m_firstSent = m_rate.m_firstSentTime;
+  skb->m_rateInfo.m_deliveredTime = m_rate.m_deliveredTime;
+  skb->m_rateInfo.m_isAppLimited = (m_rate.m_appLimited != 0);
+  skb->m_rateInfo.m_delivered = m_rate.m_delivered;
+}
+
+inline void
+TcpRateLinux::SkbDelivered (TcpTxItem *skb)
+{
+  StartSample ();
+  TcpTxItem::RateInformation &info = skb->m_rateInfo;
+  if (info.m_deliveredTime == Time::Max ())
+    {
+      // Already delivered, e.g. SACKed before being ACKed
+      return;
+    }
+
+  m_rate.m_delivered += skb->GetSeqSize ();
+  m_rate.m_deliveredTime = Simulator::Now ();
+
+  // The sample is taken from the most recently sent segment delivered
+  if (m_rateSample.m_priorDelivered == 0
+      || info.m_delivered > m_rateSample.m_priorDelivered)
+    {
+      m_rateSample.m_priorDelivered = info.m_delivered;
+      m_rateSample.m_priorTime = info.m_deliveredTime;
+      m_rateSample.m_isAppLimited = info.m_isAppLimited;
+      m_rateSample.m_sendElapsed = skb->m_lastSent - info.m_firstSent;
+      m_rateSample.m_ackElapsed = Simulator::Now () - info.m_deliveredTime;
+      m_rate.m_firstSentTime = skb->m_lastSent;
+    }
+
+  // Mark the segment as delivered once
+  info.m_deliveredTime = Time::Max ();
+  m_rateTrace (m_rate);
+}
+
+inline void
+TcpRateLinux::CalculateAppLimited (uint32_t cWnd, uint32_t inFlight,
+                                   uint32_t segmentSize,
+                                   const SequenceNumber32 &tailSeq,
+                                   const SequenceNumber32 &nextTx,
+                                   uint32_t lostOut, uint32_t retransOut)
+{
+  if (tailSeq - nextTx < static_cast<int32_t> (segmentSize)  // Not a full segment to send
+      && inFlight < cWnd                                    // Window not full
+      && lostOut <= retransOut)                             // No lost segment to retransmit
+    {
+      m_rate.m_appLimited = std::max<uint64_t> (m_rate.m_delivered + inFlight, 1);
+      m_rateTrace (m_rate);
+    }
+}
+
+inline const TcpRateOps::TcpRateSample &
+TcpRateLinux::GenerateSample (uint32_t delivered, uint32_t lost, bool isSackReneg,
+                              uint32_t priorInFlight, const Time &minRtt)
+{
+  StartSample ();
+  m_sampleGenerated = true;
+
+  // The connection is no longer application limited once the data sent
+  // while it was has been delivered
+  if (m_rate.m_appLimited != 0 && m_rate.m_delivered > m_rate.m_appLimited)
+    {
+      m_rate.m_appLimited = 0;
+    }
+
+  m_rateSample.m_ackedSacked = delivered;
+  m_rateSample.m_bytesLoss = lost;
+  m_rateSample.m_priorInFlight = priorInFlight;
+
+  if (m_rateSample.m_priorTime == Seconds (0.0) || isSackReneg)
+    {
+      // No segment sent with rate information was delivered
+      m_rateSample.m_delivered = -1;
+      m_rateSample.m_interval = Seconds (0.0);
+      m_rateSampleTrace (m_rateSample);
+      return m_rateSample;
+    }
+
+  m_rateSample.m_delivered = static_cast<int32_t> (m_rate.m_delivered - m_rateSample.m_priorDelivered);
+
+  // The ACKs can be compressed, or the sends bursty: the longer of the
+  // two intervals does not overestimate the rate
+  m_rateSample.m_interval = std::max (m_rateSample.m_sendElapsed, m_rateSample.m_ackElapsed);
+
+  // An interval shorter than the minimum RTT comes from a spurious
+  // retransmission or ACK decimation: the sample is dropped
+  if (m_rateSample.m_interval < minRtt)
+    {
+      m_rateSample.m_interval = Seconds (0.0);
+      m_rateSample.m_priorTime = Seconds (0.0);
+      m_rateSampleTrace (m_rateSample);
+      return m_rateSample;
+    }
+
+  if (!m_rateSample.m_interval.IsZero ())
+    {
+      m_rateSample.m_deliveryRate = DataRate (static_cast<uint64_t> (
+        m_rateSample.m_delivered * 8.0 / m_rateSample.m_interval.GetSeconds ()));
+    }
+
+  // Keep the last sample which is not application limited, or the
+  // highest rate if all are
+  if (!m_rateSample.m_isAppLimited
+      || m_rateSample.m_deliveryRate >= m_rate.m_rateDelivered)
+    {
+      m_rate.m_rateDelivered = m_rateSample.m_deliveryRate;
+      m_rate.m_rateInterval = m_rateSample.m_interval;
+      m_rate.m_rateAppLimited = m_rateSample.m_isAppLimited;
+      m_rateTrace (m_rate);
+    }
+
+  m_rateSampleTrace (m_rateSample);
+  return m_rateSample;
+}
+
+inline const TcpRateOps::TcpRateConnection &
+TcpRateLinux::GetConnectionRate (void)
+{
+  return m_rate;
+}
+
+} // namespace ns3
+
+#endif /* TCP_RATE_OPS_H */
@@ -22,12 +22,14 @@
 #define TCP_RX_BUFFER_H
 
 #include <map>
+#include "ns3/assert.h"
 #include "ns3/traced-value.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/sequence-number.h"
 #include "ns3/ptr.h"
 #include "ns3/tcp-header.h"
 #include "ns3/tcp-option-sack.h"
+#include "ns3/tcp-rx-ring-buffer.h"
 
 namespace ns3 {
 class Packet;
@@ -67,6 +69,17 @@ class Packet;
  * For more information about the SACK list, please check the documentation of
  * the method GetSackList.
  *
+ * Ring buffer mode
+ * ----------------
+ *
+ * By default, each segment is kept as a packet in a map, and the packets
+ * are merged by Extract. In ring buffer mode (SetRingBufferMode), the
+ * bytes are copied into a TcpRxRingBuffer as large as the window, whose
+ * interval set gives the holes and the SACK blocks: no allocation is made
+ * per segment, which keeps Add and Extract cheap with large windows and
+ * heavy reordering. The packets given to the application are then built
+ * from the bytes, so the tags of the received packets are not delivered.
+ *
  * \see GetSackList
  * \see UpdateSackList
  */
@@ -181,6 +194,23 @@ public:
    */
   bool GotFin () const { return m_gotFin; }
 
+  /**
+   * \brief Store the data in a TcpRxRingBuffer instead of a map of packets
+   *
+   * Must be set while the buffer is empty. Add, Extract, Size, Available,
+   * NextRxSequence and GetSackList (see tcp-rx-buffer.cc) switch to
+   * m_ring in this mode.
+   *
+   * \param enable true to enable the ring buffer mode
+   */
+  void SetRingBufferMode (bool enable);
+
+  /**
+   * \brief Says if the data is stored in a TcpRxRingBuffer
+   * \return true in ring buffer mode
+   */
+  bool IsRingBufferMode (void) const;
+
 private:
   /**
    * \brief Update the sack list, with the block seq starting at the beginning
@@ -226,8 +256,37 @@ private:
   uint32_t m_maxBuffer;                      //!< Upper bound of the number of data bytes in buffer (RCV.WND)
   uint32_t m_availBytes;                     //!< Number of bytes available to read, i.e. contiguous block at head
   std::map<SequenceNumber32, Ptr<Packet> > m_data; //!< Corresponding data (may be null)
+  bool m_ringBufferMode {false};             //!< Is the data stored in m_ring?
+  TcpRxRingBuffer m_ring;                    //!< Data in ring buffer mode
 };
 
 } //namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+TcpRxBuffer::SetRingBufferMode (bool enable)
+{
+  NS_ASSERT_MSG (m_size == 0, "TcpRxBuffer mode changed with data in the buffer");
+  m_ringBufferMode = enable;
+  if (enable)
+    {
+      m_ring.Reset (m_nextRxSeq);
+      m_ring.SetCapacity (m_maxBuffer);
+    }
+}
+
+inline bool
+TcpRxBuffer::IsRingBufferMode (void) const
+{
+  return m_ringBufferMode;
+}
+
+} //namespace ns3
+
 #endif /* TCP_RX_BUFFER_H */
@@ -0,0 +1,401 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_RX_RING_BUFFER_H
+#define TCP_RX_RING_BUFFER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/sequence-number.h"
+#include "ns3/tcp-option-sack.h"
+
+/**
+ * \file
+ * \ingroup tcp
+ * ns3::TcpRxRingBuffer declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Byte ring and interval set storage of the receive window
+ *
+ * The bytes of the window [Head, Head + capacity) are stored at a fixed
+ * place of a ring allocated once, whatever the order in which they arrive;
+ * the blocks received above the first missing byte are kept in a sorted
+ * vector of disjoint intervals. A segment is therefore added with a copy
+ * of its bytes and an update of the interval set, and data is extracted
+ * with one copy, without a container node per segment: heavy reordering
+ * costs O(log h) per segment, h being the number of holes, plus a move of
+ * the intervals above the segment.
+ *
+ * The bytes are copied out of the packets: the packets given to the
+ * application are new packets, without the tags of the received ones.
+ */
+class TcpRxRingBuffer
+{
+public:
+  /**
+   * \brief Constructor
+   * \param head sequence number of the first byte to receive
+   */
+  TcpRxRingBuffer (const SequenceNumber32 &head = SequenceNumber32 (0));
+
+  /**
+   * \brief Drop all the data and restart from a sequence number
+   * \param head sequence number of the first byte to receive
+   */
+  void Reset (const SequenceNumber32 &head);
+  /**
+   * \brief Set the size of the window
+   *
+   * The ring grows, keeping its data; it never shrinks below the
+   * data it holds.
+   *
+   * \param capacity the number of bytes of the window
+   */
+  void SetCapacity (uint32_t capacity);
+  /**
+   * \returns the number of bytes of the window
+   */
+  uint32_t GetCapacity (void) const;
+
+  /**
+   * \returns the sequence number of the first byte not extracted
+   */
+  SequenceNumber32 Head (void) const;
+  /**
+   * \returns the sequence number of the first missing byte (RCV.NXT)
+   */
+  SequenceNumber32 NextRxSequence (void) const;
+  /**
+   * \returns the number of bytes stored, not necessarily contiguous
+   */
+  uint32_t Size (void) const;
+  /**
+   * \returns the number of contiguous bytes from Head
+   */
+  uint32_t Available (void) const;
+  /**
+   * \returns the number of blocks received above NextRxSequence
+   */
+  uint32_t GetBlockCount (void) const;
+
+  /**
+   * \brief Store a segment
+   *
+   * The bytes before NextRxSequence or beyond the window are dropped.
+   *
+   * \param p the payload of the segment
+   * \param seq the sequence number of its first byte
+   * \returns the number of bytes not stored before
+   */
+  uint32_t Add (Ptr<const Packet> p, const SequenceNumber32 &seq);
+  /**
+   * \brief Extract contiguous data from Head
+   *
+   * \param maxSize the maximum number of bytes to extract
+   * \returns a packet with the data, or 0 if none is available
+   */
+  Ptr<Packet> Extract (uint32_t maxSize);
+  /**
+   * \brief Get the SACK blocks of the data above NextRxSequence
+   *
+   * The first block is the one which contains the last segment added
+   * out of order, as RFC 2018 requires; the other ones follow from the
+   * highest.
+   *
+   * \param maxBlocks the maximum number of blocks
+   * \returns the blocks
+   */
+  TcpOptionSack::SackList GetSackList (uint32_t maxBlocks = 4) const;
+
+private:
+  /// An interval [first, second) of received bytes
+  typedef std::pair<SequenceNumber32, SequenceNumber32> Block;
+
+  /**
+   * \param block a block
+   * \param seq a sequence number
+   * \returns true if the block ends before seq
+   */
+  static bool EndsBefore (const Block &block, const SequenceNumber32 &seq);
+  /**
+   * \brief Copy bytes into the ring
+   * \param seq sequence number of the first byte
+   * \param data the bytes
+   * \param size the number of bytes
+   */
+  void Write (const SequenceNumber32 &seq, const uint8_t *data, uint32_t size);
+  /**
+   * \brief Copy bytes out of the ring
+   * \param seq sequence number of the first byte
+   * \param data the destination
+   * \param size the number of bytes
+   */
+  void Read (const SequenceNumber32 &seq, uint8_t *data, uint32_t size) const;
+
+  std::vector<uint8_t> m_ring;    //!< The bytes of the window
+  uint32_t m_headIndex;           //!< Index in m_ring of the byte m_head
+  SequenceNumber32 m_head;        //!< First byte not extracted
+  SequenceNumber32 m_nextRxSeq;   //!< First missing byte
+  uint32_t m_size;                //!< Number of bytes stored
+  std::vector<Block> m_blocks;    //!< Sorted disjoint blocks above m_nextRxSeq
+  SequenceNumber32 m_lastBlock;   //!< Start of the block of the last out of order segment
+  std::vector<uint8_t> m_scratch; //!< Copy space for the packets
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+TcpRxRingBuffer::TcpRxRingBuffer (const SequenceNumber32 &head)
+  : m_headIndex (0),
+    m_head (head),
+    m_nextRxSeq (head),
+    m_size (0),
+    m_lastBlock (head)
+{
+}
+
+inline void
+TcpRxRingBuffer::Reset (const SequenceNumber32 &head)
+{
+  m_headIndex = 0;
+  m_head = head;
+  m_nextRxSeq = head;
+  m_size = 0;
+  m_blocks.clear ();
+  m_lastBlock = head;
+}
+
+inline void
+TcpRxRingBuffer::SetCapacity (uint32_t capacity)
+{
+  uint32_t used = m_blocks.empty () ? Available ()
+    : static_cast<uint32_t> (m_blocks.back ().second - m_head);
+  capacity = std::max (capacity, used);
+  if (capacity <= m_ring.size ())
+    {
+      return;
+    }
+  // Linearize from the head into the new ring
+  std::vector<uint8_t> ring (capacity);
+  if (used > 0)
+    {
+      Read (m_head, &ring[0], used);
+    }
+  m_ring.swap (ring);
+  m_headIndex = 0;
+}
+
+inline uint32_t
+TcpRxRingBuffer::GetCapacity (void) const
+{
+  return m_ring.size ();
+}
+
+inline SequenceNumber32
+TcpRxRingBuffer::Head (void) const
+{
+  return m_head;
+}
+
+inline SequenceNumber32
+TcpRxRingBuffer::NextRxSequence (void) const
+{
+  return m_nextRxSeq;
+}
+
+inline uint32_t
+TcpRxRingBuffer::Size (void) const
+{
+  return m_size;
+}
+
+inline uint32_t
+TcpRxRingBuffer::Available (void) const
+{
+  return m_nextRxSeq - m_head;
+}
+
+inline uint32_t
+TcpRxRingBuffer::GetBlockCount (void) const
+{
+  return m_blocks.size ();
+}
+
+inline bool
+TcpRxRingBuffer::EndsBefore (const Block &block, const SequenceNumber32 &seq)
+{
+  return block.second < seq;
+}
+
+inline void
+TcpRxRingBuffer::Write (const SequenceNumber32 &seq, const uint8_t *data, uint32_t size)
+{
+  uint32_t index = (m_headIndex + static_cast<uint32_t> (seq - m_head)) % m_ring.size ();
+  uint32_t first = std::min<uint32_t> (size, m_ring.size () - index);
+  std::memcpy (&m_ring[index], data, first);
+  if (first < size)
+    {
+      std::memcpy (&m_ring[0], data + first, size - first);
+    }
+}
+
+inline void
+TcpRxRingBuffer::Read (const SequenceNumber32 &seq, uint8_t *data, uint32_t size) const
+{
+  uint32_t index = (m_headIndex + static_cast<uint32_t> (seq - m_head)) % m_ring.size ();
+  uint32_t first = std::min<uint32_t> (size, m_ring.size () - index);
+  std::memcpy (data, &m_ring[index], first);
+  if (first < size)
+    {
+      std::memcpy (data + first, &m_ring[0], size - first);
+    }
+}
+
+inline uint32_t
+TcpRxRingBuffer::Add (Ptr<const Packet> p, const SequenceNumber32 &seq)
+{
+  SequenceNumber32 start = seq;
+  SequenceNumber32 end = seq + p->GetSize ();
+  SequenceNumber32 windowEnd = m_head + m_ring.size ();
+  if (start < m_nextRxSeq)
+    {
+      start = m_nextRxSeq;
+    }
+  if (end > windowEnd)
+    {
+      end = windowEnd;
+    }
+  if (end <= start)
+    {
+      return 0;
+    }
+
+  uint32_t offset = start - seq;
+  uint32_t size = end - start;
+  if (m_scratch.size () < offset + size)
+    {
+      m_scratch.resize (offset + size);
+    }
+  p->CopyData (&m_scratch[0], offset + size);
+  Write (start, &m_scratch[offset], size);
+
+  // The blocks which overlap or touch [start, end) are merged with it
+  std::vector<Block>::iterator first = std::lower_bound (m_blocks.begin (), m_blocks.end (),
+                                                         start, &TcpRxRingBuffer::EndsBefore);
+  std::vector<Block>::iterator last = first;
+  uint32_t added = size;
+  Block merged (start, end);
+  for (; last != m_blocks.end () && last->first <= end; ++last)
+    {
+      SequenceNumber32 overlapStart = std::max (start, last->first);
+      SequenceNumber32 overlapEnd = std::min (end, last->second);
+      if (overlapStart < overlapEnd)
+        {
+          added -= overlapEnd - overlapStart;
+        }
+      merged.first = std::min (merged.first, last->first);
+      merged.second = std::max (merged.second, last->second);
+    }
+  m_size += added;
+
+  if (merged.first == m_nextRxSeq)
+    {
+      // In order: the merged block is at the front of the set
+      m_nextRxSeq = merged.second;
+      m_blocks.erase (first, last);
+    }
+  else
+    {
+      first = m_blocks.erase (first, last);
+      m_blocks.insert (first, merged);
+      m_lastBlock = merged.first;
+    }
+  return added;
+}
+
+inline Ptr<Packet>
+TcpRxRingBuffer::Extract (uint32_t maxSize)
+{
+  uint32_t size = std::min (maxSize, Available ());
+  if (size == 0)
+    {
+      return 0;
+    }
+  Ptr<Packet> p;
+  if (m_headIndex + size <= m_ring.size ())
+    {
+      p = Create<Packet> (&m_ring[m_headIndex], size);
+    }
+  else
+    {
+      if (m_scratch.size () < size)
+        {
+          m_scratch.resize (size);
+        }
+      Read (m_head, &m_scratch[0], size);
+      p = Create<Packet> (&m_scratch[0], size);
+    }
+  m_head += size;
+  m_headIndex = (m_headIndex + size) % m_ring.size ();
+  m_size -= size;
+  return p;
+}
+
+inline TcpOptionSack::SackList
+TcpRxRingBuffer::GetSackList (uint32_t maxBlocks) const
+{
+  TcpOptionSack::SackList list;
+  std::vector<Block>::const_iterator recent = std::lower_bound (m_blocks.begin (), m_blocks.end (),
+                                                                m_lastBlock + 1, &TcpRxRingBuffer::EndsBefore);
+  if (recent != m_blocks.end () && m_lastBlock < recent->first)
+    {
+      // The block was delivered in order since
+      recent = m_blocks.end ();
+    }
+  if (recent != m_blocks.end () && maxBlocks > 0)
+    {
+      list.push_back (*recent);
+    }
+  for (std::vector<Block>::const_reverse_iterator it = m_blocks.rbegin ();
+       it != m_blocks.rend () && list.size () < maxBlocks; ++it)
+    {
+      if (it.base () - 1 != recent)
+        {
+          list.push_back (*it);
+        }
+    }
+  return list;
+}
+
+} // namespace ns3
+
+#endif /* TCP_RX_RING_BUFFER_H */
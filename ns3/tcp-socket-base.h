@@ -43,6 +43,8 @@ class TcpL4Protocol;
 class TcpHeader;
 class TcpCongestionOps;
 class TcpRecoveryOps;
+class TcpRateOps;
+class TcpPacer;
 class RttEstimator;
 class TcpRxBuffer;
 class TcpTxBuffer;
@@ -316,6 +318,43 @@ public:
    */
   uint32_t GetRetxThresh (void) const { return m_retxThresh; }
 
+  /**
+   * \brief Set the maximum number of segments sent as one super-segment
+   *
+   * With n greater than one, SendDataPacket sends up to n segments of
+   * data as one packet carrying a GsoTag (TCP segmentation offload, see
+   * TcpOffload); the NetDevice splits it, or not on a channel which
+   * carries super-segments. The default, one, disables the offload.
+   * The super-segments are built by SendDataPacket (see
+   * tcp-socket-base.cc), and split with the segmenter that
+   * TcpOffload::Register installs.
+   *
+   * \param n the maximum number of segments
+   */
+  void SetTsoMaxSegments (uint32_t n) { m_tsoMaxSegments = n; }
+
+  /**
+   * \brief Get the maximum number of segments sent as one super-segment
+   * \return the maximum number of segments
+   */
+  uint32_t GetTsoMaxSegments (void) const { return m_tsoMaxSegments; }
+
+  /**
+   * \brief Set the pacer which releases the paced sends
+   *
+   * By default, the socket uses the pacer shared by the sockets of its
+   * node (TcpPacer::GetPacer).
+   *
+   * \param pacer the pacer
+   */
+  void SetPacer (Ptr<TcpPacer> pacer);
+
+  /**
+   * \brief Get the pacer which releases the paced sends
+   * \return the pacer, or 0 if none is used yet
+   */
+  Ptr<TcpPacer> GetPacer (void) const;
+
   /**
    * \brief Callback pointer for cWnd trace chaining
    */
@@ -440,6 +479,16 @@ public:
    */
   void SetRecoveryAlgorithm (Ptr<TcpRecoveryOps> recovery);
 
+  /**
+   * \brief Get the delivery rate estimator of this socket
+   *
+   * The estimator is always updated; its samples go to
+   * TcpCongestionOps::CongControl when the congestion control implements it.
+   *
+   * \return the rate estimator
+   */
+  Ptr<TcpRateOps> GetRateOps (void) const;
+
   /**
    * \brief Mark ECT(0)
    *
@@ -486,7 +535,8 @@ public:
   typedef enum
     {
       NoEcn = 0,   //!< ECN is not enabled.
-      ClassicEcn   //!< ECN functionality as described in RFC 3168.
+      ClassicEcn,  //!< ECN functionality as described in RFC 3168.
+      DctcpEcn     //!< ECN functionality as described in RFC 8257 (DCTCP).
     } EcnMode_t;
 
   /**
@@ -532,7 +582,16 @@ public:
   /**
    * \brief Set ECN mode to use on the socket
    *
-   * \param ecnMode Mode of ECN. Currently NoEcn and ClassicEcn is supported.
+   * In DctcpEcn mode, the negotiation is the one of RFC 3168, but the
+   * receiver sets ECE on the ACKs of the CE marked segments only, without
+   * waiting for a CWR, and the sender reports each ECE to the congestion
+   * control (ECN_ECE_RCVD for the ACK) instead of halving the cwnd, so that
+   * TcpDctcp can estimate the fraction of the bytes marked.
+   *
+   * The UseEcn attribute takes the same modes, once DctcpEcn is listed in
+   * its EnumChecker (see tcp-socket-base.cc); until then, call SetEcn.
+   *
+   * \param ecnMode Mode of ECN: NoEcn, ClassicEcn or DctcpEcn.
    */
   void SetEcn (EcnMode_t ecnMode);
 
@@ -550,6 +609,7 @@ public:
   virtual int ShutdownRecv (void);    // Assert the m_shutdownRecv flag to prevent forward to app
   virtual int Send (Ptr<Packet> p, uint32_t flags);  // Call by app to send data to network
   virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress); // Same as Send(), toAddress is insignificant
+  virtual int SendBatch (const std::vector<Ptr<Packet> > &packets, uint32_t flags); // Same as Send(), one state check and one SendPendingData for the batch
   virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags); // Return a packet to be forwarded to app
   virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress); // ... and write the remote address at fromAddress
   virtual uint32_t GetTxAvailable (void) const; // Available Tx buffer size
@@ -569,6 +629,11 @@ public:
                                          const Ptr<const TcpSocketBase> socket);
 
 protected:
+  /**
+   * \brief Cancel the pending paced release of the socket, if any
+   */
+  virtual void DoDispose (void);
+
   // Implementing ns3::TcpSocket -- Attribute get/set
   // inherited, no need to doc
 
@@ -1020,6 +1085,19 @@ protected:
    */
   virtual void DelAckTimeout (void);
 
+  /**
+   * \brief Update the CE state of the DCTCP receiver with a data segment
+   *
+   * When the CE mark of the segments changes while an ACK is delayed, the
+   * ACK of the segments received before is sent at once, with the ECE of
+   * the previous state, so that the sender counts the marked bytes exactly
+   * (RFC 8257, section 3.2). The ACKs then carry ECE as long as the
+   * segments are CE marked.
+   *
+   * \param ce true if the IP header of the segment has CE set
+   */
+  void DctcpUpdateCeState (bool ce);
+
   /**
    * \brief Timeout at LAST_ACK, close the connection
    */
@@ -1162,6 +1240,50 @@ protected:
    */
   void NotifyPacingPerformed (void);
 
+  /**
+   * \brief Check the pacing budget before sending a segment
+   *
+   * Without pacing, always true. Otherwise, true if the next paced send
+   * is due within the slack of the pacer; if not, the pacer is asked to
+   * call PacingRelease at that time.
+   *
+   * \return true if a segment can be sent now
+   */
+  bool PacingCheck (void);
+
+  /**
+   * \brief Account a segment sent with pacing
+   *
+   * Delays the next paced send by the transmission time of the segment
+   * at m_currentPacingRate.
+   *
+   * \param bytes size of the segment
+   */
+  void PacingSent (uint32_t bytes);
+
+  /**
+   * \brief Resume the sends stopped by PacingCheck
+   */
+  void PacingRelease (void);
+
+  /**
+   * \brief Feed an ACK to the delivery rate estimator, and hand the rate
+   * sample to TcpCongestionOps::CongControl if the congestion control
+   * implements it
+   *
+   * Called once per ACK, after the segments it delivers have been passed
+   * to TcpRateOps::SkbDelivered through DiscardUpTo and Update.
+   *
+   * \param delivered the bytes newly ACKed or SACKed
+   * \param lost the bytes newly marked lost
+   * \param isSackReneg true if the receiver reneged on its SACKs
+   * \param priorInFlight the bytes in flight before the ACK
+   * \return true if CongControl ran, in which case IncreaseWindow and
+   * UpdatePacingRate must not be called for this ACK
+   */
+  bool RateAckReceived (uint32_t delivered, uint32_t lost, bool isSackReneg,
+                        uint32_t priorInFlight);
+
   /**
    * \brief Add Tags for the Socket
    * \param p Packet
@@ -1243,6 +1365,7 @@ protected:
   uint32_t m_timestampToEcho  {0};    //!< Timestamp to echo
 
   EventId m_sendPendingDataEvent {}; //!< micro-delay event to send pending data
+  uint32_t m_tsoMaxSegments {1};     //!< Maximum number of segments per super-segment
 
   // Fast Retransmit and Recovery
   SequenceNumber32       m_recover    {0};   //!< Previous highest Tx seqnum for fast recovery (set it to initial seq number)
@@ -1253,6 +1376,7 @@ protected:
   Ptr<TcpSocketState>    m_tcb;               //!< Congestion control information
   Ptr<TcpCongestionOps>  m_congestionControl; //!< Congestion control
   Ptr<TcpRecoveryOps>    m_recoveryOps;       //!< Recovery Algorithm
+  Ptr<TcpRateOps>        m_rateOps;           //!< Rate operations
 
   // Guesses over the other connection end
   bool m_isFirstPartialAck {true}; //!< First partial ACK during RECOVERY
@@ -1266,12 +1390,15 @@ protected:
 
   // Pacing related variable
   Timer m_pacingTimer {Timer::REMOVE_ON_DESTROY}; //!< Pacing Event
+  Ptr<TcpPacer> m_pacer;                          //!< Pacer of the paced sends
+  Time m_pacingNextSend {0};                      //!< Time of the next paced send
 
   // Parameters related to Explicit Congestion Notification
   EcnMode_t                     m_ecnMode    {EcnMode_t::NoEcn};      //!< Socket ECN capability
   TracedValue<SequenceNumber32> m_ecnEchoSeq {0};      //!< Sequence number of the last received ECN Echo
   TracedValue<SequenceNumber32> m_ecnCESeq   {0};      //!< Sequence number of the last received Congestion Experienced
   TracedValue<SequenceNumber32> m_ecnCWRSeq  {0};      //!< Sequence number of the last sent CWR
+  bool                          m_dctcpCeState {false}; //!< DctcpEcn: was the last data segment CE marked?
 };
 
 /**
@@ -1296,4 +1423,177 @@ typedef void (* EcnStatesTracedValueCallback)(const TcpSocketState::EcnState_t o
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+#include "ns3/simulator.h"
+#include "ns3/abort.h"
+#include "ns3/tcp-tx-buffer.h"
+#include "ns3/tcp-pacer.h"
+#include "ns3/tcp-rate-ops.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-congestion-ops.h"
+
+namespace ns3 {
+
+inline int
+TcpSocketBase::SendBatch (const std::vector<Ptr<Packet> > &packets, uint32_t flags)
+{
+  NS_ABORT_MSG_IF (flags, "use of flags is not supported in TcpSocketBase::SendBatch()");
+  if (m_state != ESTABLISHED && m_state != SYN_SENT && m_state != CLOSE_WAIT)
+    { // Connection not established yet
+      m_errno = ERROR_NOTCONN;
+      return -1;
+    }
+  if (m_shutdownSend)
+    {
+      m_errno = ERROR_SHUTDOWN;
+      return -1;
+    }
+  // Store the packets into the Tx buffer, as Send does one at a time
+  int sent = 0;
+  for (std::vector<Ptr<Packet> >::const_iterator i = packets.begin (); i != packets.end (); ++i)
+    {
+      if (!m_txBuffer->Add (*i))
+        { // TxBuffer overflow: the packets accepted so far are sent
+          m_errno = ERROR_MSGSIZE;
+          break;
+        }
+      sent++;
+    }
+  if (sent == 0)
+    {
+      return packets.empty () ? 0 : -1;
+    }
+  // Submit the data to lower layers once for the whole batch
+  if ((m_state == ESTABLISHED || m_state == CLOSE_WAIT) && AvailableWindow () > 0
+      && !m_sendPendingDataEvent.IsRunning ())
+    {
+      m_sendPendingDataEvent = Simulator::Schedule (TimeStep (1),
+                                                    &TcpSocketBase::SendPendingData,
+                                                    this, m_connected);
+    }
+  return sent;
+}
+
+inline Ptr<TcpRateOps>
+TcpSocketBase::GetRateOps (void) const
+{
+  return m_rateOps;
+}
+
+inline bool
+TcpSocketBase::RateAckReceived (uint32_t delivered, uint32_t lost, bool isSackReneg,
+                                uint32_t priorInFlight)
+{
+  if (m_rateOps == 0)
+    {
+      return false;
+    }
+  m_rateOps->CalculateAppLimited (m_tcb->m_cWnd, m_tcb->m_bytesInFlight.Get (),
+                                  m_tcb->m_segmentSize, m_txBuffer->TailSequence (),
+                                  m_tcb->m_nextTxSequence, m_txBuffer->GetLost (),
+                                  m_txBuffer->GetRetransmitsCount ());
+  const TcpRateOps::TcpRateSample &rs =
+    m_rateOps->GenerateSample (delivered, lost, isSackReneg, priorInFlight,
+                               m_tcb->m_minRtt);
+  if (!m_congestionControl->HasCongControl ())
+    {
+      return false;
+    }
+  m_congestionControl->CongControl (m_tcb, m_rateOps->GetConnectionRate (), rs);
+  return true;
+}
+
+inline void
+TcpSocketBase::DctcpUpdateCeState (bool ce)
+{
+  if (ce != m_dctcpCeState && m_delAckCount > 0)
+    {
+      // ACK now the segments of the previous state
+      m_delAckEvent.Cancel ();
+      m_delAckCount = 0;
+      SendEmptyPacket (m_dctcpCeState ? (TcpHeader::ACK | TcpHeader::ECE) : TcpHeader::ACK);
+    }
+  m_dctcpCeState = ce;
+  m_tcb->m_ecnState = ce ? TcpSocketState::ECN_CE_RCVD : TcpSocketState::ECN_IDLE;
+  m_congestionControl->CwndEvent (m_tcb, ce ? TcpSocketState::CA_EVENT_ECN_IS_CE
+                                            : TcpSocketState::CA_EVENT_ECN_NO_CE);
+}
+
+inline void
+TcpSocketBase::SetPacer (Ptr<TcpPacer> pacer)
+{
+  if (m_pacer != 0)
+    {
+      m_pacer->Cancel (this);
+    }
+  m_pacer = pacer;
+}
+
+inline Ptr<TcpPacer>
+TcpSocketBase::GetPacer (void) const
+{
+  return m_pacer;
+}
+
+inline void
+TcpSocketBase::DoDispose (void)
+{
+  if (m_pacer != 0)
+    {
+      m_pacer->Cancel (this);
+      m_pacer = 0;
+    }
+  TcpSocket::DoDispose ();
+}
+
+inline bool
+TcpSocketBase::PacingCheck (void)
+{
+  if (!m_tcb->m_pacing || m_tcb->m_currentPacingRate.GetBitRate () == 0)
+    {
+      return true;
+    }
+  if (m_pacer == 0)
+    {
+      m_pacer = TcpPacer::GetPacer (m_node);
+    }
+  if (m_pacingNextSend <= Simulator::Now () + m_pacer->GetSlack ())
+    {
+      return true;
+    }
+  // The pending release holds a reference, so the socket outlives it
+  m_pacer->Schedule (this, m_pacingNextSend,
+                     MakeCallback (&TcpSocketBase::PacingRelease,
+                                   Ptr<TcpSocketBase> (this)));
+  return false;
+}
+
+inline void
+TcpSocketBase::PacingSent (uint32_t bytes)
+{
+  if (!m_tcb->m_pacing || m_tcb->m_currentPacingRate.GetBitRate () == 0)
+    {
+      return;
+    }
+  // No credit is kept across an idle period
+  Time start = std::max (m_pacingNextSend, Simulator::Now ());
+  m_pacingNextSend = start + m_tcb->m_currentPacingRate.CalculateBytesTxTime (bytes);
+}
+
+inline void
+TcpSocketBase::PacingRelease (void)
+{
+  if (m_state == CLOSED)
+    {
+      return;
+    }
+  SendPendingData (m_connected);
+}
+
+} // namespace ns3
+
 #endif /* TCP_SOCKET_BASE_H */
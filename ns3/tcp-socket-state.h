@@ -92,8 +92,8 @@ public:
     CA_EVENT_CWND_RESTART, /**< congestion window restart. Not triggered */
     CA_EVENT_COMPLETE_CWR, /**< end of congestion recovery */
     CA_EVENT_LOSS,         /**< loss timeout */
-    CA_EVENT_ECN_NO_CE,    /**< ECT set, but not CE marked. Not triggered */
-    CA_EVENT_ECN_IS_CE,    /**< received CE marked IP packet. Not triggered */
+    CA_EVENT_ECN_NO_CE,    /**< ECT set, but not CE marked. Triggered in DctcpEcn mode only */
+    CA_EVENT_ECN_IS_CE,    /**< received CE marked IP packet. Triggered in DctcpEcn mode only */
     CA_EVENT_DELAYED_ACK,  /**< Delayed ack is sent */
     CA_EVENT_NON_DELAYED_ACK, /**< Non-delayed ack is sent */
   } TcpCAEvent_t;
@@ -148,6 +148,8 @@ public:
   bool                   m_pacing            {false}; //!< Pacing status
   DataRate               m_maxPacingRate     {0};    //!< Max Pacing rate
   DataRate               m_currentPacingRate {0};    //!< Current Pacing rate
+  uint16_t               m_pacingSsRatio     {200};  //!< Pacing rate, in percent of cWnd per RTT, in slow start
+  uint16_t               m_pacingCaRatio     {120};  //!< Pacing rate, in percent of cWnd per RTT, in congestion avoidance
 
   Time                   m_minRtt  {Time::Max ()};   //!< Minimum RTT observed throughout the connection
 
@@ -24,45 +24,17 @@
 
 #include "ns3/object.h"
 #include "ns3/traced-value.h"
+#include "ns3/callback.h"
 #include "ns3/sequence-number.h"
 #include "ns3/nstime.h"
 #include "ns3/tcp-option-sack.h"
 #include "ns3/packet.h"
+#include "ns3/tcp-tx-item.h"
+#include "ns3/tcp-tx-scoreboard.h"
 
 namespace ns3 {
 class Packet;
 
-/**
- * \ingroup tcp
- *
- * \brief Item that encloses the application packet and some flags for it
- */
-class TcpTxItem
-{
-public:
-  // Default constructor, copy-constructor, destructor
-
-  /**
-   * \brief Print the time
-   * \param os ostream
-   */
-  void Print (std::ostream &os) const;
-
-  /**
-   * \brief Get the size in the sequence number space
-   *
-   * \return 1 if the packet size is 0 or there's no packet, otherwise the size of the packet
-   */
-  uint32_t GetSeqSize (void) const { return m_packet && m_packet->GetSize () > 0 ? m_packet->GetSize () : 1; }
-
-  SequenceNumber32 m_startSeq {0};     //!< Sequence number of the item (if transmitted)
-  Ptr<Packet> m_packet {nullptr};    //!< Application packet (can be null)
-  bool m_lost          {false};      //!< Indicates if the segment has been lost (RTO)
-  bool m_retrans       {false};      //!< Indicates if the segment is retransmitted
-  Time m_lastSent      {Time::Min()};//!< Timestamp of the time at which the segment has been sent last time
-  bool m_sacked        {false};      //!< Indicates if the segment has been SACKed
-};
-
 /**
  * \ingroup tcp
  *
@@ -146,6 +118,18 @@ public:
  * connection, the TcpSocketImplementation should provide hints through
  * the MarkHeadAsLost and AddRenoSack methods.
  *
+ * Scoreboard mode
+ * ---------------
+ *
+ * With windows of hundreds of thousands of segments, walking the sent list
+ * on every ACK dominates the run time. In scoreboard mode
+ * (SetScoreboardMode), the items of the sent list are also indexed by
+ * sequence number in a TcpTxScoreboard, which answers in O(log n) the
+ * lookups of IsLost, IsLostRFC, Update, NextSeg, UpdateLostCount and of a
+ * retransmission in CopyFromSequence. The list keeps the ownership and the
+ * order of the items. The mode is off by default, and the lookups then
+ * walk the sent list.
+ *
  * \see BytesInFlight
  * \see Size
  * \see SizeFromSequence
@@ -241,6 +225,24 @@ public:
    */
   uint32_t GetSacked (void) const { return m_sackedOut; }
 
+  /**
+   * \brief Index the sent list in a TcpTxScoreboard
+   *
+   * Enabling the mode indexes the items already sent. In this mode, every
+   * insertion, removal, split or merge of an item of the sent list, and
+   * every change of its flags, is reflected in the index (see
+   * tcp-tx-buffer.cc), and the lookups use it.
+   *
+   * \param enable true to enable the scoreboard mode
+   */
+  void SetScoreboardMode (bool enable);
+
+  /**
+   * \brief Says if the sent list is indexed in a TcpTxScoreboard
+   * \return true in scoreboard mode
+   */
+  bool IsScoreboardMode (void) const;
+
   /**
    * \brief Append a data packet to the end of the buffer
    *
@@ -295,6 +297,18 @@ public:
    */
   void DiscardUpTo (const SequenceNumber32& seq);
 
+  /**
+   * \brief Discard data up to but not including this sequence number,
+   * and notify each item before its deletion.
+   *
+   * \param seq The first sequence number to maintain after discarding all the
+   * previous sequences.
+   * \param beforeDelCb Callback invoked, if it is not null, before the deletion
+   * of an item (typically, TcpRateOps::SkbDelivered)
+   */
+  void DiscardUpTo (const SequenceNumber32& seq,
+                    const Callback<void, TcpTxItem *> &beforeDelCb);
+
   /**
    * \brief Update the scoreboard
    * \param list list of SACKed blocks
@@ -302,6 +316,16 @@ public:
    */
   bool Update (const TcpOptionSack::SackList &list);
 
+  /**
+   * \brief Update the scoreboard, and notify each newly SACKed item.
+   * \param list list of SACKed blocks
+   * \param sackedCb Callback invoked, if it is not null, when a segment has been
+   * SACKed by the receiver (typically, TcpRateOps::SkbDelivered)
+   * \returns true in case of an update
+   */
+  bool Update (const TcpOptionSack::SackList &list,
+               const Callback<void, TcpTxItem *> &sackedCb);
+
   /**
    * \brief Check if a segment is lost
    *
@@ -450,6 +474,20 @@ private:
    */
   bool IsLostRFC (const SequenceNumber32 &seq, const PacketList::const_iterator &segment) const;
 
+  /**
+   * \brief IsLost in scoreboard mode
+   * \param seq Sequence
+   * \return true if the segment which contains seq is marked lost
+   */
+  bool IsLostIndexed (const SequenceNumber32 &seq) const;
+
+  /**
+   * \brief IsLostRFC in scoreboard mode
+   * \param seq Sequence
+   * \return true if seq is lost per RFC 6675, false otherwise
+   */
+  bool IsLostRFCIndexed (const SequenceNumber32 &seq) const;
+
   /**
    * \brief Calculate the number of bytes in flight per RFC 6675
    * \return the number of bytes in flight
@@ -616,6 +654,8 @@ private:
   uint32_t m_segmentSize {0}; //!< Segment size from TcpSocketBase
   bool     m_renoSack {false}; //!< Indicates if AddRenoSack was called
 
+  bool     m_scoreboardMode {false}; //!< Is m_sentList indexed in m_scoreboard?
+  TcpTxScoreboard m_scoreboard; //!< Index of the items of m_sentList by sequence number
 };
 
 /**
@@ -636,4 +676,50 @@ std::ostream & operator<< (std::ostream & os, TcpTxItem const & item);
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline void
+TcpTxBuffer::SetScoreboardMode (bool enable)
+{
+  m_scoreboardMode = enable;
+  m_scoreboard.Clear ();
+  if (enable)
+    {
+      for (PacketList::const_iterator it = m_sentList.begin (); it != m_sentList.end (); ++it)
+        {
+          m_scoreboard.Insert (*it);
+        }
+    }
+}
+
+inline bool
+TcpTxBuffer::IsScoreboardMode (void) const
+{
+  return m_scoreboardMode;
+}
+
+inline bool
+TcpTxBuffer::IsLostIndexed (const SequenceNumber32 &seq) const
+{
+  if (seq >= m_highestSack.second)
+    {
+      return false;
+    }
+  const TcpTxItem *item = m_scoreboard.Find (seq);
+  return item != 0 && item->m_lost;
+}
+
+inline bool
+TcpTxBuffer::IsLostRFCIndexed (const SequenceNumber32 &seq) const
+{
+  return m_scoreboard.IsLost (seq, m_dupAckThresh, m_segmentSize);
+}
+
+} // namespace ns3
+
 #endif /* TCP_TX_BUFFER_H */
@@ -0,0 +1,577 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_TX_SCOREBOARD_H
+#define TCP_TX_SCOREBOARD_H
+
+#include <stdint.h>
+#include "ns3/sequence-number.h"
+#include "ns3/tcp-tx-item.h"
+
+/**
+ * \file
+ * \ingroup tcp
+ * ns3::TcpTxScoreboard declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Index of the sent segments of a TcpTxBuffer by sequence number
+ *
+ * The scoreboard is a treap (a binary search tree balanced by random
+ * priorities) of the TcpTxItem of the sent list, keyed by their starting
+ * sequence number. Each node keeps, for its subtree, the number of
+ * items of each Kind and the number of SACKed bytes, so that the questions
+ * asked on every ACK during a recovery take O(log n) instead of a walk of
+ * the sent list:
+ *
+ * - Find() returns the item which contains a sequence number (IsLost,
+ *   CopyFromSequence on a retransmission, the SACK blocks of Update);
+ * - IsLost() is the RFC 6675 IsLost (SeqNum) test, from the SACKed
+ *   segments and bytes above a sequence number;
+ * - GetLostBoundary() returns the highest item for which this test holds:
+ *   all the items below it which are not SACKed are lost (UpdateLostCount);
+ * - FindFirst() returns the first item of a Kind from a sequence number,
+ *   e.g. the next hole to mark lost or the segment to retransmit (NextSeg).
+ *
+ * The items stay owned by the sent list. The scoreboard reads their flags
+ * and size, so each change of m_sacked, m_lost, m_retrans or of the packet
+ * of an indexed item must be followed by Refresh(), and a change of
+ * m_startSeq by Erase() and Insert().
+ *
+ * TcpTxBuffer maintains one in scoreboard mode (TcpTxBuffer::SetScoreboardMode).
+ */
+class TcpTxScoreboard
+{
+public:
+  /**
+   * \brief Categories of items counted in each subtree
+   */
+  enum Kind
+  {
+    SACKED = 0,     //!< SACKed
+    HOLE,           //!< Neither SACKed nor lost
+    LOST,           //!< Lost, not SACKed and not retransmitted (RFC 6675 NextSeg rule 1)
+    NOT_RETRANS,    //!< Neither SACKed nor retransmitted (RFC 6675 NextSeg rule 3)
+    KIND_COUNT      //!< Number of kinds
+  };
+
+  TcpTxScoreboard ();
+  ~TcpTxScoreboard ();
+
+  /**
+   * \brief Add an item
+   *
+   * \param item the item; no other item has the same starting sequence
+   */
+  void Insert (TcpTxItem *item);
+  /**
+   * \brief Remove an item
+   *
+   * \param startSeq the starting sequence of the item
+   * \returns the item removed, or 0 if none starts at startSeq
+   */
+  TcpTxItem * Erase (const SequenceNumber32 &startSeq);
+  /**
+   * \brief Update the counters after a change of the flags or size of an item
+   *
+   * \param item the item
+   */
+  void Refresh (const TcpTxItem *item);
+  /**
+   * \brief Remove all the items
+   */
+  void Clear (void);
+
+  /**
+   * \returns the number of items
+   */
+  uint32_t GetSize (void) const;
+  /**
+   * \param kind the category
+   * \returns the number of items of the kind
+   */
+  uint32_t GetCount (Kind kind) const;
+
+  /**
+   * \param seq a sequence number
+   * \returns the item which contains seq, or 0
+   */
+  TcpTxItem * Find (const SequenceNumber32 &seq) const;
+  /**
+   * \brief Find the first item of a kind
+   *
+   * \param kind the category
+   * \param from the lowest starting sequence number to consider
+   * \returns the item with the lowest starting sequence number not below
+   *          from, or 0
+   */
+  TcpTxItem * FindFirst (Kind kind, const SequenceNumber32 &from) const;
+  /**
+   * \brief Count the SACKed items above a sequence number
+   *
+   * The item which contains seq is counted.
+   *
+   * \param seq a sequence number
+   * \param [out] count the number of SACKed items
+   * \param [out] bytes the number of SACKed bytes
+   */
+  void GetSackedAbove (const SequenceNumber32 &seq, uint32_t *count, uint64_t *bytes) const;
+  /**
+   * \brief RFC 6675 IsLost (SeqNum)
+   *
+   * \param seq a sequence number
+   * \param dupThresh the duplicate ACK threshold
+   * \param segmentSize the sender maximum segment size
+   * \returns true if dupThresh SACKed segments, or more than
+   *          (dupThresh - 1) * segmentSize SACKed bytes, are above seq
+   */
+  bool IsLost (const SequenceNumber32 &seq, uint32_t dupThresh, uint32_t segmentSize) const;
+  /**
+   * \brief Find the highest item for which IsLost holds
+   *
+   * \param dupThresh the duplicate ACK threshold
+   * \param segmentSize the sender maximum segment size
+   * \returns the item, or 0 if IsLost holds for no item
+   */
+  TcpTxItem * GetLostBoundary (uint32_t dupThresh, uint32_t segmentSize) const;
+
+private:
+  /**
+   * \brief Copy constructor
+   *
+   * Defined and unimplemented to avoid misuse
+   */
+  TcpTxScoreboard (const TcpTxScoreboard &);
+  /**
+   * \brief Copy constructor
+   *
+   * Defined and unimplemented to avoid misuse
+   * \returns
+   */
+  TcpTxScoreboard & operator= (const TcpTxScoreboard &);
+
+  /**
+   * \brief Node of the treap
+   */
+  struct Node
+  {
+    TcpTxItem *item;               //!< The item
+    SequenceNumber32 start;        //!< Starting sequence of the item
+    uint32_t priority;             //!< Heap priority
+    Node *left;                    //!< Items before
+    Node *right;                   //!< Items after
+    uint32_t size;                 //!< Number of items in the subtree
+    uint32_t counts[KIND_COUNT];   //!< Number of items of each kind in the subtree
+    uint64_t sackedBytes;          //!< SACKed bytes in the subtree
+  };
+
+  /**
+   * \param item an item
+   * \param kind a category
+   * \returns true if the item is of the kind
+   */
+  static bool IsKind (const TcpTxItem *item, Kind kind);
+  /**
+   * \brief Recompute the counters of a node from its item and children
+   * \param n the node
+   */
+  static void Pull (Node *n);
+  /**
+   * \brief Split a subtree
+   * \param n the subtree
+   * \param key the split key
+   * \param [out] l the nodes before key
+   * \param [out] r the nodes at or after key
+   */
+  static void Split (Node *n, const SequenceNumber32 &key, Node **l, Node **r);
+  /**
+   * \brief Merge two subtrees
+   * \param l the first subtree
+   * \param r the second subtree, all after l
+   * \returns the merged subtree
+   */
+  static Node * Merge (Node *l, Node *r);
+  /**
+   * \brief Update the counters on the path to a key
+   * \param n the subtree
+   * \param key the key
+   */
+  static void RefreshPath (Node *n, const SequenceNumber32 &key);
+  /**
+   * \brief FindFirst in a subtree
+   * \param n the subtree
+   * \param kind the category
+   * \param from the lowest starting sequence number
+   * \returns the node, or 0
+   */
+  static Node * FindFirst (Node *n, Kind kind, const SequenceNumber32 &from);
+  /**
+   * \brief Delete a subtree
+   * \param n the subtree
+   */
+  static void Delete (Node *n);
+  /**
+   * \returns the next random priority
+   */
+  uint32_t NextPriority (void);
+
+  Node *m_root;    //!< Root of the treap
+  uint32_t m_seed; //!< State of the priority generator
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+TcpTxScoreboard::TcpTxScoreboard ()
+  : m_root (0),
+    m_seed (2463534242U)
+{
+}
+
+inline
+TcpTxScoreboard::~TcpTxScoreboard ()
+{
+  Clear ();
+}
+
+inline uint32_t
+TcpTxScoreboard::NextPriority (void)
+{
+  // xorshift32: the priorities only balance the tree, they must not
+  // draw from the simulation random streams.
+  m_seed ^= m_seed << 13;
+  m_seed ^= m_seed >> 17;
+  m_seed ^= m_seed << 5;
+  return m_seed;
+}
+
+inline bool
+TcpTxScoreboard::IsKind (const TcpTxItem *item, Kind kind)
+{
+  switch (kind)
+    {
+    case SACKED:
+      return item->m_sacked;
+    case HOLE:
+      return !item->m_sacked && !item->m_lost;
+    case LOST:
+      return !item->m_sacked && !item->m_retrans && item->m_lost;
+    case NOT_RETRANS:
+      return !item->m_sacked && !item->m_retrans;
+    default:
+      return false;
+    }
+}
+
+inline void
+TcpTxScoreboard::Pull (Node *n)
+{
+  n->size = 1;
+  n->sackedBytes = n->item->m_sacked ? n->item->GetSeqSize () : 0;
+  for (int k = 0; k < KIND_COUNT; ++k)
+    {
+      n->counts[k] = IsKind (n->item, static_cast<Kind> (k)) ? 1 : 0;
+    }
+  Node *children[2] = { n->left, n->right };
+  for (int c = 0; c < 2; ++c)
+    {
+      if (children[c] != 0)
+        {
+          n->size += children[c]->size;
+          n->sackedBytes += children[c]->sackedBytes;
+          for (int k = 0; k < KIND_COUNT; ++k)
+            {
+              n->counts[k] += children[c]->counts[k];
+            }
+        }
+    }
+}
+
+inline void
+TcpTxScoreboard::Split (Node *n, const SequenceNumber32 &key, Node **l, Node **r)
+{
+  if (n == 0)
+    {
+      *l = 0;
+      *r = 0;
+    }
+  else if (n->start < key)
+    {
+      Split (n->right, key, &n->right, r);
+      *l = n;
+      Pull (n);
+    }
+  else
+    {
+      Split (n->left, key, l, &n->left);
+      *r = n;
+      Pull (n);
+    }
+}
+
+inline TcpTxScoreboard::Node *
+TcpTxScoreboard::Merge (Node *l, Node *r)
+{
+  if (l == 0)
+    {
+      return r;
+    }
+  if (r == 0)
+    {
+      return l;
+    }
+  if (l->priority > r->priority)
+    {
+      l->right = Merge (l->right, r);
+      Pull (l);
+      return l;
+    }
+  r->left = Merge (l, r->left);
+  Pull (r);
+  return r;
+}
+
+inline void
+TcpTxScoreboard::Insert (TcpTxItem *item)
+{
+  Node *n = new Node;
+  n->item = item;
+  n->start = item->m_startSeq;
+  n->priority = NextPriority ();
+  n->left = 0;
+  n->right = 0;
+  Pull (n);
+
+  Node *l, *r;
+  Split (m_root, n->start, &l, &r);
+  m_root = Merge (Merge (l, n), r);
+}
+
+inline TcpTxItem *
+TcpTxScoreboard::Erase (const SequenceNumber32 &startSeq)
+{
+  Node *l, *m, *r;
+  Split (m_root, startSeq, &l, &r);
+  Split (r, startSeq + 1, &m, &r);
+  m_root = Merge (l, r);
+  if (m == 0)
+    {
+      return 0;
+    }
+  TcpTxItem *item = m->item;
+  delete m;
+  return item;
+}
+
+inline void
+TcpTxScoreboard::RefreshPath (Node *n, const SequenceNumber32 &key)
+{
+  if (n == 0)
+    {
+      return;
+    }
+  if (key < n->start)
+    {
+      RefreshPath (n->left, key);
+    }
+  else if (n->start < key)
+    {
+      RefreshPath (n->right, key);
+    }
+  Pull (n);
+}
+
+inline void
+TcpTxScoreboard::Refresh (const TcpTxItem *item)
+{
+  RefreshPath (m_root, item->m_startSeq);
+}
+
+inline void
+TcpTxScoreboard::Delete (Node *n)
+{
+  if (n != 0)
+    {
+      Delete (n->left);
+      Delete (n->right);
+      delete n;
+    }
+}
+
+inline void
+TcpTxScoreboard::Clear (void)
+{
+  Delete (m_root);
+  m_root = 0;
+}
+
+inline uint32_t
+TcpTxScoreboard::GetSize (void) const
+{
+  return m_root != 0 ? m_root->size : 0;
+}
+
+inline uint32_t
+TcpTxScoreboard::GetCount (Kind kind) const
+{
+  return m_root != 0 ? m_root->counts[kind] : 0;
+}
+
+inline TcpTxItem *
+TcpTxScoreboard::Find (const SequenceNumber32 &seq) const
+{
+  // The last item which starts at or before seq
+  Node *candidate = 0;
+  for (Node *n = m_root; n != 0; )
+    {
+      if (n->start <= seq)
+        {
+          candidate = n;
+          n = n->right;
+        }
+      else
+        {
+          n = n->left;
+        }
+    }
+  if (candidate == 0 || seq >= candidate->start + candidate->item->GetSeqSize ())
+    {
+      return 0;
+    }
+  return candidate->item;
+}
+
+inline TcpTxScoreboard::Node *
+TcpTxScoreboard::FindFirst (Node *n, Kind kind, const SequenceNumber32 &from)
+{
+  if (n == 0 || n->counts[kind] == 0)
+    {
+      return 0;
+    }
+  if (n->start < from)
+    {
+      return FindFirst (n->right, kind, from);
+    }
+  Node *found = FindFirst (n->left, kind, from);
+  if (found != 0)
+    {
+      return found;
+    }
+  if (IsKind (n->item, kind))
+    {
+      return n;
+    }
+  return FindFirst (n->right, kind, from);
+}
+
+inline TcpTxItem *
+TcpTxScoreboard::FindFirst (Kind kind, const SequenceNumber32 &from) const
+{
+  Node *n = FindFirst (m_root, kind, from);
+  return n != 0 ? n->item : 0;
+}
+
+inline void
+TcpTxScoreboard::GetSackedAbove (const SequenceNumber32 &seq, uint32_t *count, uint64_t *bytes) const
+{
+  *count = 0;
+  *bytes = 0;
+  for (Node *n = m_root; n != 0; )
+    {
+      // The items are disjoint, so "ends after seq" is monotone in the key
+      if (n->start + n->item->GetSeqSize () > seq)
+        {
+          if (n->item->m_sacked)
+            {
+              ++*count;
+              *bytes += n->item->GetSeqSize ();
+            }
+          if (n->right != 0)
+            {
+              *count += n->right->counts[SACKED];
+              *bytes += n->right->sackedBytes;
+            }
+          n = n->left;
+        }
+      else
+        {
+          n = n->right;
+        }
+    }
+}
+
+inline bool
+TcpTxScoreboard::IsLost (const SequenceNumber32 &seq, uint32_t dupThresh, uint32_t segmentSize) const
+{
+  uint32_t count;
+  uint64_t bytes;
+  GetSackedAbove (seq, &count, &bytes);
+  return count >= dupThresh
+         || bytes > static_cast<uint64_t> (dupThresh - 1) * segmentSize;
+}
+
+inline TcpTxItem *
+TcpTxScoreboard::GetLostBoundary (uint32_t dupThresh, uint32_t segmentSize) const
+{
+  uint64_t maxBytes = static_cast<uint64_t> (dupThresh - 1) * segmentSize;
+  // SACKed items and bytes of the items after the current subtree
+  uint32_t count = 0;
+  uint64_t bytes = 0;
+  Node *n = m_root;
+  while (n != 0)
+    {
+      uint32_t rightCount = count;
+      uint64_t rightBytes = bytes;
+      if (n->right != 0)
+        {
+          rightCount += n->right->counts[SACKED];
+          rightBytes += n->right->sackedBytes;
+        }
+      if (rightCount >= dupThresh || rightBytes > maxBytes)
+        {
+          n = n->right;
+          continue;
+        }
+      if (n->item->m_sacked)
+        {
+          ++rightCount;
+          rightBytes += n->item->GetSeqSize ();
+        }
+      if (rightCount >= dupThresh || rightBytes > maxBytes)
+        {
+          return n->item;
+        }
+      count = rightCount;
+      bytes = rightBytes;
+      n = n->left;
+    }
+  return 0;
+}
+
+} // namespace ns3
+
+#endif /* TCP_TX_SCOREBOARD_H */
@@ -0,0 +1,230 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TOMBSTONE_TRACKER_H
+#define TOMBSTONE_TRACKER_H
+
+#include "scheduler.h"
+#include "event-impl.h"
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::TombstoneTracker declaration and inline implementation.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief Lazy deletion bookkeeping for the event list of a simulator.
+ *
+ * Timers such as the TCP retransmission timeout or the Wi-Fi ACK
+ * timeout are cancelled and rescheduled all the time. Removing each
+ * cancelled event from the Scheduler costs a search (O(n) in the
+ * ListScheduler, the HeapScheduler and the CalendarScheduler); leaving
+ * it in place costs nothing at cancellation time, but the dead event
+ * keeps weighing on every Insert and RemoveNext until it reaches the
+ * head of the list.
+ *
+ * In lazy deletion mode, a simulator only marks the cancelled events
+ * and reports them to this tracker with NotifyCancel(). When the
+ * tombstones exceed both a minimum count and a fraction of the event
+ * list, the list is compacted with Scheduler::RemoveCancelled(), which
+ * removes all of them in one pass.
+ *
+ * The simulator must also report every Insert and RemoveNext, so that
+ * the tracker knows the size of the list.
+ */
+class TombstoneTracker
+{
+public:
+  /** Lazy deletion counters. */
+  struct Stats
+  {
+    uint32_t events;      /**< Number of events in the list, tombstones included. */
+    uint32_t tombstones;  /**< Number of cancelled events still in the list. */
+    uint64_t cancelled;   /**< Number of events cancelled while in the list. */
+    uint64_t expired;     /**< Number of tombstones which reached the head of the list. */
+    uint64_t compactions; /**< Number of compactions. */
+    uint64_t compacted;   /**< Number of tombstones removed by the compactions. */
+  };
+
+  /** Constructor: compaction at 50% tombstones, and at least 1024 of them. */
+  TombstoneTracker ();
+
+  /**
+   * Set the compaction threshold.
+   *
+   * \param [in] ratio The fraction of tombstones in the list above which
+   * it is compacted; 0 disables compaction.
+   * \param [in] minimum The minimum number of tombstones for a compaction.
+   */
+  void SetCompaction (double ratio, uint32_t minimum);
+  /** Record the insertion of an event in the list. */
+  void NotifyInsert (void);
+  /**
+   * Record the removal of an event from the head of the list.
+   *
+   * \param [in] ev The event removed.
+   */
+  void NotifyRemoveNext (const Scheduler::Event &ev);
+  /** Record the removal of an event from the list with Scheduler::Remove. */
+  void NotifyRemove (void);
+  /**
+   * Record the cancellation of an event still held by the list, and
+   * compact the list if the compaction threshold is exceeded.
+   *
+   * \param [in] events The event list.
+   * \returns \c true if the list was compacted.
+   */
+  bool NotifyCancel (Scheduler *events);
+  /**
+   * Remove all the tombstones from the list.
+   *
+   * \param [in] events The event list.
+   */
+  void Compact (Scheduler *events);
+  /** Forget the content of the list, after it was emptied; the counters are kept. */
+  void Clear (void);
+  /**
+   * Get the counters.
+   *
+   * \returns The counters.
+   */
+  Stats GetStats (void) const;
+  /**
+   * Get the fraction of the list made of tombstones.
+   *
+   * \returns The tombstone ratio.
+   */
+  double GetRatio (void) const;
+
+private:
+  /** Compaction threshold, as a fraction of the list size. */
+  double m_ratio;
+  /** Minimum number of tombstones for a compaction. */
+  uint32_t m_minimum;
+  /** The counters. */
+  Stats m_stats;
+};
+
+} // namespace ns3
+
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline
+TombstoneTracker::TombstoneTracker ()
+  : m_ratio (0.5),
+    m_minimum (1024)
+{
+  m_stats.events = 0;
+  m_stats.tombstones = 0;
+  m_stats.cancelled = 0;
+  m_stats.expired = 0;
+  m_stats.compactions = 0;
+  m_stats.compacted = 0;
+}
+
+inline void
+TombstoneTracker::SetCompaction (double ratio, uint32_t minimum)
+{
+  m_ratio = ratio;
+  m_minimum = minimum;
+}
+
+inline void
+TombstoneTracker::NotifyInsert (void)
+{
+  m_stats.events++;
+}
+
+inline void
+TombstoneTracker::NotifyRemoveNext (const Scheduler::Event &ev)
+{
+  m_stats.events--;
+  // Events cancelled without NotifyCancel, e.g. by EventId::Cancel
+  // on an expired id, are not counted as tombstones.
+  if (ev.impl->IsCancelled () && m_stats.tombstones > 0)
+    {
+      m_stats.tombstones--;
+      m_stats.expired++;
+    }
+}
+
+inline void
+TombstoneTracker::NotifyRemove (void)
+{
+  m_stats.events--;
+}
+
+inline bool
+TombstoneTracker::NotifyCancel (Scheduler *events)
+{
+  m_stats.tombstones++;
+  m_stats.cancelled++;
+  if (m_ratio > 0
+      && m_stats.tombstones >= m_minimum
+      && m_stats.tombstones > m_ratio * m_stats.events)
+    {
+      Compact (events);
+      return true;
+    }
+  return false;
+}
+
+inline void
+TombstoneTracker::Compact (Scheduler *events)
+{
+  uint32_t removed = events->RemoveCancelled ();
+  m_stats.events -= removed;
+  m_stats.tombstones = 0;
+  m_stats.compactions++;
+  m_stats.compacted += removed;
+}
+
+inline void
+TombstoneTracker::Clear (void)
+{
+  m_stats.events = 0;
+  m_stats.tombstones = 0;
+}
+
+inline TombstoneTracker::Stats
+TombstoneTracker::GetStats (void) const
+{
+  return m_stats;
+}
+
+inline double
+TombstoneTracker::GetRatio (void) const
+{
+  if (m_stats.events == 0)
+    {
+      return 0;
+    }
+  return static_cast<double> (m_stats.tombstones) / m_stats.events;
+}
+
+} // namespace ns3
+
+#endif /* TOMBSTONE_TRACKER_H */
@@ -27,6 +27,7 @@
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -65,6 +66,18 @@ public:
    */
   void SetRemote (Address addr);
 
+  /**
+   * \brief Set the number of packets given to the socket per call.
+   *
+   * With a batch size n greater than one, the client hands n packets
+   * to Socket::SendBatch every n intervals instead of one packet to
+   * Socket::Send every interval. The default, one, sends the packets
+   * one at a time.
+   *
+   * \param batchSize the number of packets per call
+   */
+  void SetBatchSize (uint32_t batchSize);
+
 protected:
   virtual void DoDispose (void);
 
@@ -77,6 +90,13 @@ private:
    * \brief Send a packet
    */
   void Send (void);
+  /**
+   * \brief Send a batch of up to m_batchSize packets, and schedule
+   * the next batch
+   *
+   * Scheduled instead of Send when m_batchSize is greater than one.
+   */
+  void SendBatch (void);
 
   uint32_t m_count; //!< Maximum number of packets the application will send
   Time m_interval; //!< Packet inter-send time
@@ -87,9 +107,59 @@ private:
   Address m_peerAddress; //!< Remote peer address
   uint16_t m_peerPort; //!< Remote peer port
   EventId m_sendEvent; //!< Event to send the next packet
+  uint32_t m_batchSize {1}; //!< Number of packets per Socket::SendBatch call
 
 };
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+#include "ns3/assert.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/seq-ts-header.h"
+
+namespace ns3 {
+
+inline void
+UdpClient::SetBatchSize (uint32_t batchSize)
+{
+  NS_ASSERT (batchSize > 0);
+  m_batchSize = batchSize;
+}
+
+inline void
+UdpClient::SendBatch (void)
+{
+  NS_ASSERT (m_sendEvent.IsExpired ());
+  std::vector<Ptr<Packet> > batch;
+  for (uint32_t i = 0; i < m_batchSize && m_sent + i < m_count; i++)
+    {
+      SeqTsHeader seqTs;
+      seqTs.SetSeq (m_sent + i);
+      Ptr<Packet> p = Create<Packet> (m_size-(8+4)); // 8+4 : the size of the seqTs header
+      p->AddHeader (seqTs);
+      batch.push_back (p);
+    }
+  int sent = m_socket->SendBatch (batch);
+  if (sent > 0)
+    {
+      // The packets refused are sent again, with the same sequence
+      // numbers, with the next batch.
+      m_sent += sent;
+    }
+  if (m_sent < m_count)
+    {
+      m_sendEvent = Simulator::Schedule (m_interval * static_cast<int64_t> (batch.size ()),
+                                         &UdpClient::SendBatch, this);
+    }
+}
+
+} // namespace ns3
+
 #endif /* UDP_CLIENT_H */
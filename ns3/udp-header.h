@@ -26,6 +26,7 @@
 #include "ns3/header.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
+#include "ns3/fixed-size-header.h"
 
 namespace ns3 {
 /**
@@ -166,6 +167,26 @@ public:
    */
   uint16_t GetChecksum ();
 
+  /** Size of the header, for Packet::AddHeader. */
+  static const uint32_t FIXED_SIZE = 8;
+  /**
+   * Serialize the header for Packet::AddHeader.
+   *
+   * \param [out] buffer The FIXED_SIZE bytes to write.
+   * \param [in] size The size of the packet.
+   * \returns false if the checksum must be calculated over the payload.
+   */
+  bool SerializeFixed (uint8_t *buffer, uint32_t size) const;
+  /**
+   * Deserialize the header for Packet::RemoveHeader.
+   *
+   * \param [in] buffer The FIXED_SIZE bytes to read.
+   * \param [in] size The size of the packet.
+   * \returns FIXED_SIZE, or 0 if the checksum must be verified over the
+   *          payload.
+   */
+  uint32_t DeserializeFixed (uint8_t const *buffer, uint32_t size);
+
 private:
   /**
    * \brief Calculate the header checksum
@@ -187,4 +208,42 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+inline bool
+UdpHeader::SerializeFixed (uint8_t *buffer, uint32_t size) const
+{
+  if (m_checksum == 0 && m_calcChecksum)
+    {
+      return false;
+    }
+  FixedSizeHeader::WriteHtonU16 (buffer, m_sourcePort);
+  FixedSizeHeader::WriteHtonU16 (buffer + 2, m_destinationPort);
+  FixedSizeHeader::WriteHtonU16 (buffer + 4, m_payloadSize == 0 ? size : m_payloadSize);
+  FixedSizeHeader::WriteU16 (buffer + 6, m_checksum);
+  return true;
+}
+
+inline uint32_t
+UdpHeader::DeserializeFixed (uint8_t const *buffer, uint32_t size)
+{
+  NS_UNUSED (size);
+  if (m_calcChecksum)
+    {
+      return 0;
+    }
+  m_sourcePort = FixedSizeHeader::ReadNtohU16 (buffer);
+  m_destinationPort = FixedSizeHeader::ReadNtohU16 (buffer + 2);
+  m_payloadSize = FixedSizeHeader::ReadNtohU16 (buffer + 4);
+  m_checksum = FixedSizeHeader::ReadU16 (buffer + 6);
+  return FIXED_SIZE;
+}
+
+} // namespace ns3
+
 #endif /* UDP_HEADER */
@@ -197,6 +197,24 @@ public:
   void Send (Ptr<Packet> packet,
              Ipv4Address saddr, Ipv4Address daddr, 
              uint16_t sport, uint16_t dport, Ptr<Ipv4Route> route);
+  /**
+   * \brief Send several packets of one flow via UDP (IPv4)
+   *
+   * Equivalent to calling Send (packet, saddr, daddr, sport, dport, route)
+   * for each packet, but the UDP header and its pseudo-header checksum
+   * are built once for the batch; the route is looked up once by the
+   * caller.
+   *
+   * \param packets The packets to send, in order
+   * \param saddr The source Ipv4Address
+   * \param daddr The destination Ipv4Address
+   * \param sport The source port number
+   * \param dport The destination port number
+   * \param route The route
+   */
+  void SendBatch (const std::vector<Ptr<Packet> > &packets,
+                  Ipv4Address saddr, Ipv4Address daddr,
+                  uint16_t sport, uint16_t dport, Ptr<Ipv4Route> route);
   /**
    * \brief Send a packet via UDP (IPv6)
    * \param packet The packet to send
@@ -279,4 +297,37 @@ private:
 
 } // namespace ns3
 
+
+/********************************************************************
+ *  Implementation of the inline methods declared above.
+ ********************************************************************/
+
+#include "ns3/node.h"
+#include "ns3/udp-header.h"
+#include "ns3/ipv4-route.h"
+
+namespace ns3 {
+
+inline void
+UdpL4Protocol::SendBatch (const std::vector<Ptr<Packet> > &packets,
+                          Ipv4Address saddr, Ipv4Address daddr,
+                          uint16_t sport, uint16_t dport, Ptr<Ipv4Route> route)
+{
+  UdpHeader udpHeader;
+  if (Node::ChecksumEnabled ())
+    {
+      udpHeader.EnableChecksums ();
+      udpHeader.InitializeChecksum (saddr, daddr, PROT_NUMBER);
+    }
+  udpHeader.SetDestinationPort (dport);
+  udpHeader.SetSourcePort (sport);
+  for (std::vector<Ptr<Packet> >::const_iterator i = packets.begin (); i != packets.end (); ++i)
+    {
+      (*i)->AddHeader (udpHeader);
+      m_downTarget (*i, saddr, daddr, PROT_NUMBER, route);
+    }
+}
+
+} // namespace ns3
+
 #endif /* UDP_L4_PROTOCOL_H */
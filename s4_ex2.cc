@@ -89,7 +89,7 @@ MyApp::StopApplication(void)
 void
 MyApp::SendPacket(void)
 {
-	Ptr<Packet> packet = Create<Packet>(m_packetSize);
+	Ptr<Packet> packet = PacketPool::Create(m_packetSize);
 	m_socket->Send(packet);
 
 	if (++m_packetsSent < m_nPackets)
@@ -181,6 +181,11 @@ main(int argc, char *argv[]) {
 
 	Simulator::Stop(Seconds(20));
 	Simulator::Run();
+	if (PacketPool::IsEnabled())
+	{
+		PacketPool::PrintStats(std::cout);
+		std::cout << std::endl;
+	}
 	Simulator::Destroy();
 	return 0;
 }
\ No newline at end of file
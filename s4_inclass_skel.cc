@@ -91,7 +91,7 @@ MyApp::StopApplication(void)
 void
 MyApp::SendPacket(void)
 {
-	Ptr<Packet> packet = Create<Packet>(m_packetSize);
+	Ptr<Packet> packet = PacketPool::Create(m_packetSize);
 	m_socket->Send(packet);
 
 	if (++m_packetsSent < m_nPackets)